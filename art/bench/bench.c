@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include "art_ext.h"
+#include "bintree_ext.h"
+#include "logger.h"
+
+/*
+ * art benchmark
+ *
+ * Usage: art_bench [n]
+ *
+ * n keys in three distributions, each loaded into the radix tree, an AVL
+ * bintree and a plain bintree:
+ *
+ *   dense       0..n-1 in random order
+ *   sparse      n distinct keys spread over all 32 bits, random order
+ *   sequential  0..n-1 ascending (too slow for the plain tree, skipped)
+ *
+ * Reports insert, hit and miss search (in random order), full in-order
+ * scan and heap in use.
+ */
+
+#define BENCH_SPREAD 2654435761u    /* odd, so i * BENCH_SPREAD is 1:1 */
+
+typedef enum bench_dist_ {
+    benchDense,
+    benchSparse,
+    benchSequential
+} bench_dist_e;
+
+static const char *dist_names[] = {"dense", "sparse", "sequential"};
+
+static double
+bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_shuffle(int *keys, long n, unsigned int seed)
+{
+    long i = 0;
+
+    for (i = n - 1; i > 0; i--) {
+        long j = ((long)rand_r(&seed) << 15 ^ rand_r(&seed)) % (i + 1);
+        int tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+/* the i-th key of a distribution; i in [n, 2n) gives keys not loaded */
+static inline int
+bench_key(bench_dist_e dist, long i)
+{
+    return (benchSparse == dist) ? (int)((unsigned int)i * BENCH_SPREAD) : (int)i;
+}
+
+static int
+_bench_sum(int data, void *ctx)
+{
+    *(long*)ctx += data;
+    return 0;
+}
+
+static void
+_bench_run(const char *label, int mode, bench_dist_e dist, long n)
+{
+    int *load = (int*)malloc(n * sizeof(int));
+    int *probe = (int*)malloc(n * sizeof(int));
+    ArtPtr a = NULL;
+    BintreePtr b = NULL;
+    struct mallinfo2 mi;
+    size_t heap = 0;
+    long i = 0, hits = 0, sum = 0;
+    double t0, t1, t2, t3, t4;
+
+    /* probe holds indices, so misses can use the same random order */
+    for (i = 0; i < n; i++) {
+        load[i] = bench_key(dist, i);
+        probe[i] = (int)i;
+    }
+    if (benchSequential != dist) {
+        bench_shuffle(load, n, 7);
+    }
+    bench_shuffle(probe, n, 8);
+
+    mi = mallinfo2();
+    heap = mi.uordblks + mi.hblkhd;
+    t0 = bench_now();
+    if (mode < 0) {
+        a = art_create(label);
+        for (i = 0; i < n; i++) {
+            art_insert(a, load[i]);
+        }
+    } else {
+        b = bintree_create_mode(label, (bintree_mode_e)mode);
+        for (i = 0; i < n; i++) {
+            bintree_insert(b, load[i]);
+        }
+    }
+    t1 = bench_now();
+    mi = mallinfo2();
+    heap = mi.uordblks + mi.hblkhd - heap;
+
+    for (i = 0; i < n; i++) {
+        int k = bench_key(dist, probe[i]);
+        hits += a ? art_search(a, k) : bintree_search(b, k);
+    }
+    t2 = bench_now();
+    for (i = 0; i < n; i++) {
+        int k = bench_key(dist, n + probe[i]);
+        hits += a ? art_search(a, k) : bintree_search(b, k);
+    }
+    t3 = bench_now();
+    if (a) {
+        art_range_foreach(a, -2147483647 - 1, 2147483647, _bench_sum, &sum);
+    } else {
+        bintree_inorder_foreach(b, _bench_sum, &sum);
+    }
+    t4 = bench_now();
+
+    printf("%-10s %-10s insert %6.1f ns  hit %6.1f ns  miss %6.1f ns  "
+           "scan %5.1f ns/key  %5.1f B/key  (hits %li)\n",
+           dist_names[dist], label, (t1 - t0) / n * 1e9, (t2 - t1) / n * 1e9,
+           (t3 - t2) / n * 1e9, (t4 - t3) / n * 1e9, (double)heap / n, hits);
+
+    if (a) {
+        art_destroy(a);
+    } else {
+        bintree_destroy(b);
+    }
+    free(load);
+    free(probe);
+}
+
+int
+main(int argc, char *argv[])
+{
+    long n = (argc > 1) ? atol(argv[1]) : 1000000;
+    int d = 0;
+
+    /* per-node tracing would dominate every measurement */
+    logger_set_level(dbgErr);
+
+    for (d = benchDense; d <= benchSequential; d++) {
+        printf("=== n=%li, %s keys\n", n, dist_names[d]);
+        _bench_run("art", -1, d, n);
+        _bench_run("avl", bintreeAvl, d, n);
+        if (benchSequential != d) {
+            _bench_run("plain", bintreePlain, d, n);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#ifndef __ART_EXT_H__
+#define __ART_EXT_H__
+
+typedef struct art_s* ArtPtr;
+
+/*
+ * Ordered set of ints as an adaptive radix tree: one byte of the key per
+ * level, inner nodes sized to their fan-out (4, 16, 48 or 256 children).
+ * Lookups cost at most four node visits whatever the number of keys, and
+ * compare bytes rather than whole keys.  Not thread safe.
+ */
+
+/* Public APIs */
+ArtPtr art_create(const char *name);
+void art_destroy(ArtPtr artp);
+
+int  art_insert(ArtPtr artp, int data);
+int  art_remove(ArtPtr artp, int data);
+int  art_search(ArtPtr artp, int data);
+int  art_count(ArtPtr artp);
+int  art_minvalue(ArtPtr artp);
+int  art_maxvalue(ArtPtr artp);
+int  art_range_foreach(ArtPtr artp, int lo, int hi,
+                       int (*fn)(int data, void *ctx), void *ctx);
+
+#endif /* __ART_EXT_H__ */
@@ -0,0 +1,76 @@
+#ifndef __ART_INT_H__
+#define __ART_INT_H__
+
+#include <stdint.h>
+#include "art_ext.h"
+
+#define ART_MAGIC_IN_USE 0x1242
+#define ART_MAGIC_FREED  0x1243
+
+#define ART_MAX_NAME_LEN 80
+#define ART_KEY_LEN      4          /* bytes in a key, most significant first */
+
+/*
+ * Child references.  A subtree holding a single key is not a node but
+ * the key itself, tagged in the low bit of the pointer; the key needs 33
+ * bits, so this layout is for 64-bit builds only.
+ */
+typedef void* art_ref_t;
+
+#define ART_IS_LEAF(_r_)   ((uintptr_t)(_r_) & 1)
+#define ART_LEAF(_k_)      ((art_ref_t)(((uintptr_t)(_k_) << 1) | 1))
+#define ART_LEAF_KEY(_r_)  ((uint32_t)((uintptr_t)(_r_) >> 1))
+
+typedef enum art_type_ {
+    artNode4,
+    artNode16,
+    artNode48,
+    artNode256
+} art_type_e;
+
+/*
+ * Inner node header.  prefix holds the key bytes every key below shares
+ * between the parent's branch byte and this node's; with 4-byte keys
+ * that is at most 3, so the prefix is always stored in full.
+ */
+typedef struct art_node_s {
+    uint8_t type;
+    uint8_t plen;
+    uint16_t nchild;
+    uint8_t prefix[ART_KEY_LEN - 1];
+} art_node_t;
+
+/* keys[] sorted, child[i] goes with keys[i] */
+typedef struct art_node4_s {
+    art_node_t hdr;
+    uint8_t keys[4];
+    art_ref_t child[4];
+} art_node4_t;
+
+typedef struct art_node16_s {
+    art_node_t hdr;
+    uint8_t keys[16];
+    art_ref_t child[16];
+} art_node16_t;
+
+/* index[byte] is 1 + the slot in child[], 0 if absent */
+typedef struct art_node48_s {
+    art_node_t hdr;
+    uint8_t index[256];
+    art_ref_t child[48];
+} art_node48_t;
+
+typedef struct art_node256_s {
+    art_node_t hdr;
+    art_ref_t child[256];
+} art_node256_t;
+
+/* Public set */
+typedef struct art_s {
+    int magic;
+    char name[ART_MAX_NAME_LEN];
+    int count;
+    art_ref_t root;
+} art_t;
+
+#endif /* __ART_INT_H__ */
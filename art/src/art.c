@@ -0,0 +1,883 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "art_ext.h"
+#include "art_int.h"
+#include "logger.h"
+
+/*
+ * Adaptive radix tree for int keys (Leis et al., ICDE 2013)
+ *
+ * Keys are mapped to unsigned with the sign bit flipped, so byte order
+ * is numeric order, and consumed most significant byte first.  Each
+ * inner node picks the smallest layout for its fan-out:
+ *
+ *   Node4    up to 4 children, sorted key bytes, linear scan
+ *   Node16   up to 16, sorted key bytes, one SSE2 compare finds the slot
+ *   Node48   256-byte index into 48 child slots
+ *   Node256  direct array
+ *
+ * growing when full and shrinking, with some hysteresis, when sparse.
+ * A subtree with one key is stored as a tagged leaf (lazy expansion)
+ * and a chain of single-child nodes collapses into its lowest node's
+ * prefix (path compression), so every inner node branches.
+ *
+ * Recursion is bounded by the key length: at most four levels.
+ */
+
+#define MAGIC_IN_USE_CHECK(_mag_) \
+    if (ART_MAGIC_IN_USE != _mag_) { \
+        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
+                ART_MAGIC_IN_USE, _mag_); \
+        goto out; \
+    } \
+
+_Static_assert(sizeof(uintptr_t) >= 8, "tagged ART leaves need 64-bit pointers");
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Map an int to its radix key, unsigned with the same order
+ *
+ * @param data (i) key
+ * @return radix key
+ */
+static inline uint32_t
+_art_key(int data)
+{
+    return (uint32_t)data ^ 0x80000000u;
+}
+
+/**
+ * Inverse of _art_key
+ *
+ * @param key (i) radix key
+ * @return int key
+ */
+static inline int
+_art_data(uint32_t key)
+{
+    return (int)(key ^ 0x80000000u);
+}
+
+/**
+ * Byte of a radix key consumed at a depth
+ *
+ * @param key   (i) radix key
+ * @param depth (i) 0 for the most significant byte
+ * @return key byte
+ */
+static inline uint8_t
+_art_byte(uint32_t key, int depth)
+{
+    return (uint8_t)(key >> (8 * (ART_KEY_LEN - 1 - depth)));
+}
+
+/**
+ * Alloc an empty inner node
+ *
+ * @param type (i) node layout
+ * @return art_node_t*
+ */
+static art_node_t*
+_art_node_alloc(art_type_e type)
+{
+    static const size_t sizes[] = {sizeof(art_node4_t), sizeof(art_node16_t),
+                                   sizeof(art_node48_t), sizeof(art_node256_t)};
+    art_node_t *node = (art_node_t*)calloc(1, sizes[type]);
+    assert(NULL != node);
+
+    node->type = type;
+    return node;
+}
+
+/**
+ * Copy a header into a node of another layout, keeping its type
+ *
+ * @param dst (o) new node
+ * @param src (i) node it replaces
+ * @return void
+ */
+static void
+_art_copy_header(art_node_t *dst, const art_node_t *src)
+{
+    dst->plen = src->plen;
+    dst->nchild = src->nchild;
+    memcpy(dst->prefix, src->prefix, sizeof(dst->prefix));
+}
+
+/**
+ * Find the slot of the child for a key byte
+ *
+ * @param node (i) inner node
+ * @param c    (i) key byte
+ * @return child slot, NULL if there is no such child
+ */
+static art_ref_t*
+_art_find_child(art_node_t *node, uint8_t c)
+{
+    int i = 0;
+
+    switch (node->type) {
+    case artNode4: {
+        art_node4_t *n = (art_node4_t*)node;
+        for (i = 0; i < node->nchild; i++) {
+            if (n->keys[i] == c) {
+                return &n->child[i];
+            }
+        }
+        return NULL;
+    }
+    case artNode16: {
+        art_node16_t *n = (art_node16_t*)node;
+#ifdef __SSE2__
+        __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char)c),
+                                     _mm_loadu_si128((const __m128i*)n->keys));
+        int mask = _mm_movemask_epi8(cmp) & ((1 << node->nchild) - 1);
+        return (0 != mask) ? &n->child[__builtin_ctz(mask)] : NULL;
+#else
+        for (i = 0; i < node->nchild; i++) {
+            if (n->keys[i] == c) {
+                return &n->child[i];
+            }
+        }
+        return NULL;
+#endif
+    }
+    case artNode48: {
+        art_node48_t *n = (art_node48_t*)node;
+        return (0 != n->index[c]) ? &n->child[n->index[c] - 1] : NULL;
+    }
+    default: {
+        art_node256_t *n = (art_node256_t*)node;
+        return (NULL != n->child[c]) ? &n->child[c] : NULL;
+    }
+    }
+}
+
+/**
+ * Insert a child into a sorted Node4/Node16 key array with room left
+ *
+ * @param keys   (i/o) sorted key bytes
+ * @param child  (i/o) children
+ * @param nchild (i) children before the insert
+ * @param c      (i) key byte
+ * @param ref    (i) child
+ * @return void
+ */
+static void
+_art_sorted_insert(uint8_t *keys, art_ref_t *child, int nchild, uint8_t c,
+                   art_ref_t ref)
+{
+    int pos = 0;
+
+    while (pos < nchild && keys[pos] < c) {
+        pos++;
+    }
+    memmove(&keys[pos + 1], &keys[pos], nchild - pos);
+    memmove(&child[pos + 1], &child[pos], (nchild - pos) * sizeof(child[0]));
+    keys[pos] = c;
+    child[pos] = ref;
+}
+
+/**
+ * Add a child for a new key byte, growing the node into the next layout
+ * when it is full
+ *
+ * @param slot (i/o) where the node hangs, updated if it grows
+ * @param c    (i) key byte, not already present
+ * @param ref  (i) child
+ * @return void
+ */
+static void
+_art_add_child(art_ref_t *slot, uint8_t c, art_ref_t ref)
+{
+    art_node_t *node = (art_node_t*)*slot;
+    art_node_t *grown = NULL;
+    int i = 0;
+
+    switch (node->type) {
+    case artNode4: {
+        art_node4_t *n = (art_node4_t*)node;
+        if (node->nchild < 4) {
+            _art_sorted_insert(n->keys, n->child, node->nchild++, c, ref);
+            return;
+        }
+        art_node16_t *g = (art_node16_t*)(grown = _art_node_alloc(artNode16));
+        memcpy(g->keys, n->keys, 4);
+        memcpy(g->child, n->child, 4 * sizeof(n->child[0]));
+        break;
+    }
+    case artNode16: {
+        art_node16_t *n = (art_node16_t*)node;
+        if (node->nchild < 16) {
+            _art_sorted_insert(n->keys, n->child, node->nchild++, c, ref);
+            return;
+        }
+        art_node48_t *g = (art_node48_t*)(grown = _art_node_alloc(artNode48));
+        for (i = 0; i < 16; i++) {
+            g->index[n->keys[i]] = i + 1;
+            g->child[i] = n->child[i];
+        }
+        break;
+    }
+    case artNode48: {
+        art_node48_t *n = (art_node48_t*)node;
+        if (node->nchild < 48) {
+            /* removals leave holes, take the first free slot */
+            for (i = 0; NULL != n->child[i]; i++);
+            n->child[i] = ref;
+            n->index[c] = i + 1;
+            node->nchild++;
+            return;
+        }
+        art_node256_t *g = (art_node256_t*)(grown = _art_node_alloc(artNode256));
+        for (i = 0; i < 256; i++) {
+            if (0 != n->index[i]) {
+                g->child[i] = n->child[n->index[i] - 1];
+            }
+        }
+        break;
+    }
+    default: {
+        art_node256_t *n = (art_node256_t*)node;
+        n->child[c] = ref;
+        node->nchild++;
+        return;
+    }
+    }
+
+    _art_copy_header(grown, node);
+    free(node);
+    *slot = grown;
+    _art_add_child(slot, c, ref);
+}
+
+/**
+ * Remove the child for a key byte, shrinking the node into the previous
+ * layout when it gets sparse and replacing a Node4 left with one child
+ * by that child
+ *
+ * @param slot (i/o) where the node hangs, updated if it changes
+ * @param c    (i) key byte, present
+ * @return void
+ */
+static void
+_art_remove_child(art_ref_t *slot, uint8_t c)
+{
+    art_node_t *node = (art_node_t*)*slot;
+    art_node_t *shrunk = NULL;
+    int i = 0, j = 0;
+
+    switch (node->type) {
+    case artNode4:
+    case artNode16: {
+        /* Node4 and Node16 share the keys/child layout up to the size */
+        uint8_t *keys = (artNode4 == node->type) ?
+                        ((art_node4_t*)node)->keys : ((art_node16_t*)node)->keys;
+        art_ref_t *child = (artNode4 == node->type) ?
+                           ((art_node4_t*)node)->child : ((art_node16_t*)node)->child;
+        for (i = 0; keys[i] != c; i++);
+        memmove(&keys[i], &keys[i + 1], node->nchild - i - 1);
+        memmove(&child[i], &child[i + 1], (node->nchild - i - 1) * sizeof(child[0]));
+        node->nchild--;
+        if (artNode16 == node->type && 3 == node->nchild) {
+            art_node4_t *s = (art_node4_t*)(shrunk = _art_node_alloc(artNode4));
+            memcpy(s->keys, keys, 3);
+            memcpy(s->child, child, 3 * sizeof(child[0]));
+        } else if (artNode4 == node->type && 1 == node->nchild) {
+            art_ref_t only = child[0];
+            if (!ART_IS_LEAF(only)) {
+                /* fold this node's prefix and branch byte into the child's */
+                art_node_t *cn = (art_node_t*)only;
+                uint8_t prefix[ART_KEY_LEN - 1];
+                int plen = node->plen;
+                memcpy(prefix, node->prefix, plen);
+                prefix[plen++] = keys[0];
+                memcpy(&prefix[plen], cn->prefix, cn->plen);
+                cn->plen += plen;
+                memcpy(cn->prefix, prefix, cn->plen);
+            }
+            free(node);
+            *slot = only;
+            return;
+        }
+        break;
+    }
+    case artNode48: {
+        art_node48_t *n = (art_node48_t*)node;
+        n->child[n->index[c] - 1] = NULL;
+        n->index[c] = 0;
+        node->nchild--;
+        if (12 == node->nchild) {
+            art_node16_t *s = (art_node16_t*)(shrunk = _art_node_alloc(artNode16));
+            for (i = 0; i < 256; i++) {
+                if (0 != n->index[i]) {
+                    s->keys[j] = i;
+                    s->child[j++] = n->child[n->index[i] - 1];
+                }
+            }
+        }
+        break;
+    }
+    default: {
+        art_node256_t *n = (art_node256_t*)node;
+        n->child[c] = NULL;
+        node->nchild--;
+        if (37 == node->nchild) {
+            art_node48_t *s = (art_node48_t*)(shrunk = _art_node_alloc(artNode48));
+            for (i = 0; i < 256; i++) {
+                if (NULL != n->child[i]) {
+                    s->child[j] = n->child[i];
+                    s->index[i] = ++j;
+                }
+            }
+        }
+        break;
+    }
+    }
+
+    if (NULL != shrunk) {
+        _art_copy_header(shrunk, node);
+        free(node);
+        *slot = shrunk;
+    }
+}
+
+/**
+ * Make a Node4 holding two children
+ *
+ * @param c1 (i) key byte of the first child
+ * @param r1 (i) first child
+ * @param c2 (i) key byte of the second child, != c1
+ * @param r2 (i) second child
+ * @return the node
+ */
+static art_node_t*
+_art_node4_pair(uint8_t c1, art_ref_t r1, uint8_t c2, art_ref_t r2)
+{
+    art_node4_t *n = (art_node4_t*)_art_node_alloc(artNode4);
+
+    if (c2 < c1) {
+        uint8_t c = c1;
+        art_ref_t r = r1;
+        c1 = c2;
+        r1 = r2;
+        c2 = c;
+        r2 = r;
+    }
+    n->keys[0] = c1;
+    n->child[0] = r1;
+    n->keys[1] = c2;
+    n->child[1] = r2;
+    n->hdr.nchild = 2;
+    return &n->hdr;
+}
+
+/**
+ * Number of leading prefix bytes of a node that match a key
+ *
+ * @param node  (i) inner node
+ * @param key   (i) radix key
+ * @param depth (i) depth of the node's first prefix byte
+ * @return 0..node->plen
+ */
+static inline int
+_art_prefix_match(const art_node_t *node, uint32_t key, int depth)
+{
+    int p = 0;
+
+    while (p < node->plen && node->prefix[p] == _art_byte(key, depth + p)) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Insert a key below a slot
+ *
+ * Algorithm: an empty slot takes a leaf.  A leaf with another key
+ *            becomes a Node4 over both, prefixed with the bytes they
+ *            share.  A node whose prefix diverges from the key is split
+ *            at the divergence under a new Node4.  Otherwise descend,
+ *            adding a leaf where the branch byte has no child yet.
+ *
+ * @param slot  (i/o) subtree
+ * @param key   (i) radix key
+ * @param depth (i) key bytes consumed above the slot
+ * @return 1 if inserted, 0 if already present
+ */
+static int
+_art_insert(art_ref_t *slot, uint32_t key, int depth)
+{
+    art_node_t *node = NULL;
+    art_ref_t *next = NULL;
+    int p = 0;
+
+    if (NULL == *slot) {
+        *slot = ART_LEAF(key);
+        return 1;
+    }
+
+    if (ART_IS_LEAF(*slot)) {
+        uint32_t other = ART_LEAF_KEY(*slot);
+        if (other == key) {
+            return 0;
+        }
+        for (p = depth; _art_byte(other, p) == _art_byte(key, p); p++);
+        node = _art_node4_pair(_art_byte(other, p), *slot,
+                               _art_byte(key, p), ART_LEAF(key));
+        node->plen = p - depth;
+        for (p = 0; p < node->plen; p++) {
+            node->prefix[p] = _art_byte(key, depth + p);
+        }
+        *slot = node;
+        return 1;
+    }
+
+    node = (art_node_t*)*slot;
+    p = _art_prefix_match(node, key, depth);
+    if (p < node->plen) {
+        art_node_t *split = _art_node4_pair(node->prefix[p], node,
+                                            _art_byte(key, depth + p), ART_LEAF(key));
+        split->plen = p;
+        memcpy(split->prefix, node->prefix, p);
+        node->plen -= p + 1;
+        memmove(node->prefix, &node->prefix[p + 1], node->plen);
+        *slot = split;
+        return 1;
+    }
+
+    depth += node->plen;
+    next = _art_find_child(node, _art_byte(key, depth));
+    if (NULL != next) {
+        return _art_insert(next, key, depth + 1);
+    }
+    _art_add_child(slot, _art_byte(key, depth), ART_LEAF(key));
+    return 1;
+}
+
+/**
+ * Remove a key below a slot
+ *
+ * @param slot  (i/o) subtree
+ * @param key   (i) radix key
+ * @param depth (i) key bytes consumed above the slot
+ * @return 1 if removed, 0 if not present
+ */
+static int
+_art_remove(art_ref_t *slot, uint32_t key, int depth)
+{
+    art_node_t *node = NULL;
+    art_ref_t *next = NULL;
+    uint8_t c = 0;
+
+    if (NULL == *slot) {
+        return 0;
+    }
+    if (ART_IS_LEAF(*slot)) {
+        if (ART_LEAF_KEY(*slot) != key) {
+            return 0;
+        }
+        *slot = NULL;
+        return 1;
+    }
+
+    node = (art_node_t*)*slot;
+    if (_art_prefix_match(node, key, depth) < node->plen) {
+        return 0;
+    }
+    depth += node->plen;
+    c = _art_byte(key, depth);
+    next = _art_find_child(node, c);
+    if (NULL == next) {
+        return 0;
+    }
+    if (!ART_IS_LEAF(*next)) {
+        return _art_remove(next, key, depth + 1);
+    }
+    if (ART_LEAF_KEY(*next) != key) {
+        return 0;
+    }
+    _art_remove_child(slot, c);
+    return 1;
+}
+
+/**
+ * Leftmost or rightmost child of an inner node
+ *
+ * @param node (i) inner node
+ * @param last (i) non-zero for the rightmost
+ * @return child
+ */
+static art_ref_t
+_art_edge_child(art_node_t *node, int last)
+{
+    int i = 0;
+
+    switch (node->type) {
+    case artNode4:
+        return ((art_node4_t*)node)->child[last ? node->nchild - 1 : 0];
+    case artNode16:
+        return ((art_node16_t*)node)->child[last ? node->nchild - 1 : 0];
+    case artNode48: {
+        art_node48_t *n = (art_node48_t*)node;
+        for (i = last ? 255 : 0; 0 == n->index[i]; i += last ? -1 : 1);
+        return n->child[n->index[i] - 1];
+    }
+    default: {
+        art_node256_t *n = (art_node256_t*)node;
+        for (i = last ? 255 : 0; NULL == n->child[i]; i += last ? -1 : 1);
+        return n->child[i];
+    }
+    }
+}
+
+/**
+ * Call fn for the keys of a subtree that fall in [lo, hi], ascending
+ *
+ * @param ref   (i) subtree
+ * @param path  (i) key bytes above the subtree, in place, rest zero
+ * @param depth (i) key bytes consumed above the subtree
+ * @param lo    (i) lower bound, radix key
+ * @param hi    (i) upper bound, radix key
+ * @param fn    (i) callback
+ * @param ctx   (i) passed to fn
+ * @param cnt   (i/o) keys passed to fn so far
+ * @return non-zero if fn stopped the walk
+ */
+static int
+_art_range(art_ref_t ref, uint32_t path, int depth, uint32_t lo, uint32_t hi,
+           int (*fn)(int data, void *ctx), void *ctx, int *cnt)
+{
+    art_node_t *node = NULL;
+    uint32_t span = 0;
+    int i = 0, shift = 0;
+
+    if (ART_IS_LEAF(ref)) {
+        uint32_t key = ART_LEAF_KEY(ref);
+        if (key < lo || key > hi) {
+            return 0;
+        }
+        (*cnt)++;
+        return fn(_art_data(key), ctx);
+    }
+
+    node = (art_node_t*)ref;
+    for (i = 0; i < node->plen; i++, depth++) {
+        path |= (uint32_t)node->prefix[i] << (8 * (ART_KEY_LEN - 1 - depth));
+    }
+    shift = 8 * (ART_KEY_LEN - 1 - depth);
+    span = (shift > 0) ? (0xffffffffu >> (32 - shift)) : 0;
+
+    for (i = 0; i < 256; i++) {
+        art_ref_t child = NULL;
+        uint32_t low = 0;
+
+        switch (node->type) {
+        case artNode4:
+        case artNode16: {
+            uint8_t *keys = (artNode4 == node->type) ?
+                            ((art_node4_t*)node)->keys : ((art_node16_t*)node)->keys;
+            if (i >= node->nchild) {
+                return 0;
+            }
+            child = (artNode4 == node->type) ? ((art_node4_t*)node)->child[i] :
+                                               ((art_node16_t*)node)->child[i];
+            low = path | ((uint32_t)keys[i] << shift);
+            break;
+        }
+        case artNode48: {
+            art_node48_t *n = (art_node48_t*)node;
+            if (0 != n->index[i]) {
+                child = n->child[n->index[i] - 1];
+            }
+            low = path | ((uint32_t)i << shift);
+            break;
+        }
+        default:
+            child = ((art_node256_t*)node)->child[i];
+            low = path | ((uint32_t)i << shift);
+            break;
+        }
+
+        if (low > hi) {
+            return 0;
+        }
+        if (NULL == child || (low | span) < lo) {
+            continue;
+        }
+        if (_art_range(child, low, depth + 1, lo, hi, fn, ctx, cnt)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Free a subtree
+ *
+ * @param ref (i) subtree
+ * @return void
+ */
+static void
+_art_destroy(art_ref_t ref)
+{
+    art_node_t *node = (art_node_t*)ref;
+    int i = 0;
+
+    if (NULL == ref || ART_IS_LEAF(ref)) {
+        return;
+    }
+    switch (node->type) {
+    case artNode4:
+        for (i = 0; i < node->nchild; i++) {
+            _art_destroy(((art_node4_t*)node)->child[i]);
+        }
+        break;
+    case artNode16:
+        for (i = 0; i < node->nchild; i++) {
+            _art_destroy(((art_node16_t*)node)->child[i]);
+        }
+        break;
+    case artNode48:
+        for (i = 0; i < 48; i++) {
+            _art_destroy(((art_node48_t*)node)->child[i]);
+        }
+        break;
+    default:
+        for (i = 0; i < 256; i++) {
+            _art_destroy(((art_node256_t*)node)->child[i]);
+        }
+        break;
+    }
+    free(node);
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Create a new, empty radix tree
+ *
+ * Note - allocs mem for a new tree, caller must call art_destroy()
+ *
+ * @param name (i) name for the tree
+ * @return ArtPtr
+ */
+ArtPtr
+art_create(const char *name)
+{
+    assert(NULL != name);
+
+    ArtPtr artp = (art_t*)malloc(sizeof(*artp));
+    assert(NULL != artp);
+
+    artp->magic = ART_MAGIC_IN_USE;
+    strncpy(artp->name, name, ART_MAX_NAME_LEN - 1);
+    artp->name[ART_MAX_NAME_LEN - 1] = '\0';
+    artp->count = 0;
+    artp->root = NULL;
+    return artp;
+}
+
+/**
+ * Destroy a radix tree
+ *
+ * @param artp (i) ptr to tree to destroy
+ * @return void
+ */
+void
+art_destroy(ArtPtr artp)
+{
+    assert(NULL != artp);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    _art_destroy(artp->root);
+    artp->magic = ART_MAGIC_FREED;
+    free(artp);
+out:
+    return;
+}
+
+/**
+ * Insert a key
+ *
+ * @param artp (i) radix tree
+ * @param data (i) key to insert
+ * @return 1 if inserted, 0 if already present
+ */
+int
+art_insert(ArtPtr artp, int data)
+{
+    int added = 0;
+
+    assert(NULL != artp);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    added = _art_insert(&artp->root, _art_key(data), 0);
+    artp->count += added;
+out:
+    return added;
+}
+
+/**
+ * Remove a key
+ *
+ * @param artp (i) radix tree
+ * @param data (i) key to remove
+ * @return 1 if removed, 0 if not present
+ */
+int
+art_remove(ArtPtr artp, int data)
+{
+    int removed = 0;
+
+    assert(NULL != artp);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    removed = _art_remove(&artp->root, _art_key(data), 0);
+    artp->count -= removed;
+out:
+    return removed;
+}
+
+/**
+ * Search for a key
+ *
+ * Algorithm: check each node's prefix, then follow the child for the
+ *            next key byte until reaching a leaf, which holds the whole
+ *            key to compare against
+ *
+ * @param artp (i) radix tree
+ * @param data (i) key to find
+ * @return 1 if found, else 0
+ */
+int
+art_search(ArtPtr artp, int data)
+{
+    uint32_t key = _art_key(data);
+    art_ref_t ref = NULL;
+    art_ref_t *next = NULL;
+    int depth = 0;
+
+    assert(NULL != artp);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    ref = artp->root;
+    while (NULL != ref && !ART_IS_LEAF(ref)) {
+        art_node_t *node = (art_node_t*)ref;
+        if (_art_prefix_match(node, key, depth) < node->plen) {
+            return 0;
+        }
+        depth += node->plen;
+        next = _art_find_child(node, _art_byte(key, depth++));
+        ref = (NULL != next) ? *next : NULL;
+    }
+    return (NULL != ref && ART_LEAF_KEY(ref) == key);
+out:
+    return 0;
+}
+
+/**
+ * Number of keys, O(1)
+ *
+ * @param artp (i) radix tree
+ * @return key count
+ */
+int
+art_count(ArtPtr artp)
+{
+    assert(NULL != artp);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    return artp->count;
+out:
+    return 0;
+}
+
+/**
+ * Find the smallest key
+ *
+ * @param artp (i) radix tree
+ * @return minimum value, 0 if empty
+ */
+int
+art_minvalue(ArtPtr artp)
+{
+    art_ref_t ref = NULL;
+
+    assert(NULL != artp);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    ref = artp->root;
+    if (NULL == ref) {
+        return 0;
+    }
+    while (!ART_IS_LEAF(ref)) {
+        ref = _art_edge_child((art_node_t*)ref, 0);
+    }
+    return _art_data(ART_LEAF_KEY(ref));
+out:
+    return 0;
+}
+
+/**
+ * Find the largest key
+ *
+ * @param artp (i) radix tree
+ * @return maximum value, 0 if empty
+ */
+int
+art_maxvalue(ArtPtr artp)
+{
+    art_ref_t ref = NULL;
+
+    assert(NULL != artp);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    ref = artp->root;
+    if (NULL == ref) {
+        return 0;
+    }
+    while (!ART_IS_LEAF(ref)) {
+        ref = _art_edge_child((art_node_t*)ref, 1);
+    }
+    return _art_data(ART_LEAF_KEY(ref));
+out:
+    return 0;
+}
+
+/**
+ * Call fn for every key in [lo, hi] in ascending order; INT_MIN and
+ * INT_MAX bounds walk the whole tree
+ *
+ * @param artp (i) radix tree
+ * @param lo   (i) lower bound, inclusive
+ * @param hi   (i) upper bound, inclusive
+ * @param fn   (i) callback, non-zero return stops the walk
+ * @param ctx  (i) passed to fn
+ * @return number of keys passed to fn
+ */
+int
+art_range_foreach(ArtPtr artp, int lo, int hi,
+                  int (*fn)(int data, void *ctx), void *ctx)
+{
+    int cnt = 0;
+
+    assert(NULL != artp);
+    assert(NULL != fn);
+    MAGIC_IN_USE_CHECK(artp->magic);
+
+    if (NULL != artp->root && lo <= hi) {
+        _art_range(artp->root, 0, 0, _art_key(lo), _art_key(hi), fn, ctx, &cnt);
+    }
+out:
+    return cnt;
+}
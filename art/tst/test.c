@@ -0,0 +1,388 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "test.h"
+#include "art_ext.h"
+#include "logger.h"
+
+/**
+ * Convenience macro to save a couple lines of code
+ */
+#define FAIL_TEST do { \
+        passed = 0; \
+        goto out; \
+    } while(0)
+
+/**
+ * Helper to print timestamped PASS or FAIL message
+ *
+ * @param result (i) result, 1 if passed, 0 if failed
+ * @param test_name (i) test name to log
+ * @return void
+ */
+static inline void 
+print_result(int result, const char* test_name) {
+    if (result) {
+        logger(dbgInfo, "*** TestID: %s PASSED", test_name);
+    } else {
+        logger(dbgInfo, "*** TestID: %s FAILED", test_name);
+    }
+}
+
+/**
+ * Range callback: append key to a bounded array, stop when full
+ */
+typedef struct range_ctx_s {
+    int *out;
+    int cnt;
+    int max;
+} range_ctx_t;
+
+static int
+_range_collect(int data, void *ctx)
+{
+    range_ctx_t *rc = (range_ctx_t*)ctx;
+    rc->out[rc->cnt++] = data;
+    return (rc->cnt == rc->max);
+}
+
+static int
+_int_cmp(const void *a, const void *b)
+{
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Helper to check a tree against a reference membership array
+ *
+ * @param t     (i) tree to check
+ * @param pool  (i) candidate keys, sorted and distinct
+ * @param ref   (i) ref[i] = 1 if pool[i] expected
+ * @param n     (i) pool size
+ * @return 1 if tree matches, 0 else
+ */
+static int
+_art_verify_ref(ArtPtr t, const int *pool, const char *ref, int n)
+{
+    int *out = (int*)malloc(n * sizeof(int));
+    int *expect = (int*)malloc(n * sizeof(int));
+    range_ctx_t rc = {out, 0, n + 1};
+    int i = 0, cnt = 0, ok = 0;
+
+    for (i = 0; i < n; i++) {
+        if (ref[i] != art_search(t, pool[i])) {
+            logger(dbgErr, "Key %i: expected %i, search says %i", pool[i],
+                    ref[i], art_search(t, pool[i]));
+            goto done;
+        }
+        if (ref[i]) {
+            expect[cnt++] = pool[i];
+        }
+    }
+    if (cnt != art_count(t)) {
+        logger(dbgErr, "Expected %i keys, tree has %i", cnt, art_count(t));
+        goto done;
+    }
+    if (cnt > 0 && (expect[0] != art_minvalue(t) ||
+                    expect[cnt - 1] != art_maxvalue(t))) {
+        logger(dbgErr, "Expected min %i max %i, got %i %i", expect[0],
+                expect[cnt - 1], art_minvalue(t), art_maxvalue(t));
+        goto done;
+    }
+    /* a full scan must give back exactly the keys, in order */
+    if (cnt != art_range_foreach(t, INT_MIN, INT_MAX, _range_collect, &rc) ||
+        0 != memcmp(out, expect, cnt * sizeof(int))) {
+        logger(dbgErr, "Full range scan mismatch");
+        goto done;
+    }
+    ok = 1;
+done:
+    free(out);
+    free(expect);
+    return ok;
+}
+
+/**
+ * Helper to run a random insert/remove mix over a key pool, checking
+ * every status and the whole tree every so often
+ *
+ * @param t    (i) tree, empty
+ * @param pool (i) candidate keys, sorted and distinct
+ * @param n    (i) pool size
+ * @param ops  (i) operations to run
+ * @param seed (i) rand_r seed
+ * @return 1 if the tree tracked the reference throughout, 0 else
+ */
+static int
+_art_random_ops(ArtPtr t, const int *pool, int n, int ops, unsigned int seed)
+{
+    char *ref = (char*)calloc(n, 1);
+    int i = 0, ok = 0;
+
+    for (i = 0; i < ops; i++) {
+        int k = rand_r(&seed) % n;
+        /* grow for the first half, shrink for the second */
+        if (rand_r(&seed) % ops > i) {
+            if (art_insert(t, pool[k]) == ref[k]) {
+                logger(dbgErr, "Insert %i returned wrong status", pool[k]);
+                goto done;
+            }
+            ref[k] = 1;
+        } else {
+            if (art_remove(t, pool[k]) != ref[k]) {
+                logger(dbgErr, "Remove %i returned wrong status", pool[k]);
+                goto done;
+            }
+            ref[k] = 0;
+        }
+        if (0 == i % 2000 && !_art_verify_ref(t, pool, ref, n)) {
+            logger(dbgErr, "Diverged at op %i", i);
+            goto done;
+        }
+    }
+    ok = _art_verify_ref(t, pool, ref, n);
+done:
+    free(ref);
+    return ok;
+}
+
+/** 
+ * Test1: empty tree, verify count is 0 and lookups miss
+ */
+void 
+test1(const char *test_name) {
+    int passed = 1;
+
+    int out[1];
+    range_ctx_t rc = {out, 0, 1};
+
+    ArtPtr t = art_create(test_name);
+
+    if (0 != art_count(t) || art_search(t, 0) || art_remove(t, 0) ||
+        0 != art_minvalue(t) || 0 != art_maxvalue(t) ||
+        0 != art_range_foreach(t, INT_MIN, INT_MAX, _range_collect, &rc)) {
+        logger(dbgErr, "Empty tree misbehaves");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    art_destroy(t);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test2: insert a handful of keys including the int extremes and keys
+ *        differing only in their low or high byte, verify set
+ *        semantics, count, min and max
+ */
+void 
+test2(const char *test_name) {
+    int passed = 1;
+
+    int keys[] = {8, 3, 0x10008, -1, 0, 0x7f000008, INT_MAX, INT_MIN, 4,
+                  0x100, 0x10000, -256};
+    int num_keys = sizeof(keys) / sizeof(keys[0]);
+    int i = 0;
+
+    ArtPtr t = art_create(test_name);
+    for (i = 0; i < num_keys; i++) {
+        if (!art_insert(t, keys[i])) {
+            FAIL_TEST;
+        }
+    }
+    /* second insert of a key is refused */
+    if (art_insert(t, 0x10008) || num_keys != art_count(t)) {
+        logger(dbgErr, "Duplicate accepted or count %i wrong", art_count(t));
+        FAIL_TEST;
+    }
+    for (i = 0; i < num_keys; i++) {
+        if (!art_search(t, keys[i])) {
+            logger(dbgErr, "Key %i missing", keys[i]);
+            FAIL_TEST;
+        }
+    }
+    if (INT_MIN != art_minvalue(t) || INT_MAX != art_maxvalue(t) ||
+        art_search(t, 5) || art_search(t, 0x108) || art_search(t, 0x7f000000)) {
+        FAIL_TEST;
+    }
+    if (!art_remove(t, INT_MIN) || !art_remove(t, INT_MAX) ||
+        art_remove(t, INT_MAX) || -256 != art_minvalue(t) ||
+        0x7f000008 != art_maxvalue(t) || num_keys - 2 != art_count(t)) {
+        logger(dbgErr, "Remove of extremes wrong");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    art_destroy(t);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test3: random insert/remove mixes checked against a reference, over
+ *        a dense range (full Node256 fan-out) and sparse random keys
+ *        (long shared prefixes that split and merge)
+ */
+void 
+test3(const char *test_name) {
+    int passed = 1;
+
+    int n = 3000;
+    int *pool = (int*)malloc(n * sizeof(int));
+    unsigned int seed = 333;
+    int i = 0, j = 0;
+
+    ArtPtr t = art_create(test_name);
+
+    /* dense, straddling zero */
+    for (i = 0; i < n; i++) {
+        pool[i] = i - n / 2;
+    }
+    if (!_art_random_ops(t, pool, n, 60000, 33)) {
+        logger(dbgErr, "Dense keys diverged");
+        FAIL_TEST;
+    }
+    art_destroy(t);
+
+    /* sparse, a few clusters so some prefixes are shared */
+    t = art_create(test_name);
+    for (i = 0; i < n; i++) {
+        unsigned int base = (i % 4) * 0x3f000000u + 0xa0000000u;
+        pool[i] = (int)((i % 3) ? (unsigned)rand_r(&seed) << 16 ^ rand_r(&seed) :
+                                  base + rand_r(&seed) % 0x20000);
+    }
+    qsort(pool, n, sizeof(int), _int_cmp);
+    for (i = j = 0; i < n; i++) {
+        if (0 == j || pool[j - 1] != pool[i]) {
+            pool[j++] = pool[i];
+        }
+    }
+    if (!_art_random_ops(t, pool, j, 60000, 34)) {
+        logger(dbgErr, "Sparse keys diverged");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    art_destroy(t);
+    free(pool);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test4: range scans, including empty, inverted, boundary-crossing and
+ *        early-stopped ones
+ */
+void 
+test4(const char *test_name) {
+    int passed = 1;
+
+    int out[1000];
+    int i = 0;
+    range_ctx_t rc = {out, 0, 1000};
+
+    ArtPtr t = art_create(test_name);
+    for (i = -500; i < 500; i++) {
+        art_insert(t, 3 * i);
+    }
+    /* [10, 40] holds 12, 15, ..., 39 */
+    if (10 != art_range_foreach(t, 10, 40, _range_collect, &rc) ||
+        12 != out[0] || 39 != out[9]) {
+        FAIL_TEST;
+    }
+    /* across the sign change: -6, -3, 0, 3 */
+    rc.cnt = 0;
+    if (4 != art_range_foreach(t, -7, 4, _range_collect, &rc) ||
+        -6 != out[0] || 3 != out[3]) {
+        FAIL_TEST;
+    }
+    /* across a byte boundary: 255, 258 */
+    rc.cnt = 0;
+    if (2 != art_range_foreach(t, 254, 258, _range_collect, &rc) ||
+        255 != out[0] || 258 != out[1]) {
+        FAIL_TEST;
+    }
+    rc.cnt = 0;
+    if (0 != art_range_foreach(t, 40, 10, _range_collect, &rc) ||
+        0 != art_range_foreach(t, 1498, 4000, _range_collect, &rc) ||
+        1 != art_range_foreach(t, 1497, 1497, _range_collect, &rc) ||
+        0 != art_range_foreach(t, 13, 14, _range_collect, &rc)) {
+        FAIL_TEST;
+    }
+    rc.cnt = 0;
+    rc.max = 5;
+    if (5 != art_range_foreach(t, 0, INT_MAX, _range_collect, &rc) ||
+        12 != out[4]) {
+        logger(dbgErr, "Early stop wrong");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    art_destroy(t);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test5: grow one node through every layout and back, checking the
+ *        whole tree at every child count
+ */
+void 
+test5(const char *test_name) {
+    int passed = 1;
+
+    int pool[256];
+    char ref[256];
+    int i = 0;
+
+    ArtPtr t = art_create(test_name);
+    /* keys 0x1200..0x12ff share one inner node, added out of order */
+    for (i = 0; i < 256; i++) {
+        pool[i] = 0x1200 + i;
+    }
+    memset(ref, 0, sizeof(ref));
+    for (i = 0; i < 256; i++) {
+        int k = (i * 37) % 256;
+        art_insert(t, pool[k]);
+        ref[k] = 1;
+        if (!_art_verify_ref(t, pool, ref, 256)) {
+            logger(dbgErr, "Grow diverged at %i children", i + 1);
+            FAIL_TEST;
+        }
+    }
+    for (i = 0; i < 256; i++) {
+        int k = (i * 101) % 256;
+        art_remove(t, pool[k]);
+        ref[k] = 0;
+        if (!_art_verify_ref(t, pool, ref, 256)) {
+            logger(dbgErr, "Shrink diverged at %i children", 255 - i);
+            FAIL_TEST;
+        }
+    }
+    if (0 != art_count(t)) {
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    art_destroy(t);
+    print_result(passed, test_name);
+}
+
+test_arr_t Tests[] = 
+{
+    {"test1", test1},
+    {"test2", test2},
+    {"test3", test3},
+    {"test4", test4},
+    {"test5", test5},
+};
+
+int
+main(int argc, char *argv[])
+{
+    int i = 0;
+    for (i = 0; i < sizeof(Tests) / sizeof(Tests[0]); i++) {
+	logger(dbgInfo, "Running %s...", Tests[i].test_name);
+	Tests[i].test_fn(Tests[i].test_name);
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bench.h"
+#include "logger.h"
+
+/*
+ * bintree benchmarks
+ *
+ * Usage: bintree_bench [bench_name] [n]
+ * With no arguments every benchmark runs at its default size.
+ */
+
+/**
+ * Helper to get a monotonic timestamp in seconds
+ *
+ * @return seconds
+ */
+double
+bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Helper to alloc keys 0..n-1 in ascending order
+ *
+ * Note - caller must free() the returned array
+ *
+ * @param n (i) number of keys
+ * @return int array of n keys
+ */
+int*
+bench_keys_sorted(long n)
+{
+    int *keys = (int*)malloc(n * sizeof(*keys));
+    long i = 0;
+
+    for (i = 0; i < n; i++) {
+        keys[i] = (int)i;
+    }
+    return keys;
+}
+
+/**
+ * Helper to shuffle keys in place (Fisher-Yates)
+ *
+ * @param keys (i/o) keys to shuffle
+ * @param n    (i) number of keys
+ * @param seed (i) random seed
+ * @return void
+ */
+void
+bench_shuffle(int *keys, long n, unsigned int seed)
+{
+    long i = 0;
+
+    for (i = n - 1; i > 0; i--) {
+        long j = ((long)rand_r(&seed) << 15 ^ rand_r(&seed)) % (i + 1);
+        int tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+/**
+ * Helper to alloc n distinct keys in random order
+ *
+ * Note - caller must free() the returned array
+ *
+ * @param n    (i) number of keys
+ * @param seed (i) random seed
+ * @return int array of n keys
+ */
+int*
+bench_keys_random(long n, unsigned int seed)
+{
+    int *keys = bench_keys_sorted(n);
+    bench_shuffle(keys, n, seed);
+    return keys;
+}
+
+bench_arr_t Benches[] =
+{
+    {"balance", bench_balance, 1000000},
+    {"iterative", bench_iterative, 1000000},
+    {"btree", bench_btree, 1000000},
+    {"frozen", bench_frozen, 10000000},
+    {"bulkload", bench_bulkload, 10000000},
+    {"range", bench_range, 1000000},
+    {"order", bench_order, 1000000},
+    {"concurrent", bench_concurrent, 1000000},
+    {"arena", bench_arena, 10000000},
+    {"map", bench_map, 1000000},
+    {"image", bench_image, 10000000},
+    {"parallel", bench_parallel, 10000000},
+    {"walk", bench_walk, 10000000},
+    {"batch", bench_batch, 10000000},
+    {"setop", bench_setop, 10000000},
+    {"version", bench_version, 1000000},
+    {"splay", bench_splay, 1000000},
+    {"compact", bench_compact, 10000000},
+    {"multiset", bench_multiset, 1000000},
+    {"rebalance", bench_rebalance, 20000},
+};
+
+int
+main(int argc, char *argv[])
+{
+    int i = 0;
+
+    /* per-node tracing would dominate every measurement */
+    logger_set_level(dbgErr);
+
+    for (i = 0; i < sizeof(Benches) / sizeof(Benches[0]); i++) {
+        if (argc > 1 && 0 != strcmp(argv[1], Benches[i].bench_name)) {
+            continue;
+        }
+        long n = (argc > 2) ? atol(argv[2]) : Benches[i].default_n;
+        printf("=== %s (n=%li)\n", Benches[i].bench_name, n);
+        Benches[i].bench_fn(n);
+    }
+    return 0;
+}
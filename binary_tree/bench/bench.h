@@ -0,0 +1,40 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#define BENCH_NAME_MAX_LEN 80
+
+typedef struct bench_arr_s {
+    char bench_name[BENCH_NAME_MAX_LEN];
+    void (*bench_fn)(long n);
+    long default_n;
+} bench_arr_t;
+
+/* Helpers, see bench.c */
+double bench_now(void);
+int* bench_keys_sorted(long n);
+int* bench_keys_random(long n, unsigned int seed);
+void bench_shuffle(int *keys, long n, unsigned int seed);
+
+/* Benchmarks, one file each */
+void bench_balance(long n);
+void bench_iterative(long n);
+void bench_btree(long n);
+void bench_frozen(long n);
+void bench_bulkload(long n);
+void bench_range(long n);
+void bench_order(long n);
+void bench_concurrent(long n);
+void bench_arena(long n);
+void bench_map(long n);
+void bench_image(long n);
+void bench_parallel(long n);
+void bench_walk(long n);
+void bench_batch(long n);
+void bench_setop(long n);
+void bench_version(long n);
+void bench_splay(long n);
+void bench_compact(long n);
+void bench_multiset(long n);
+void bench_rebalance(long n);
+
+#endif /*__BENCH_H__*/
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+#include "bintree_int.h"
+
+/*
+ * Node arena against one malloc per node.
+ *
+ * churn:    n node allocs, n frees, n allocs again (the second round
+ *           comes off the freelist), raw node APIs against malloc/free.
+ * tree:     build a tree from n random keys, remove every key, insert
+ *           them all again, then destroy it.  The malloc baseline is the
+ *           pre-arena plain insert plus its post-order teardown walk.
+ */
+
+static bintreenode_t*
+_malloc_insert(bintreenode_t *root, int data)
+{
+    bintreenode_t **link = &root;
+    bintreenode_t *node = NULL;
+
+    while (NULL != *link) {
+        link = (data < (*link)->data) ? &(*link)->left : &(*link)->right;
+    }
+    node = (bintreenode_t*)malloc(sizeof(*node));
+    node->data = data;
+    node->left = node->right = NULL;
+    *link = node;
+    return root;
+}
+
+static void
+_malloc_destroy(bintreenode_t *node)
+{
+    if (NULL == node) {
+        return;
+    }
+    _malloc_destroy(node->left);
+    _malloc_destroy(node->right);
+    free(node);
+}
+
+static void
+_bench_churn(long n)
+{
+    bintreenode_t **nodes = (bintreenode_t**)malloc(n * sizeof(*nodes));
+    BintreePtr b = bintree_create("arena");
+    long i = 0;
+    int round = 0;
+    double t0, t1;
+
+    t0 = bench_now();
+    for (round = 0; round < 2; round++) {
+        for (i = 0; i < n; i++) {
+            nodes[i] = (bintreenode_t*)malloc(sizeof(bintreenode_t));
+            nodes[i]->data = (int)i;
+        }
+        for (i = 0; i < n; i++) {
+            free(nodes[i]);
+        }
+    }
+    t1 = bench_now();
+    printf("%-24s %9li  %8.1f ns/node\n", "churn malloc/free", n,
+           (t1 - t0) * 1e9 / (4 * n));
+
+    t0 = bench_now();
+    for (round = 0; round < 2; round++) {
+        for (i = 0; i < n; i++) {
+            nodes[i] = _bintree_node_alloc(b, (int)i);
+        }
+        for (i = 0; i < n; i++) {
+            _bintree_node_free(b, nodes[i]);
+        }
+    }
+    t1 = bench_now();
+    printf("%-24s %9li  %8.1f ns/node\n", "churn arena", n,
+           (t1 - t0) * 1e9 / (4 * n));
+
+    bintree_destroy(b);
+    free(nodes);
+}
+
+static void
+_bench_tree(long n)
+{
+    int *keys = bench_keys_random(n, 11);
+    bintreenode_t *root = NULL;
+    long i = 0;
+    double t0, t1, t2;
+
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        root = _malloc_insert(root, keys[i]);
+    }
+    t1 = bench_now();
+    _malloc_destroy(root);
+    t2 = bench_now();
+    printf("%-24s %9li  insert %8.1f ns/op  destroy %8.1f ms\n", "malloc per node",
+           n, (t1 - t0) * 1e9 / n, (t2 - t1) * 1e3);
+
+    BintreePtr b = bintree_create("arena");
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    t1 = bench_now();
+    printf("%-24s %9li  insert %8.1f ns/op\n", "arena, fresh chunks", n,
+           (t1 - t0) * 1e9 / n);
+
+    for (i = 0; i < n; i++) {
+        bintree_remove(b, keys[i]);
+    }
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    t1 = bench_now();
+    bintree_destroy(b);
+    t2 = bench_now();
+    printf("%-24s %9li  insert %8.1f ns/op  destroy %8.1f ms\n", "arena, from freelist",
+           n, (t1 - t0) * 1e9 / n, (t2 - t1) * 1e3);
+
+    free(keys);
+}
+
+void
+bench_arena(long n)
+{
+    _bench_churn(n);
+    _bench_tree(n);
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Plain vs AVL: insert sorted and random keys, report depth and
+ * search throughput.
+ *
+ * Sorted inserts into the plain tree are O(n^2) and recurse n deep,
+ * so that case is capped at BENCH_PLAIN_SORTED_MAX keys.
+ */
+
+#define BENCH_PLAIN_SORTED_MAX 20000
+
+static void
+_bench_one(const char *label, bintree_mode_e mode, int sorted, long n)
+{
+    int *keys = sorted ? bench_keys_sorted(n) : bench_keys_random(n, 1);
+    int *probe = bench_keys_random(n, 2);
+    long found = 0;
+    long i = 0;
+
+    BintreePtr b = bintree_create_mode(label, mode);
+
+    double t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    double t1 = bench_now();
+    for (i = 0; i < n; i++) {
+        found += bintree_search(b, probe[i]);
+    }
+    double t2 = bench_now();
+
+    printf("%-6s %-7s %9li  depth %7i  insert %8.1f ns/op  "
+           "search %7.2f Mops/s  (found %li)\n",
+           label, sorted ? "sorted" : "random", n, bintree_maxdepth(b),
+           (t1 - t0) / n * 1e9, n / (t2 - t1) / 1e6, found);
+
+    bintree_destroy(b);
+    free(keys);
+    free(probe);
+}
+
+void
+bench_balance(long n)
+{
+    long plain_sorted_n = (n < BENCH_PLAIN_SORTED_MAX) ? n : BENCH_PLAIN_SORTED_MAX;
+
+    _bench_one("plain", bintreePlain, 1, plain_sorted_n);
+    _bench_one("avl", bintreeAvl, 1, plain_sorted_n);
+    _bench_one("avl", bintreeAvl, 1, n);
+    _bench_one("plain", bintreePlain, 0, n);
+    _bench_one("avl", bintreeAvl, 0, n);
+}
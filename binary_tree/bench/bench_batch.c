@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Batched versus one-at-a-time lookups on AVL trees of growing size.
+ *
+ * scalar:  bintree_search() in a loop
+ * batch:   bintree_search_batch() over the same keys
+ *
+ * Probes are random and half of them miss.  Once the tree outgrows the
+ * caches, scalar lookups stall on every level while the batch keeps
+ * several misses in flight.
+ */
+
+#define BENCH_BATCH_PROBES 2000000
+
+static void
+_bench_batch_size(long n, const int *probe, uint8_t *found)
+{
+    int *keys = bench_keys_random(n, 41);
+    BintreePtr b = bintree_create_mode("avl", bintreeAvl);
+    long i = 0, hits_s = 0, hits_b = 0;
+    double t0, t1, t2;
+
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i] * 2);
+    }
+
+    t0 = bench_now();
+    for (i = 0; i < BENCH_BATCH_PROBES; i++) {
+        hits_s += bintree_search(b, probe[i]);
+    }
+    t1 = bench_now();
+    bintree_search_batch(b, probe, BENCH_BATCH_PROBES, found);
+    t2 = bench_now();
+    for (i = 0; i < BENCH_BATCH_PROBES; i++) {
+        hits_b += found[i];
+    }
+
+    printf("n=%-10li scalar %8.2f Mops/s  batch %8.2f Mops/s  x%.2f  (hits %li/%li)\n",
+           n, BENCH_BATCH_PROBES / (t1 - t0) / 1e6,
+           BENCH_BATCH_PROBES / (t2 - t1) / 1e6, (t1 - t0) / (t2 - t1),
+           hits_s, hits_b);
+    bintree_destroy(b);
+    free(keys);
+}
+
+void
+bench_batch(long n)
+{
+    long sizes[] = {1000, 65536, 1000000, 10000000};
+    int *probe = (int*)malloc(BENCH_BATCH_PROBES * sizeof(*probe));
+    uint8_t *found = (uint8_t*)malloc(BENCH_BATCH_PROBES);
+    unsigned int seed = 42;
+    long i = 0, s = 0;
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= n; s++) {
+        for (i = 0; i < BENCH_BATCH_PROBES; i++) {
+            probe[i] = (int)(((long)rand_r(&seed) << 15 ^ rand_r(&seed)) % (2 * sizes[s]));
+        }
+        _bench_batch_size(sizes[s], probe, found);
+    }
+    free(probe);
+    free(found);
+}
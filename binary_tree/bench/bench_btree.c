@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * B-tree mode against the pointer trees, random keys, growing sizes up
+ * to n (1M, 10M, 50M).  Bytes/key is heap growth as seen by malloc,
+ * including allocator overhead.
+ */
+
+static void
+_bench_one(const char *label, bintree_mode_e mode, const int *keys,
+           const int *probe, long n)
+{
+    size_t heap0 = mallinfo2().uordblks;
+    long found = 0;
+    long i = 0;
+
+    BintreePtr b = bintree_create_mode(label, mode);
+
+    double t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    double t1 = bench_now();
+    for (i = 0; i < n; i++) {
+        found += bintree_search(b, probe[i]);
+    }
+    double t2 = bench_now();
+    size_t heap1 = mallinfo2().uordblks;
+
+    printf("%-6s %9li  depth %3i  insert %7.1f ns/op  search %6.2f Mops/s  "
+           "%5.1f bytes/key  (found %li)\n",
+           label, n, bintree_maxdepth(b), (t1 - t0) / n * 1e9,
+           n / (t2 - t1) / 1e6, (double)(heap1 - heap0) / n, found);
+
+    bintree_destroy(b);
+}
+
+void
+bench_btree(long n)
+{
+    long sizes[] = {1000000, 10000000, 50000000};
+    int s = 0;
+
+    for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= n; s++) {
+        int *keys = bench_keys_random(sizes[s], 1);
+        int *probe = bench_keys_random(sizes[s], 2);
+
+        _bench_one("plain", bintreePlain, keys, probe, sizes[s]);
+        _bench_one("avl", bintreeAvl, keys, probe, sizes[s]);
+        _bench_one("btree", bintreeBtree, keys, probe, sizes[s]);
+
+        free(keys);
+        free(probe);
+    }
+}
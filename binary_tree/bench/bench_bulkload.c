@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Startup time: n bintree_insert() calls of sorted keys (AVL, and B-tree
+ * mode) against one bintree_build_sorted(), plus the export back out.
+ * Plain mode is skipped, sorted inserts make it quadratic.
+ */
+
+static void
+_bench_inserts(const char *label, bintree_mode_e mode, const int *keys, long n)
+{
+    long i = 0;
+
+    double t0 = bench_now();
+    BintreePtr b = bintree_create_mode(label, mode);
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    double t1 = bench_now();
+    printf("%-24s %9li  %9.1f ms  depth %i\n", label, n, (t1 - t0) * 1e3,
+           bintree_maxdepth(b));
+    bintree_destroy(b);
+}
+
+void
+bench_bulkload(long n)
+{
+    int *keys = bench_keys_sorted(n);
+    int *out = (int*)malloc(n * sizeof(*out));
+
+    _bench_inserts("avl insert loop", bintreeAvl, keys, n);
+    _bench_inserts("btree insert loop", bintreeBtree, keys, n);
+
+    double t0 = bench_now();
+    BintreePtr b = bintree_build_sorted("bulk", keys, n);
+    double t1 = bench_now();
+    printf("%-24s %9li  %9.1f ms  depth %i\n", "bintree_build_sorted", n,
+           (t1 - t0) * 1e3, bintree_maxdepth(b));
+
+    t0 = bench_now();
+    bintree_to_sorted_array(b, out);
+    t1 = bench_now();
+    printf("%-24s %9li  %9.1f ms\n", "bintree_to_sorted_array", n, (t1 - t0) * 1e3);
+
+    t0 = bench_now();
+    bintree_destroy(b);
+    t1 = bench_now();
+    printf("%-24s %9li  %9.1f ms\n", "bintree_destroy", n, (t1 - t0) * 1e3);
+
+    free(keys);
+    free(out);
+}
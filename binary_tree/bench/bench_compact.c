@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include "bench.h"
+#include "bintree_ext.h"
+#include "bintree_compact_ext.h"
+
+/*
+ * Compact 32-bit-index trees against plain pointer trees.
+ *
+ * Both are built from the same n random keys in the same order, so they
+ * have exactly the same shape and the difference is layout alone.
+ * Reports heap growth per key, insert time, and search time for every
+ * key in a second random order.
+ */
+
+static size_t
+_heap_in_use(void)
+{
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+void
+bench_compact(long n)
+{
+    int *keys = bench_keys_random(n, 46);
+    int *probe = bench_keys_random(n, 64);
+    long i = 0, hits = 0;
+    size_t heap = 0;
+    double t0, t1, t2;
+    int depth = 0;
+
+    heap = _heap_in_use();
+    t0 = bench_now();
+    BintreeCompactPtr c = bintree_compact_create("compact");
+    for (i = 0; i < n; i++) {
+        bintree_compact_insert(c, keys[i]);
+    }
+    t1 = bench_now();
+    heap = _heap_in_use() - heap;
+    for (i = 0; i < n; i++) {
+        hits += bintree_compact_search(c, probe[i]);
+    }
+    t2 = bench_now();
+    depth = bintree_compact_maxdepth(c);
+    printf("%-10s insert %7.1f ns  search %7.1f ns  %5.1f B/key  depth %i  (hits %li)\n",
+           "compact", (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n,
+           (double)heap / n, depth, hits);
+    bintree_compact_destroy(c);
+
+    hits = 0;
+    heap = _heap_in_use();
+    t0 = bench_now();
+    BintreePtr b = bintree_create("plain");
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    t1 = bench_now();
+    heap = _heap_in_use() - heap;
+    for (i = 0; i < n; i++) {
+        hits += bintree_search(b, probe[i]);
+    }
+    t2 = bench_now();
+    depth = bintree_maxdepth(b);
+    printf("%-10s insert %7.1f ns  search %7.1f ns  %5.1f B/key  depth %i  (hits %li)\n",
+           "pointer", (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n,
+           (double)heap / n, depth, hits);
+    bintree_destroy(b);
+
+    free(keys);
+    free(probe);
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Read scaling: 1..8 threads each doing a 99% search / 1% insert-or-remove
+ * mix on one tree of n keys.  bintreeConcurrent readers take no lock;
+ * the baseline is what callers did before, an AVL tree behind a mutex
+ * (and, for reference, behind a rwlock).
+ */
+
+#define BENCH_OPS_PER_THREAD 400000
+#define BENCH_MAX_THREADS    8
+
+typedef enum bench_lock_ {
+    benchNoLock,
+    benchMutex,
+    benchRwlock
+} bench_lock_e;
+
+typedef struct bench_thr_s {
+    BintreePtr b;
+    bench_lock_e lock;
+    long n;
+    unsigned int seed;
+    long found;
+} bench_thr_t;
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t bench_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+static void*
+_bench_worker(void *arg)
+{
+    bench_thr_t *t = (bench_thr_t*)arg;
+    unsigned int seed = t->seed;
+    int i = 0;
+
+    for (i = 0; i < BENCH_OPS_PER_THREAD; i++) {
+        int k = (int)(((long)rand_r(&seed) << 15 ^ rand_r(&seed)) % t->n);
+        int write = (0 == rand_r(&seed) % 100);
+
+        if (benchMutex == t->lock) {
+            pthread_mutex_lock(&bench_mutex);
+        } else if (benchRwlock == t->lock) {
+            if (write) {
+                pthread_rwlock_wrlock(&bench_rwlock);
+            } else {
+                pthread_rwlock_rdlock(&bench_rwlock);
+            }
+        }
+
+        if (write) {
+            /* keys past n come and go, the base set stays put */
+            if (i & 1) {
+                bintree_insert(t->b, (int)t->n + k);
+            } else if (bintree_search(t->b, (int)t->n + k)) {
+                bintree_remove(t->b, (int)t->n + k);
+            }
+        } else {
+            t->found += bintree_search(t->b, k);
+        }
+
+        if (benchMutex == t->lock) {
+            pthread_mutex_unlock(&bench_mutex);
+        } else if (benchRwlock == t->lock) {
+            pthread_rwlock_unlock(&bench_rwlock);
+        }
+    }
+    return NULL;
+}
+
+static void
+_bench_run(const char *label, bintree_mode_e mode, bench_lock_e lock,
+           const int *keys, long n)
+{
+    pthread_t tids[BENCH_MAX_THREADS];
+    bench_thr_t thr[BENCH_MAX_THREADS];
+    long i = 0;
+    int nthreads = 0, j = 0;
+
+    for (nthreads = 1; nthreads <= BENCH_MAX_THREADS; nthreads *= 2) {
+        BintreePtr b = bintree_create_mode(label, mode);
+        long found = 0;
+        for (i = 0; i < n; i++) {
+            bintree_insert(b, keys[i]);
+        }
+
+        double t0 = bench_now();
+        for (j = 0; j < nthreads; j++) {
+            thr[j].b = b;
+            thr[j].lock = lock;
+            thr[j].n = n;
+            thr[j].seed = 17 + j;
+            thr[j].found = 0;
+            pthread_create(&tids[j], NULL, _bench_worker, &thr[j]);
+        }
+        for (j = 0; j < nthreads; j++) {
+            pthread_join(tids[j], NULL);
+            found += thr[j].found;
+        }
+        double t1 = bench_now();
+
+        printf("%-18s threads %i  %7.2f Mops/s  (found %li)\n", label, nthreads,
+               (double)nthreads * BENCH_OPS_PER_THREAD / (t1 - t0) / 1e6, found);
+        bintree_destroy(b);
+    }
+}
+
+void
+bench_concurrent(long n)
+{
+    int *keys = bench_keys_random(n, 11);
+
+    _bench_run("concurrent", bintreeConcurrent, benchNoLock, keys, n);
+    _bench_run("avl + mutex", bintreeAvl, benchMutex, keys, n);
+    _bench_run("avl + rwlock", bintreeAvl, benchRwlock, keys, n);
+    free(keys);
+}
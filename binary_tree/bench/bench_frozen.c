@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Lookups per second: AVL pointer tree vs its frozen Eytzinger copy,
+ * one bintree_search() at a time and through bintree_search_many().
+ * Half the probes miss.
+ */
+
+static void
+_bench_one(long n)
+{
+    int *keys = bench_keys_random(n, 1);
+    int *probe = bench_keys_random(2 * n, 2);
+    uint8_t *found = (uint8_t*)malloc(2 * n);
+    long hits = 0;
+    long i = 0;
+    double t0, t1;
+
+    BintreePtr b = bintree_create_mode("avl", bintreeAvl);
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    t0 = bench_now();
+    BintreePtr f = bintree_freeze(b);
+    t1 = bench_now();
+    printf("%9li  freeze %8.1f ms\n", n, (t1 - t0) * 1e3);
+
+    t0 = bench_now();
+    for (i = 0; i < 2 * n; i++) {
+        hits += bintree_search(b, probe[i]);
+    }
+    t1 = bench_now();
+    printf("%9li  avl     search       %7.2f Mops/s  (hits %li)\n",
+           n, 2 * n / (t1 - t0) / 1e6, hits);
+
+    hits = 0;
+    t0 = bench_now();
+    for (i = 0; i < 2 * n; i++) {
+        hits += bintree_search(f, probe[i]);
+    }
+    t1 = bench_now();
+    printf("%9li  frozen  search       %7.2f Mops/s  (hits %li)\n",
+           n, 2 * n / (t1 - t0) / 1e6, hits);
+
+    hits = 0;
+    t0 = bench_now();
+    bintree_search_many(f, probe, 2 * n, found);
+    t1 = bench_now();
+    for (i = 0; i < 2 * n; i++) {
+        hits += found[i];
+    }
+    printf("%9li  frozen  search_many  %7.2f Mops/s  (hits %li)\n",
+           n, 2 * n / (t1 - t0) / 1e6, hits);
+
+    bintree_destroy(f);
+    bintree_destroy(b);
+    free(keys);
+    free(probe);
+    free(found);
+}
+
+void
+bench_frozen(long n)
+{
+    _bench_one(n / 100);
+    _bench_one(n / 10);
+    _bench_one(n);
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Cold start: getting a searchable tree back after a restart.
+ *
+ * reinsert:  n bintree_insert() calls (AVL) from keys already in memory
+ * mmap:      bintree_load_mmap() of an image saved earlier; "cold" has
+ *            the file dropped from the page cache first, "warm" does not
+ *
+ * Each is followed by BENCH_PROBES random searches, since the mapping
+ * only pays for the pages those searches fault in.
+ */
+
+#define BENCH_IMAGE_PATH "/tmp/bintree_bench.img"
+#define BENCH_PROBES     1000000
+
+static long
+_bench_probe(BintreePtr b, const int *probe)
+{
+    long found = 0, i = 0;
+
+    for (i = 0; i < BENCH_PROBES; i++) {
+        found += bintree_search(b, probe[i]);
+    }
+    return found;
+}
+
+static void
+_bench_drop_cache(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static void
+_bench_load(const char *label, const int *probe)
+{
+    double t0 = bench_now();
+    BintreePtr b = bintree_load_mmap(BENCH_IMAGE_PATH);
+    double t1 = bench_now();
+    long found = _bench_probe(b, probe);
+    double t2 = bench_now();
+
+    printf("%-24s load %10.3f ms  +%i searches %8.1f ms  (found %li)\n", label,
+           (t1 - t0) * 1e3, BENCH_PROBES, (t2 - t1) * 1e3, found);
+    bintree_destroy(b);
+}
+
+void
+bench_image(long n)
+{
+    int *keys = bench_keys_random(n, 31);
+    int *probe = bench_keys_random(BENCH_PROBES, 32);
+    long i = 0, found = 0;
+    double t0, t1, t2;
+
+    t0 = bench_now();
+    BintreePtr b = bintree_create_mode("avl", bintreeAvl);
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    t1 = bench_now();
+    found = _bench_probe(b, probe);
+    t2 = bench_now();
+    printf("%-24s load %10.3f ms  +%i searches %8.1f ms  (found %li)\n", "reinsert (avl)",
+           (t1 - t0) * 1e3, BENCH_PROBES, (t2 - t1) * 1e3, found);
+
+    t0 = bench_now();
+    bintree_save(b, BENCH_IMAGE_PATH);
+    t1 = bench_now();
+    printf("%-24s %10.1f ms  %li bytes\n", "bintree_save", (t1 - t0) * 1e3,
+           128 + (n + 1) * (long)sizeof(int));
+    bintree_destroy(b);
+
+    _bench_drop_cache(BENCH_IMAGE_PATH);
+    _bench_load("mmap, cold", probe);
+    _bench_load("mmap, warm", probe);
+
+    unlink(BENCH_IMAGE_PATH);
+    free(keys);
+    free(probe);
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Per-op latency of the recursive, traced insert/search/remove paths
+ * the plain tree used to have ("before") against the iterative public
+ * APIs ("after").  The old paths are reproduced here on raw nodes.
+ * Logging is filtered by level in both cases, so "before" excludes the
+ * cost of actually printing and understates the real difference.
+ * Keys are random, the old recursive paths cannot survive sorted input
+ * at these sizes.
+ */
+
+/* owner passed to the node allocator by the old paths */
+static bintree_t *old_tree = NULL;
+
+static bintreenode_t*
+_old_insert(bintreenode_t *node, int data)
+{
+    if (NULL == node) {
+        logger(dbgInfo, "Hit leaf node, adding %i", data);
+        return _bintree_node_alloc(old_tree, data);
+    }
+    if (data < node->data) {
+        logger(dbgInfo, "Cur node %i, data %i, going left", node->data, data);
+        node->left = _old_insert(node->left, data);
+    } else {
+        logger(dbgInfo, "Cur node %i, data %i, going right", node->data, data);
+        node->right = _old_insert(node->right, data);
+    }
+    return node;
+}
+
+static int
+_old_search(bintreenode_t *node, int data)
+{
+    if (NULL == node) {
+        logger(dbgInfo, "Did not find node %i", data);
+        return 0;
+    }
+    if (data == node->data) {
+        logger(dbgInfo, "Found node %i", data);
+        return 1;
+    }
+    if (data < node->data) {
+        return _old_search(node->left, data);
+    }
+    return _old_search(node->right, data);
+}
+
+static bintreenode_t*
+_old_remove(bintreenode_t *root, int data)
+{
+    if (NULL == root) {
+        return root;
+    }
+    if (data < root->data) {
+        root->left = _old_remove(root->left, data);
+    } else if (data > root->data) {
+        root->right = _old_remove(root->right, data);
+    } else {
+        bintreenode_t *tmp = NULL;
+        if (NULL == root->left) {
+            tmp = root->right;
+            _bintree_node_free(old_tree, root);
+            return tmp;
+        } else if (NULL == root->right) {
+            tmp = root->left;
+            _bintree_node_free(old_tree, root);
+            return tmp;
+        }
+        bintreenode_t *min_node = root->right;
+        while (NULL != min_node->left) {
+            min_node = min_node->left;
+        }
+        root->data = min_node->data;
+        root->right = _old_remove(root->right, root->data);
+    }
+    return root;
+}
+
+static void
+_bench_one(long n)
+{
+    int *keys = bench_keys_random(n, 1);
+    int *probe = bench_keys_random(n, 2);
+    bintreenode_t *root = NULL;
+    long found = 0;
+    long i = 0;
+    double t0, t1, t2, t3;
+
+    old_tree = bintree_create("before");
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        logger(dbgInfo, "Adding data: %i", keys[i]);
+        root = _old_insert(root, keys[i]);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++) {
+        logger(dbgInfo, "Searching for data: %i", probe[i]);
+        found += _old_search(root, probe[i]);
+    }
+    t2 = bench_now();
+    for (i = 0; i < n; i++) {
+        logger(dbgInfo, "Removing data: %i", probe[i]);
+        root = _old_remove(root, probe[i]);
+    }
+    t3 = bench_now();
+    printf("%9li before  insert %8.1f ns/op  search %8.1f ns/op  remove %8.1f ns/op  (found %li)\n",
+           n, (t1 - t0) / n * 1e9, (t2 - t1) / n * 1e9, (t3 - t2) / n * 1e9, found);
+    bintree_destroy(old_tree);
+
+    found = 0;
+    BintreePtr b = bintree_create("iterative");
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++) {
+        found += bintree_search(b, probe[i]);
+    }
+    t2 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_remove(b, probe[i]);
+    }
+    t3 = bench_now();
+    printf("%9li after   insert %8.1f ns/op  search %8.1f ns/op  remove %8.1f ns/op  (found %li)\n",
+           n, (t1 - t0) / n * 1e9, (t2 - t1) / n * 1e9, (t3 - t2) / n * 1e9, found);
+
+    bintree_destroy(b);
+    free(keys);
+    free(probe);
+}
+
+void
+bench_iterative(long n)
+{
+    /* small trees show per-level overhead, large ones are miss-bound */
+    _bench_one(n / 100);
+    _bench_one(n / 10);
+    _bench_one(n);
+}
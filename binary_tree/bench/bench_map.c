@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_map_ext.h"
+#include "bintree_map_gen.h"
+
+/*
+ * Key/value maps with int keys: the comparator-callback map against the
+ * one BINTREE_MAP_DEFINE generates.  Same AVL algorithm; the callback map
+ * pays an indirect call per comparison and a pointer chase to reach each
+ * key, the generated one compares keys stored in the node inline.
+ */
+
+BINTREE_MAP_DEFINE(bmap, int, long, BINTREE_MAP_CMP_NUM)
+
+static int
+_bench_cmp(const void *a, const void *b)
+{
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static void
+_bench_print(const char *label, long n, double t0, double t1, double t2,
+             double t3, double t4, long check)
+{
+    printf("%-24s %9li  put %7.1f  update %7.1f  find %7.1f  erase %7.1f ns/op  (check %li)\n",
+           label, n, (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n,
+           (t3 - t2) * 1e9 / n, (t4 - t3) * 1e9 / n, check);
+}
+
+void
+bench_map(long n)
+{
+    int *keys = bench_keys_random(n, 21);
+    int *probe = bench_keys_random(n, 22);
+    long *vals = (long*)malloc(n * sizeof(*vals));
+    long i = 0, check = 0;
+    double t0, t1, t2, t3, t4;
+
+    BintreeMapPtr m = bintree_map_create("callback", _bench_cmp);
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        vals[i] = i;
+        bintree_map_put(m, &keys[i], &vals[i]);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_map_put(m, &keys[i], &vals[n - 1 - i]);
+    }
+    t2 = bench_now();
+    for (i = 0; i < n; i++) {
+        void **vp = bintree_map_find(m, &probe[i]);
+        check += (NULL != vp) ? *(long*)*vp : 0;
+    }
+    t3 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_map_erase(m, &probe[i]);
+    }
+    t4 = bench_now();
+    _bench_print("comparator callback", n, t0, t1, t2, t3, t4, check);
+    bintree_map_destroy(m);
+
+    check = 0;
+    bmap_t *g = bmap_create();
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bmap_put(g, keys[i], i);
+    }
+    t1 = bench_now();
+    for (i = 0; i < n; i++) {
+        bmap_put(g, keys[i], n - 1 - i);
+    }
+    t2 = bench_now();
+    for (i = 0; i < n; i++) {
+        long *vp = bmap_find(g, probe[i]);
+        check += (NULL != vp) ? *vp : 0;
+    }
+    t3 = bench_now();
+    for (i = 0; i < n; i++) {
+        bmap_erase(g, probe[i]);
+    }
+    t4 = bench_now();
+    _bench_print("BINTREE_MAP_DEFINE", n, t0, t1, t2, t3, t4, check);
+    bmap_destroy(g);
+
+    free(keys);
+    free(probe);
+    free(vals);
+}
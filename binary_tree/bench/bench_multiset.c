@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Multiset mode against duplicate nodes.
+ *
+ * n keys drawn from d distinct values, for a few duplication levels,
+ * loaded in random order into a plain, an AVL and a multiset tree.
+ * Reports insert time, heap growth per key, depth, and the time to
+ * count each distinct value's copies.
+ */
+
+static size_t
+_heap_in_use(void)
+{
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+void
+bench_multiset(long n)
+{
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeMultiset};
+    const char *names[] = {"plain", "avl", "multiset"};
+    long distinct[] = {n / 10, n / 1000, 100};
+    int *keys = (int*)malloc(n * sizeof(*keys));
+    int m = 0, j = 0;
+    long i = 0, total = 0;
+
+    for (j = 0; j < sizeof(distinct) / sizeof(distinct[0]); j++) {
+        long d = distinct[j];
+        unsigned int seed = 47;
+
+        for (i = 0; i < n; i++) {
+            keys[i] = (int)((((long)rand_r(&seed) << 15) ^ rand_r(&seed)) % d);
+        }
+        printf("-- %li distinct keys, ~%li copies each\n", d, n / d);
+        for (m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            size_t heap = 0;
+            double t0, t1, t2;
+
+            /* plain trees chain copies: n / d steps per insert */
+            if (bintreePlain == modes[m] && n / d > 1000) {
+                printf("%-10s skipped, %li-deep duplicate chains\n", names[m], n / d);
+                continue;
+            }
+            heap = _heap_in_use();
+            t0 = bench_now();
+            BintreePtr b = bintree_create_mode(names[m], modes[m]);
+            for (i = 0; i < n; i++) {
+                bintree_insert(b, keys[i]);
+            }
+            t1 = bench_now();
+            heap = _heap_in_use() - heap;
+            total = 0;
+            for (i = 0; i < d; i++) {
+                total += bintree_count_key(b, (int)i);
+            }
+            t2 = bench_now();
+            printf("%-10s insert %7.1f ns  count_key %8.1f ns  %6.2f B/key  "
+                   "depth %6i  (total %li)\n", names[m], (t1 - t0) * 1e9 / n,
+                   (t2 - t1) * 1e9 / d, (double)heap / n, bintree_maxdepth(b),
+                   total);
+            bintree_destroy(b);
+        }
+    }
+    free(keys);
+}
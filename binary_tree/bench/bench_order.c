@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Percentile queries on a tree that keeps changing: each round inserts
+ * one key, then asks for p50/p90/p99/p99.9.  bintree_select() answers
+ * from subtree sizes; without it the only way is to export the tree and
+ * index the sorted array (or qsort an unordered copy).
+ */
+
+#define BENCH_ROUNDS 200
+
+static int
+_bench_cmp(const void *a, const void *b)
+{
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+void
+bench_order(long n)
+{
+    int *keys = bench_keys_random(n, 5);
+    int *out = (int*)malloc((n + BENCH_ROUNDS) * sizeof(*out));
+    double pct[] = {0.50, 0.90, 0.99, 0.999};
+    int num_pct = sizeof(pct) / sizeof(pct[0]);
+    long i = 0, sum_sel = 0, sum_exp = 0, sum_qs = 0;
+    int r = 0, p = 0, v = 0;
+
+    BintreePtr b = bintree_create_mode("avl", bintreeAvl);
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+
+    double t0 = bench_now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        bintree_insert(b, keys[r] + 1);
+        int cnt = bintree_count(b);
+        for (p = 0; p < num_pct; p++) {
+            bintree_select(b, (int)(pct[p] * (cnt - 1)), &v);
+            sum_sel += v;
+        }
+    }
+    double t1 = bench_now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        bintree_remove(b, keys[r] + 1);
+    }
+
+    double t2 = bench_now();
+    for (r = 0; r < BENCH_ROUNDS; r++) {
+        bintree_insert(b, keys[r] + 1);
+        int cnt = bintree_to_sorted_array(b, out);
+        for (p = 0; p < num_pct; p++) {
+            sum_exp += out[(int)(pct[p] * (cnt - 1))];
+        }
+    }
+    double t3 = bench_now();
+
+    /* an unordered snapshot has to be sorted first */
+    int rounds_qs = BENCH_ROUNDS / 20;
+    double t4 = bench_now();
+    for (r = 0; r < rounds_qs; r++) {
+        for (i = 0; i < n; i++) {
+            out[i] = keys[i];
+        }
+        qsort(out, n, sizeof(*out), _bench_cmp);
+        for (p = 0; p < num_pct; p++) {
+            sum_qs += out[(int)(pct[p] * (n - 1))];
+        }
+    }
+    double t5 = bench_now();
+
+    printf("%-24s %12.1f ns/round  (check %li)\n", "insert + bintree_select",
+           (t1 - t0) * 1e9 / BENCH_ROUNDS, sum_sel);
+    printf("%-24s %12.1f ns/round  (check %li)\n", "insert + sorted export",
+           (t3 - t2) * 1e9 / BENCH_ROUNDS, sum_exp);
+    printf("%-24s %12.1f ns/round  (check %li)\n", "copy + qsort",
+           (t5 - t4) * 1e9 / rounds_qs, sum_qs);
+
+    t0 = bench_now();
+    for (r = 0; r < 1000000; r++) {
+        sum_sel += bintree_count(b);
+    }
+    t1 = bench_now();
+    printf("%-24s %12.1f ns/call   (check %li)\n", "bintree_count",
+           (t1 - t0) * 1e9 / 1000000, sum_sel);
+
+    bintree_destroy(b);
+    free(keys);
+    free(out);
+}
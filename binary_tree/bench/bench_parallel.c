@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Whole-tree aggregates, serial walk against the thread-pool versions at
+ * 1, 2, 4 and 8 threads, on a plain tree of random keys.  The path sum
+ * asked for does not exist, so every version visits every node.  The
+ * serial reduce is a bintree_range_foreach() over all keys.
+ */
+
+static long
+_bench_key(int data, void *ctx)
+{
+    return data;
+}
+
+static long
+_bench_add(long a, long b)
+{
+    return a + b;
+}
+
+static int
+_bench_fold(int data, void *ctx)
+{
+    *(long*)ctx += data;
+    return 0;
+}
+
+static void
+_bench_row(const char *label, int threads, double t_depth, double t_sum,
+           double t_reduce)
+{
+    printf("%-12s %2i thr  maxdepth %8.1f ms  hasPathSum %8.1f ms  reduce %8.1f ms\n",
+           label, threads, t_depth * 1e3, t_sum * 1e3, t_reduce * 1e3);
+}
+
+void
+bench_parallel(long n)
+{
+    int *keys = bench_keys_random(n, 41);
+    int threads[] = {1, 2, 4, 8};
+    long i = 0, check = 0;
+    int t = 0;
+    double t0, t1, t2, t3;
+
+    BintreePtr b = bintree_create("plain");
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+
+    t0 = bench_now();
+    check += bintree_maxdepth(b);
+    t1 = bench_now();
+    check += bintree_hasPathSum(b, -1);
+    t2 = bench_now();
+    bintree_range_foreach(b, INT_MIN, INT_MAX, _bench_fold, &check);
+    t3 = bench_now();
+    _bench_row("serial", 1, t1 - t0, t2 - t1, t3 - t2);
+
+    for (t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        t0 = bench_now();
+        check += bintree_maxdepth_parallel(b, threads[t]);
+        t1 = bench_now();
+        check += bintree_hasPathSum_parallel(b, -1, threads[t]);
+        t2 = bench_now();
+        check += bintree_reduce_parallel(b, _bench_key, _bench_add, 0, NULL,
+                                         threads[t]);
+        t3 = bench_now();
+        _bench_row("pool", threads[t], t1 - t0, t2 - t1, t3 - t2);
+    }
+    printf("(check %li)\n", check);
+
+    bintree_destroy(b);
+    free(keys);
+}
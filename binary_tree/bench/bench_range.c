@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Range scans: bintree_range_foreach() over windows of 10 .. 100K keys in
+ * AVL, B-tree and frozen trees of n keys, against the only option before
+ * it existed, exporting the whole tree and picking the window out.
+ */
+
+static int
+_bench_sum(int data, void *ctx)
+{
+    *(long*)ctx += data;
+    return 0;
+}
+
+static void
+_bench_scans(const char *label, BintreePtr b, long n)
+{
+    int widths[] = {10, 1000, 100000};
+    int w = 0, q = 0;
+
+    for (w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+        int width = widths[w];
+        int queries = (int)(20000000L / (width + 100));
+        unsigned int seed = 99;
+        long sum = 0, keys = 0;
+
+        if (width > n) {
+            continue;
+        }
+        double t0 = bench_now();
+        for (q = 0; q < queries; q++) {
+            int lo = rand_r(&seed) % (n - width + 1);
+            keys += bintree_range_foreach(b, lo, lo + width - 1, _bench_sum, &sum);
+        }
+        double t1 = bench_now();
+        printf("%-8s width %6i  %9.1f ns/scan  %6.2f ns/key  (sum %li)\n",
+               label, width, (t1 - t0) * 1e9 / queries,
+               (t1 - t0) * 1e9 / keys, sum);
+    }
+}
+
+void
+bench_range(long n)
+{
+    int *keys = bench_keys_random(n, 3);
+    int *out = (int*)malloc(n * sizeof(*out));
+    long i = 0;
+
+    BintreePtr avl = bintree_create_mode("avl", bintreeAvl);
+    BintreePtr bt = bintree_create_mode("btree", bintreeBtree);
+    for (i = 0; i < n; i++) {
+        bintree_insert(avl, keys[i]);
+        bintree_insert(bt, keys[i]);
+    }
+    BintreePtr fz = bintree_freeze(avl);
+
+    _bench_scans("avl", avl, n);
+    _bench_scans("btree", bt, n);
+    _bench_scans("frozen", fz, n);
+
+    /* export-and-filter costs a full walk whatever the width */
+    double t0 = bench_now();
+    bintree_to_sorted_array(avl, out);
+    double t1 = bench_now();
+    printf("%-8s full export %9.1f ns/scan\n", "avl", (t1 - t0) * 1e9);
+
+    bintree_destroy(avl);
+    bintree_destroy(bt);
+    bintree_destroy(fz);
+    free(keys);
+    free(out);
+}
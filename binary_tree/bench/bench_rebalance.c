@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Rebalance: a plain tree of n keys inserted in sorted order is a
+ * chain; report search latency on it, the cost of bintree_rebalance(),
+ * and search latency after.  Then the same inserts into a tree with
+ * auto rebalance on, against the plain inserts.
+ *
+ * A search of the chain walks n/2 nodes on average, so that phase only
+ * makes BENCH_CHAIN_PROBES lookups.  Depths come from bintree_stats(),
+ * which does not recurse down the chain.
+ */
+
+#define BENCH_CHAIN_PROBES 20000
+#define BENCH_TREE_PROBES  2000000
+
+/* ns per lookup of the first cnt probes, cycling through them */
+static double
+_bench_search(BintreePtr b, const int *probe, long n, long cnt, long *found)
+{
+    long i = 0;
+    double t0 = bench_now();
+
+    for (i = 0; i < cnt; i++) {
+        *found += bintree_search(b, probe[i % n]);
+    }
+    return (bench_now() - t0) / cnt * 1e9;
+}
+
+static int
+_bench_height(BintreePtr b)
+{
+    bintree_stats_t st;
+
+    bintree_stats(b, &st);
+    return st.height;
+}
+
+void
+bench_rebalance(long n)
+{
+    int *keys = bench_keys_sorted(n);
+    int *probe = bench_keys_random(n, 2);
+    long found = 0, i = 0;
+    double ins_plain = 0, ins_auto = 0, before = 0, after = 0, t0 = 0;
+    int h_before = 0;
+
+    BintreePtr b = bintree_create("plain");
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    ins_plain = (bench_now() - t0) / n * 1e9;
+    h_before = _bench_height(b);
+    before = _bench_search(b, probe, n, BENCH_CHAIN_PROBES, &found);
+
+    t0 = bench_now();
+    bintree_rebalance(b);
+    t0 = bench_now() - t0;
+    after = _bench_search(b, probe, n, BENCH_TREE_PROBES, &found);
+
+    printf("sorted chain  depth %8i  search %10.1f ns/op\n", h_before, before);
+    printf("rebalanced    depth %8i  search %10.1f ns/op  (%.2f ms, "
+           "%.1f ns/node)\n", _bench_height(b), after, t0 * 1e3, t0 / n * 1e9);
+    printf("speedup       %.0fx\n", before / after);
+    bintree_destroy(b);
+
+    b = bintree_create("auto");
+    bintree_set_auto_rebalance(b, 2.0);
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    ins_auto = (bench_now() - t0) / n * 1e9;
+    after = _bench_search(b, probe, n, BENCH_TREE_PROBES, &found);
+
+    printf("insert sorted plain        %10.1f ns/op\n", ins_plain);
+    printf("insert sorted auto (x2.0)  %10.1f ns/op  depth %i  "
+           "search %.1f ns/op\n", ins_auto, _bench_height(b), after);
+    printf("(found %li)\n", found);
+
+    bintree_destroy(b);
+    free(keys);
+    free(probe);
+}
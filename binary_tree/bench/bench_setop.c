@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Set operations on two n-key AVL trees.
+ *
+ * join:   bintree_union() / bintree_intersection() / bintree_difference()
+ * naive:  what callers did before, one search plus insert or remove per
+ *         key of the other tree
+ *
+ * A holds the multiples of 2, B the multiples of 3, so a third of each
+ * overlaps.  "disjoint" unions A = [0, n) with B = [n, 2n).
+ */
+
+typedef enum { OP_UNION, OP_INTERSECTION, OP_DIFFERENCE } bench_op_e;
+
+static BintreePtr
+_bench_set(long n, long step, long base)
+{
+    int *keys = bench_keys_sorted(n);
+    BintreePtr b = NULL;
+    long i = 0;
+
+    for (i = 0; i < n; i++) {
+        keys[i] = (int)(base + keys[i] * step);
+    }
+    b = bintree_build_sorted("set", keys, n);
+    free(keys);
+    return b;
+}
+
+static int
+_bench_naive(BintreePtr a, BintreePtr b, bench_op_e op)
+{
+    int na = bintree_count(a), nb = bintree_count(b);
+    int *keys = (int*)malloc((na > nb ? na : nb) * sizeof(*keys));
+    int i = 0, n = 0;
+
+    switch (op) {
+    case OP_UNION:
+        n = bintree_to_sorted_array(b, keys);
+        for (i = 0; i < n; i++) {
+            if (!bintree_search(a, keys[i])) {
+                bintree_insert(a, keys[i]);
+            }
+        }
+        break;
+    case OP_INTERSECTION:
+        n = bintree_to_sorted_array(a, keys);
+        for (i = 0; i < n; i++) {
+            if (!bintree_search(b, keys[i])) {
+                bintree_remove(a, keys[i]);
+            }
+        }
+        break;
+    default:
+        n = bintree_to_sorted_array(b, keys);
+        for (i = 0; i < n; i++) {
+            if (bintree_search(a, keys[i])) {
+                bintree_remove(a, keys[i]);
+            }
+        }
+        break;
+    }
+    free(keys);
+    return bintree_count(a);
+}
+
+static void
+_bench_setop(const char *label, long n, long step_a, long base_a,
+             long step_b, long base_b, bench_op_e op)
+{
+    int (*fns[])(BintreePtr, BintreePtr) = {bintree_union,
+                                            bintree_intersection,
+                                            bintree_difference};
+    BintreePtr a = _bench_set(n, step_a, base_a);
+    BintreePtr b = _bench_set(n, step_b, base_b);
+    double t0, t1, t_join, t_naive;
+    int cnt_join = 0, cnt_naive = 0;
+
+    t0 = bench_now();
+    cnt_join = fns[op](a, b);
+    t1 = bench_now();
+    t_join = t1 - t0;
+    bintree_destroy(a);
+    bintree_destroy(b);
+
+    a = _bench_set(n, step_a, base_a);
+    b = _bench_set(n, step_b, base_b);
+    t0 = bench_now();
+    cnt_naive = _bench_naive(a, b, op);
+    t1 = bench_now();
+    t_naive = t1 - t0;
+    bintree_destroy(a);
+    bintree_destroy(b);
+
+    printf("%-14s join %10.1f ms  naive %10.1f ms  x%-7.1f (keys %i/%i)\n",
+           label, t_join * 1e3, t_naive * 1e3, t_naive / t_join,
+           cnt_join, cnt_naive);
+}
+
+void
+bench_setop(long n)
+{
+    _bench_setop("union", n, 2, 0, 3, 0, OP_UNION);
+    _bench_setop("intersection", n, 2, 0, 3, 0, OP_INTERSECTION);
+    _bench_setop("difference", n, 2, 0, 3, 0, OP_DIFFERENCE);
+    _bench_setop("disjoint", n, 1, 0, 1, n, OP_UNION);
+}
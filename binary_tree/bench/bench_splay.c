@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "bench.h"
+#include "bintree_ext.h"
+
+/*
+ * Skewed lookups: splay against plain and AVL trees of n keys inserted
+ * in random order.
+ *
+ * Probes follow a Zipf distribution over the keys (rank r drawn with
+ * probability ~ 1/r^s), for a few skews s; s = 0 is uniform.  Ranks are
+ * assigned in a second random order so the hot keys are not the ones
+ * inserted first, which would put them near the root of the plain tree.
+ */
+
+#define BENCH_ZIPF_PROBES 5000000
+
+/* BENCH_ZIPF_PROBES keys, rank r of n drawn with probability ~ 1/r^s */
+static int*
+_bench_zipf(const int *keys, long n, double s, unsigned int seed)
+{
+    double *cdf = (double*)malloc(n * sizeof(*cdf));
+    int *probe = (int*)malloc(BENCH_ZIPF_PROBES * sizeof(*probe));
+    double sum = 0;
+    long i = 0;
+
+    for (i = 0; i < n; i++) {
+        sum += 1.0 / pow(i + 1, s);
+        cdf[i] = sum;
+    }
+    for (i = 0; i < BENCH_ZIPF_PROBES; i++) {
+        double u = sum * rand_r(&seed) / ((double)RAND_MAX + 1);
+        long lo = 0, hi = n - 1;
+        while (lo < hi) {
+            long mid = (lo + hi) / 2;
+            if (cdf[mid] < u) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        probe[i] = keys[lo];
+    }
+    free(cdf);
+    return probe;
+}
+
+void
+bench_splay(long n)
+{
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeSplay};
+    const char *names[] = {"plain", "avl", "splay"};
+    double skews[] = {0.0, 0.8, 1.0, 1.2};
+    int *keys = bench_keys_random(n, 61);
+    BintreePtr b[3];
+    long i = 0, found = 0;
+    int m = 0, z = 0;
+    double t0, t1;
+
+    for (m = 0; m < 3; m++) {
+        b[m] = bintree_create_mode(names[m], modes[m]);
+        for (i = 0; i < n; i++) {
+            bintree_insert(b[m], keys[i]);
+        }
+    }
+    bench_shuffle(keys, n, 62);
+    for (z = 0; z < sizeof(skews) / sizeof(skews[0]); z++) {
+        int *probe = _bench_zipf(keys, n, skews[z], 63 + z);
+        printf("zipf s=%.1f ", skews[z]);
+        for (m = 0; m < 3; m++) {
+            found = 0;
+            t0 = bench_now();
+            for (i = 0; i < BENCH_ZIPF_PROBES; i++) {
+                found += bintree_search(b[m], probe[i]);
+            }
+            t1 = bench_now();
+            printf("  %s %7.1f ns", names[m], (t1 - t0) * 1e9 / BENCH_ZIPF_PROBES);
+        }
+        printf("  (found %li)\n", found);
+        free(probe);
+    }
+    for (m = 0; m < 3; m++) {
+        bintree_destroy(b[m]);
+    }
+    free(keys);
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include "bench.h"
+#include "bintree_ext.h"
+#include "bintree_ver_ext.h"
+
+/*
+ * Persistent versions against a mutable AVL tree of n keys.
+ *
+ * build:     n inserts, each one a new version (the previous released)
+ * snapshot:  bintree_ver_retain() against what a mutable tree needs for
+ *            a private copy, bintree_to_sorted_array() + build_sorted()
+ * versions:  BENCH_VERSIONS more single-key inserts with every version
+ *            kept alive; heap growth per version is the price of
+ *            keeping each snapshot
+ */
+
+#define BENCH_VERSIONS 100000
+#define BENCH_PROBES   1000000
+
+static size_t
+_bench_heap(void)
+{
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+void
+bench_version(long n)
+{
+    int *keys = bench_keys_random(n, 51);
+    int *probe = bench_keys_random(n, 52);
+    int *sorted = (int*)malloc(n * sizeof(*sorted));
+    BintreeVerPtr *vers = (BintreeVerPtr*)malloc((BENCH_VERSIONS + 1) * sizeof(*vers));
+    BintreeVerPtr v = NULL, next = NULL;
+    BintreePtr b = NULL, copy = NULL;
+    long i = 0, found = 0, probes = n < BENCH_PROBES ? n : BENCH_PROBES;
+    size_t heap0 = 0;
+    double t0, t1;
+
+    t0 = bench_now();
+    b = bintree_create_mode("avl", bintreeAvl);
+    for (i = 0; i < n; i++) {
+        bintree_insert(b, keys[i]);
+    }
+    t1 = bench_now();
+    printf("%-22s %10.1f ns/insert\n", "build avl", (t1 - t0) * 1e9 / n);
+
+    t0 = bench_now();
+    v = bintree_ver_create("ver");
+    for (i = 0; i < n; i++) {
+        next = bintree_ver_insert(v, keys[i]);
+        bintree_ver_release(v);
+        v = next;
+    }
+    t1 = bench_now();
+    printf("%-22s %10.1f ns/insert\n", "build versioned", (t1 - t0) * 1e9 / n);
+
+    t0 = bench_now();
+    for (i = 0; i < probes; i++) {
+        found += bintree_search(b, probe[i]);
+    }
+    t1 = bench_now();
+    printf("%-22s %10.1f ns/search\n", "search avl", (t1 - t0) * 1e9 / probes);
+    t0 = bench_now();
+    for (i = 0; i < probes; i++) {
+        found += bintree_ver_search(v, probe[i]);
+    }
+    t1 = bench_now();
+    printf("%-22s %10.1f ns/search  (found %li)\n", "search versioned",
+           (t1 - t0) * 1e9 / probes, found);
+
+    t0 = bench_now();
+    bintree_to_sorted_array(b, sorted);
+    copy = bintree_build_sorted("copy", sorted, n);
+    t1 = bench_now();
+    printf("%-22s %10.3f ms\n", "snapshot by copy", (t1 - t0) * 1e3);
+    bintree_destroy(copy);
+    t0 = bench_now();
+    next = bintree_ver_retain(v);
+    t1 = bench_now();
+    printf("%-22s %10.3f ms\n", "snapshot by retain", (t1 - t0) * 1e3);
+    bintree_ver_release(next);
+
+    heap0 = _bench_heap();
+    vers[0] = v;
+    for (i = 0; i < BENCH_VERSIONS; i++) {
+        vers[i + 1] = bintree_ver_insert(vers[i], (int)(n + i));
+    }
+    printf("%-22s %10.1f bytes/version (%i live versions, a full copy is %li)\n",
+           "memory", (double)(_bench_heap() - heap0) / BENCH_VERSIONS,
+           BENCH_VERSIONS, n * 32);
+    t0 = bench_now();
+    for (i = 0; i <= BENCH_VERSIONS; i++) {
+        bintree_ver_release(vers[i]);
+    }
+    t1 = bench_now();
+    printf("%-22s %10.1f ns/version\n", "release", (t1 - t0) * 1e9 / BENCH_VERSIONS);
+
+    bintree_destroy(b);
+    free(vers);
+    free(sorted);
+    free(probe);
+    free(keys);
+}
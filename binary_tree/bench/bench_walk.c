@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "bintree_ext.h"
+#include "bintree_int.h"
+
+/*
+ * Callback traversals over an n-node degenerate chain (what sorted
+ * inserts give a plain tree), leaning right and leaning left, and over
+ * a balanced tree of the same keys.  The chains are linked up directly,
+ * n sorted inserts would take O(n^2).  The recursive logging
+ * bintree_inorder() is run in a child process, since it is expected to
+ * blow the stack.
+ */
+
+static int
+_bench_sum(int data, void *ctx)
+{
+    *(long*)ctx += data;
+    return 0;
+}
+
+static BintreePtr
+_bench_chain(long n, int right)
+{
+    BintreePtr b = bintree_create(right ? "right chain" : "left chain");
+    bintreenode_t *prev = NULL;
+    long i = 0;
+
+    /* build bottom-up so every size is known */
+    for (i = 0; i < n; i++) {
+        int data = right ? (int)(n - 1 - i) : (int)i;
+        bintreenode_t *node = _bintree_node_alloc(b, data);
+        node->size = (int)i + 1;
+        if (right) {
+            node->right = prev;
+        } else {
+            node->left = prev;
+        }
+        prev = node;
+    }
+    b->root = prev;
+    return b;
+}
+
+static void
+_bench_recursive(BintreePtr b)
+{
+    int status = 0;
+    pid_t pid = fork();
+
+    if (0 == pid) {
+        bintree_inorder(b);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    if (WIFSIGNALED(status)) {
+        printf("%-24s killed by signal %i\n", "  bintree_inorder", WTERMSIG(status));
+    } else {
+        printf("%-24s completed\n", "  bintree_inorder");
+    }
+}
+
+static void
+_bench_walks(const char *label, BintreePtr b, long n)
+{
+    long sum = 0;
+    double t0, t1, t2, t3;
+
+    t0 = bench_now();
+    bintree_preorder_foreach(b, _bench_sum, &sum);
+    t1 = bench_now();
+    bintree_inorder_foreach(b, _bench_sum, &sum);
+    t2 = bench_now();
+    bintree_postorder_foreach(b, _bench_sum, &sum);
+    t3 = bench_now();
+    printf("%-24s %9li  pre %8.1f ms  in %8.1f ms  post %8.1f ms  (check %li)\n",
+           label, n, (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t3 - t2) * 1e3, sum);
+}
+
+void
+bench_walk(long n)
+{
+    int *keys = bench_keys_sorted(n);
+    BintreePtr b = NULL;
+
+    b = _bench_chain(n, 1);
+    _bench_walks("right chain", b, n);
+    _bench_recursive(b);
+    bintree_destroy(b);
+
+    b = _bench_chain(n, 0);
+    _bench_walks("left chain", b, n);
+    _bench_recursive(b);
+    bintree_destroy(b);
+
+    b = bintree_build_sorted("balanced", keys, n);
+    _bench_walks("balanced", b, n);
+    bintree_destroy(b);
+    free(keys);
+}
@@ -0,0 +1,120 @@
+#ifndef __BINTREE_AVL_GEN_H__
+#define __BINTREE_AVL_GEN_H__
+
+#include <stddef.h>
+
+/*
+ * AVL balancing generator
+ *
+ * BINTREE_AVL_DEFINE(name, node_t, update, own, rotated) expands to the
+ * height bookkeeping, rotations and rebalance step for any node type
+ * with height, left and right fields, so the AVL trees in bintree
+ * balance with the same code:
+ *
+ *   static int     name_height(node_t *node);       0 for NULL
+ *   static void    name_fix(node_t *node);          height from children
+ *   static node_t* name_rotate_right(node_t *y);
+ *   static node_t* name_rotate_left(node_t *x);
+ *   static node_t* name_rebalance(node_t *node);
+ *   static node_t* name_rebalance_with(void *ctx, node_t *node);
+ *
+ * The hooks are function-like macros or functions:
+ *
+ *   update(node)      after name_fix() set node's height, recompute
+ *                     anything else kept per subtree (BINTREE_AVL_NOP)
+ *   own(ctx, link)    make the node link points at safe to modify;
+ *                     called on every node a rotation is about to move
+ *                     except the subtree root, which the caller owns.
+ *                     BINTREE_AVL_NOP unless nodes are copied before
+ *                     they are written
+ *   rotated()         once per rotation (BINTREE_AVL_NOP)
+ *
+ * name_rebalance() passes ctx NULL to own.  All functions are static.
+ */
+
+#define BINTREE_AVL_NOP(...) do {} while (0)
+
+#define BINTREE_AVL_DEFINE(name, node_t, update, own, rotated)                \
+                                                                              \
+static inline int                                                             \
+name##_height(node_t *node)                                                   \
+{                                                                             \
+    return (NULL == node) ? 0 : node->height;                                 \
+}                                                                             \
+                                                                              \
+static inline void                                                            \
+name##_fix(node_t *node)                                                      \
+{                                                                             \
+    int hl = name##_height(node->left);                                       \
+    int hr = name##_height(node->right);                                      \
+    node->height = 1 + (hl > hr ? hl : hr);                                   \
+    update(node);                                                             \
+}                                                                             \
+                                                                              \
+/*        y            x                                                      \
+ *       / \          / \                                                     \
+ *      x   c  -->   a   y                                                    \
+ *     / \              / \                                                   \
+ *    a   b            b   c                                                  \
+ */                                                                           \
+static inline node_t*                                                         \
+name##_rotate_right(node_t *y)                                                \
+{                                                                             \
+    node_t *x = y->left;                                                      \
+    rotated();                                                                \
+    y->left = x->right;                                                       \
+    x->right = y;                                                             \
+    name##_fix(y);                                                            \
+    name##_fix(x);                                                            \
+    return x;                                                                 \
+}                                                                             \
+                                                                              \
+static inline node_t*                                                         \
+name##_rotate_left(node_t *x)                                                 \
+{                                                                             \
+    node_t *y = x->right;                                                     \
+    rotated();                                                                \
+    x->right = y->left;                                                       \
+    y->left = x;                                                              \
+    name##_fix(x);                                                            \
+    name##_fix(y);                                                            \
+    return y;                                                                 \
+}                                                                             \
+                                                                              \
+/* after one subtree of node changed height by at most one: if left-heavy     \
+   by 2 rotate right, first rotating the left child left if it leans          \
+   right; mirror for right-heavy */                                           \
+static inline node_t*                                                         \
+name##_rebalance_with(void *ctx, node_t *node)                                \
+{                                                                             \
+    int balance = 0;                                                          \
+    name##_fix(node);                                                         \
+    balance = name##_height(node->left) - name##_height(node->right);         \
+    if (balance > 1) {                                                        \
+        own(ctx, &node->left);                                                \
+        if (name##_height(node->left->left) <                                 \
+            name##_height(node->left->right)) {                               \
+            own(ctx, &node->left->right);                                     \
+            node->left = name##_rotate_left(node->left);                      \
+        }                                                                     \
+        return name##_rotate_right(node);                                     \
+    }                                                                         \
+    if (balance < -1) {                                                       \
+        own(ctx, &node->right);                                               \
+        if (name##_height(node->right->right) <                               \
+            name##_height(node->right->left)) {                               \
+            own(ctx, &node->right->left);                                     \
+            node->right = name##_rotate_right(node->right);                   \
+        }                                                                     \
+        return name##_rotate_left(node);                                      \
+    }                                                                         \
+    return node;                                                              \
+}                                                                             \
+                                                                              \
+static inline node_t*                                                         \
+name##_rebalance(node_t *node)                                                \
+{                                                                             \
+    return name##_rebalance_with(NULL, node);                                 \
+}
+
+#endif /* __BINTREE_AVL_GEN_H__ */
@@ -0,0 +1,34 @@
+#ifndef __BINTREE_COMPACT_EXT_H__
+#define __BINTREE_COMPACT_EXT_H__
+
+#include <stddef.h>
+
+/*
+ * Compact unbalanced int tree
+ *
+ * Same shape and semantics as a bintreePlain tree (equal keys go right,
+ * remove takes out one), but nodes live in one growable array and link
+ * to each other by 32-bit index: 12 bytes a node instead of 32, so more
+ * of the tree fits in each cache line and page.  No subtree sizes are
+ * kept, so there is no select or rank.  Not thread safe.
+ */
+
+typedef struct bintree_compact_s* BintreeCompactPtr;
+
+/* Public APIs */
+BintreeCompactPtr bintree_compact_create(const char *name);
+void bintree_compact_destroy(BintreeCompactPtr treep);
+
+void bintree_compact_reserve(BintreeCompactPtr treep, int n);
+void bintree_compact_insert(BintreeCompactPtr treep, int data);
+void bintree_compact_remove(BintreeCompactPtr treep, int data);
+int  bintree_compact_search(BintreeCompactPtr treep, int data);
+int  bintree_compact_count(BintreeCompactPtr treep);
+int  bintree_compact_minvalue(BintreeCompactPtr treep);
+int  bintree_compact_maxvalue(BintreeCompactPtr treep);
+int  bintree_compact_maxdepth(BintreeCompactPtr treep);
+int  bintree_compact_inorder_foreach(BintreeCompactPtr treep,
+                                     int (*fn)(int data, void *ctx), void *ctx);
+size_t bintree_compact_memory(BintreeCompactPtr treep);
+
+#endif /* __BINTREE_COMPACT_EXT_H__ */
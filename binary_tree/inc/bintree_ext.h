@@ -1,10 +1,56 @@
 #ifndef __BINTREE_EXT_H__
 #define __BINTREE_EXT_H__
 
+#include <stdint.h>
+
 typedef struct bintree_s* BintreePtr;
+typedef struct bintree_iter_s* BintreeIterPtr;
+
+/* Tree flavours, picked at create time */
+typedef enum bintree_mode_ {
+    bintreePlain,      /* unbalanced BST, shape follows insert order */
+    bintreeAvl,        /* AVL, height kept O(log n) on insert/remove */
+    bintreeBtree,      /* B-tree, one cache line of keys per node */
+    bintreeFrozen,     /* read-only Eytzinger array, see bintree_freeze()
+                          and bintree_load_mmap() */
+    bintreeConcurrent, /* AVL, lock-free readers, writers serialized */
+    bintreeSplay,      /* self-adjusting, searched keys move to the root;
+                          single-threaded, searches modify the tree */
+    bintreeMultiset,   /* AVL, one node per distinct key holding how many
+                          times it was inserted */
+    bintreeModeMax
+} bintree_mode_e;
+
+/*
+ * Shape and cost figures from bintree_stats(), gathered in one O(n) pass.
+ * Depths count nodes from the root, which is at depth 1; B-tree depths
+ * are node levels and each key counts at its node's level.
+ */
+#define BINTREE_STATS_DEPTHS   64   /* the last bucket takes deeper nodes too */
+#define BINTREE_STATS_BALANCES 5    /* balance <= -2, -1, 0, 1, >= 2 */
+
+typedef struct bintree_stats_s {
+    long keys;                          /* duplicates included */
+    long nodes;                         /* B-tree: keys */
+    int height;                         /* same as bintree_maxdepth() */
+    long depth_hist[BINTREE_STATS_DEPTHS];      /* [d] nodes at depth d + 1 */
+    double avg_path;                    /* nodes visited by a search for
+                                           a key in the tree, on average */
+    long balance_hist[BINTREE_STATS_BALANCES];  /* nodes by height(left) -
+                                           height(right), binary modes */
+    size_t memory;                      /* bytes held, tree header included */
+
+    /* Process-wide, since start or bintree_stats_reset_counters(); only
+       counted when built with -DBINTREE_STATS_COUNTERS, else 0 */
+    long searches;                      /* plain, AVL, concurrent and
+                                           multiset bintree_search() calls */
+    long search_cmps;                   /* nodes those searches visited */
+    long rotations;                     /* AVL, concurrent, multiset, splay */
+} bintree_stats_t;
 
 /* Public APIs */
 BintreePtr bintree_create(const char *name);
+BintreePtr bintree_create_mode(const char *name, bintree_mode_e mode);
 void bintree_destroy(BintreePtr bintreep);
 
 void bintree_insert(BintreePtr bintreep, int data);
@@ -15,10 +61,50 @@ int  bintree_minvalue(BintreePtr bintreep);
 int  bintree_maxvalue(BintreePtr bintreep);
 int  bintree_maxdepth(BintreePtr bintreep);
 int  bintree_hasPathSum(BintreePtr bintreep, int sum);
+int  bintree_select(BintreePtr bintreep, int k, int *result);
+int  bintree_rank(BintreePtr bintreep, int data);
+int  bintree_count_key(BintreePtr bintreep, int data);
+int  bintree_stats(BintreePtr bintreep, bintree_stats_t *out);
+void bintree_stats_reset_counters(void);
+int  bintree_rebalance(BintreePtr bintreep);
+int  bintree_set_auto_rebalance(BintreePtr bintreep, double factor);
 
 void bintree_preorder(BintreePtr bintreep);
 void bintree_inorder(BintreePtr bintreep);
 void bintree_postorder(BintreePtr bintreep);
+int  bintree_preorder_foreach(BintreePtr bintreep, int (*fn)(int data, void *ctx),
+                              void *ctx);
+int  bintree_inorder_foreach(BintreePtr bintreep, int (*fn)(int data, void *ctx),
+                             void *ctx);
+int  bintree_postorder_foreach(BintreePtr bintreep, int (*fn)(int data, void *ctx),
+                               void *ctx);
+
+BintreePtr bintree_build_sorted(const char *name, const int *keys, int n);
+int  bintree_to_sorted_array(BintreePtr bintreep, int *out);
+
+int  bintree_union(BintreePtr dst, BintreePtr src);
+int  bintree_intersection(BintreePtr dst, BintreePtr src);
+int  bintree_difference(BintreePtr dst, BintreePtr src);
+
+BintreePtr bintree_freeze(BintreePtr bintreep);
+void bintree_search_many(BintreePtr bintreep, const int *keys, int n, uint8_t *found);
+void bintree_search_batch(BintreePtr bintreep, const int *keys, int n, uint8_t *found);
+
+int  bintree_maxdepth_parallel(BintreePtr bintreep, int nthreads);
+int  bintree_hasPathSum_parallel(BintreePtr bintreep, int sum, int nthreads);
+long bintree_reduce_parallel(BintreePtr bintreep, long (*map)(int data, void *ctx),
+                             long (*combine)(long a, long b), long identity,
+                             void *ctx, int nthreads);
+
+int  bintree_save(BintreePtr bintreep, const char *path);
+BintreePtr bintree_load_mmap(const char *path);
+
+int  bintree_lower_bound(BintreePtr bintreep, int data, int *result);
+int  bintree_range_foreach(BintreePtr bintreep, int lo, int hi,
+                           int (*fn)(int data, void *ctx), void *ctx);
+BintreeIterPtr bintree_iter_create(BintreePtr bintreep, int from);
+int  bintree_iter_next(BintreeIterPtr iterp, int *data);
+void bintree_iter_destroy(BintreeIterPtr iterp);
 
 #endif /* __BINTREE_EXT_H__ */
 
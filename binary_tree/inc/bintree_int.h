@@ -1,24 +1,333 @@
 #ifndef __BINTREE_INT_H__
 #define __BINTREE_INT_H__
 
+#include <pthread.h>
+#include "bintree_ext.h"
+#include "bintree_map_ext.h"
+#include "bintree_ver_ext.h"
+#include "bintree_compact_ext.h"
+#include "epoch.h"
+
 #define BINTREE_MAGIC_IN_USE 0x1235
 #define BINTREE_MAGIC_FREED  0x1236
 
 #define BINTREE_MAX_NAME_LEN 80
 
+#define BINTREE_ITER_MAGIC_IN_USE 0x1238
+#define BINTREE_ITER_MAGIC_FREED  0x1239
+
+#define BINTREE_MAP_MAGIC_IN_USE 0x123A
+#define BINTREE_MAP_MAGIC_FREED  0x123B
+
+#define BINTREE_VER_MAGIC_IN_USE 0x123C
+#define BINTREE_VER_MAGIC_FREED  0x123D
+
+#define BINTREE_COMPACT_MAGIC_IN_USE 0x123E
+#define BINTREE_COMPACT_MAGIC_FREED  0x123F
+
+/* Needs logger.h and an 'out' label in the caller */
+#define MAGIC_IN_USE_CHECK(_mag_) \
+    if (BINTREE_MAGIC_IN_USE != _mag_) { \
+        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
+                BINTREE_MAGIC_IN_USE, _mag_); \
+        goto out; \
+    } \
+
+
 /* Internal binary-tree node */
 typedef struct bintreenode_s {
     int data;
+    int height;                 /* subtree height, maintained by AVL mode */
+    int size;                   /* keys in this subtree, itself included */
+    int count;                  /* copies of data, only bintreeMultiset
+                                   mode has any other value than 1 */
     struct bintreenode_s *left;
     struct bintreenode_s *right;
 } bintreenode_t;
 
+/*
+ * Node arena for plain and AVL modes.  Nodes are carved from chunks that
+ * double from BINTREE_ARENA_MIN_CHUNK up to BINTREE_ARENA_MAX_CHUNK nodes;
+ * removed nodes go on a freelist chained through ->left.  Destroying the
+ * tree frees the chunks without walking the nodes.
+ */
+#define BINTREE_ARENA_MIN_CHUNK 32
+#define BINTREE_ARENA_MAX_CHUNK 65536
+
+typedef struct bintree_chunk_s {
+    struct bintree_chunk_s *next;
+    bintreenode_t nodes[];
+} bintree_chunk_t;
+
+/*
+ * Internal B-tree node, header plus keys fill one 64-byte cache line.
+ * Child pointers are only allocated for internal nodes.
+ */
+#define BTREE_MAX_KEYS   15
+#define BTREE_MIN_DEGREE ((BTREE_MAX_KEYS + 1) / 2)
+
+typedef struct btreenode_s {
+    unsigned short nkeys;
+    unsigned short leaf;
+    int keys[BTREE_MAX_KEYS];          /* unused slots hold INT_MAX */
+    struct btreenode_s *child[];       /* nkeys + 1 used, internal only */
+} btreenode_t;
 
 /* Public list */
 typedef struct bintree_s {
     int magic;
     char name[BINTREE_MAX_NAME_LEN];
+    bintree_mode_e mode;
     bintreenode_t *root;
+    btreenode_t *broot;         /* bintreeBtree mode only */
+    int *eytz;                  /* bintreeFrozen mode only, 1-based */
+    int nkeys;                  /* bintreeBtree and bintreeFrozen modes */
+    void *image;                /* bintree_load_mmap() mapping eytz points into */
+    size_t image_len;
+    bintree_chunk_t *chunks;    /* node arena, newest chunk first */
+    int chunk_used;             /* nodes handed out from the newest chunk */
+    int chunk_cap;
+    bintreenode_t *freelist;    /* removed nodes, chained through ->left */
+    size_t arena_bytes;         /* held by chunks, for bintree_stats() */
+    double rebalance_factor;    /* bintree_set_auto_rebalance(), 0 = off */
+    pthread_mutex_t wlock;      /* bintreeConcurrent mode only, serializes writers */
+    bintreenode_t **stale;      /* nodes replaced by the write in progress */
+    int stale_len;
+    int stale_cap;
 } bintree_t;
 
+/*
+ * On-disk image written by bintree_save(): this header, then nkeys + 1
+ * ints in the frozen Eytzinger layout (slot 0 unused), so a read-only
+ * mapping of the file can serve as a frozen tree's array.  The header
+ * is a whole number of cache lines to keep the array aligned.
+ */
+#define BINTREE_IMAGE_MAGIC   "BINTREE"
+#define BINTREE_IMAGE_VERSION 1
+#define BINTREE_IMAGE_BOM     0x01020304u   /* catches byte-order mismatch */
+
+typedef struct bintree_image_hdr_s {
+    char magic[8];
+    uint32_t version;
+    uint32_t bom;
+    uint32_t key_size;          /* sizeof(int) of the writer */
+    uint32_t nkeys;
+    char name[BINTREE_MAX_NAME_LEN];
+    char pad[24];
+} bintree_image_hdr_t;
+
+/* Key/value map node and map, see bintree_map.c */
+typedef struct bintree_mapnode_s {
+    const void *key;
+    void *value;
+    int height;
+    struct bintree_mapnode_s *left;
+    struct bintree_mapnode_s *right;
+} bintree_mapnode_t;
+
+typedef struct bintree_map_s {
+    int magic;
+    char name[BINTREE_MAX_NAME_LEN];
+    bintree_map_cmp_fn cmp;
+    bintree_mapnode_t *root;
+    int count;
+} bintree_map_t;
+
+/*
+ * Persistent tree node and version, see bintree_ver.c.  refcnt counts
+ * the parents and versions pointing at the node; it fits in what would
+ * be padding, so a node is the same 32 bytes as a bintreenode_t.
+ */
+typedef struct bintree_vnode_s {
+    int data;
+    int height;
+    int size;
+    int refcnt;
+    struct bintree_vnode_s *left;
+    struct bintree_vnode_s *right;
+} bintree_vnode_t;
+
+typedef struct bintree_ver_s {
+    int magic;
+    int refcnt;                 /* handles held by callers */
+    long number;                /* 0 at create, parent's + 1 after a write */
+    char name[BINTREE_MAX_NAME_LEN];
+    bintree_vnode_t *root;
+} bintree_ver_t;
+
+/*
+ * Compact tree node and tree, see bintree_compact.c.  Nodes are slots of
+ * one array and link by index; slot 0 is never used, so index 0 is the
+ * empty link.  Freed slots are chained through left.
+ */
+#define BINTREE_COMPACT_NIL       0u
+#define BINTREE_COMPACT_MIN_SLOTS 64
+
+typedef struct bintree_cnode_s {
+    int data;
+    uint32_t left;
+    uint32_t right;
+} bintree_cnode_t;
+
+typedef struct bintree_compact_s {
+    int magic;
+    char name[BINTREE_MAX_NAME_LEN];
+    bintree_cnode_t *slot;
+    uint32_t cap;               /* slots allocated, slot 0 included */
+    uint32_t used;              /* slots ever handed out, slot 0 included */
+    uint32_t root;
+    uint32_t freelist;
+    int count;
+} bintree_compact_t;
+
+/**
+ * Pin the current version of a tree for reading and return its root
+ *
+ * Only bintreeConcurrent mode needs this; it makes every node reachable
+ * from the returned root safe to use until _bintree_read_exit()
+ *
+ * @param bintreep (i) tree to read
+ * @return root node
+ */
+static inline bintreenode_t*
+_bintree_read_enter(bintree_t *bintreep)
+{
+    if (bintreeConcurrent == bintreep->mode) {
+        epoch_enter();
+        return __atomic_load_n(&bintreep->root, __ATOMIC_ACQUIRE);
+    }
+    return bintreep->root;
+}
+
+/**
+ * End a read started by _bintree_read_enter()
+ *
+ * @param bintreep (i) tree being read
+ * @return void
+ */
+static inline void
+_bintree_read_exit(bintree_t *bintreep)
+{
+    if (bintreeConcurrent == bintreep->mode) {
+        epoch_exit();
+    }
+}
+
+/*
+ * In-order iterator.  Stack depth is O(tree height); plain/AVL trees use
+ * the inline stack until a degenerate tree forces it onto the heap.
+ */
+#define BINTREE_ITER_INLINE  64
+#define BTREE_ITER_MAX_DEPTH 32
+
+typedef struct bintree_iter_s {
+    int magic;
+    bintree_t *tree;
+    int top;
+    int cap;
+    bintreenode_t **stack;                             /* plain/AVL */
+    bintreenode_t *inline_stack[BINTREE_ITER_INLINE];
+    const btreenode_t *bnode[BTREE_ITER_MAX_DEPTH];    /* B-tree: node and */
+    int bidx[BTREE_ITER_MAX_DEPTH];                    /* next key index */
+    unsigned int slot;                                 /* frozen, 0 = end */
+    int repeat;                        /* copies of the top node produced */
+} bintree_iter_t;
+
+/*
+ * Optional cost counters, see bintree_stats().  Off by default: build
+ * with -DBINTREE_STATS_COUNTERS to count.  Process-wide, so updated with
+ * relaxed atomics from any thread.
+ */
+typedef struct bintree_counters_s {
+    long searches;
+    long search_cmps;
+    long rotations;
+} bintree_counters_t;
+
+extern bintree_counters_t _bintree_counters;
+
+#ifdef BINTREE_STATS_COUNTERS
+#define BINTREE_COUNT(_ctr_) \
+    __atomic_add_fetch(&_bintree_counters._ctr_, 1, __ATOMIC_RELAXED)
+#else
+#define BINTREE_COUNT(_ctr_) do {} while (0)
+#endif
+
+/* Lookups kept in flight by bintree_search_batch() on pointer trees */
+#define BINTREE_BATCH_GROUP 16
+
+/* Traversal orders for the callback walks, see bintree_walk.c */
+typedef enum bintree_order_ {
+    bintreePreorder,
+    bintreeInorder,
+    bintreePostorder
+} bintree_order_e;
+
+/* Node alloc/free, see bintree.c */
+bintreenode_t* _bintree_node_alloc(bintree_t *bintreep, int data);
+void _bintree_node_free(bintree_t *bintreep, bintreenode_t *node);
+
+/* AVL mode, see bintree_avl.c */
+bintreenode_t* _bintree_avl_insert(bintree_t *bintreep, bintreenode_t *node, int data);
+bintreenode_t* _bintree_avl_remove(bintree_t *bintreep, bintreenode_t *node, int data);
+bintreenode_t* _bintree_avl_join(bintreenode_t *l, bintreenode_t *mid, bintreenode_t *r);
+bintreenode_t* _bintree_avl_join2(bintreenode_t *l, bintreenode_t *r);
+bintreenode_t* _bintree_avl_split(bintreenode_t *node, int data, bintreenode_t **l,
+                                  bintreenode_t **r);
+
+/* Splay mode, see bintree_splay.c */
+int  _bintree_splay_search(bintree_t *bintreep, int data);
+void _bintree_splay_insert(bintree_t *bintreep, int data);
+void _bintree_splay_remove(bintree_t *bintreep, int data);
+
+/* Rebalancing, see bintree_rebalance.c */
+void _bintree_dsw(bintree_t *bintreep);
+int  _bintree_rebalance_due(bintree_t *bintreep, int depth);
+
+/* Concurrent mode writers, see bintree_rcu.c */
+void _bintree_rcu_insert(bintree_t *bintreep, int data);
+void _bintree_rcu_remove(bintree_t *bintreep, int data);
+
+/* B-tree mode, see bintree_btree.c */
+void _bintree_btree_insert(btreenode_t **rootp, int data);
+int  _bintree_btree_remove(btreenode_t **rootp, int data);
+int  _bintree_btree_search(const btreenode_t *node, int data);
+void _bintree_btree_destroy(btreenode_t *node);
+int  _bintree_btree_minvalue(const btreenode_t *node);
+int  _bintree_btree_maxvalue(const btreenode_t *node);
+int  _bintree_btree_maxdepth(const btreenode_t *node);
+void _bintree_btree_traverse(const btreenode_t *node, const char *order);
+int  _bintree_btree_walk(const btreenode_t *node, bintree_order_e order,
+                         int (*fn)(int data, void *ctx), void *ctx);
+int  _bintree_btree_collect(const btreenode_t *node, int *out);
+void _bintree_btree_stats(const btreenode_t *node, int depth, bintree_stats_t *out);
+
+/* Frozen mode, see bintree_frozen.c */
+void _bintree_frozen_build(bintree_t *bintreep, const int *sorted, int n);
+int  _bintree_frozen_search(const int *eytz, int n, int data);
+void _bintree_frozen_search_many(const int *eytz, int n, const int *keys,
+                                 int cnt, uint8_t *found);
+int  _bintree_frozen_minvalue(const int *eytz, int n);
+int  _bintree_frozen_maxvalue(const int *eytz, int n);
+int  _bintree_frozen_maxdepth(int n);
+int  _bintree_frozen_select(const int *eytz, int n, int k);
+int  _bintree_frozen_rank(const int *eytz, int n, int data);
+int  _bintree_frozen_hasPathSum(const int *eytz, int n, int sum);
+void _bintree_frozen_traverse(const int *eytz, int n, const char *order);
+int  _bintree_frozen_walk(const int *eytz, int n, bintree_order_e order,
+                          int (*fn)(int data, void *ctx), void *ctx);
+int  _bintree_frozen_collect(const int *eytz, int n, int *out);
+void _bintree_frozen_stats(int n, bintree_stats_t *out);
+
+/* Arena hand-over for the set operations, see bintree.c */
+void _bintree_arena_merge(bintree_t *dst, bintree_t *src);
+
+/* Saved images, see bintree_image.c */
+void _bintree_image_unmap(bintree_t *bintreep);
+
+/* Ordered iteration, see bintree_iter.c */
+void _bintree_iter_init(bintree_iter_t *iterp, bintree_t *bintreep, int from);
+int  _bintree_iter_next(bintree_iter_t *iterp, int *data);
+void _bintree_iter_release(bintree_iter_t *iterp);
+
 #endif /* __BINTREE_INT_H__ */
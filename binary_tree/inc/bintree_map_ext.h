@@ -0,0 +1,32 @@
+#ifndef __BINTREE_MAP_EXT_H__
+#define __BINTREE_MAP_EXT_H__
+
+/*
+ * Ordered key/value map, AVL balanced
+ *
+ * Keys are opaque pointers ordered by the comparator given at create
+ * time; the map stores the pointers, the caller owns what they point to
+ * and must keep keys alive and unchanged while they are in the map.
+ *
+ * For a fixed key type, bintree_map_gen.h generates the same map with
+ * keys and values stored in the node and the comparison inlined.
+ */
+
+typedef struct bintree_map_s* BintreeMapPtr;
+
+/* <0, 0, >0 as a is less than, equal to, greater than b */
+typedef int (*bintree_map_cmp_fn)(const void *a, const void *b);
+
+/* Public APIs */
+BintreeMapPtr bintree_map_create(const char *name, bintree_map_cmp_fn cmp);
+void bintree_map_destroy(BintreeMapPtr mapp);
+
+int    bintree_map_put(BintreeMapPtr mapp, const void *key, void *value);
+void** bintree_map_find(BintreeMapPtr mapp, const void *key);
+int    bintree_map_erase(BintreeMapPtr mapp, const void *key);
+int    bintree_map_count(BintreeMapPtr mapp);
+int    bintree_map_foreach(BintreeMapPtr mapp,
+                           int (*fn)(const void *key, void *value, void *ctx),
+                           void *ctx);
+
+#endif /* __BINTREE_MAP_EXT_H__ */
@@ -0,0 +1,209 @@
+#ifndef __BINTREE_MAP_GEN_H__
+#define __BINTREE_MAP_GEN_H__
+
+#include <stdlib.h>
+#include <assert.h>
+#include "bintree_avl_gen.h"
+
+/*
+ * Type-specialized ordered key/value map generator
+ *
+ * BINTREE_MAP_DEFINE(name, key_t, val_t, cmp) expands to an AVL map
+ * with the same semantics as bintree_map_ext.h, but with the key and
+ * value stored in the node and cmp expanded inline at every comparison.
+ * cmp(a, b) is a function-like macro or function returning <0, 0, >0;
+ * BINTREE_MAP_CMP_NUM suits any arithmetic key type.
+ *
+ *   BINTREE_MAP_DEFINE(imap, int, double, BINTREE_MAP_CMP_NUM)
+ *
+ * generates:
+ *
+ *   imap_t* imap_create(void);
+ *   void    imap_destroy(imap_t *m);
+ *   int     imap_put(imap_t *m, int key, double value);   1 added, 0 replaced
+ *   double* imap_find(imap_t *m, int key);                NULL if absent
+ *   int     imap_erase(imap_t *m, int key);               1 removed
+ *   int     imap_count(imap_t *m);
+ *   int     imap_foreach(imap_t *m, int (*fn)(int, double*, void*), void *ctx);
+ *
+ * All functions are static, use the macro once per type in each .c file
+ * that needs it.
+ */
+
+#define BINTREE_MAP_CMP_NUM(a, b) (((a) > (b)) - ((a) < (b)))
+
+#define BINTREE_MAP_DEFINE(name, key_t, val_t, cmp)                           \
+                                                                              \
+typedef struct name##_node_s {                                                \
+    key_t key;                                                                \
+    val_t value;                                                              \
+    int height;                                                               \
+    struct name##_node_s *left;                                               \
+    struct name##_node_s *right;                                              \
+} name##_node_t;                                                              \
+                                                                              \
+typedef struct name##_s {                                                     \
+    name##_node_t *root;                                                      \
+    int count;                                                                \
+} name##_t;                                                                   \
+                                                                              \
+BINTREE_AVL_DEFINE(name##_avl, name##_node_t, BINTREE_AVL_NOP,                \
+                   BINTREE_AVL_NOP, BINTREE_AVL_NOP)                          \
+                                                                              \
+static inline name##_node_t*                                                  \
+name##_put_(name##_node_t *node, key_t key, val_t value, int *added)          \
+{                                                                             \
+    int c = 0;                                                                \
+    if (NULL == node) {                                                       \
+        node = (name##_node_t*)malloc(sizeof(*node));                         \
+        assert(NULL != node);                                                 \
+        node->key = key;                                                      \
+        node->value = value;                                                  \
+        node->height = 1;                                                     \
+        node->left = node->right = NULL;                                      \
+        *added = 1;                                                           \
+        return node;                                                          \
+    }                                                                         \
+    c = cmp(key, node->key);                                                  \
+    if (0 == c) {                                                             \
+        node->value = value;                                                  \
+        return node;                                                          \
+    }                                                                         \
+    if (c < 0) {                                                              \
+        node->left = name##_put_(node->left, key, value, added);              \
+    } else {                                                                  \
+        node->right = name##_put_(node->right, key, value, added);            \
+    }                                                                         \
+    return name##_avl_rebalance(node);                                        \
+}                                                                             \
+                                                                              \
+static inline name##_node_t*                                                  \
+name##_unlink_min_(name##_node_t *node, name##_node_t **min)                  \
+{                                                                             \
+    if (NULL == node->left) {                                                 \
+        *min = node;                                                          \
+        return node->right;                                                   \
+    }                                                                         \
+    node->left = name##_unlink_min_(node->left, min);                         \
+    return name##_avl_rebalance(node);                                        \
+}                                                                             \
+                                                                              \
+static inline name##_node_t*                                                  \
+name##_erase_(name##_node_t *node, key_t key, int *erased)                    \
+{                                                                             \
+    int c = 0;                                                                \
+    if (NULL == node) {                                                       \
+        return NULL;                                                          \
+    }                                                                         \
+    c = cmp(key, node->key);                                                  \
+    if (c < 0) {                                                              \
+        node->left = name##_erase_(node->left, key, erased);                  \
+    } else if (c > 0) {                                                       \
+        node->right = name##_erase_(node->right, key, erased);                \
+    } else {                                                                  \
+        name##_node_t *left = node->left;                                     \
+        name##_node_t *right = node->right;                                   \
+        name##_node_t *succ = NULL;                                           \
+        free(node);                                                           \
+        *erased = 1;                                                          \
+        if (NULL == left) {                                                   \
+            return right;                                                     \
+        }                                                                     \
+        if (NULL == right) {                                                  \
+            return left;                                                      \
+        }                                                                     \
+        right = name##_unlink_min_(right, &succ);                             \
+        succ->left = left;                                                    \
+        succ->right = right;                                                  \
+        node = succ;                                                          \
+    }                                                                         \
+    return name##_avl_rebalance(node);                                        \
+}                                                                             \
+                                                                              \
+static inline void                                                            \
+name##_destroy_(name##_node_t *node)                                          \
+{                                                                             \
+    if (NULL == node) {                                                       \
+        return;                                                               \
+    }                                                                         \
+    name##_destroy_(node->left);                                              \
+    name##_destroy_(node->right);                                             \
+    free(node);                                                               \
+}                                                                             \
+                                                                              \
+static inline int                                                             \
+name##_foreach_(name##_node_t *node, int (*fn)(key_t, val_t*, void*),         \
+                void *ctx)                                                    \
+{                                                                             \
+    if (NULL == node) {                                                       \
+        return 0;                                                             \
+    }                                                                         \
+    return name##_foreach_(node->left, fn, ctx) ||                            \
+           fn(node->key, &node->value, ctx) ||                                \
+           name##_foreach_(node->right, fn, ctx);                             \
+}                                                                             \
+                                                                              \
+static inline name##_t*                                                       \
+name##_create(void)                                                           \
+{                                                                             \
+    name##_t *m = (name##_t*)malloc(sizeof(*m));                              \
+    assert(NULL != m);                                                        \
+    m->root = NULL;                                                           \
+    m->count = 0;                                                             \
+    return m;                                                                 \
+}                                                                             \
+                                                                              \
+static inline void                                                            \
+name##_destroy(name##_t *m)                                                   \
+{                                                                             \
+    assert(NULL != m);                                                        \
+    name##_destroy_(m->root);                                                 \
+    free(m);                                                                  \
+}                                                                             \
+                                                                              \
+static inline int                                                             \
+name##_put(name##_t *m, key_t key, val_t value)                               \
+{                                                                             \
+    int added = 0;                                                            \
+    m->root = name##_put_(m->root, key, value, &added);                       \
+    m->count += added;                                                        \
+    return added;                                                             \
+}                                                                             \
+                                                                              \
+static inline val_t*                                                          \
+name##_find(name##_t *m, key_t key)                                           \
+{                                                                             \
+    name##_node_t *node = m->root;                                            \
+    while (NULL != node) {                                                    \
+        int c = cmp(key, node->key);                                          \
+        if (0 == c) {                                                         \
+            return &node->value;                                              \
+        }                                                                     \
+        node = (c < 0) ? node->left : node->right;                            \
+    }                                                                         \
+    return NULL;                                                              \
+}                                                                             \
+                                                                              \
+static inline int                                                             \
+name##_erase(name##_t *m, key_t key)                                          \
+{                                                                             \
+    int erased = 0;                                                           \
+    m->root = name##_erase_(m->root, key, &erased);                           \
+    m->count -= erased;                                                       \
+    return erased;                                                            \
+}                                                                             \
+                                                                              \
+static inline int                                                             \
+name##_count(name##_t *m)                                                     \
+{                                                                             \
+    return m->count;                                                          \
+}                                                                             \
+                                                                              \
+static inline int                                                             \
+name##_foreach(name##_t *m, int (*fn)(key_t, val_t*, void*), void *ctx)       \
+{                                                                             \
+    assert(NULL != fn);                                                       \
+    return name##_foreach_(m->root, fn, ctx) ? 1 : 0;                         \
+}
+
+#endif /* __BINTREE_MAP_GEN_H__ */
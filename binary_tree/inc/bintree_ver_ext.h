@@ -0,0 +1,34 @@
+#ifndef __BINTREE_VER_EXT_H__
+#define __BINTREE_VER_EXT_H__
+
+/*
+ * Persistent (versioned) ordered int set, AVL balanced
+ *
+ * Every version is immutable.  Insert and remove leave the version they
+ * are given untouched and return a new one that shares every node off
+ * the changed path, so a write costs O(log n) nodes and a snapshot is
+ * just another reference to a version.  Nodes are reference counted and
+ * freed when the last version using them is released.
+ *
+ * Any number of threads may search, update from and release versions
+ * concurrently; each handle is released once per create, insert, remove
+ * or retain that returned it.
+ */
+
+typedef struct bintree_ver_s* BintreeVerPtr;
+
+/* Public APIs */
+BintreeVerPtr bintree_ver_create(const char *name);
+BintreeVerPtr bintree_ver_retain(BintreeVerPtr verp);
+void bintree_ver_release(BintreeVerPtr verp);
+
+BintreeVerPtr bintree_ver_insert(BintreeVerPtr verp, int data);
+BintreeVerPtr bintree_ver_remove(BintreeVerPtr verp, int data);
+
+int  bintree_ver_search(BintreeVerPtr verp, int data);
+int  bintree_ver_count(BintreeVerPtr verp);
+long bintree_ver_number(BintreeVerPtr verp);
+int  bintree_ver_foreach(BintreeVerPtr verp, int (*fn)(int data, void *ctx),
+                         void *ctx);
+
+#endif /* __BINTREE_VER_EXT_H__ */
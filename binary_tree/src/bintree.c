@@ -1,36 +1,81 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <assert.h>
 #include "bintree_ext.h"
 #include "bintree_int.h"
 #include "logger.h"
 
-#define MAGIC_IN_USE_CHECK(_mag_) \
-    if (BINTREE_MAGIC_IN_USE != _mag_) { \
-        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
-                BINTREE_MAGIC_IN_USE, _mag_); \
-        goto out; \
-    } \
-
 /************************************
  *    Static Helpers
  ************************************/
+/**
+ * Internal API to add a chunk of cap nodes to a tree's arena
+ *
+ * Whatever is left of the previous chunk stays unused until the tree is
+ * destroyed.
+ *
+ * @param bintreep (i/o) tree that owns the arena
+ * @param cap      (i) nodes in the new chunk
+ * @return void
+ */
+static void
+_bintree_arena_grow(bintree_t *bintreep, int cap)
+{
+    bintree_chunk_t *chunk = (bintree_chunk_t*)malloc(sizeof(*chunk) +
+                                            cap * sizeof(bintreenode_t));
+    assert(NULL != chunk);
+
+    chunk->next = bintreep->chunks;
+    bintreep->chunks = chunk;
+    bintreep->arena_bytes += sizeof(*chunk) + cap * sizeof(bintreenode_t);
+    bintreep->chunk_used = 0;
+    bintreep->chunk_cap = cap;
+}
+
 /**
  * Internal API to alloc and init a node
  *
+ * Plain and AVL trees take nodes from their arena, reusing removed ones
+ * first.  Concurrent trees use malloc, their nodes are handed to
+ * epoch_retire() and freed long after the write that replaced them.
+ *
  * Note this alloc's memory, need to call corresponding free func
  * 
- * @param data (i) data to store
+ * @param bintreep (i) tree the node will belong to
+ * @param data     (i) data to store
  * @return node_t*
  */
-static bintreenode_t*
-_bintree_node_alloc(int data)
+bintreenode_t*
+_bintree_node_alloc(bintree_t *bintreep, int data)
 {
-    bintreenode_t *node = (bintreenode_t*)malloc(sizeof(*node));
-    assert(NULL != node);
+    bintreenode_t *node = NULL;
+
+    if (bintreeConcurrent == bintreep->mode) {
+        node = (bintreenode_t*)malloc(sizeof(*node));
+        assert(NULL != node);
+    } else if (NULL != bintreep->freelist) {
+        node = bintreep->freelist;
+        bintreep->freelist = node->left;
+    } else {
+        if (bintreep->chunk_used == bintreep->chunk_cap) {
+            int cap = BINTREE_ARENA_MAX_CHUNK;
+            if (bintreep->chunk_cap < BINTREE_ARENA_MAX_CHUNK / 2) {
+                cap = 2 * bintreep->chunk_cap;
+            }
+            if (cap < BINTREE_ARENA_MIN_CHUNK) {
+                cap = BINTREE_ARENA_MIN_CHUNK;
+            }
+            _bintree_arena_grow(bintreep, cap);
+        }
+        node = &bintreep->chunks->nodes[bintreep->chunk_used++];
+    }
 
     node->data = data;
+    node->height = 1;
+    node->size = 1;
+    node->count = 1;
     node->left = NULL;
     node->right = NULL;
     return node;
@@ -39,35 +84,116 @@ _bintree_node_alloc(int data)
 /**
  * Internal API to free a previously alloc'ed node
  *
- * @param node (i) node to free
+ * Arena nodes go on the tree's freelist for the next insert; their
+ * memory is released by bintree_destroy()
+ *
+ * @param bintreep (i) tree the node belongs to
+ * @param node     (i) node to free
  * @return void
  */
-static void
-_bintree_node_free(bintreenode_t *node)
+void
+_bintree_node_free(bintree_t *bintreep, bintreenode_t *node)
 {
     assert(NULL != node);
-    free(node);
+    if (bintreeConcurrent == bintreep->mode) {
+        free(node);
+        return;
+    }
+    node->left = bintreep->freelist;
+    bintreep->freelist = node;
+}
+
+/**
+ * Internal API to hand all of src's arena over to dst
+ *
+ * Used when src's nodes are about to be linked into dst: from here on
+ * they are dst's to free, and src is left empty.  src's chunks go after
+ * dst's newest chunk so dst keeps carving from that one.
+ *
+ * @param dst (i/o) tree taking the nodes
+ * @param src (i/o) tree giving them up
+ * @return void
+ */
+void
+_bintree_arena_merge(bintree_t *dst, bintree_t *src)
+{
+    bintree_chunk_t *tail = src->chunks;
+    bintreenode_t *free_tail = src->freelist;
+
+    if (NULL == tail) {
+        return;
+    }
+    while (NULL != tail->next) {
+        tail = tail->next;
+    }
+    if (NULL == dst->chunks) {
+        dst->chunks = src->chunks;
+        dst->chunk_used = src->chunk_used;
+        dst->chunk_cap = src->chunk_cap;
+    } else {
+        tail->next = dst->chunks->next;
+        dst->chunks->next = src->chunks;
+    }
+    if (NULL != free_tail) {
+        while (NULL != free_tail->left) {
+            free_tail = free_tail->left;
+        }
+        free_tail->left = dst->freelist;
+        dst->freelist = src->freelist;
+    }
+
+    dst->arena_bytes += src->arena_bytes;
+    src->arena_bytes = 0;
+    src->root = NULL;
+    src->chunks = NULL;
+    src->chunk_used = src->chunk_cap = 0;
+    src->freelist = NULL;
+}
+
+/**
+ * Internal API to release a tree's node arena
+ *
+ * O(chunks), every node in the tree goes with its chunk
+ *
+ * @param bintreep (i/o) tree that owns the arena
+ * @return void
+ */
+static void
+_bintree_arena_destroy(bintree_t *bintreep)
+{
+    bintree_chunk_t *chunk = bintreep->chunks;
+
+    while (NULL != chunk) {
+        bintree_chunk_t *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    bintreep->chunks = NULL;
+    bintreep->chunk_used = bintreep->chunk_cap = 0;
+    bintreep->freelist = NULL;
+    bintreep->arena_bytes = 0;
 }
 
 /**
- * Internal API to destroy a binary tree
+ * Internal API to destroy a malloc'ed binary tree (concurrent mode)
  *
  * Algorithm: post-order traversal, then free the node
  * 
- * @param node (i) rot node
+ * @param bintreep (i) tree the nodes belong to
+ * @param node     (i) rot node
  * @return void
  */
 static void
-_bintree_destroy(bintreenode_t *node)
+_bintree_destroy(bintree_t *bintreep, bintreenode_t *node)
 {
     if (NULL == node) {
         return;
     }
-    _bintree_destroy(node->left);
-    _bintree_destroy(node->right);
+    _bintree_destroy(bintreep, node->left);
+    _bintree_destroy(bintreep, node->right);
 
     logger(dbgInfo, "Destroying node %i", node->data);
-    _bintree_node_free(node);
+    _bintree_node_free(bintreep, node);
 
     return;
 }
@@ -75,88 +201,173 @@ _bintree_destroy(bintreenode_t *node)
 /**
  * Internal helper to add node to tree
  *
- * Algorithm: Recursively walk left or right subtree, looking for NULL node,
- *            which is the base case.  Return a new node to the caller,
- *            which will set new node's parent link to this new node
+ * Algorithm: Walk a pointer to the parent's child link left or right
+ *            until it points at a NULL link, then hang the new node there.
+ *            Every node passed on the way gains one descendant.
+ *            Iterative, so degenerate trees cannot overflow the stack.
  *
- * @param node (i) ptr to current node while traversing tree
- * @param data (i) data to insert
- * @return ptr to a node
+ * @param bintreep (i) tree being inserted into
+ * @param link     (i) link to the subtree root
+ * @param data     (i) data to insert
+ * @return depth of the new node, the subtree root is 1
  */
-static bintreenode_t*
-_insert_node(bintreenode_t *node, int data)
+static int
+_insert_node(bintree_t *bintreep, bintreenode_t **link, int data)
 {
-    if (NULL == node) {
-        logger(dbgInfo, "Hit leaf node, adding %i", data);
-        return _bintree_node_alloc(data);
-    }
+    int depth = 1;
 
-    if (data < node->data) {
-        logger(dbgInfo, "Cur node %i, data %i, going left", node->data, data);
-        node->left = _insert_node(node->left, data);
-    } else {
-        logger(dbgInfo, "Cur node %i, data %i, going right", node->data, data);
-        node->right = _insert_node(node->right, data);
+    while (NULL != *link) {
+        (*link)->size++;
+        link = (data < (*link)->data) ? &(*link)->left : &(*link)->right;
+        depth++;
     }
-
-    return node;
+    *link = _bintree_node_alloc(bintreep, data);
+    return depth;
 }
 
 /**
- * Internal helper to recursively delete a node in a binary tree
+ * Internal helper to delete a node in a binary tree
  * 
  * Algorithm: 
- * Search for the node to delete. Do recursively, which will keep track of 'parent'
- * node once we find the node to delete. this will be important later
+ * Walk a pointer to the parent's child link down to the node to delete,
+ * so the parent can be relinked without tracking it separately.
  *
  * Once node is found:
- *    if leaf node:
- *       simply delete node and return NULL, which sets parent to NULL
- *    if only has right subtree:
- *       delete node and return ptr to right subtree, which will link parent to right subtree
- *    if only has left subtree:
- *       delete node and return ptr to left subtree, which will link parent to left subtree
+ *    if it has no left subtree:
+ *       point the parent link at the right subtree (possibly NULL)
+ *    if it has no right subtree:
+ *       point the parent link at the left subtree
  *    if has both subtrees:
  *       find sucessor node - min node of right subtree
- *       copy successor node data value into current node
- *       recursively delete right subtree of current node, looking for the now-duplicate
- *          data value, which will be guaranteed to be a leaf or right-subtree only case      
+ *       unlink successor (it has no left child, so its right subtree
+ *          takes its place) and splice it in where the deleted node was
+ *
+ * Subtree sizes are only touched once the node is known to exist: the
+ * path from the root down to it, and from it down to the successor,
+ * each lose one node.
+ *
+ * @param bintreep (i) tree being removed from
+ * @param link     (i) link to the subtree root
+ * @param data     (i) data value to remove
+ * @return void
  */
-static bintreenode_t*
-_bintree_remove(bintreenode_t *root, int data) {
-    if (NULL == root) {
-        printf("Data %i not found in tree\n", data);
-        return root;
+static void
+_bintree_remove(bintree_t *bintreep, bintreenode_t **link, int data)
+{
+    bintreenode_t *node = NULL;
+    bintreenode_t *cur = *link;
+
+    while (NULL != (node = *link) && data != node->data) {
+        link = (data < node->data) ? &node->left : &node->right;
+    }
+    if (NULL == node) {
+        logger(dbgWarn, "Data %i not found in tree", data);
+        return;
+    }
+    for (; cur != node; cur = (data < cur->data) ? cur->left : cur->right) {
+        cur->size--;
     }
 
-    if (data < root->data) {
-        root->left = _bintree_remove(root->left, data);
-    } else if (data > root->data) {
-        root->right = _bintree_remove(root->right, data);
+    if (NULL == node->left) {
+        *link = node->right;
+    } else if (NULL == node->right) {
+        *link = node->left;
     } else {
-        if (NULL == root->left && NULL == root->right) {
-            _bintree_node_free(root);
-            return NULL;
-        }
-        else if (NULL == root->left && NULL != root->right) {
-            bintreenode_t *tmp = root->right;
-            _bintree_node_free(root);
-            return tmp;
-        }
-        else if (NULL != root->left && NULL == root->right) {
-            bintreenode_t *tmp = root->left;
-            _bintree_node_free(root);
-            return tmp;
-        } else {
-            bintreenode_t *min_node = root->right;
-            while (NULL != min_node->left) {
-                min_node = min_node->left;
-            };
-            root->data = min_node->data;
-            root->right = _bintree_remove(root->right, root->data);
+        bintreenode_t **succ_link = &node->right;
+        bintreenode_t *succ = NULL;
+
+        while (NULL != (*succ_link)->left) {
+            (*succ_link)->size--;
+            succ_link = &(*succ_link)->left;
         }
+        succ = *succ_link;
+        *succ_link = succ->right;
+
+        succ->left = node->left;
+        succ->right = node->right;
+        succ->size = node->size - 1;
+        *link = succ;
+    }
+    _bintree_node_free(bintreep, node);
+}
+
+/**
+ * Internal helper to find the node holding data in a multiset tree
+ *
+ * @param node (i) root node
+ * @param data (i) data to look for
+ * @return the node, NULL if data is not in the tree
+ */
+static bintreenode_t*
+_bintree_multi_find(bintreenode_t *node, int data)
+{
+    while (NULL != node && data != node->data) {
+        node = (data < node->data) ? node->left : node->right;
+    }
+    return node;
+}
+
+/**
+ * Internal helper to change the count of a key already in a multiset
+ * tree, and the sizes on the path down to it
+ *
+ * @param node  (i) root node
+ * @param data  (i) key, present
+ * @param delta (i) +1 or -1
+ * @return void
+ */
+static void
+_bintree_multi_adjust(bintreenode_t *node, int data, int delta)
+{
+    while (data != node->data) {
+        node->size += delta;
+        node = (data < node->data) ? node->left : node->right;
+    }
+    node->size += delta;
+    node->count += delta;
+}
+
+/**
+ * Internal helper to add one copy of data to a multiset tree
+ *
+ * Algorithm: a key already present only gets its count (and the sizes
+ *            above it) bumped, the shape does not change; a new key is
+ *            an AVL insert of a node with count 1
+ *
+ * @param bintreep (i/o) multiset tree
+ * @param data     (i) data to insert
+ * @return void
+ */
+static void
+_bintree_multi_insert(bintree_t *bintreep, int data)
+{
+    if (NULL != _bintree_multi_find(bintreep->root, data)) {
+        _bintree_multi_adjust(bintreep->root, data, 1);
+    } else {
+        bintreep->root = _bintree_avl_insert(bintreep, bintreep->root, data);
+    }
+}
+
+/**
+ * Internal helper to remove one copy of data from a multiset tree, the
+ * node goes (AVL remove) with its last copy
+ *
+ * @param bintreep (i/o) multiset tree
+ * @param data     (i) data to remove
+ * @return void
+ */
+static void
+_bintree_multi_remove(bintree_t *bintreep, int data)
+{
+    bintreenode_t *node = _bintree_multi_find(bintreep->root, data);
+
+    if (NULL == node) {
+        logger(dbgWarn, "Data %i not found in tree", data);
+    } else if (node->count > 1) {
+        _bintree_multi_adjust(bintreep->root, data, -1);
+    } else {
+        bintreep->root = _bintree_avl_remove(bintreep, bintreep->root, data);
     }
-    return root;
 }
 
 /** 
@@ -169,41 +380,141 @@ _bintree_remove(bintreenode_t *root, int data) {
  * @param data (i) data to search for
  * @return 1 if found, 0 if not found
  */
-int
-_bintree_search(bintreenode_t *node, int data) { 
-    if (NULL == node) {
-        logger(dbgInfo, "Did not find node %i", data);
-        return 0;
+static int
+_bintree_search(bintreenode_t *node, int data)
+{
+    BINTREE_COUNT(searches);
+    while (NULL != node) {
+        BINTREE_COUNT(search_cmps);
+        if (data == node->data) {
+            return 1;
+        }
+        node = (data < node->data) ? node->left : node->right;
     }
-    if (data == node->data) {
-        logger(dbgInfo, "Found node %i", data);
-        return 1;
+    return 0;
+}
+
+/**
+ * Internal API to search a pointer tree for many keys with their memory
+ * stalls overlapped
+ *
+ * Algorithm: BINTREE_BATCH_GROUP lookups are in flight at once.  Each
+ *            pass takes every lookup one level down and prefetches the
+ *            node it lands on, so by the time the pass comes back round
+ *            that node is (ideally) in cache.  A finished lookup hands
+ *            its slot to the next key straight away, so one long path
+ *            does not hold up the rest of the group.
+ *
+ * @param root  (i) root node
+ * @param keys  (i) data values to search for
+ * @param n     (i) number of values
+ * @param found (o) found[i] = 1 if keys[i] is in the tree, 0 else
+ * @return void
+ */
+static void
+_bintree_search_batch(bintreenode_t *root, const int *keys, int n, uint8_t *found)
+{
+    bintreenode_t *node[BINTREE_BATCH_GROUP];
+    int idx[BINTREE_BATCH_GROUP];
+    int next = 0, live = 0, j = 0;
+
+    for (j = 0; j < BINTREE_BATCH_GROUP; j++) {
+        node[j] = root;
+        idx[j] = (next < n) ? next++ : -1;
     }
-    if (data < node->data) {
-        return _bintree_search(node->left, data);
-    } else {
-        return _bintree_search(node->right, data);
+    live = next;
+    while (live > 0) {
+        for (j = 0; j < BINTREE_BATCH_GROUP; j++) {
+            bintreenode_t *cur = node[j];
+            int data = 0;
+
+            if (idx[j] < 0) {
+                continue;
+            }
+            data = keys[idx[j]];
+            if (NULL != cur && data != cur->data) {
+                cur = (data < cur->data) ? cur->left : cur->right;
+                __builtin_prefetch(cur);
+                node[j] = cur;
+                continue;
+            }
+            found[idx[j]] = (NULL != cur);
+            if (next < n) {
+                node[j] = root;
+                idx[j] = next++;
+            } else {
+                idx[j] = -1;
+                live--;
+            }
+        }
     }
 }
 
 /**
- * Internal API to count tree nodes
+ * Size of a possibly-NULL subtree
  *
- * Algorithm: For each non-null node visited, return 
- *            1 + count in left subtree + count in right subtree
+ * @param node (i) subtree root
+ * @return key count, 0 for NULL
+ */
+static inline int
+_bintree_size(bintreenode_t *node)
+{
+    return (NULL == node) ? 0 : node->size;
+}
+
+/**
+ * Internal API to find the k-th smallest node (0-based)
+ *
+ * Algorithm: the left subtree holds the size(left) smallest keys, so
+ *            compare k with it and go left, stop, or go right with k
+ *            reduced by size(left) + the node's count
  *
  * @param node (i) root node
- * @return count of nodes in tree
+ * @param k    (i) rank wanted, 0 <= k < size(node)
+ * @return node holding the k-th smallest key
+ */
+static bintreenode_t*
+_bintree_select(bintreenode_t *node, int k)
+{
+    while (NULL != node) {
+        int left = _bintree_size(node->left);
+        if (k < left) {
+            node = node->left;
+        } else if (k < left + node->count) {
+            break;
+        } else {
+            k -= left + node->count;
+            node = node->right;
+        }
+    }
+    return node;
+}
+
+/**
+ * Internal API to count the keys smaller than data
+ *
+ * Algorithm: search for data; every time the path turns right, the node
+ *            and its whole left subtree are smaller
+ *
+ * @param node (i) root node
+ * @param data (i) data to rank
+ * @return number of keys < data
  */
 static int
-_bintree_count(bintreenode_t *node) {
-    if (NULL == node) {
-        return 0;
+_bintree_rank(bintreenode_t *node, int data)
+{
+    int rank = 0;
+
+    while (NULL != node) {
+        if (node->data < data) {
+            rank += _bintree_size(node->left) + node->count;
+            node = node->right;
+        } else {
+            node = node->left;
+        }
     }
-    return (1 + 
-            _bintree_count(node->left) + 
-            _bintree_count(node->right));
-};
+    return rank;
+}
 
 /**
  * Internal API to perform preorder traversal
@@ -217,10 +528,14 @@ _bintree_count(bintreenode_t *node) {
 static void
 _bintree_preorder(bintreenode_t *node)
 {
+    int i = 0;
+
     if (NULL == node) {
         return;
     }
-    logger(dbgInfo, "Preorder: %i, ", node->data);
+    for (i = 0; i < node->count; i++) {
+        logger(dbgInfo, "Preorder: %i, ", node->data);
+    }
     _bintree_preorder(node->left);
     _bintree_preorder(node->right);
 }
@@ -236,11 +551,15 @@ _bintree_preorder(bintreenode_t *node)
  */
 static void
 _bintree_inorder(bintreenode_t *node) {
+    int i = 0;
+
     if (NULL == node) {
         return;
     }
     _bintree_inorder(node->left);
-    logger(dbgInfo, "Inorder: %i, ", node->data);
+    for (i = 0; i < node->count; i++) {
+        logger(dbgInfo, "Inorder: %i, ", node->data);
+    }
     _bintree_inorder(node->right);
 }
 
@@ -255,12 +574,16 @@ _bintree_inorder(bintreenode_t *node) {
  */
 static void
 _bintree_postorder(bintreenode_t *node) {
+    int i = 0;
+
     if (NULL == node) {
         return;
     }
     _bintree_postorder(node->left);
     _bintree_postorder(node->right);
-    logger(dbgInfo, "Postorder: %i, ", node->data);
+    for (i = 0; i < node->count; i++) {
+        logger(dbgInfo, "Postorder: %i, ", node->data);
+    }
 }
 
 /**
@@ -308,6 +631,101 @@ _bintree_hasPathSum(bintreenode_t *node, int sum)
     return (left_has_sum || right_has_sum);
 }
 
+/**
+ * Internal API to copy a pointer tree's data out in ascending order
+ *
+ * Algorithm: in-order walk with an explicit, growable stack, so
+ *            degenerate trees cannot overflow the call stack
+ *
+ * @param node (i) root node
+ * @param out  (o) array with room for every key
+ * @return number of values written
+ */
+static int
+_bintree_collect(bintreenode_t *node, int *out)
+{
+    bintreenode_t **stack = NULL;
+    int top = 0, cap = 0, n = 0, i = 0;
+
+    while (NULL != node || top > 0) {
+        while (NULL != node) {
+            if (top == cap) {
+                cap = cap ? 2 * cap : 64;
+                stack = (bintreenode_t**)realloc(stack, cap * sizeof(*stack));
+                assert(NULL != stack);
+            }
+            stack[top++] = node;
+            node = node->left;
+        }
+        node = stack[--top];
+        for (i = 0; i < node->count; i++) {
+            out[n++] = node->data;
+        }
+        node = node->right;
+    }
+    free(stack);
+    return n;
+}
+
+/**
+ * Internal API to copy any tree's data out in ascending order
+ *
+ * @param bintreep (i) binary tree
+ * @param out      (o) array with room for bintree_count() values
+ * @return number of values written
+ */
+static int
+_bintree_to_sorted(bintree_t *bintreep, int *out)
+{
+    int n = 0;
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        return _bintree_btree_collect(bintreep->broot, out);
+    case bintreeFrozen:
+        return _bintree_frozen_collect(bintreep->eytz, bintreep->nkeys, out);
+    default:
+        n = _bintree_collect(_bintree_read_enter(bintreep), out);
+        _bintree_read_exit(bintreep);
+        return n;
+    }
+}
+
+/**
+ * Internal API to build a perfectly balanced subtree from sorted keys
+ *
+ * Algorithm: the middle key becomes the root, each half recursively
+ *            becomes a subtree.  Node i of the block holds keys[i], so
+ *            no allocation happens here.  Heights are filled in so the
+ *            result is also a valid AVL tree.
+ *
+ * @param block (i) preallocated nodes, one per key
+ * @param keys  (i) keys in ascending order
+ * @param lo    (i) first key index of this subtree
+ * @param hi    (i) last key index of this subtree
+ * @return subtree root
+ */
+static bintreenode_t*
+_bintree_build(bintreenode_t *block, const int *keys, int lo, int hi)
+{
+    if (lo > hi) {
+        return NULL;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    bintreenode_t *node = &block[mid];
+
+    node->data = keys[mid];
+    node->count = 1;
+    node->left = _bintree_build(block, keys, lo, mid - 1);
+    node->right = _bintree_build(block, keys, mid + 1, hi);
+    node->size = hi - lo + 1;
+
+    /* right half is never shorter than the left */
+    node->height = 1 + (NULL == node->right ? 0 : node->right->height);
+    return node;
+}
+
 /************************************
  *    Public APIs
  ************************************/
@@ -322,15 +740,49 @@ _bintree_hasPathSum(bintreenode_t *node, int sum)
  */
 BintreePtr 
 bintree_create(const char *name)
+{
+    return bintree_create_mode(name, bintreePlain);
+}
+
+/**
+ * Create a new binary tree of the given flavour
+ *
+ * Note - allocs mem for a new tree, caller must call bintree_destroy()
+ *
+ * @param name (i) name for binary tree
+ * @param mode (i) tree flavour, see bintree_mode_e
+ * @return BintreePtr
+ */
+BintreePtr
+bintree_create_mode(const char *name, bintree_mode_e mode)
 {
     assert(NULL != name);
+    assert(mode < bintreeModeMax);
 
     BintreePtr bintreep = (bintree_t*)malloc(sizeof(*bintreep));
     assert(NULL != bintreep);
 
     bintreep->magic = BINTREE_MAGIC_IN_USE;
     strcpy(bintreep->name, name);
+    bintreep->mode = mode;
     bintreep->root = NULL;
+    bintreep->broot = NULL;
+    bintreep->eytz = NULL;
+    bintreep->nkeys = 0;
+    bintreep->image = NULL;
+    bintreep->image_len = 0;
+    bintreep->chunks = NULL;
+    bintreep->chunk_used = 0;
+    bintreep->chunk_cap = 0;
+    bintreep->freelist = NULL;
+    bintreep->arena_bytes = 0;
+    bintreep->rebalance_factor = 0.0;
+    bintreep->stale = NULL;
+    bintreep->stale_len = 0;
+    bintreep->stale_cap = 0;
+    if (bintreeConcurrent == mode) {
+        pthread_mutex_init(&bintreep->wlock, NULL);
+    }
 
     return bintreep;
 }
@@ -338,6 +790,8 @@ bintree_create(const char *name)
 /**
  * Destroy a binary tree
  *
+ * For bintreeConcurrent mode no other thread may be using the tree
+ *
  * @param bintreep (i) ptr to binary tree to destroy
  */
 void 
@@ -346,7 +800,20 @@ bintree_destroy(BintreePtr bintreep)
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    _bintree_destroy(bintreep->root);
+    _bintree_btree_destroy(bintreep->broot);
+    if (NULL != bintreep->image) {
+        _bintree_image_unmap(bintreep);
+    } else {
+        free(bintreep->eytz);
+    }
+    if (bintreeConcurrent == bintreep->mode) {
+        _bintree_destroy(bintreep, bintreep->root);
+        /* flush nodes retired by this thread's writes */
+        epoch_barrier();
+        pthread_mutex_destroy(&bintreep->wlock);
+    }
+    _bintree_arena_destroy(bintreep);
+    free(bintreep->stale);
      
     /* finally, free the bintree itself */
     free(bintreep);
@@ -366,8 +833,33 @@ bintree_insert(BintreePtr bintreep, int data)
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    logger(dbgInfo, "Adding data: %i", data);
-    bintreep->root = _insert_node(bintreep->root, data);
+    switch (bintreep->mode) {
+    case bintreeAvl:
+        bintreep->root = _bintree_avl_insert(bintreep, bintreep->root, data);
+        break;
+    case bintreeBtree:
+        _bintree_btree_insert(&bintreep->broot, data);
+        bintreep->nkeys++;
+        break;
+    case bintreeFrozen:
+        logger(dbgErr, "Tree '%s' is frozen, cannot insert %i", bintreep->name, data);
+        break;
+    case bintreeConcurrent:
+        _bintree_rcu_insert(bintreep, data);
+        break;
+    case bintreeSplay:
+        _bintree_splay_insert(bintreep, data);
+        break;
+    case bintreeMultiset:
+        _bintree_multi_insert(bintreep, data);
+        break;
+    default:
+        if (_bintree_rebalance_due(bintreep,
+                                   _insert_node(bintreep, &bintreep->root, data))) {
+            _bintree_dsw(bintreep);
+        }
+        break;
+    }
 out:
     return;
 }
@@ -385,8 +877,33 @@ bintree_remove(BintreePtr bintreep, int data)
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    logger(dbgInfo, "Removing data: %i", data);
-    _bintree_remove(bintreep->root, data);
+    switch (bintreep->mode) {
+    case bintreeAvl:
+        bintreep->root = _bintree_avl_remove(bintreep, bintreep->root, data);
+        break;
+    case bintreeBtree:
+        if (_bintree_btree_remove(&bintreep->broot, data)) {
+            bintreep->nkeys--;
+        } else {
+            logger(dbgWarn, "Data %i not found in tree", data);
+        }
+        break;
+    case bintreeFrozen:
+        logger(dbgErr, "Tree '%s' is frozen, cannot remove %i", bintreep->name, data);
+        break;
+    case bintreeConcurrent:
+        _bintree_rcu_remove(bintreep, data);
+        break;
+    case bintreeSplay:
+        _bintree_splay_remove(bintreep, data);
+        break;
+    case bintreeMultiset:
+        _bintree_multi_remove(bintreep, data);
+        break;
+    default:
+        _bintree_remove(bintreep, &bintreep->root, data);
+        break;
+    }
 out:
     return;
 }
@@ -394,6 +911,9 @@ out:
 /**
  * Search for a node in a binary tree
  *
+ * In bintreeSplay mode this moves the key found, or the last node
+ * visited, to the root.
+ *
  * @param bintreep (i) binary tree to search
  * @param data     (i) data to search for 
  * @return void
@@ -406,8 +926,21 @@ bintree_search(BintreePtr bintreep, int data)
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    logger(dbgInfo, "Searching for data: %i", data);
-    found = _bintree_search(bintreep->root, data);
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        found = _bintree_btree_search(bintreep->broot, data);
+        break;
+    case bintreeFrozen:
+        found = _bintree_frozen_search(bintreep->eytz, bintreep->nkeys, data);
+        break;
+    case bintreeSplay:
+        found = _bintree_splay_search(bintreep, data);
+        break;
+    default:
+        found = _bintree_search(_bintree_read_enter(bintreep), data);
+        _bintree_read_exit(bintreep);
+        break;
+    }
 
 out:
     return found;
@@ -415,18 +948,30 @@ out:
 }
 
 /**
- * Return how many nodes are in the binary tree
+ * Return how many keys are in the binary tree, duplicates included, in
+ * O(1)
  *
  * @param bintreep (i) binary tree to count
- * @return count of nodes in binary tree
+ * @return count of keys in binary tree
  */
 int 
 bintree_count(BintreePtr bintreep)
 {
+    int cnt = 0;
+
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    int cnt = _bintree_count(bintreep->root);
+    switch (bintreep->mode) {
+    case bintreeBtree:
+    case bintreeFrozen:
+        cnt = bintreep->nkeys;
+        break;
+    default:
+        cnt = _bintree_size(_bintree_read_enter(bintreep));
+        _bintree_read_exit(bintreep);
+        break;
+    }
 out:
     return cnt;
 }
@@ -440,15 +985,28 @@ out:
 int
 bintree_minvalue(BintreePtr bintreep)
 {
+    int min = 0;
+
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    bintreenode_t *cur = bintreep->root;
+    if (bintreeBtree == bintreep->mode) {
+        min = _bintree_btree_minvalue(bintreep->broot);
+        goto out;
+    }
+    if (bintreeFrozen == bintreep->mode) {
+        min = _bintree_frozen_minvalue(bintreep->eytz, bintreep->nkeys);
+        goto out;
+    }
+
+    bintreenode_t *cur = _bintree_read_enter(bintreep);
     while (NULL != cur->left) {
         cur = cur->left;
     }
+    min = cur->data;
+    _bintree_read_exit(bintreep);
 out:
-    return cur->data;
+    return min;
 }
 
 /**
@@ -460,31 +1018,59 @@ out:
 int
 bintree_maxvalue(BintreePtr bintreep)
 {
+    int max = 0;
+
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    bintreenode_t *cur = bintreep->root;
+    if (bintreeBtree == bintreep->mode) {
+        max = _bintree_btree_maxvalue(bintreep->broot);
+        goto out;
+    }
+    if (bintreeFrozen == bintreep->mode) {
+        max = _bintree_frozen_maxvalue(bintreep->eytz, bintreep->nkeys);
+        goto out;
+    }
+
+    bintreenode_t *cur = _bintree_read_enter(bintreep);
     while (NULL != cur->right) {
         cur = cur->right;
     }
+    max = cur->data;
+    _bintree_read_exit(bintreep);
 out:
-    return cur->data;
+    return max;
 }
 
 
 /**
  * Find the max-depth of a binary tree
  *
+ * For bintreeBtree mode this is the number of node levels
+ *
  * @param bintreep (i) binary tree
  * @return max depth
  */
 int
 bintree_maxdepth(BintreePtr bintreep)
 {
+    int max_depth = 0;
+
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    int max_depth = _bintree_maxdepth(bintreep->root);
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        max_depth = _bintree_btree_maxdepth(bintreep->broot);
+        break;
+    case bintreeFrozen:
+        max_depth = _bintree_frozen_maxdepth(bintreep->nkeys);
+        break;
+    default:
+        max_depth = _bintree_maxdepth(_bintree_read_enter(bintreep));
+        _bintree_read_exit(bintreep);
+        break;
+    }
 out:
     return max_depth;
 }
@@ -492,6 +1078,8 @@ out:
 /**
  * Check if a given path-sum exists in a tree
  *
+ * Not supported for bintreeBtree mode, whose paths are not binary
+ *
  * @param bintreep (i) binary tree
  * @param sum      (i) sum
  * @return 1 if sum exists for a path, 0 else
@@ -499,10 +1087,21 @@ out:
 int
 bintree_hasPathSum(BintreePtr bintreep, int sum)
 {
+    int has_sum = 0;
+
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    int has_sum = _bintree_hasPathSum(bintreep->root, sum);
+    if (bintreeBtree == bintreep->mode) {
+        logger(dbgErr, "hasPathSum not supported for B-tree mode");
+        goto out;
+    }
+    if (bintreeFrozen == bintreep->mode) {
+        has_sum = _bintree_frozen_hasPathSum(bintreep->eytz, bintreep->nkeys, sum);
+        goto out;
+    }
+    has_sum = _bintree_hasPathSum(_bintree_read_enter(bintreep), sum);
+    _bintree_read_exit(bintreep);
 out:
     return has_sum;
 }
@@ -519,7 +1118,18 @@ bintree_preorder(BintreePtr bintreep) {
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    _bintree_preorder(bintreep->root);
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        _bintree_btree_traverse(bintreep->broot, "Preorder");
+        break;
+    case bintreeFrozen:
+        _bintree_frozen_traverse(bintreep->eytz, bintreep->nkeys, "Preorder");
+        break;
+    default:
+        _bintree_preorder(_bintree_read_enter(bintreep));
+        _bintree_read_exit(bintreep);
+        break;
+    }
 out:
     return;
 }
@@ -536,7 +1146,18 @@ bintree_inorder(BintreePtr bintreep) {
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    _bintree_inorder(bintreep->root);
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        _bintree_btree_traverse(bintreep->broot, "Inorder");
+        break;
+    case bintreeFrozen:
+        _bintree_frozen_traverse(bintreep->eytz, bintreep->nkeys, "Inorder");
+        break;
+    default:
+        _bintree_inorder(_bintree_read_enter(bintreep));
+        _bintree_read_exit(bintreep);
+        break;
+    }
 out:
     return;
 }
@@ -553,7 +1174,314 @@ bintree_postorder(BintreePtr bintreep) {
     assert(NULL != bintreep);
     MAGIC_IN_USE_CHECK(bintreep->magic);
 
-    _bintree_postorder(bintreep->root);
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        _bintree_btree_traverse(bintreep->broot, "Postorder");
+        break;
+    case bintreeFrozen:
+        _bintree_frozen_traverse(bintreep->eytz, bintreep->nkeys, "Postorder");
+        break;
+    default:
+        _bintree_postorder(_bintree_read_enter(bintreep));
+        _bintree_read_exit(bintreep);
+        break;
+    }
+out:
+    return;
+}
+
+/**
+ * Freeze a binary tree into a read-only, pointer-free copy
+ *
+ * The copy stores its keys in one array in Eytzinger (BFS) order and
+ * answers search/count/min/max/traversals without chasing pointers.
+ * Insert and remove on the copy are rejected.  The source tree is left
+ * untouched; both must be destroyed with bintree_destroy().  A
+ * bintreeConcurrent tree is copied from a single version, so writers
+ * may keep running.
+ *
+ * @param bintreep (i) binary tree to freeze, any mode
+ * @return BintreePtr to the frozen copy
+ */
+BintreePtr
+bintree_freeze(BintreePtr bintreep)
+{
+    BintreePtr frozenp = NULL;
+    bintreenode_t *root = NULL;
+    int *sorted = NULL;
+    int n = 0;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+    case bintreeFrozen:
+        n = bintree_count(bintreep);
+        sorted = (int*)malloc((n > 0 ? n : 1) * sizeof(*sorted));
+        assert(NULL != sorted);
+        n = _bintree_to_sorted(bintreep, sorted);
+        break;
+    default:
+        /* size and copy must come from the same version of a concurrent tree */
+        root = _bintree_read_enter(bintreep);
+        n = _bintree_size(root);
+        sorted = (int*)malloc((n > 0 ? n : 1) * sizeof(*sorted));
+        assert(NULL != sorted);
+        n = _bintree_collect(root, sorted);
+        _bintree_read_exit(bintreep);
+        break;
+    }
+
+    frozenp = bintree_create_mode(bintreep->name, bintreeFrozen);
+    _bintree_frozen_build(frozenp, sorted, n);
+    free(sorted);
+out:
+    return frozenp;
+}
+
+/**
+ * Search for many data values at once
+ *
+ * Pointer trees keep BINTREE_BATCH_GROUP lookups in flight and prefetch
+ * each one's next node, so cache misses on different lookups overlap
+ * instead of stalling one after another.  Frozen trees advance several
+ * lookups in lockstep (with AVX2 gathers when the CPU has them); B-trees
+ * loop over bintree_search(), their wide nodes already cut the misses.
+ *
+ * @param bintreep (i) binary tree to search
+ * @param keys     (i) data values to search for
+ * @param n        (i) number of values
+ * @param found    (o) found[i] = 1 if keys[i] is in the tree, 0 else
+ * @return void
+ */
+void
+bintree_search_batch(BintreePtr bintreep, const int *keys, int n, uint8_t *found)
+{
+    int i = 0;
+
+    assert(NULL != bintreep);
+    assert(NULL != keys || 0 == n);
+    assert(NULL != found || 0 == n);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        for (i = 0; i < n; i++) {
+            found[i] = _bintree_btree_search(bintreep->broot, keys[i]);
+        }
+        break;
+    case bintreeFrozen:
+        _bintree_frozen_search_many(bintreep->eytz, bintreep->nkeys, keys, n, found);
+        break;
+    default:
+        _bintree_search_batch(_bintree_read_enter(bintreep), keys, n, found);
+        _bintree_read_exit(bintreep);
+        break;
+    }
 out:
     return;
 }
+
+/**
+ * Search for many data values at once, same as bintree_search_batch()
+ *
+ * @param bintreep (i) binary tree to search
+ * @param keys     (i) data values to search for
+ * @param n        (i) number of values
+ * @param found    (o) found[i] = 1 if keys[i] is in the tree, 0 else
+ * @return void
+ */
+void
+bintree_search_many(BintreePtr bintreep, const int *keys, int n, uint8_t *found)
+{
+    bintree_search_batch(bintreep, keys, n, found);
+}
+
+/**
+ * Build a balanced binary tree from sorted data in O(n)
+ *
+ * All nodes come from one arena chunk sized to fit.  The tree is created
+ * in bintreeAvl mode so later inserts and removes keep it balanced.
+ *
+ * Note - allocs mem for a new tree, caller must call bintree_destroy()
+ *
+ * @param name (i) name for binary tree
+ * @param keys (i) data in ascending order, duplicates allowed
+ * @param n    (i) number of keys
+ * @return BintreePtr, or NULL if keys are not sorted
+ */
+BintreePtr
+bintree_build_sorted(const char *name, const int *keys, int n)
+{
+    BintreePtr bintreep = NULL;
+    int i = 0;
+
+    assert(NULL != keys || 0 == n);
+    assert(0 <= n);
+
+    for (i = 1; i < n; i++) {
+        if (keys[i] < keys[i - 1]) {
+            logger(dbgErr, "Keys not sorted at index %i (%i after %i)",
+                    i, keys[i], keys[i - 1]);
+            return NULL;
+        }
+    }
+
+    bintreep = bintree_create_mode(name, bintreeAvl);
+    if (n > 0) {
+        _bintree_arena_grow(bintreep, n);
+        bintreep->chunk_used = n;
+        bintreep->root = _bintree_build(bintreep->chunks->nodes, keys, 0, n - 1);
+    }
+    return bintreep;
+}
+
+/**
+ * Copy a binary tree's data out in ascending order
+ *
+ * Inverse of bintree_build_sorted(), works for every mode
+ *
+ * @param bintreep (i) binary tree
+ * @param out      (o) array with room for bintree_count() values
+ * @return number of values written
+ */
+int
+bintree_to_sorted_array(BintreePtr bintreep, int *out)
+{
+    int n = 0;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    n = _bintree_to_sorted(bintreep, out);
+out:
+    return n;
+}
+
+/**
+ * Find the k-th smallest value (0-based) in O(log n)
+ *
+ * bintree_select(b, 0, &x) gives the minimum, k = count - 1 the maximum
+ * and k = count / 2 the median.  Not supported for bintreeBtree mode,
+ * whose nodes carry no subtree sizes.
+ *
+ * @param bintreep (i) binary tree
+ * @param k        (i) rank wanted
+ * @param result   (o) k-th smallest value, untouched if k is out of range
+ * @return 1 if 0 <= k < count, 0 else
+ */
+int
+bintree_select(BintreePtr bintreep, int k, int *result)
+{
+    int found = 0;
+
+    assert(NULL != bintreep);
+    assert(NULL != result);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    if (bintreeBtree == bintreep->mode) {
+        logger(dbgErr, "select not supported for B-tree mode");
+        goto out;
+    }
+    if (bintreeFrozen == bintreep->mode) {
+        found = (k >= 0 && k < bintreep->nkeys);
+        if (found) {
+            *result = _bintree_frozen_select(bintreep->eytz, bintreep->nkeys, k);
+        }
+        goto out;
+    }
+    /* size and walk must come from the same version of a concurrent tree */
+    bintreenode_t *root = _bintree_read_enter(bintreep);
+    found = (k >= 0 && k < _bintree_size(root));
+    if (found) {
+        *result = _bintree_select(root, k)->data;
+    }
+    _bintree_read_exit(bintreep);
+out:
+    return found;
+}
+
+/**
+ * Count the values smaller than data in O(log n)
+ *
+ * This is the 0-based position data has, or would be inserted at, in
+ * sorted order.  Not supported for bintreeBtree mode.
+ *
+ * @param bintreep (i) binary tree
+ * @param data     (i) data to rank
+ * @return number of values < data
+ */
+int
+bintree_rank(BintreePtr bintreep, int data)
+{
+    int rank = 0;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        logger(dbgErr, "rank not supported for B-tree mode");
+        break;
+    case bintreeFrozen:
+        rank = _bintree_frozen_rank(bintreep->eytz, bintreep->nkeys, data);
+        break;
+    default:
+        rank = _bintree_rank(_bintree_read_enter(bintreep), data);
+        _bintree_read_exit(bintreep);
+        break;
+    }
+out:
+    return rank;
+}
+
+/**
+ * Count the copies of data in the tree
+ *
+ * O(log n) for bintreeMultiset mode, which keeps the count in the node,
+ * and for every mode with subtree sizes, where it is a difference of
+ * ranks.  B-trees walk the copies, O(log n + copies).
+ *
+ * @param bintreep (i) binary tree
+ * @param data     (i) data to count
+ * @return number of keys == data
+ */
+int
+bintree_count_key(BintreePtr bintreep, int data)
+{
+    bintreenode_t *root = NULL;
+    bintree_iter_t iter;
+    int cnt = 0, key = 0, above = 0;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        _bintree_iter_init(&iter, bintreep, data);
+        while (_bintree_iter_next(&iter, &key) && key == data) {
+            cnt++;
+        }
+        _bintree_iter_release(&iter);
+        break;
+    case bintreeFrozen:
+        above = (INT_MAX == data) ? bintreep->nkeys :
+                _bintree_frozen_rank(bintreep->eytz, bintreep->nkeys, data + 1);
+        cnt = above - _bintree_frozen_rank(bintreep->eytz, bintreep->nkeys, data);
+        break;
+    case bintreeMultiset:
+        root = _bintree_multi_find(bintreep->root, data);
+        cnt = (NULL == root) ? 0 : root->count;
+        break;
+    default:
+        /* both ranks must come from the same version of a concurrent tree */
+        root = _bintree_read_enter(bintreep);
+        above = (INT_MAX == data) ? _bintree_size(root) : _bintree_rank(root, data + 1);
+        cnt = above - _bintree_rank(root, data);
+        _bintree_read_exit(bintreep);
+        break;
+    }
+out:
+    return cnt;
+}
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "bintree_avl_gen.h"
+#include "logger.h"
+
+/*
+ * AVL mode for bintree
+ *
+ * Same node layout and search path as the plain tree; insert and remove
+ * additionally keep each node's height (and subtree size, recomputed at
+ * the same points) and rotate on the way back up so sibling subtree
+ * heights never differ by more than one.  Recursion depth
+ * is therefore bounded by ~1.44 * log2(n).
+ *
+ * Join and split, the primitives of the set operations in
+ * bintree_setop.c, relink existing nodes and never allocate.
+ *
+ * bintreeMultiset trees are AVL trees whose nodes carry a count; sizes
+ * here add up counts, so the same code balances both.
+ */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Size of a possibly-NULL subtree
+ *
+ * @param node (i) subtree root
+ * @return key count, 0 for NULL
+ */
+static inline int
+_avl_size(bintreenode_t *node)
+{
+    return (NULL == node) ? 0 : node->size;
+}
+
+/**
+ * Recompute a node's subtree size from its children, once its height
+ * is fixed
+ *
+ * @param node (i) node to update
+ * @return void
+ */
+static inline void
+_avl_update(bintreenode_t *node)
+{
+    node->size = node->count + _avl_size(node->left) + _avl_size(node->right);
+}
+
+#define _AVL_ROTATED() BINTREE_COUNT(rotations)
+
+/* _avl_height, _avl_fix, _avl_rotate_left/right, _avl_rebalance */
+BINTREE_AVL_DEFINE(_avl, bintreenode_t, _avl_update, BINTREE_AVL_NOP, _AVL_ROTATED)
+
+/**
+ * Unlink the minimum node of a subtree, rebalancing on the way up
+ *
+ * @param node (i) subtree root
+ * @param min  (o) the unlinked node
+ * @return new subtree root
+ */
+static bintreenode_t*
+_avl_unlink_min(bintreenode_t *node, bintreenode_t **min)
+{
+    if (NULL == node->left) {
+        *min = node;
+        return node->right;
+    }
+    node->left = _avl_unlink_min(node->left, min);
+    return _avl_rebalance(node);
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Insert into an AVL subtree
+ *
+ * Algorithm: plain BST descent (equal keys go right), then rebalance
+ *            each node on the path while unwinding
+ *
+ * @param bintreep (i) owning tree
+ * @param node     (i) subtree root
+ * @param data     (i) data to insert
+ * @return new subtree root
+ */
+bintreenode_t*
+_bintree_avl_insert(bintree_t *bintreep, bintreenode_t *node, int data)
+{
+    if (NULL == node) {
+        return _bintree_node_alloc(bintreep, data);
+    }
+
+    if (data < node->data) {
+        node->left = _bintree_avl_insert(bintreep, node->left, data);
+    } else {
+        node->right = _bintree_avl_insert(bintreep, node->right, data);
+    }
+    return _avl_rebalance(node);
+}
+
+/**
+ * Remove one occurrence of data from an AVL subtree
+ *
+ * Algorithm: find the node; if it has two children, splice its in-order
+ *            successor into its place (relinking, not copying data).
+ *            Rebalance each node on the path while unwinding.
+ *
+ * @param bintreep (i) owning tree
+ * @param node     (i) subtree root
+ * @param data     (i) data to remove
+ * @return new subtree root
+ */
+bintreenode_t*
+_bintree_avl_remove(bintree_t *bintreep, bintreenode_t *node, int data)
+{
+    if (NULL == node) {
+        logger(dbgWarn, "Data %i not found in tree", data);
+        return NULL;
+    }
+
+    if (data < node->data) {
+        node->left = _bintree_avl_remove(bintreep, node->left, data);
+    } else if (data > node->data) {
+        node->right = _bintree_avl_remove(bintreep, node->right, data);
+    } else {
+        bintreenode_t *left = node->left;
+        bintreenode_t *right = node->right;
+        bintreenode_t *succ = NULL;
+
+        _bintree_node_free(bintreep, node);
+        if (NULL == left) {
+            return right;
+        }
+        if (NULL == right) {
+            return left;
+        }
+        right = _avl_unlink_min(right, &succ);
+        succ->left = left;
+        succ->right = right;
+        node = succ;
+    }
+    return _avl_rebalance(node);
+}
+
+/**
+ * Join two AVL subtrees around a middle node
+ *
+ * Every key in l must be <= mid->data <= every key in r.
+ *
+ * Algorithm: if the heights are within one, mid becomes the root.
+ *            Otherwise descend the inner spine of the taller tree to
+ *            the first subtree no more than one taller than the other
+ *            tree, hang the join there and rebalance on the way back up,
+ *            as an insert would.  O(|height(l) - height(r)|)
+ *
+ * @param l   (i) left subtree, may be NULL
+ * @param mid (i) detached node to place between them
+ * @param r   (i) right subtree, may be NULL
+ * @return root of the joined tree
+ */
+bintreenode_t*
+_bintree_avl_join(bintreenode_t *l, bintreenode_t *mid, bintreenode_t *r)
+{
+    int hl = _avl_height(l);
+    int hr = _avl_height(r);
+
+    if (hl > hr + 1) {
+        l->right = _bintree_avl_join(l->right, mid, r);
+        return _avl_rebalance(l);
+    }
+    if (hr > hl + 1) {
+        r->left = _bintree_avl_join(l, mid, r->left);
+        return _avl_rebalance(r);
+    }
+    mid->left = l;
+    mid->right = r;
+    _avl_fix(mid);
+    return mid;
+}
+
+/**
+ * Join two AVL subtrees with no middle node, every key in l <= every
+ * key in r
+ *
+ * @param l (i) left subtree, may be NULL
+ * @param r (i) right subtree, may be NULL
+ * @return root of the joined tree
+ */
+bintreenode_t*
+_bintree_avl_join2(bintreenode_t *l, bintreenode_t *r)
+{
+    bintreenode_t *min = NULL;
+
+    if (NULL == r) {
+        return l;
+    }
+    r = _avl_unlink_min(r, &min);
+    return _bintree_avl_join(l, min, r);
+}
+
+/**
+ * Split an AVL subtree around data
+ *
+ * Algorithm: descend towards data; each node passed is joined, with the
+ *            subtree on its far side, onto the half it belongs to.  The
+ *            joins along the path telescope, O(log n) overall.
+ *
+ * @param node (i) subtree root, consumed
+ * @param data (i) split key
+ * @param l    (o) subtree of the keys < data, apart from any duplicates
+ *                 of data below the matching node
+ * @param r    (o) subtree of the keys > data, same caveat
+ * @return the detached node holding data, or NULL if there is none
+ */
+bintreenode_t*
+_bintree_avl_split(bintreenode_t *node, int data, bintreenode_t **l,
+                   bintreenode_t **r)
+{
+    bintreenode_t *found = NULL;
+    bintreenode_t *part = NULL;
+
+    if (NULL == node) {
+        *l = *r = NULL;
+        return NULL;
+    }
+    if (data < node->data) {
+        found = _bintree_avl_split(node->left, data, l, &part);
+        *r = _bintree_avl_join(part, node, node->right);
+    } else if (data > node->data) {
+        found = _bintree_avl_split(node->right, data, &part, r);
+        *l = _bintree_avl_join(node->left, node, part);
+    } else {
+        *l = node->left;
+        *r = node->right;
+        node->left = node->right = NULL;
+        found = node;
+    }
+    return found;
+}
@@ -0,0 +1,714 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * B-tree mode for bintree
+ *
+ * Each node's header and keys fill exactly one 64-byte cache line, so a
+ * lookup takes one miss per level instead of one per key compared.  Child
+ * pointers follow the key line and exist only in internal nodes; leaves
+ * are a single cache line.
+ *
+ * Unused key slots are kept at INT_MAX, so the in-node search can scan
+ * all BTREE_MAX_KEYS slots with a fixed trip count and no branches, which
+ * the compiler turns into a few vector compares.
+ *
+ * Duplicates are allowed: child i holds keys in [keys[i-1], keys[i]].
+ * Inserts descend by upper bound (equal keys go right), searches and
+ * removes by lower bound.
+ *
+ * Insert and remove follow the single-pass CLRS scheme: full children are
+ * split before descending into them, and minimal children are topped up
+ * from a sibling (or merged) before descending, so nothing walks back up.
+ */
+
+#define BTREE_NODE_ALIGN 64
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Bytes allocated for a B-tree node
+ *
+ * @param leaf (i) 1 for a leaf (no child pointers), 0 for internal
+ * @return size, a multiple of BTREE_NODE_ALIGN
+ */
+static inline size_t
+_btree_node_bytes(int leaf)
+{
+    size_t size = sizeof(btreenode_t);
+
+    if (!leaf) {
+        size += (BTREE_MAX_KEYS + 1) * sizeof(btreenode_t*);
+    }
+    /* aligned_alloc wants a multiple of the alignment */
+    return (size + BTREE_NODE_ALIGN - 1) & ~(size_t)(BTREE_NODE_ALIGN - 1);
+}
+
+/**
+ * Internal API to alloc and init a B-tree node
+ *
+ * Note this alloc's memory, need to call _btree_node_free
+ *
+ * @param leaf (i) 1 for a leaf (no child pointers), 0 for internal
+ * @return btreenode_t*
+ */
+static btreenode_t*
+_btree_node_alloc(int leaf)
+{
+    btreenode_t *node = NULL;
+    int i = 0;
+
+    node = (btreenode_t*)aligned_alloc(BTREE_NODE_ALIGN, _btree_node_bytes(leaf));
+    assert(NULL != node);
+
+    node->nkeys = 0;
+    node->leaf = leaf;
+    for (i = 0; i < BTREE_MAX_KEYS; i++) {
+        node->keys[i] = INT_MAX;
+    }
+    return node;
+}
+
+/**
+ * Internal API to free a B-tree node
+ *
+ * @param node (i) node to free
+ * @return void
+ */
+static void
+_btree_node_free(btreenode_t *node)
+{
+    assert(NULL != node);
+    free(node);
+}
+
+/**
+ * Number of keys in node strictly less than data
+ *
+ * Note - relies on unused slots holding INT_MAX, which is never < data
+ *
+ * @param node (i) node to scan
+ * @param data (i) key
+ * @return index of first key >= data
+ */
+static inline int
+_btree_lower(const btreenode_t *node, int data)
+{
+    int pos = 0;
+    int i = 0;
+
+    for (i = 0; i < BTREE_MAX_KEYS; i++) {
+        pos += (node->keys[i] < data);
+    }
+    return pos;
+}
+
+/**
+ * Number of keys in node less than or equal to data
+ *
+ * @param node (i) node to scan
+ * @param data (i) key
+ * @return index of first key > data
+ */
+static inline int
+_btree_upper(const btreenode_t *node, int data)
+{
+    int pos = 0;
+    int i = 0;
+
+    for (i = 0; i < BTREE_MAX_KEYS; i++) {
+        pos += (node->keys[i] <= data);
+    }
+    /* INT_MAX padding counts when data == INT_MAX */
+    return (pos < node->nkeys) ? pos : node->nkeys;
+}
+
+/**
+ * Split the full child at index i of a non-full parent
+ *
+ * Algorithm: the upper BTREE_MIN_DEGREE-1 keys (and children) move to a
+ *            new right sibling, the median moves up into the parent
+ *
+ * @param parent (i) non-full internal node
+ * @param i      (i) index of the full child
+ * @return void
+ */
+static void
+_btree_split_child(btreenode_t *parent, int i)
+{
+    btreenode_t *left = parent->child[i];
+    btreenode_t *right = _btree_node_alloc(left->leaf);
+    int t = BTREE_MIN_DEGREE;
+    int j = 0;
+
+    assert(BTREE_MAX_KEYS == left->nkeys);
+
+    right->nkeys = t - 1;
+    for (j = 0; j < t - 1; j++) {
+        right->keys[j] = left->keys[j + t];
+        left->keys[j + t] = INT_MAX;
+    }
+    if (!left->leaf) {
+        for (j = 0; j < t; j++) {
+            right->child[j] = left->child[j + t];
+        }
+    }
+
+    /* make room in the parent and pull up the median */
+    for (j = parent->nkeys; j > i; j--) {
+        parent->keys[j] = parent->keys[j - 1];
+        parent->child[j + 1] = parent->child[j];
+    }
+    parent->keys[i] = left->keys[t - 1];
+    parent->child[i + 1] = right;
+    parent->nkeys++;
+
+    left->keys[t - 1] = INT_MAX;
+    left->nkeys = t - 1;
+}
+
+/**
+ * Remove the key (and right child, for internal nodes) at index i,
+ * shifting the rest down
+ *
+ * @param node (i) node to remove from
+ * @param i    (i) key index
+ * @return void
+ */
+static void
+_btree_shift_out(btreenode_t *node, int i)
+{
+    int j = 0;
+
+    for (j = i; j < node->nkeys - 1; j++) {
+        node->keys[j] = node->keys[j + 1];
+        if (!node->leaf) {
+            node->child[j + 1] = node->child[j + 2];
+        }
+    }
+    node->nkeys--;
+    node->keys[node->nkeys] = INT_MAX;
+}
+
+/**
+ * Merge child i+1 and separator i into child i, freeing child i+1
+ *
+ * @param parent (i) internal node
+ * @param i      (i) index of left child
+ * @return the merged child
+ */
+static btreenode_t*
+_btree_merge(btreenode_t *parent, int i)
+{
+    btreenode_t *left = parent->child[i];
+    btreenode_t *right = parent->child[i + 1];
+    int j = 0;
+
+    left->keys[left->nkeys] = parent->keys[i];
+    for (j = 0; j < right->nkeys; j++) {
+        left->keys[left->nkeys + 1 + j] = right->keys[j];
+    }
+    if (!left->leaf) {
+        for (j = 0; j <= right->nkeys; j++) {
+            left->child[left->nkeys + 1 + j] = right->child[j];
+        }
+    }
+    left->nkeys += 1 + right->nkeys;
+
+    _btree_shift_out(parent, i);
+    _btree_node_free(right);
+    return left;
+}
+
+/**
+ * Make sure child i of parent has at least BTREE_MIN_DEGREE keys before
+ * descending into it
+ *
+ * Algorithm: borrow through the parent from a sibling with a spare key,
+ *            otherwise merge with a sibling
+ *
+ * @param parent (i) internal node
+ * @param i      (i) index of child to top up
+ * @return child to descend into (may be the merged left sibling)
+ */
+static btreenode_t*
+_btree_fill(btreenode_t *parent, int i)
+{
+    btreenode_t *c = parent->child[i];
+    int j = 0;
+
+    if (i > 0 && parent->child[i - 1]->nkeys >= BTREE_MIN_DEGREE) {
+        /* rotate right: left sibling -> parent -> c */
+        btreenode_t *l = parent->child[i - 1];
+        for (j = c->nkeys; j > 0; j--) {
+            c->keys[j] = c->keys[j - 1];
+        }
+        if (!c->leaf) {
+            for (j = c->nkeys + 1; j > 0; j--) {
+                c->child[j] = c->child[j - 1];
+            }
+            c->child[0] = l->child[l->nkeys];
+        }
+        c->keys[0] = parent->keys[i - 1];
+        c->nkeys++;
+        parent->keys[i - 1] = l->keys[l->nkeys - 1];
+        l->nkeys--;
+        l->keys[l->nkeys] = INT_MAX;
+        return c;
+    }
+
+    if (i < parent->nkeys && parent->child[i + 1]->nkeys >= BTREE_MIN_DEGREE) {
+        /* rotate left: c <- parent <- right sibling */
+        btreenode_t *r = parent->child[i + 1];
+        c->keys[c->nkeys] = parent->keys[i];
+        if (!c->leaf) {
+            c->child[c->nkeys + 1] = r->child[0];
+        }
+        c->nkeys++;
+        parent->keys[i] = r->keys[0];
+        for (j = 0; j < r->nkeys - 1; j++) {
+            r->keys[j] = r->keys[j + 1];
+        }
+        if (!r->leaf) {
+            for (j = 0; j < r->nkeys; j++) {
+                r->child[j] = r->child[j + 1];
+            }
+        }
+        r->nkeys--;
+        r->keys[r->nkeys] = INT_MAX;
+        return c;
+    }
+
+    if (i < parent->nkeys) {
+        return _btree_merge(parent, i);
+    }
+    return _btree_merge(parent, i - 1);
+}
+
+/**
+ * If a merge emptied an internal root, its only child becomes the root
+ *
+ * @param rootp (i/o) root link
+ * @return void
+ */
+static void
+_btree_shrink_root(btreenode_t **rootp)
+{
+    btreenode_t *root = *rootp;
+
+    if (0 == root->nkeys) {
+        *rootp = root->leaf ? NULL : root->child[0];
+        _btree_node_free(root);
+    }
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Insert into a B-tree
+ *
+ * @param rootp (i/o) root link
+ * @param data  (i) data to insert
+ * @return void
+ */
+void
+_bintree_btree_insert(btreenode_t **rootp, int data)
+{
+    btreenode_t *node = *rootp;
+    int i = 0;
+
+    if (NULL == node) {
+        node = _btree_node_alloc(1);
+        *rootp = node;
+    } else if (BTREE_MAX_KEYS == node->nkeys) {
+        /* full root: grow a level on top, then split */
+        btreenode_t *new_root = _btree_node_alloc(0);
+        new_root->child[0] = node;
+        _btree_split_child(new_root, 0);
+        *rootp = new_root;
+        node = new_root;
+    }
+
+    while (!node->leaf) {
+        i = _btree_upper(node, data);
+        if (BTREE_MAX_KEYS == node->child[i]->nkeys) {
+            _btree_split_child(node, i);
+            if (data >= node->keys[i]) {
+                i++;
+            }
+        }
+        node = node->child[i];
+    }
+
+    i = _btree_upper(node, data);
+    memmove(&node->keys[i + 1], &node->keys[i],
+            (node->nkeys - i) * sizeof(node->keys[0]));
+    node->keys[i] = data;
+    node->nkeys++;
+}
+
+/**
+ * Remove one occurrence of data from a B-tree
+ *
+ * Algorithm (CLRS):
+ *    key found in leaf:      shift it out
+ *    key found in internal:  replace it by its predecessor (or successor)
+ *                            from a child with a spare key and go delete
+ *                            that instead; if neither child has a spare,
+ *                            merge both around the key and keep going
+ *    key not in node:        top up the child we are about to enter
+ *
+ * @param rootp (i/o) root link
+ * @param data  (i) data to remove
+ * @return 1 if removed, 0 if not found
+ */
+int
+_bintree_btree_remove(btreenode_t **rootp, int data)
+{
+    btreenode_t *node = *rootp;
+    int i = 0;
+
+    while (NULL != node) {
+        i = _btree_lower(node, data);
+
+        if (i < node->nkeys && data == node->keys[i]) {
+            if (node->leaf) {
+                _btree_shift_out(node, i);
+                if (node == *rootp) {
+                    _btree_shrink_root(rootp);
+                }
+                return 1;
+            }
+
+            btreenode_t *y = node->child[i];
+            btreenode_t *z = node->child[i + 1];
+            if (y->nkeys >= BTREE_MIN_DEGREE) {
+                btreenode_t *p = y;
+                while (!p->leaf) {
+                    p = p->child[p->nkeys];
+                }
+                data = p->keys[p->nkeys - 1];
+                node->keys[i] = data;
+                node = y;
+            } else if (z->nkeys >= BTREE_MIN_DEGREE) {
+                btreenode_t *s = z;
+                while (!s->leaf) {
+                    s = s->child[0];
+                }
+                data = s->keys[0];
+                node->keys[i] = data;
+                node = z;
+            } else {
+                btreenode_t *merged = _btree_merge(node, i);
+                if (node == *rootp) {
+                    _btree_shrink_root(rootp);
+                }
+                node = merged;
+            }
+            continue;
+        }
+
+        if (node->leaf) {
+            return 0;
+        }
+
+        if (node->child[i]->nkeys < BTREE_MIN_DEGREE) {
+            btreenode_t *c = _btree_fill(node, i);
+            if (node == *rootp) {
+                _btree_shrink_root(rootp);
+            }
+            node = c;
+        } else {
+            node = node->child[i];
+        }
+    }
+    return 0;
+}
+
+/**
+ * Search a B-tree for a datum
+ *
+ * @param node (i) root node
+ * @param data (i) data to search for
+ * @return 1 if found, 0 if not found
+ */
+int
+_bintree_btree_search(const btreenode_t *node, int data)
+{
+    int i = 0;
+
+    while (NULL != node) {
+        i = _btree_lower(node, data);
+        if (i < node->nkeys && data == node->keys[i]) {
+            return 1;
+        }
+        if (node->leaf) {
+            return 0;
+        }
+        node = node->child[i];
+    }
+    return 0;
+}
+
+/**
+ * Free every node of a B-tree
+ *
+ * @param node (i) root node
+ * @return void
+ */
+void
+_bintree_btree_destroy(btreenode_t *node)
+{
+    int i = 0;
+
+    if (NULL == node) {
+        return;
+    }
+    if (!node->leaf) {
+        for (i = 0; i <= node->nkeys; i++) {
+            _bintree_btree_destroy(node->child[i]);
+        }
+    }
+    _btree_node_free(node);
+}
+
+/**
+ * Smallest key in a non-empty B-tree
+ *
+ * @param node (i) root node
+ * @return minimum value
+ */
+int
+_bintree_btree_minvalue(const btreenode_t *node)
+{
+    while (!node->leaf) {
+        node = node->child[0];
+    }
+    return node->keys[0];
+}
+
+/**
+ * Largest key in a non-empty B-tree
+ *
+ * @param node (i) root node
+ * @return maximum value
+ */
+int
+_bintree_btree_maxvalue(const btreenode_t *node)
+{
+    while (!node->leaf) {
+        node = node->child[node->nkeys];
+    }
+    return node->keys[node->nkeys - 1];
+}
+
+/**
+ * Number of node levels in a B-tree (all leaves sit at the same depth)
+ *
+ * @param node (i) root node
+ * @return levels, 0 for an empty tree
+ */
+int
+_bintree_btree_maxdepth(const btreenode_t *node)
+{
+    int depth = 0;
+
+    while (NULL != node) {
+        depth++;
+        node = node->leaf ? NULL : node->child[0];
+    }
+    return depth;
+}
+
+/**
+ * Log the keys of a B-tree in the given order
+ *
+ * Pre-order logs a node's keys before its children, post-order after,
+ * in-order interleaves them so keys come out sorted
+ *
+ * @param node  (i) root node
+ * @param order (i) "Preorder", "Inorder" or "Postorder"
+ * @return void
+ */
+void
+_bintree_btree_traverse(const btreenode_t *node, const char *order)
+{
+    int inorder = (0 == strcmp(order, "Inorder"));
+    int i = 0;
+
+    if (NULL == node) {
+        return;
+    }
+    if (0 == strcmp(order, "Preorder")) {
+        for (i = 0; i < node->nkeys; i++) {
+            logger(dbgInfo, "%s: %i, ", order, node->keys[i]);
+        }
+    }
+    for (i = 0; i <= node->nkeys; i++) {
+        if (!node->leaf) {
+            _bintree_btree_traverse(node->child[i], order);
+        }
+        if (inorder && i < node->nkeys) {
+            logger(dbgInfo, "%s: %i, ", order, node->keys[i]);
+        }
+    }
+    if (0 == strcmp(order, "Postorder")) {
+        for (i = 0; i < node->nkeys; i++) {
+            logger(dbgInfo, "%s: %i, ", order, node->keys[i]);
+        }
+    }
+}
+
+/**
+ * Hand a B-tree node's keys to fn, see _bintree_btree_walk
+ *
+ * @param node    (i) node
+ * @param fn      (i) callback
+ * @param ctx     (i) passed to fn
+ * @param visited (i/o) keys passed to fn so far
+ * @return 1 if fn asked to stop, else 0
+ */
+static int
+_btree_walk_keys(const btreenode_t *node, int (*fn)(int data, void *ctx),
+                 void *ctx, int *visited)
+{
+    int i = 0;
+
+    for (i = 0; i < node->nkeys; i++) {
+        (*visited)++;
+        if (0 != fn(node->keys[i], ctx)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Recursive part of _bintree_btree_walk
+ *
+ * @param node    (i) subtree root
+ * @param order   (i) traversal order
+ * @param fn      (i) callback
+ * @param ctx     (i) passed to fn
+ * @param visited (i/o) keys passed to fn so far
+ * @return 1 if fn asked to stop, else 0
+ */
+static int
+_btree_walk(const btreenode_t *node, bintree_order_e order,
+            int (*fn)(int data, void *ctx), void *ctx, int *visited)
+{
+    int i = 0;
+
+    if (NULL == node) {
+        return 0;
+    }
+    if (bintreePreorder == order && _btree_walk_keys(node, fn, ctx, visited)) {
+        return 1;
+    }
+    for (i = 0; i <= node->nkeys; i++) {
+        if (!node->leaf && _btree_walk(node->child[i], order, fn, ctx, visited)) {
+            return 1;
+        }
+        if (bintreeInorder == order && i < node->nkeys) {
+            (*visited)++;
+            if (0 != fn(node->keys[i], ctx)) {
+                return 1;
+            }
+        }
+    }
+    if (bintreePostorder == order && _btree_walk_keys(node, fn, ctx, visited)) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Call fn on the keys of a B-tree in the given order, orders as for
+ * _bintree_btree_traverse; recursion depth is the tree's height
+ *
+ * @param node  (i) root node
+ * @param order (i) traversal order
+ * @param fn    (i) callback, non-zero return stops the walk
+ * @param ctx   (i) passed to fn
+ * @return number of keys passed to fn
+ */
+int
+_bintree_btree_walk(const btreenode_t *node, bintree_order_e order,
+                    int (*fn)(int data, void *ctx), void *ctx)
+{
+    int visited = 0;
+
+    _btree_walk(node, order, fn, ctx, &visited);
+    return visited;
+}
+
+/**
+ * Copy a B-tree's keys out in ascending order
+ *
+ * @param node (i) root node
+ * @param out  (o) array with room for every key
+ * @return number of keys written
+ */
+int
+_bintree_btree_collect(const btreenode_t *node, int *out)
+{
+    int n = 0;
+    int i = 0;
+
+    if (NULL == node) {
+        return 0;
+    }
+    for (i = 0; i < node->nkeys; i++) {
+        if (!node->leaf) {
+            n += _bintree_btree_collect(node->child[i], out + n);
+        }
+        out[n++] = node->keys[i];
+    }
+    if (!node->leaf) {
+        n += _bintree_btree_collect(node->child[node->nkeys], out + n);
+    }
+    return n;
+}
+
+/**
+ * Add a B-tree's keys, levels and node memory to a stats record
+ *
+ * Each key counts as a node at its node's level; avg_path is left as
+ * the sum of those levels for the caller to divide
+ *
+ * @param node  (i) subtree root
+ * @param depth (i) level of node, 1 for the root
+ * @param out   (i/o) stats being gathered
+ * @return void
+ */
+void
+_bintree_btree_stats(const btreenode_t *node, int depth, bintree_stats_t *out)
+{
+    int i = 0;
+
+    if (NULL == node) {
+        return;
+    }
+    out->keys += node->nkeys;
+    out->nodes += node->nkeys;
+    out->depth_hist[(depth < BINTREE_STATS_DEPTHS ? depth : BINTREE_STATS_DEPTHS) - 1] +=
+        node->nkeys;
+    out->avg_path += (double)depth * node->nkeys;
+    out->memory += _btree_node_bytes(node->leaf);
+    if (depth > out->height) {
+        out->height = depth;
+    }
+    if (!node->leaf) {
+        for (i = 0; i <= node->nkeys; i++) {
+            _bintree_btree_stats(node->child[i], depth + 1, out);
+        }
+    }
+}
@@ -0,0 +1,527 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "bintree_compact_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Compact bintree
+ *
+ * A plain BST whose nodes are slots of one array, linked by 32-bit
+ * index.  A pointer-mode node is 32 bytes: key, height and size, then
+ * two 8-byte links; here it is the key and two 4-byte links, 12 bytes,
+ * with five nodes to a cache line instead of two.  The array doubles as
+ * it fills, and realloc of a large block can remap rather than copy.
+ *
+ * Because the array can move, nothing holds a node pointer across an
+ * alloc: insert allocates first and walks after.  Every walk is
+ * iterative, since an unbalanced tree can be as deep as it is large.
+ */
+
+#define COMPACT_MAGIC_IN_USE_CHECK(_mag_) \
+    if (BINTREE_COMPACT_MAGIC_IN_USE != _mag_) { \
+        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
+                BINTREE_COMPACT_MAGIC_IN_USE, _mag_); \
+        goto out; \
+    } \
+
+#define COMPACT_STACK_INLINE 64
+
+/* Explicit stack for the walks, inline until a deep tree outgrows it */
+typedef struct compact_stack_s {
+    int top;
+    int cap;
+    uint32_t *slot;
+    int *depth;
+    uint32_t inline_slot[COMPACT_STACK_INLINE];
+    int inline_depth[COMPACT_STACK_INLINE];
+} compact_stack_t;
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Grow the slot array to hold at least cap slots
+ *
+ * @param treep (i/o) compact tree
+ * @param cap   (i) slots wanted, slot 0 included
+ * @return void
+ */
+static void
+_compact_grow(bintree_compact_t *treep, uint32_t cap)
+{
+    bintree_cnode_t *slot = NULL;
+
+    if (cap <= treep->cap) {
+        return;
+    }
+    slot = (bintree_cnode_t*)realloc(treep->slot, (size_t)cap * sizeof(*slot));
+    assert(NULL != slot);
+    treep->slot = slot;
+    treep->cap = cap;
+}
+
+/**
+ * Alloc a leaf, reusing a freed slot if there is one
+ *
+ * Note - may move the slot array
+ *
+ * @param treep (i/o) compact tree
+ * @param data  (i) data to store
+ * @return index of the new node
+ */
+static uint32_t
+_compact_node_alloc(bintree_compact_t *treep, int data)
+{
+    uint32_t idx = treep->freelist;
+
+    if (BINTREE_COMPACT_NIL != idx) {
+        treep->freelist = treep->slot[idx].left;
+    } else {
+        if (treep->used == treep->cap) {
+            assert(treep->cap <= UINT32_MAX / 2);
+            _compact_grow(treep, 2 * treep->cap);
+        }
+        idx = treep->used++;
+    }
+    treep->slot[idx].data = data;
+    treep->slot[idx].left = BINTREE_COMPACT_NIL;
+    treep->slot[idx].right = BINTREE_COMPACT_NIL;
+    return idx;
+}
+
+/**
+ * Push a node and its depth, moving the stack to the heap once it
+ * outgrows the inline arrays
+ *
+ * @param st    (i/o) stack
+ * @param idx   (i) node
+ * @param depth (i) depth of the node
+ * @return void
+ */
+static inline void
+_compact_push(compact_stack_t *st, uint32_t idx, int depth)
+{
+    if (st->top == st->cap) {
+        uint32_t *slot = NULL;
+        int *dep = NULL;
+        st->cap *= 2;
+        if (st->slot == st->inline_slot) {
+            slot = (uint32_t*)malloc(st->cap * sizeof(*slot));
+            dep = (int*)malloc(st->cap * sizeof(*dep));
+            assert(NULL != slot && NULL != dep);
+            memcpy(slot, st->inline_slot, sizeof(st->inline_slot));
+            memcpy(dep, st->inline_depth, sizeof(st->inline_depth));
+        } else {
+            slot = (uint32_t*)realloc(st->slot, st->cap * sizeof(*slot));
+            dep = (int*)realloc(st->depth, st->cap * sizeof(*dep));
+            assert(NULL != slot && NULL != dep);
+        }
+        st->slot = slot;
+        st->depth = dep;
+    }
+    st->slot[st->top] = idx;
+    st->depth[st->top++] = depth;
+}
+
+/**
+ * Set up an empty stack
+ *
+ * @param st (o) stack
+ * @return void
+ */
+static void
+_compact_stack_init(compact_stack_t *st)
+{
+    st->top = 0;
+    st->cap = COMPACT_STACK_INLINE;
+    st->slot = st->inline_slot;
+    st->depth = st->inline_depth;
+}
+
+/**
+ * Free a stack's heap arrays, if it has any
+ *
+ * @param st (i/o) stack
+ * @return void
+ */
+static void
+_compact_stack_release(compact_stack_t *st)
+{
+    if (st->slot != st->inline_slot) {
+        free(st->slot);
+        free(st->depth);
+    }
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Create a new, empty compact tree
+ *
+ * Note - allocs mem for a new tree, caller must call
+ *        bintree_compact_destroy()
+ *
+ * @param name (i) name for the tree
+ * @return BintreeCompactPtr
+ */
+BintreeCompactPtr
+bintree_compact_create(const char *name)
+{
+    assert(NULL != name);
+
+    BintreeCompactPtr treep = (bintree_compact_t*)malloc(sizeof(*treep));
+    assert(NULL != treep);
+
+    treep->magic = BINTREE_COMPACT_MAGIC_IN_USE;
+    strncpy(treep->name, name, BINTREE_MAX_NAME_LEN - 1);
+    treep->name[BINTREE_MAX_NAME_LEN - 1] = '\0';
+    treep->slot = NULL;
+    treep->cap = 0;
+    treep->used = 1;
+    treep->root = BINTREE_COMPACT_NIL;
+    treep->freelist = BINTREE_COMPACT_NIL;
+    treep->count = 0;
+    _compact_grow(treep, BINTREE_COMPACT_MIN_SLOTS);
+    return treep;
+}
+
+/**
+ * Destroy a compact tree, O(1): the nodes go with the array
+ *
+ * @param treep (i) compact tree
+ * @return void
+ */
+void
+bintree_compact_destroy(BintreeCompactPtr treep)
+{
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    free(treep->slot);
+    treep->magic = BINTREE_COMPACT_MAGIC_FREED;
+    free(treep);
+out:
+    return;
+}
+
+/**
+ * Make room for n more keys up front, so a bulk load neither moves the
+ * array nor ends up with up to twice the slots it needs
+ *
+ * @param treep (i/o) compact tree
+ * @param n     (i) keys about to be inserted
+ * @return void
+ */
+void
+bintree_compact_reserve(BintreeCompactPtr treep, int n)
+{
+    assert(NULL != treep);
+    assert(n >= 0);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    assert((uint64_t)treep->used + n <= UINT32_MAX);
+    _compact_grow(treep, treep->used + n);
+out:
+    return;
+}
+
+/**
+ * Insert a key, equal keys go right of existing ones
+ *
+ * @param treep (i/o) compact tree
+ * @param data  (i) data to insert
+ * @return void
+ */
+void
+bintree_compact_insert(BintreeCompactPtr treep, int data)
+{
+    uint32_t idx = BINTREE_COMPACT_NIL;
+    uint32_t *link = NULL;
+
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    /* alloc first: it may move the array the walk points into */
+    idx = _compact_node_alloc(treep, data);
+    link = &treep->root;
+    while (BINTREE_COMPACT_NIL != *link) {
+        bintree_cnode_t *node = &treep->slot[*link];
+        link = (data < node->data) ? &node->left : &node->right;
+    }
+    *link = idx;
+    treep->count++;
+out:
+    return;
+}
+
+/**
+ * Remove one occurrence of a key
+ *
+ * Algorithm: as _bintree_remove() in bintree.c: walk the parent's link
+ *            down to the node, splice out a node with at most one child,
+ *            else move its in-order successor into its place
+ *
+ * @param treep (i/o) compact tree
+ * @param data  (i) data to remove
+ * @return void
+ */
+void
+bintree_compact_remove(BintreeCompactPtr treep, int data)
+{
+    bintree_cnode_t *slot = NULL, *node = NULL;
+    uint32_t *link = NULL;
+    uint32_t idx = BINTREE_COMPACT_NIL;
+
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    slot = treep->slot;
+    link = &treep->root;
+    while (BINTREE_COMPACT_NIL != (idx = *link) && data != slot[idx].data) {
+        link = (data < slot[idx].data) ? &slot[idx].left : &slot[idx].right;
+    }
+    if (BINTREE_COMPACT_NIL == idx) {
+        logger(dbgWarn, "Data %i not found in tree", data);
+        goto out;
+    }
+
+    node = &slot[idx];
+    if (BINTREE_COMPACT_NIL == node->left) {
+        *link = node->right;
+    } else if (BINTREE_COMPACT_NIL == node->right) {
+        *link = node->left;
+    } else {
+        uint32_t *succ_link = &node->right;
+        uint32_t succ = BINTREE_COMPACT_NIL;
+
+        while (BINTREE_COMPACT_NIL != slot[*succ_link].left) {
+            succ_link = &slot[*succ_link].left;
+        }
+        succ = *succ_link;
+        *succ_link = slot[succ].right;
+
+        slot[succ].left = node->left;
+        slot[succ].right = node->right;
+        *link = succ;
+    }
+    node->left = treep->freelist;
+    treep->freelist = idx;
+    treep->count--;
+out:
+    return;
+}
+
+/**
+ * Search for a key
+ *
+ * @param treep (i) compact tree
+ * @param data  (i) data to search for
+ * @return 1 if found, else 0
+ */
+int
+bintree_compact_search(BintreeCompactPtr treep, int data)
+{
+    const bintree_cnode_t *slot = NULL;
+    uint32_t idx = BINTREE_COMPACT_NIL;
+
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    slot = treep->slot;
+    idx = treep->root;
+    while (BINTREE_COMPACT_NIL != idx) {
+        if (data == slot[idx].data) {
+            return 1;
+        }
+        idx = (data < slot[idx].data) ? slot[idx].left : slot[idx].right;
+    }
+out:
+    return 0;
+}
+
+/**
+ * Number of keys, O(1)
+ *
+ * @param treep (i) compact tree
+ * @return key count
+ */
+int
+bintree_compact_count(BintreeCompactPtr treep)
+{
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    return treep->count;
+out:
+    return 0;
+}
+
+/**
+ * Find the smallest key
+ *
+ * @param treep (i) compact tree
+ * @return minimum value, 0 if empty
+ */
+int
+bintree_compact_minvalue(BintreeCompactPtr treep)
+{
+    uint32_t idx = BINTREE_COMPACT_NIL;
+
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    idx = treep->root;
+    if (BINTREE_COMPACT_NIL == idx) {
+        goto out;
+    }
+    while (BINTREE_COMPACT_NIL != treep->slot[idx].left) {
+        idx = treep->slot[idx].left;
+    }
+    return treep->slot[idx].data;
+out:
+    return 0;
+}
+
+/**
+ * Find the largest key
+ *
+ * @param treep (i) compact tree
+ * @return maximum value, 0 if empty
+ */
+int
+bintree_compact_maxvalue(BintreeCompactPtr treep)
+{
+    uint32_t idx = BINTREE_COMPACT_NIL;
+
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    idx = treep->root;
+    if (BINTREE_COMPACT_NIL == idx) {
+        goto out;
+    }
+    while (BINTREE_COMPACT_NIL != treep->slot[idx].right) {
+        idx = treep->slot[idx].right;
+    }
+    return treep->slot[idx].data;
+out:
+    return 0;
+}
+
+/**
+ * Depth of the deepest leaf, 1 for a lone root, 0 if empty
+ *
+ * Algorithm: depth-first with an explicit stack of pending right
+ *            children, so a right-leaning chain needs no stack at all
+ *
+ * @param treep (i) compact tree
+ * @return max depth
+ */
+int
+bintree_compact_maxdepth(BintreeCompactPtr treep)
+{
+    compact_stack_t st;
+    const bintree_cnode_t *slot = NULL;
+    uint32_t idx = BINTREE_COMPACT_NIL;
+    int depth = 0, max = 0;
+
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    _compact_stack_init(&st);
+    slot = treep->slot;
+    idx = treep->root;
+    depth = 1;
+    for (;;) {
+        while (BINTREE_COMPACT_NIL != idx) {
+            if (depth > max) {
+                max = depth;
+            }
+            if (BINTREE_COMPACT_NIL != slot[idx].right) {
+                _compact_push(&st, slot[idx].right, depth + 1);
+            }
+            idx = slot[idx].left;
+            depth++;
+        }
+        if (0 == st.top) {
+            break;
+        }
+        st.top--;
+        idx = st.slot[st.top];
+        depth = st.depth[st.top];
+    }
+    _compact_stack_release(&st);
+    return max;
+out:
+    return 0;
+}
+
+/**
+ * Call fn for every key in ascending order
+ *
+ * fn returns 0 to keep going, anything else to stop after the current
+ * key.  fn must not modify the tree.
+ *
+ * @param treep (i) compact tree
+ * @param fn    (i) callback, gets the key and ctx
+ * @param ctx   (i) opaque user context passed to fn
+ * @return number of keys passed to fn
+ */
+int
+bintree_compact_inorder_foreach(BintreeCompactPtr treep,
+                                int (*fn)(int data, void *ctx), void *ctx)
+{
+    compact_stack_t st;
+    const bintree_cnode_t *slot = NULL;
+    uint32_t idx = BINTREE_COMPACT_NIL;
+    int visited = 0;
+
+    assert(NULL != treep);
+    assert(NULL != fn);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    _compact_stack_init(&st);
+    slot = treep->slot;
+    idx = treep->root;
+    for (;;) {
+        while (BINTREE_COMPACT_NIL != idx) {
+            _compact_push(&st, idx, 0);
+            idx = slot[idx].left;
+        }
+        if (0 == st.top) {
+            break;
+        }
+        idx = st.slot[--st.top];
+        visited++;
+        if (0 != fn(slot[idx].data, ctx)) {
+            break;
+        }
+        idx = slot[idx].right;
+    }
+    _compact_stack_release(&st);
+    return visited;
+out:
+    return 0;
+}
+
+/**
+ * Bytes held by the tree: the header plus every slot allocated, in use
+ * or not
+ *
+ * @param treep (i) compact tree
+ * @return bytes
+ */
+size_t
+bintree_compact_memory(BintreeCompactPtr treep)
+{
+    assert(NULL != treep);
+    COMPACT_MAGIC_IN_USE_CHECK(treep->magic);
+
+    return sizeof(*treep) + (size_t)treep->cap * sizeof(bintree_cnode_t);
+out:
+    return 0;
+}
@@ -0,0 +1,587 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/*
+ * Frozen mode for bintree
+ *
+ * The keys live in one array in Eytzinger (BFS) order: 1-based slot k
+ * has children 2k and 2k+1, so the array is itself a complete BST with
+ * no pointers.  The top levels share a handful of cache lines, and the
+ * 16 great-great-grandchildren of slot k are contiguous at 16k, so one
+ * prefetch per step covers the line needed four levels later.
+ *
+ * Search is a branchless lower bound: k = 2k + (key < data) until k falls
+ * off the array, then the trailing 1-bits (right turns taken after the
+ * last left turn) are shifted out to recover the answer slot.
+ */
+
+#define FROZEN_ALIGN     64
+#define FROZEN_BATCH     8      /* lookups advanced in lockstep */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Internal API to fill the Eytzinger array from sorted keys
+ *
+ * Algorithm: in-order walk of the implicit tree, handing out sorted keys
+ *
+ * @param sorted (i) keys in ascending order
+ * @param i      (i/o) next sorted key to place
+ * @param eytz   (o) 1-based output array
+ * @param k      (i) current slot
+ * @param n      (i) number of keys
+ * @return void
+ */
+static void
+_frozen_fill(const int *sorted, int *i, int *eytz, int k, int n)
+{
+    if (k > n) {
+        return;
+    }
+    _frozen_fill(sorted, i, eytz, 2 * k, n);
+    eytz[k] = sorted[(*i)++];
+    _frozen_fill(sorted, i, eytz, 2 * k + 1, n);
+}
+
+/**
+ * Slot of the first key >= data, or 0 if every key is smaller
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @param data (i) key
+ * @return slot index
+ */
+static inline int
+_frozen_lower(const int *eytz, int n, int data)
+{
+    unsigned int k = 1;
+
+    while (k <= (unsigned int)n) {
+        __builtin_prefetch(eytz + 16 * k);
+        k = 2 * k + (eytz[k] < data);
+    }
+    return k >> __builtin_ffs(~k);
+}
+
+/**
+ * Number of slots in the subtree under slot k: one per level, each level
+ * twice as wide as the one above and clipped at n
+ *
+ * @param k (i) subtree root slot
+ * @param n (i) number of keys
+ * @return subtree size
+ */
+static inline unsigned int
+_frozen_size(unsigned int k, unsigned int n)
+{
+    unsigned int size = 0, width = 1;
+
+    while (k <= n) {
+        size += (n - k + 1 < width) ? n - k + 1 : width;
+        k <<= 1;
+        width <<= 1;
+    }
+    return size;
+}
+
+/**
+ * Path-sum check over the implicit tree, see _bintree_hasPathSum
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @param k    (i) current slot
+ * @param sum  (i) remaining sum
+ * @return 1 if sum exists in a path, 0 else
+ */
+static int
+_frozen_hasPathSum(const int *eytz, int n, int k, int sum)
+{
+    if (k > n) {
+        return (0 == sum);
+    }
+    int new_sum = sum - eytz[k];
+    return (_frozen_hasPathSum(eytz, n, 2 * k, new_sum) ||
+            _frozen_hasPathSum(eytz, n, 2 * k + 1, new_sum));
+}
+
+/**
+ * Logging traversal over the implicit tree
+ *
+ * @param eytz  (i) 1-based array
+ * @param n     (i) number of keys
+ * @param k     (i) current slot
+ * @param order (i) "Preorder", "Inorder" or "Postorder"
+ * @return void
+ */
+static void
+_frozen_traverse(const int *eytz, int n, int k, const char *order)
+{
+    if (k > n) {
+        return;
+    }
+    if (0 == strcmp(order, "Preorder")) {
+        logger(dbgInfo, "%s: %i, ", order, eytz[k]);
+    }
+    _frozen_traverse(eytz, n, 2 * k, order);
+    if (0 == strcmp(order, "Inorder")) {
+        logger(dbgInfo, "%s: %i, ", order, eytz[k]);
+    }
+    _frozen_traverse(eytz, n, 2 * k + 1, order);
+    if (0 == strcmp(order, "Postorder")) {
+        logger(dbgInfo, "%s: %i, ", order, eytz[k]);
+    }
+}
+
+/**
+ * Callback traversal over the implicit tree
+ *
+ * @param eytz    (i) 1-based array
+ * @param n       (i) number of keys
+ * @param k       (i) current slot
+ * @param order   (i) traversal order
+ * @param fn      (i) callback
+ * @param ctx     (i) passed to fn
+ * @param visited (i/o) keys passed to fn so far
+ * @return 1 if fn asked to stop, else 0
+ */
+static int
+_frozen_walk(const int *eytz, int n, int k, bintree_order_e order,
+             int (*fn)(int data, void *ctx), void *ctx, int *visited)
+{
+    if (k > n) {
+        return 0;
+    }
+    if (bintreePreorder == order) {
+        (*visited)++;
+        if (0 != fn(eytz[k], ctx)) {
+            return 1;
+        }
+    }
+    if (_frozen_walk(eytz, n, 2 * k, order, fn, ctx, visited)) {
+        return 1;
+    }
+    if (bintreeInorder == order) {
+        (*visited)++;
+        if (0 != fn(eytz[k], ctx)) {
+            return 1;
+        }
+    }
+    if (_frozen_walk(eytz, n, 2 * k + 1, order, fn, ctx, visited)) {
+        return 1;
+    }
+    if (bintreePostorder == order) {
+        (*visited)++;
+        return (0 != fn(eytz[k], ctx));
+    }
+    return 0;
+}
+
+/**
+ * Batch search, FROZEN_BATCH lookups advanced one level at a time so
+ * their cache misses overlap
+ *
+ * @param eytz  (i) 1-based array
+ * @param n     (i) number of keys
+ * @param keys  (i) keys to look up
+ * @param found (o) found[i] = 1 if keys[i] present
+ * @param cnt   (i) number of keys, at most FROZEN_BATCH
+ * @return void
+ */
+static void
+_frozen_search_group(const int *eytz, int n, const int *keys,
+                     uint8_t *found, int cnt)
+{
+    unsigned int k[FROZEN_BATCH];
+    int j = 0;
+    int live = cnt;
+
+    for (j = 0; j < cnt; j++) {
+        k[j] = 1;
+    }
+    while (live > 0) {
+        live = 0;
+        for (j = 0; j < cnt; j++) {
+            if (k[j] <= (unsigned int)n) {
+                __builtin_prefetch(eytz + 16 * k[j]);
+                k[j] = 2 * k[j] + (eytz[k[j]] < keys[j]);
+                live++;
+            }
+        }
+    }
+    for (j = 0; j < cnt; j++) {
+        unsigned int slot = k[j] >> __builtin_ffs(~k[j]);
+        found[j] = (0 != slot && eytz[slot] == keys[j]);
+    }
+}
+
+#if defined(__x86_64__)
+/**
+ * AVX2 version of _frozen_search_group for a full batch of 8
+ *
+ * Algorithm: all 8 lanes step for the tree height; a lane whose slot has
+ *            fallen off the array stops moving and gathers a clamped,
+ *            always-valid slot instead
+ */
+__attribute__((target("avx2")))
+static void
+_frozen_search_group_avx2(const int *eytz, int n, int levels,
+                          const int *keys, uint8_t *found)
+{
+    __m256i x = _mm256_loadu_si256((const __m256i*)keys);
+    __m256i k = _mm256_set1_epi32(1);
+    __m256i nv = _mm256_set1_epi32(n);
+    __m256i one = _mm256_set1_epi32(1);
+    unsigned int slots[FROZEN_BATCH];
+    int l = 0, j = 0;
+
+    for (l = 0; l < levels; l++) {
+        __m256i live = _mm256_cmpgt_epi32(_mm256_add_epi32(nv, one), k);
+        __m256i idx = _mm256_min_epi32(k, nv);
+        __m256i v = _mm256_i32gather_epi32(eytz, idx, 4);
+        __m256i right = _mm256_and_si256(_mm256_cmpgt_epi32(x, v), one);
+        __m256i next = _mm256_add_epi32(_mm256_add_epi32(k, k), right);
+        k = _mm256_blendv_epi8(k, next, live);
+    }
+
+    _mm256_storeu_si256((__m256i*)slots, k);
+    for (j = 0; j < FROZEN_BATCH; j++) {
+        unsigned int slot = slots[j] >> __builtin_ffs(~slots[j]);
+        found[j] = (0 != slot && eytz[slot] == keys[j]);
+    }
+}
+#endif
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Build a frozen tree's Eytzinger array from sorted keys
+ *
+ * @param bintreep (i/o) frozen tree to fill
+ * @param sorted   (i) keys in ascending order
+ * @param n        (i) number of keys
+ * @return void
+ */
+void
+_bintree_frozen_build(bintree_t *bintreep, const int *sorted, int n)
+{
+    size_t size = (n + 1) * sizeof(int);
+    int i = 0;
+
+    size = (size + FROZEN_ALIGN - 1) & ~(size_t)(FROZEN_ALIGN - 1);
+    bintreep->eytz = (int*)aligned_alloc(FROZEN_ALIGN, size);
+    assert(NULL != bintreep->eytz);
+
+    bintreep->eytz[0] = 0;
+    _frozen_fill(sorted, &i, bintreep->eytz, 1, n);
+    bintreep->nkeys = n;
+}
+
+/**
+ * Search a frozen tree for a datum
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @param data (i) data to search for
+ * @return 1 if found, 0 if not found
+ */
+int
+_bintree_frozen_search(const int *eytz, int n, int data)
+{
+    int slot = _frozen_lower(eytz, n, data);
+    return (0 != slot && eytz[slot] == data);
+}
+
+/**
+ * Smallest key of a non-empty frozen tree: the leftmost slot
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @return minimum value
+ */
+int
+_bintree_frozen_minvalue(const int *eytz, int n)
+{
+    int k = 1;
+
+    while (2 * k <= n) {
+        k = 2 * k;
+    }
+    return eytz[k];
+}
+
+/**
+ * Largest key of a non-empty frozen tree: the rightmost slot
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @return maximum value
+ */
+int
+_bintree_frozen_maxvalue(const int *eytz, int n)
+{
+    int k = 1;
+
+    while (2 * k + 1 <= n) {
+        k = 2 * k + 1;
+    }
+    return eytz[k];
+}
+
+/**
+ * Depth of the implicit tree, floor(log2(n)) + 1
+ *
+ * @param n (i) number of keys
+ * @return max depth
+ */
+int
+_bintree_frozen_maxdepth(int n)
+{
+    int depth = 0;
+
+    while (n > 0) {
+        depth++;
+        n >>= 1;
+    }
+    return depth;
+}
+
+/**
+ * k-th smallest key (0-based) of a frozen tree
+ *
+ * Algorithm: order-statistic descent as for pointer trees, with left
+ *            subtree sizes computed from the shape of the implicit tree,
+ *            so O(log^2 n) without storing any sizes
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @param k    (i) rank wanted, 0 <= k < n
+ * @return k-th smallest key
+ */
+int
+_bintree_frozen_select(const int *eytz, int n, int k)
+{
+    unsigned int slot = 1;
+
+    while (slot <= (unsigned int)n) {
+        int left = _frozen_size(2 * slot, n);
+        if (k < left) {
+            slot = 2 * slot;
+        } else if (k == left) {
+            break;
+        } else {
+            k -= left + 1;
+            slot = 2 * slot + 1;
+        }
+    }
+    return eytz[slot];
+}
+
+/**
+ * Number of keys smaller than data in a frozen tree, see _frozen_size
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @param data (i) data to rank
+ * @return number of keys < data
+ */
+int
+_bintree_frozen_rank(const int *eytz, int n, int data)
+{
+    unsigned int slot = 1;
+    int rank = 0;
+
+    while (slot <= (unsigned int)n) {
+        if (eytz[slot] < data) {
+            rank += _frozen_size(2 * slot, n) + 1;
+            slot = 2 * slot + 1;
+        } else {
+            slot = 2 * slot;
+        }
+    }
+    return rank;
+}
+
+/**
+ * Path-sum check on a frozen tree
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @param sum  (i) sum to search for
+ * @return 1 if sum exists in a path, 0 else
+ */
+int
+_bintree_frozen_hasPathSum(const int *eytz, int n, int sum)
+{
+    return _frozen_hasPathSum(eytz, n, 1, sum);
+}
+
+/**
+ * Logging traversal of a frozen tree
+ *
+ * @param eytz  (i) 1-based array
+ * @param n     (i) number of keys
+ * @param order (i) "Preorder", "Inorder" or "Postorder"
+ * @return void
+ */
+void
+_bintree_frozen_traverse(const int *eytz, int n, const char *order)
+{
+    _frozen_traverse(eytz, n, 1, order);
+}
+
+/**
+ * Call fn on the keys of a frozen tree in the given order; recursion
+ * depth is log2(n)
+ *
+ * @param eytz  (i) 1-based array
+ * @param n     (i) number of keys
+ * @param order (i) traversal order
+ * @param fn    (i) callback, non-zero return stops the walk
+ * @param ctx   (i) passed to fn
+ * @return number of keys passed to fn
+ */
+int
+_bintree_frozen_walk(const int *eytz, int n, bintree_order_e order,
+                     int (*fn)(int data, void *ctx), void *ctx)
+{
+    int visited = 0;
+
+    _frozen_walk(eytz, n, 1, order, fn, ctx, &visited);
+    return visited;
+}
+
+/**
+ * Copy a frozen tree's keys out in ascending order
+ *
+ * Algorithm: iterative in-order walk of the implicit tree; the next slot
+ *            after k is the leftmost slot of 2k+1, or else k with its
+ *            trailing right-turns shifted off and one more step up
+ *
+ * @param eytz (i) 1-based array
+ * @param n    (i) number of keys
+ * @param out  (o) n keys
+ * @return number of keys written
+ */
+int
+_bintree_frozen_collect(const int *eytz, int n, int *out)
+{
+    unsigned int k = 1;
+    int i = 0;
+
+    if (0 == n) {
+        return 0;
+    }
+    while (2 * k <= (unsigned int)n) {
+        k = 2 * k;
+    }
+    for (i = 0; i < n; i++) {
+        out[i] = eytz[k];
+        if (2 * k + 1 <= (unsigned int)n) {
+            k = 2 * k + 1;
+            while (2 * k <= (unsigned int)n) {
+                k = 2 * k;
+            }
+        } else {
+            k >>= __builtin_ffs(~k);
+        }
+    }
+    return n;
+}
+
+/**
+ * Look up many keys in a frozen tree
+ *
+ * Uses AVX2 gathers when the CPU has them, otherwise a scalar loop that
+ * still advances FROZEN_BATCH lookups in lockstep
+ *
+ * @param eytz  (i) 1-based array
+ * @param n     (i) number of keys in tree
+ * @param keys  (i) keys to look up
+ * @param cnt   (i) number of keys to look up
+ * @param found (o) found[i] = 1 if keys[i] present
+ * @return void
+ */
+void
+_bintree_frozen_search_many(const int *eytz, int n, const int *keys,
+                            int cnt, uint8_t *found)
+{
+    int i = 0;
+
+    if (0 == n) {
+        memset(found, 0, cnt);
+        return;
+    }
+
+#if defined(__x86_64__)
+    /* a load of the flags libgcc's constructor filled in, no caching
+       needed and none racing between threads sharing the tree */
+    if (__builtin_cpu_supports("avx2")) {
+        int levels = _bintree_frozen_maxdepth(n);
+        for (; i + FROZEN_BATCH <= cnt; i += FROZEN_BATCH) {
+            _frozen_search_group_avx2(eytz, n, levels, keys + i, found + i);
+        }
+    }
+#endif
+
+    for (; i < cnt; i += FROZEN_BATCH) {
+        int left = cnt - i;
+        _frozen_search_group(eytz, n, keys + i, found + i,
+                left < FROZEN_BATCH ? left : FROZEN_BATCH);
+    }
+}
+
+/**
+ * Height of the implicit subtree rooted at slot k
+ *
+ * Slots fill level by level, so the leftmost path is the longest
+ *
+ * @param n (i) number of keys
+ * @param k (i) 1-based slot
+ * @return height, 0 past the end
+ */
+static inline int
+_frozen_height(int n, unsigned int k)
+{
+    return (k > (unsigned int)n) ? 0 : 32 - __builtin_clz(n / k);
+}
+
+/**
+ * Add a frozen tree's shape and array memory to a stats record
+ *
+ * avg_path is left as the sum of depths for the caller to divide
+ *
+ * @param n   (i) number of keys
+ * @param out (i/o) stats being gathered
+ * @return void
+ */
+void
+_bintree_frozen_stats(int n, bintree_stats_t *out)
+{
+    size_t size = (n + 1) * sizeof(int);
+    unsigned int k = 0;
+
+    for (k = 1; k <= (unsigned int)n; k++) {
+        int depth = 32 - __builtin_clz(k);
+        int bf = _frozen_height(n, 2 * k) - _frozen_height(n, 2 * k + 1);
+
+        out->depth_hist[(depth < BINTREE_STATS_DEPTHS ? depth : BINTREE_STATS_DEPTHS) - 1]++;
+        out->balance_hist[bf + 2]++;
+        out->avg_path += depth;
+    }
+    out->keys += n;
+    out->nodes += n;
+    out->height = _bintree_frozen_maxdepth(n);
+    out->memory += (size + FROZEN_ALIGN - 1) & ~(size_t)(FROZEN_ALIGN - 1);
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Saved images for bintree
+ *
+ * bintree_save() writes the frozen layout of a tree, whatever its mode:
+ * a fixed header and the Eytzinger array, with no pointers in it.
+ * bintree_load_mmap() maps such a file read-only and hands back a frozen
+ * tree whose array is the mapping itself, so loading costs one mmap and
+ * the pages a lookup touches are faulted in on demand.
+ *
+ * The image is native-endian and int-sized; a file from a machine that
+ * differs in either is rejected rather than misread.
+ */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Write all of buf to f
+ *
+ * @param f   (i) open file
+ * @param buf (i) data
+ * @param len (i) bytes
+ * @return 1 on success, 0 on error
+ */
+static int
+_image_write(FILE *f, const void *buf, size_t len)
+{
+    return (len == fwrite(buf, 1, len, f));
+}
+
+/**
+ * Check a mapped image's header against the file size
+ *
+ * @param hdr  (i) header at the start of the mapping
+ * @param len  (i) file size
+ * @param path (i) file name, for the log
+ * @return 1 if the image is usable, 0 else
+ */
+static int
+_image_check(const bintree_image_hdr_t *hdr, size_t len, const char *path)
+{
+    if (0 != memcmp(hdr->magic, BINTREE_IMAGE_MAGIC, sizeof(hdr->magic))) {
+        logger(dbgErr, "'%s' is not a bintree image", path);
+        return 0;
+    }
+    if (BINTREE_IMAGE_VERSION != hdr->version) {
+        logger(dbgErr, "'%s' has image version %u, expected %u", path,
+                hdr->version, BINTREE_IMAGE_VERSION);
+        return 0;
+    }
+    if (BINTREE_IMAGE_BOM != hdr->bom || sizeof(int) != hdr->key_size) {
+        logger(dbgErr, "'%s' was written on an incompatible machine", path);
+        return 0;
+    }
+    if (NULL == memchr(hdr->name, '\0', sizeof(hdr->name))) {
+        logger(dbgErr, "'%s' has a corrupt header", path);
+        return 0;
+    }
+    if (len != sizeof(*hdr) + ((size_t)hdr->nkeys + 1) * sizeof(int)) {
+        logger(dbgErr, "'%s' is %zu bytes, header says %u keys", path, len,
+                hdr->nkeys);
+        return 0;
+    }
+    return 1;
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Release the mapping behind a tree loaded by bintree_load_mmap()
+ *
+ * @param bintreep (i/o) loaded tree
+ * @return void
+ */
+void
+_bintree_image_unmap(bintree_t *bintreep)
+{
+    munmap(bintreep->image, bintreep->image_len);
+    bintreep->image = NULL;
+    bintreep->image_len = 0;
+    bintreep->eytz = NULL;
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Save a binary tree's keys to a file bintree_load_mmap() can map
+ *
+ * Frozen trees are written as they are, other modes are frozen into a
+ * temporary copy first (O(n) extra memory).
+ *
+ * The image is written to a new temp file next to path, made with
+ * mkstemp() so concurrent saves never share one, synced, and renamed
+ * over path, so an existing image is replaced whole or not at all.
+ * Trees still mapped from the old file keep reading it, where
+ * truncating it in place would have killed their next search with
+ * SIGBUS.  Like any mkstemp() file the image is created mode 0600.
+ *
+ * @param bintreep (i) binary tree, any mode
+ * @param path     (i) file to create or replace
+ * @return 1 on success, 0 on error
+ */
+int
+bintree_save(BintreePtr bintreep, const char *path)
+{
+    BintreePtr frozenp = NULL;
+    bintree_image_hdr_t hdr;
+    char tmp[PATH_MAX];
+    FILE *f = NULL;
+    int fd = -1;
+    int ok = 0;
+
+    assert(NULL != bintreep);
+    assert(NULL != path);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    frozenp = (bintreeFrozen == bintreep->mode) ? bintreep : bintree_freeze(bintreep);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, BINTREE_IMAGE_MAGIC, sizeof(hdr.magic));
+    hdr.version = BINTREE_IMAGE_VERSION;
+    hdr.bom = BINTREE_IMAGE_BOM;
+    hdr.key_size = sizeof(int);
+    hdr.nkeys = frozenp->nkeys;
+    snprintf(hdr.name, sizeof(hdr.name), "%s", bintreep->name);
+
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp)) {
+        logger(dbgErr, "Path '%s' is too long", path);
+        goto done;
+    }
+    fd = mkstemp(tmp);
+    if (fd < 0) {
+        logger(dbgErr, "Cannot create a temp file for '%s'", path);
+        goto done;
+    }
+    f = fdopen(fd, "wb");
+    if (NULL == f) {
+        logger(dbgErr, "Cannot open '%s'", tmp);
+        close(fd);
+        unlink(tmp);
+        goto done;
+    }
+    ok = _image_write(f, &hdr, sizeof(hdr)) &&
+         _image_write(f, frozenp->eytz, (frozenp->nkeys + 1) * sizeof(int)) &&
+         0 == fflush(f) && 0 == fsync(fileno(f));
+    if (0 != fclose(f)) {
+        ok = 0;
+    }
+    if (ok && 0 != rename(tmp, path)) {
+        ok = 0;
+    }
+    if (!ok) {
+        logger(dbgErr, "Write to '%s' failed", path);
+        unlink(tmp);
+    }
+done:
+    if (frozenp != bintreep) {
+        bintree_destroy(frozenp);
+    }
+out:
+    return ok;
+}
+
+/**
+ * Load a file written by bintree_save() as a read-only frozen tree
+ *
+ * The keys are not copied: searches read the file mapping directly.
+ * The tree must be destroyed with bintree_destroy(), which unmaps it.
+ *
+ * @param path (i) image file
+ * @return BintreePtr, or NULL if the file is missing or not a valid image
+ */
+BintreePtr
+bintree_load_mmap(const char *path)
+{
+    BintreePtr bintreep = NULL;
+    const bintree_image_hdr_t *hdr = NULL;
+    struct stat st;
+    void *image = MAP_FAILED;
+    int fd = -1;
+
+    assert(NULL != path);
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        logger(dbgErr, "Cannot open '%s'", path);
+        return NULL;
+    }
+    if (0 != fstat(fd, &st) || (size_t)st.st_size < sizeof(*hdr)) {
+        logger(dbgErr, "'%s' is too short for a bintree image", path);
+        close(fd);
+        return NULL;
+    }
+    image = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == image) {
+        logger(dbgErr, "Cannot map '%s'", path);
+        return NULL;
+    }
+
+    hdr = (const bintree_image_hdr_t*)image;
+    if (!_image_check(hdr, st.st_size, path)) {
+        munmap(image, st.st_size);
+        return NULL;
+    }
+
+    bintreep = bintree_create_mode(hdr->name, bintreeFrozen);
+    bintreep->image = image;
+    bintreep->image_len = st.st_size;
+    bintreep->eytz = (int*)(hdr + 1);
+    bintreep->nkeys = hdr->nkeys;
+    return bintreep;
+}
@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Ordered iteration for bintree
+ *
+ * An iterator is positioned at the first key >= 'from' by one root-to-leaf
+ * descent that remembers, on a stack, every node whose key is still to
+ * come.  Each next() pops one key and pushes the left spine of what
+ * follows it, so visiting k keys costs O(log n + k) on a balanced tree.
+ *
+ * Plain/AVL trees keep node pointers on the stack, which lives inside the
+ * iterator and only moves to the heap for trees deeper than
+ * BINTREE_ITER_INLINE.  B-tree mode keeps (node, next key index) pairs,
+ * and frozen mode needs nothing but the current slot.
+ *
+ * Modifying a tree invalidates its iterators, except in bintreeConcurrent
+ * mode, where an iterator keeps walking the version it started on and
+ * must be destroyed by the thread that created it.
+ */
+
+#define ITER_MAGIC_IN_USE_CHECK(_mag_) \
+    if (BINTREE_ITER_MAGIC_IN_USE != _mag_) { \
+        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
+                BINTREE_ITER_MAGIC_IN_USE, _mag_); \
+        goto out; \
+    } \
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Push a node on a pointer-tree iterator's stack, moving the stack to the
+ * heap if it outgrows the inline one
+ *
+ * @param iterp (i/o) iterator
+ * @param node  (i) node to push
+ * @return void
+ */
+static void
+_iter_push(bintree_iter_t *iterp, bintreenode_t *node)
+{
+    if (iterp->top == iterp->cap) {
+        int cap = 2 * iterp->cap;
+        bintreenode_t **stack = (bintreenode_t**)malloc(cap * sizeof(*stack));
+        assert(NULL != stack);
+        memcpy(stack, iterp->stack, iterp->top * sizeof(*stack));
+        if (iterp->stack != iterp->inline_stack) {
+            free(iterp->stack);
+        }
+        iterp->stack = stack;
+        iterp->cap = cap;
+    }
+    iterp->stack[iterp->top++] = node;
+}
+
+/**
+ * Push a B-tree node and the left spine below it
+ *
+ * @param iterp (i/o) iterator
+ * @param node  (i) subtree root
+ * @return void
+ */
+static void
+_iter_push_btree_spine(bintree_iter_t *iterp, const btreenode_t *node)
+{
+    while (NULL != node) {
+        assert(iterp->top < BTREE_ITER_MAX_DEPTH);
+        iterp->bnode[iterp->top] = node;
+        iterp->bidx[iterp->top] = 0;
+        iterp->top++;
+        node = node->leaf ? NULL : node->child[0];
+    }
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Position an iterator at the first key >= from
+ *
+ * @param iterp    (o) iterator to initialise
+ * @param bintreep (i) tree to iterate
+ * @param from     (i) lower bound of keys to visit
+ * @return void
+ */
+void
+_bintree_iter_init(bintree_iter_t *iterp, bintree_t *bintreep, int from)
+{
+    iterp->magic = BINTREE_ITER_MAGIC_IN_USE;
+    iterp->tree = bintreep;
+    iterp->top = 0;
+    iterp->cap = BINTREE_ITER_INLINE;
+    iterp->stack = iterp->inline_stack;
+    iterp->slot = 0;
+    iterp->repeat = 0;
+
+    switch (bintreep->mode) {
+    case bintreeBtree: {
+        const btreenode_t *node = bintreep->broot;
+        while (NULL != node) {
+            int i = 0;
+            /* first key >= from, the child before it may hold more */
+            while (i < node->nkeys && node->keys[i] < from) {
+                i++;
+            }
+            assert(iterp->top < BTREE_ITER_MAX_DEPTH);
+            iterp->bnode[iterp->top] = node;
+            iterp->bidx[iterp->top] = i;
+            iterp->top++;
+            node = node->leaf ? NULL : node->child[i];
+        }
+        break;
+    }
+    case bintreeFrozen: {
+        const int *eytz = bintreep->eytz;
+        unsigned int n = bintreep->nkeys;
+        unsigned int k = 1;
+        while (k <= n) {
+            k = 2 * k + (eytz[k] < from);
+        }
+        iterp->slot = k >> __builtin_ffs(~k);
+        break;
+    }
+    default: {
+        bintreenode_t *node = _bintree_read_enter(bintreep);
+        while (NULL != node) {
+            if (node->data >= from) {
+                _iter_push(iterp, node);
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * Produce the next key from an iterator
+ *
+ * @param iterp (i/o) iterator
+ * @param data  (o) next key
+ * @return 1 if a key was produced, 0 when exhausted
+ */
+int
+_bintree_iter_next(bintree_iter_t *iterp, int *data)
+{
+    bintree_t *bintreep = iterp->tree;
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        while (iterp->top > 0) {
+            const btreenode_t *node = iterp->bnode[iterp->top - 1];
+            int i = iterp->bidx[iterp->top - 1];
+            if (i < node->nkeys) {
+                *data = node->keys[i];
+                iterp->bidx[iterp->top - 1] = i + 1;
+                if (!node->leaf) {
+                    _iter_push_btree_spine(iterp, node->child[i + 1]);
+                }
+                return 1;
+            }
+            iterp->top--;
+        }
+        return 0;
+
+    case bintreeFrozen: {
+        const int *eytz = bintreep->eytz;
+        unsigned int n = bintreep->nkeys;
+        unsigned int k = iterp->slot;
+        if (0 == k) {
+            return 0;
+        }
+        *data = eytz[k];
+        /* in-order successor in the implicit tree */
+        if (2 * k + 1 <= n) {
+            k = 2 * k + 1;
+            while (2 * k <= n) {
+                k = 2 * k;
+            }
+        } else {
+            k >>= __builtin_ffs(~k);
+        }
+        iterp->slot = k;
+        return 1;
+    }
+
+    default: {
+        if (0 == iterp->top) {
+            return 0;
+        }
+        bintreenode_t *node = iterp->stack[iterp->top - 1];
+        *data = node->data;
+        /* multiset nodes stay on top until every copy is produced */
+        if (++iterp->repeat < node->count) {
+            return 1;
+        }
+        iterp->repeat = 0;
+        iterp->top--;
+        for (node = node->right; NULL != node; node = node->left) {
+            _iter_push(iterp, node);
+        }
+        return 1;
+    }
+    }
+}
+
+/**
+ * Release anything an iterator moved to the heap
+ *
+ * @param iterp (i/o) iterator
+ * @return void
+ */
+void
+_bintree_iter_release(bintree_iter_t *iterp)
+{
+    if (iterp->stack != iterp->inline_stack) {
+        free(iterp->stack);
+    }
+    _bintree_read_exit(iterp->tree);
+    iterp->stack = iterp->inline_stack;
+    iterp->magic = BINTREE_ITER_MAGIC_FREED;
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Find the smallest key >= data
+ *
+ * @param bintreep (i) binary tree to search
+ * @param data     (i) lower bound
+ * @param result   (o) smallest key >= data, untouched if none
+ * @return 1 if such a key exists, 0 else
+ */
+int
+bintree_lower_bound(BintreePtr bintreep, int data, int *result)
+{
+    bintree_iter_t iter;
+    int found = 0;
+
+    assert(NULL != bintreep);
+    assert(NULL != result);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    _bintree_iter_init(&iter, bintreep, data);
+    found = _bintree_iter_next(&iter, result);
+    _bintree_iter_release(&iter);
+out:
+    return found;
+}
+
+/**
+ * Call fn for every key in [lo, hi], in ascending order
+ *
+ * Only the O(log n + k) nodes on the way to and inside the range are
+ * visited.  fn returns 0 to keep going, anything else to stop after
+ * the current key.
+ *
+ * @param bintreep (i) binary tree to scan
+ * @param lo       (i) smallest key to visit
+ * @param hi       (i) largest key to visit
+ * @param fn       (i) callback, gets the key and ctx
+ * @param ctx      (i) opaque user context passed to fn
+ * @return number of keys passed to fn
+ */
+int
+bintree_range_foreach(BintreePtr bintreep, int lo, int hi,
+                      int (*fn)(int data, void *ctx), void *ctx)
+{
+    bintree_iter_t iter;
+    int visited = 0;
+    int data = 0;
+
+    assert(NULL != bintreep);
+    assert(NULL != fn);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    _bintree_iter_init(&iter, bintreep, lo);
+    while (_bintree_iter_next(&iter, &data) && data <= hi) {
+        visited++;
+        if (0 != fn(data, ctx)) {
+            break;
+        }
+    }
+    _bintree_iter_release(&iter);
+out:
+    return visited;
+}
+
+/**
+ * Create an in-order iterator starting at the first key >= from
+ *
+ * Use INT_MIN to walk the whole tree.  The tree must not be modified
+ * while the iterator is in use.
+ *
+ * Note - allocs mem for the iterator, caller must call bintree_iter_destroy()
+ *
+ * @param bintreep (i) binary tree to iterate
+ * @param from     (i) lower bound of keys to visit
+ * @return BintreeIterPtr
+ */
+BintreeIterPtr
+bintree_iter_create(BintreePtr bintreep, int from)
+{
+    BintreeIterPtr iterp = NULL;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    iterp = (bintree_iter_t*)malloc(sizeof(*iterp));
+    assert(NULL != iterp);
+    _bintree_iter_init(iterp, bintreep, from);
+out:
+    return iterp;
+}
+
+/**
+ * Advance an iterator
+ *
+ * @param iterp (i) iterator
+ * @param data  (o) next key in ascending order
+ * @return 1 if a key was produced, 0 when exhausted
+ */
+int
+bintree_iter_next(BintreeIterPtr iterp, int *data)
+{
+    int more = 0;
+
+    assert(NULL != iterp);
+    assert(NULL != data);
+    ITER_MAGIC_IN_USE_CHECK(iterp->magic);
+
+    more = _bintree_iter_next(iterp, data);
+out:
+    return more;
+}
+
+/**
+ * Destroy an iterator
+ *
+ * @param iterp (i) iterator to destroy
+ * @return void
+ */
+void
+bintree_iter_destroy(BintreeIterPtr iterp)
+{
+    assert(NULL != iterp);
+    ITER_MAGIC_IN_USE_CHECK(iterp->magic);
+
+    _bintree_iter_release(iterp);
+    free(iterp);
+out:
+    return;
+}
@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "bintree_map_ext.h"
+#include "bintree_int.h"
+#include "bintree_avl_gen.h"
+#include "logger.h"
+
+/*
+ * Ordered key/value map
+ *
+ * An AVL tree like bintreeAvl mode, but keyed through the caller's
+ * comparator and carrying a value per node, so one descent both finds a
+ * key and reaches its value.  Keys are unique: putting an existing key
+ * replaces its value.  Every comparison is an indirect call; see
+ * bintree_map_gen.h for the inlined, type-specialized version.
+ */
+
+#define MAP_MAGIC_IN_USE_CHECK(_mag_) \
+    if (BINTREE_MAP_MAGIC_IN_USE != _mag_) { \
+        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
+                BINTREE_MAP_MAGIC_IN_USE, _mag_); \
+        goto out; \
+    } \
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/* _map_height, _map_fix, _map_rotate_left/right, _map_rebalance */
+BINTREE_AVL_DEFINE(_map, bintree_mapnode_t, BINTREE_AVL_NOP, BINTREE_AVL_NOP,
+                   BINTREE_AVL_NOP)
+
+/**
+ * Insert key or update its value in a subtree
+ *
+ * @param mapp  (i) owning map, for the comparator
+ * @param node  (i) subtree root
+ * @param key   (i) key
+ * @param value (i) value
+ * @param added (o) set to 1 if a node was added
+ * @return new subtree root
+ */
+static bintree_mapnode_t*
+_map_put(bintree_map_t *mapp, bintree_mapnode_t *node, const void *key,
+         void *value, int *added)
+{
+    int c = 0;
+
+    if (NULL == node) {
+        node = (bintree_mapnode_t*)malloc(sizeof(*node));
+        assert(NULL != node);
+        node->key = key;
+        node->value = value;
+        node->height = 1;
+        node->left = node->right = NULL;
+        *added = 1;
+        return node;
+    }
+
+    c = mapp->cmp(key, node->key);
+    if (0 == c) {
+        node->value = value;
+        return node;
+    }
+    if (c < 0) {
+        node->left = _map_put(mapp, node->left, key, value, added);
+    } else {
+        node->right = _map_put(mapp, node->right, key, value, added);
+    }
+    return _map_rebalance(node);
+}
+
+/**
+ * Unlink the minimum node of a subtree, rebalancing on the way up
+ *
+ * @param node (i) subtree root
+ * @param min  (o) the unlinked node
+ * @return new subtree root
+ */
+static bintree_mapnode_t*
+_map_unlink_min(bintree_mapnode_t *node, bintree_mapnode_t **min)
+{
+    if (NULL == node->left) {
+        *min = node;
+        return node->right;
+    }
+    node->left = _map_unlink_min(node->left, min);
+    return _map_rebalance(node);
+}
+
+/**
+ * Remove key from a subtree
+ *
+ * @param mapp   (i) owning map, for the comparator
+ * @param node   (i) subtree root
+ * @param key    (i) key
+ * @param erased (o) set to 1 if a node was removed
+ * @return new subtree root
+ */
+static bintree_mapnode_t*
+_map_erase(bintree_map_t *mapp, bintree_mapnode_t *node, const void *key,
+           int *erased)
+{
+    int c = 0;
+
+    if (NULL == node) {
+        return NULL;
+    }
+
+    c = mapp->cmp(key, node->key);
+    if (c < 0) {
+        node->left = _map_erase(mapp, node->left, key, erased);
+    } else if (c > 0) {
+        node->right = _map_erase(mapp, node->right, key, erased);
+    } else {
+        bintree_mapnode_t *left = node->left;
+        bintree_mapnode_t *right = node->right;
+        bintree_mapnode_t *succ = NULL;
+
+        free(node);
+        *erased = 1;
+        if (NULL == left) {
+            return right;
+        }
+        if (NULL == right) {
+            return left;
+        }
+        right = _map_unlink_min(right, &succ);
+        succ->left = left;
+        succ->right = right;
+        node = succ;
+    }
+    return _map_rebalance(node);
+}
+
+/**
+ * Free every node of a subtree
+ *
+ * @param node (i) subtree root
+ * @return void
+ */
+static void
+_map_destroy(bintree_mapnode_t *node)
+{
+    if (NULL == node) {
+        return;
+    }
+    _map_destroy(node->left);
+    _map_destroy(node->right);
+    free(node);
+}
+
+/**
+ * In-order walk of a subtree
+ *
+ * @param node (i) subtree root
+ * @param fn   (i) callback, non-zero return stops the walk
+ * @param ctx  (i) passed to fn
+ * @return non-zero if fn stopped the walk
+ */
+static int
+_map_foreach(bintree_mapnode_t *node,
+             int (*fn)(const void *key, void *value, void *ctx), void *ctx)
+{
+    if (NULL == node) {
+        return 0;
+    }
+    return _map_foreach(node->left, fn, ctx) ||
+           fn(node->key, node->value, ctx) ||
+           _map_foreach(node->right, fn, ctx);
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Create a new ordered map
+ *
+ * Note - allocs mem for a new map, caller must call bintree_map_destroy()
+ *
+ * @param name (i) name for the map
+ * @param cmp  (i) key comparator
+ * @return BintreeMapPtr
+ */
+BintreeMapPtr
+bintree_map_create(const char *name, bintree_map_cmp_fn cmp)
+{
+    assert(NULL != name);
+    assert(NULL != cmp);
+
+    BintreeMapPtr mapp = (bintree_map_t*)malloc(sizeof(*mapp));
+    assert(NULL != mapp);
+
+    mapp->magic = BINTREE_MAP_MAGIC_IN_USE;
+    strncpy(mapp->name, name, BINTREE_MAX_NAME_LEN - 1);
+    mapp->name[BINTREE_MAX_NAME_LEN - 1] = '\0';
+    mapp->cmp = cmp;
+    mapp->root = NULL;
+    mapp->count = 0;
+
+    return mapp;
+}
+
+/**
+ * Destroy a map; keys and values are the caller's to free
+ *
+ * @param mapp (i) map to destroy
+ * @return void
+ */
+void
+bintree_map_destroy(BintreeMapPtr mapp)
+{
+    assert(NULL != mapp);
+    MAP_MAGIC_IN_USE_CHECK(mapp->magic);
+
+    _map_destroy(mapp->root);
+    mapp->magic = BINTREE_MAP_MAGIC_FREED;
+    free(mapp);
+out:
+    return;
+}
+
+/**
+ * Insert a key, or replace the value of a key already in the map
+ *
+ * An existing key keeps its original key pointer.
+ *
+ * @param mapp  (i) map
+ * @param key   (i) key
+ * @param value (i) value
+ * @return 1 if the key was added, 0 if its value was replaced
+ */
+int
+bintree_map_put(BintreeMapPtr mapp, const void *key, void *value)
+{
+    int added = 0;
+
+    assert(NULL != mapp);
+    MAP_MAGIC_IN_USE_CHECK(mapp->magic);
+
+    mapp->root = _map_put(mapp, mapp->root, key, value, &added);
+    mapp->count += added;
+out:
+    return added;
+}
+
+/**
+ * Find a key
+ *
+ * @param mapp (i) map
+ * @param key  (i) key
+ * @return pointer to the key's value slot, valid until the key is
+ *         erased, or NULL if the key is not in the map
+ */
+void**
+bintree_map_find(BintreeMapPtr mapp, const void *key)
+{
+    bintree_mapnode_t *node = NULL;
+
+    assert(NULL != mapp);
+    MAP_MAGIC_IN_USE_CHECK(mapp->magic);
+
+    node = mapp->root;
+    while (NULL != node) {
+        int c = mapp->cmp(key, node->key);
+        if (0 == c) {
+            return &node->value;
+        }
+        node = (c < 0) ? node->left : node->right;
+    }
+out:
+    return NULL;
+}
+
+/**
+ * Remove a key and its value
+ *
+ * @param mapp (i) map
+ * @param key  (i) key
+ * @return 1 if the key was removed, 0 if it was not in the map
+ */
+int
+bintree_map_erase(BintreeMapPtr mapp, const void *key)
+{
+    int erased = 0;
+
+    assert(NULL != mapp);
+    MAP_MAGIC_IN_USE_CHECK(mapp->magic);
+
+    mapp->root = _map_erase(mapp, mapp->root, key, &erased);
+    mapp->count -= erased;
+out:
+    return erased;
+}
+
+/**
+ * Number of keys in a map, O(1)
+ *
+ * @param mapp (i) map
+ * @return key count
+ */
+int
+bintree_map_count(BintreeMapPtr mapp)
+{
+    assert(NULL != mapp);
+    MAP_MAGIC_IN_USE_CHECK(mapp->magic);
+
+    return mapp->count;
+out:
+    return 0;
+}
+
+/**
+ * Call fn on every key/value pair in ascending key order
+ *
+ * @param mapp (i) map
+ * @param fn   (i) callback, non-zero return stops the walk
+ * @param ctx  (i) passed to fn
+ * @return 1 if fn stopped the walk early, else 0
+ */
+int
+bintree_map_foreach(BintreeMapPtr mapp,
+                    int (*fn)(const void *key, void *value, void *ctx),
+                    void *ctx)
+{
+    assert(NULL != mapp);
+    assert(NULL != fn);
+    MAP_MAGIC_IN_USE_CHECK(mapp->magic);
+
+    return _map_foreach(mapp->root, fn, ctx) ? 1 : 0;
+out:
+    return 0;
+}
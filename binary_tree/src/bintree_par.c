@@ -0,0 +1,515 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#include <pthread.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Parallel aggregate queries for bintree
+ *
+ * A pointer tree is cut into tasks by one descent from the root that
+ * stops at every subtree of at most BINTREE_PAR_GRAIN nodes (subtree
+ * sizes make that check O(1)).  Those subtrees become tasks; the few
+ * nodes above them, the spine, are handled by the calling thread.  Each
+ * task records its depth and the path sum left at its root, so the
+ * per-task answers combine without looking at the spine again.
+ *
+ * Tasks run on a process-wide pool of worker threads, started on first
+ * use and grown up to BINTREE_POOL_MAX; the calling thread works too.
+ * Workers claim tasks with one atomic increment, so uneven subtrees
+ * balance out as long as there are several tasks per thread.  One job
+ * runs at a time; a job started from inside a task (a map or combine
+ * callback calling a *_parallel API) runs serially on the thread that
+ * started it, as the pool is busy with the outer job.
+ *
+ * Frozen trees split their array into slices instead.  B-tree trees and
+ * trees smaller than one grain run on the calling thread.
+ */
+
+#define BINTREE_PAR_GRAIN 8192
+#define BINTREE_POOL_MAX  64
+
+typedef struct par_job_s {
+    void (*fn)(void *arg, int task);
+    void *arg;
+    int ntasks;
+    int next;                   /* next unclaimed task */
+} par_job_t;
+
+/* One spine node or task subtree, in key order */
+typedef struct par_item_s {
+    bintreenode_t *node;        /* NULL for an empty task */
+    int spine;                  /* 1 = this node alone, 0 = whole subtree */
+    int depth;                  /* nodes above node */
+    int rem;                    /* path sum left at node */
+    long result;
+} par_item_t;
+
+typedef struct par_ctx_s {
+    par_item_t *items;
+    int nitems;
+    int found;                  /* hasPathSum: stop everyone once set */
+    long (*map)(int data, void *ctx);
+    long (*combine)(long a, long b);
+    long identity;
+    void *ctx;
+    const int *eytz;            /* frozen slices */
+    int nkeys;
+} par_ctx_t;
+
+static pthread_mutex_t pool_run_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_idle = PTHREAD_COND_INITIALIZER;
+static int pool_threads = 0;
+static unsigned long pool_gen = 0;      /* bumped for every job */
+static int pool_want = 0;               /* workers still to join the job */
+static int pool_busy = 0;               /* workers inside the job */
+static par_job_t *pool_job = NULL;
+static __thread int pool_in_task = 0;   /* this thread is running a task */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Claim and run tasks until the job has none left
+ *
+ * @param job (i/o) job being run
+ * @return void
+ */
+static void
+_pool_work(par_job_t *job)
+{
+    int task = 0;
+    int outer = pool_in_task;
+
+    pool_in_task = 1;
+    while ((task = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->ntasks) {
+        job->fn(job->arg, task);
+    }
+    pool_in_task = outer;
+}
+
+/**
+ * Pool worker: waits for a job, helps with it, repeats
+ *
+ * @param arg (i) unused
+ * @return never
+ */
+static void*
+_pool_worker(void *arg)
+{
+    unsigned long seen = 0;
+    par_job_t *job = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    seen = pool_gen;
+    for (;;) {
+        while (seen == pool_gen) {
+            pthread_cond_wait(&pool_wake, &pool_lock);
+        }
+        seen = pool_gen;
+        if (0 == pool_want) {
+            continue;
+        }
+        pool_want--;
+        pool_busy++;
+        job = pool_job;
+        pthread_mutex_unlock(&pool_lock);
+
+        _pool_work(job);
+
+        pthread_mutex_lock(&pool_lock);
+        if (0 == --pool_busy) {
+            pthread_cond_signal(&pool_idle);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Run fn(arg, 0..ntasks-1) on up to nthreads threads, the caller
+ * included, and return once every task is done
+ *
+ * @param fn       (i) task function
+ * @param arg      (i) passed to fn
+ * @param ntasks   (i) number of tasks
+ * @param nthreads (i) threads to use
+ * @return void
+ */
+static void
+_pool_run(void (*fn)(void *arg, int task), void *arg, int ntasks, int nthreads)
+{
+    par_job_t job = {fn, arg, ntasks, 0};
+    int helpers = nthreads - 1;
+
+    if (helpers > ntasks - 1) {
+        helpers = ntasks - 1;
+    }
+    if (helpers > BINTREE_POOL_MAX) {
+        helpers = BINTREE_POOL_MAX;
+    }
+    if (helpers <= 0 || pool_in_task) {
+        /* nested in a task, pool_run_lock is taken: no deadlock, no pool */
+        _pool_work(&job);
+        return;
+    }
+
+    pthread_mutex_lock(&pool_run_lock);
+    pthread_mutex_lock(&pool_lock);
+    while (pool_threads < helpers) {
+        pthread_t tid;
+        if (0 != pthread_create(&tid, NULL, _pool_worker, NULL)) {
+            logger(dbgWarn, "Thread pool stuck at %i threads", pool_threads);
+            helpers = pool_threads;
+            break;
+        }
+        pthread_detach(tid);
+        pool_threads++;
+    }
+    pool_job = &job;
+    pool_want = helpers;
+    pool_gen++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+
+    _pool_work(&job);
+
+    /* every task is claimed; workers that have not joined yet need not */
+    pthread_mutex_lock(&pool_lock);
+    pool_want = 0;
+    while (pool_busy > 0) {
+        pthread_cond_wait(&pool_idle, &pool_lock);
+    }
+    pool_job = NULL;
+    pthread_mutex_unlock(&pool_lock);
+    pthread_mutex_unlock(&pool_run_lock);
+}
+
+/**
+ * Append an item to the split list
+ *
+ * @param pc  (i/o) context holding the list
+ * @param cap (i/o) list capacity
+ * @return the new item
+ */
+static par_item_t*
+_par_item_add(par_ctx_t *pc, int *cap)
+{
+    if (pc->nitems == *cap) {
+        *cap = *cap ? 2 * *cap : 64;
+        pc->items = (par_item_t*)realloc(pc->items, *cap * sizeof(*pc->items));
+        assert(NULL != pc->items);
+    }
+    return &pc->items[pc->nitems++];
+}
+
+/**
+ * Cut a pointer tree into spine nodes and task subtrees, in key order
+ *
+ * Algorithm: in-order walk with an explicit stack that does not descend
+ *            into subtrees of BINTREE_PAR_GRAIN nodes or fewer; each of
+ *            those, and each NULL child of a spine node, is one task
+ *
+ * @param pc   (i/o) context, items filled in
+ * @param root (i) tree root
+ * @param sum  (i) path sum wanted at the root
+ * @return void
+ */
+static void
+_par_split(par_ctx_t *pc, bintreenode_t *root, int sum)
+{
+    par_item_t *stack = NULL, *item = NULL;
+    int top = 0, scap = 0, cap = 0;
+    bintreenode_t *node = root;
+    int depth = 0, rem = sum;
+
+    for (;;) {
+        while (NULL != node && node->size > BINTREE_PAR_GRAIN) {
+            if (top == scap) {
+                scap = scap ? 2 * scap : 64;
+                stack = (par_item_t*)realloc(stack, scap * sizeof(*stack));
+                assert(NULL != stack);
+            }
+            stack[top].node = node;
+            stack[top].depth = depth;
+            stack[top].rem = rem;
+            top++;
+            rem -= node->data;
+            depth++;
+            node = node->left;
+        }
+        item = _par_item_add(pc, &cap);
+        item->node = node;
+        item->spine = 0;
+        item->depth = depth;
+        item->rem = rem;
+        if (0 == top) {
+            break;
+        }
+        top--;
+        item = _par_item_add(pc, &cap);
+        *item = stack[top];
+        item->spine = 1;
+        node = item->node->right;
+        depth = item->depth + 1;
+        rem = item->rem - item->node->data;
+    }
+    free(stack);
+}
+
+/**
+ * Subtree depth, see _bintree_maxdepth
+ *
+ * @param node (i) subtree root
+ * @return depth, 0 for NULL
+ */
+static int
+_par_maxdepth(bintreenode_t *node)
+{
+    if (NULL == node) {
+        return 0;
+    }
+    int depth_left = _par_maxdepth(node->left) + 1;
+    int depth_right = _par_maxdepth(node->right) + 1;
+    return (depth_left > depth_right ? depth_left : depth_right);
+}
+
+/**
+ * Path-sum check, see _bintree_hasPathSum; gives up once another task
+ * has found a path
+ *
+ * @param pc   (i) context, for the found flag
+ * @param node (i) subtree root
+ * @param sum  (i) remaining sum
+ * @return 1 if sum exists in a path, 0 else
+ */
+static int
+_par_hasPathSum(par_ctx_t *pc, bintreenode_t *node, int sum)
+{
+    if (NULL == node) {
+        return (0 == sum);
+    }
+    if (__atomic_load_n(&pc->found, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    int new_sum = sum - node->data;
+    return (_par_hasPathSum(pc, node->left, new_sum) ||
+            _par_hasPathSum(pc, node->right, new_sum));
+}
+
+/**
+ * Map and combine every key of a subtree, in key order
+ *
+ * @param pc   (i) context with map, combine, identity and ctx
+ * @param node (i) subtree root
+ * @return combined value, identity for NULL
+ */
+static long
+_par_reduce(par_ctx_t *pc, bintreenode_t *node)
+{
+    if (NULL == node) {
+        return pc->identity;
+    }
+    long acc = _par_reduce(pc, node->left);
+    int i = 0;
+
+    for (i = 0; i < node->count; i++) {
+        acc = pc->combine(acc, pc->map(node->data, pc->ctx));
+    }
+    return pc->combine(acc, _par_reduce(pc, node->right));
+}
+
+/* Task functions: one item (or frozen slice) each */
+static void
+_par_task_maxdepth(void *arg, int task)
+{
+    par_ctx_t *pc = (par_ctx_t*)arg;
+    par_item_t *item = &pc->items[task];
+
+    item->result = item->spine ? 0 : item->depth + _par_maxdepth(item->node);
+}
+
+static void
+_par_task_hasPathSum(void *arg, int task)
+{
+    par_ctx_t *pc = (par_ctx_t*)arg;
+    par_item_t *item = &pc->items[task];
+
+    if (!item->spine && _par_hasPathSum(pc, item->node, item->rem)) {
+        __atomic_store_n(&pc->found, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void
+_par_task_reduce(void *arg, int task)
+{
+    par_ctx_t *pc = (par_ctx_t*)arg;
+    par_item_t *item = &pc->items[task];
+
+    if (item->spine) {
+        int i = 0;
+        item->result = pc->identity;
+        for (i = 0; i < item->node->count; i++) {
+            item->result = pc->combine(item->result,
+                                       pc->map(item->node->data, pc->ctx));
+        }
+    } else {
+        item->result = _par_reduce(pc, item->node);
+    }
+}
+
+static void
+_par_task_reduce_frozen(void *arg, int task)
+{
+    par_ctx_t *pc = (par_ctx_t*)arg;
+    int lo = 1 + task * BINTREE_PAR_GRAIN;
+    int hi = lo + BINTREE_PAR_GRAIN - 1;
+    long acc = pc->identity;
+    int k = 0;
+
+    if (hi > pc->nkeys) {
+        hi = pc->nkeys;
+    }
+    for (k = lo; k <= hi; k++) {
+        acc = pc->combine(acc, pc->map(pc->eytz[k], pc->ctx));
+    }
+    pc->items[task].result = acc;
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * bintree_maxdepth() spread over up to nthreads threads
+ *
+ * @param bintreep (i) binary tree
+ * @param nthreads (i) threads to use, the caller included
+ * @return max depth
+ */
+int
+bintree_maxdepth_parallel(BintreePtr bintreep, int nthreads)
+{
+    par_ctx_t pc = {0};
+    int max_depth = 0, i = 0;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    if (bintreeBtree == bintreep->mode || bintreeFrozen == bintreep->mode) {
+        return bintree_maxdepth(bintreep);
+    }
+    _par_split(&pc, _bintree_read_enter(bintreep), 0);
+    _pool_run(_par_task_maxdepth, &pc, pc.nitems, nthreads);
+    _bintree_read_exit(bintreep);
+
+    for (i = 0; i < pc.nitems; i++) {
+        if (pc.items[i].result > max_depth) {
+            max_depth = pc.items[i].result;
+        }
+    }
+    free(pc.items);
+out:
+    return max_depth;
+}
+
+/**
+ * bintree_hasPathSum() spread over up to nthreads threads; every thread
+ * stops as soon as one finds a path
+ *
+ * @param bintreep (i) binary tree
+ * @param sum      (i) sum
+ * @param nthreads (i) threads to use, the caller included
+ * @return 1 if sum exists for a path, 0 else
+ */
+int
+bintree_hasPathSum_parallel(BintreePtr bintreep, int sum, int nthreads)
+{
+    par_ctx_t pc = {0};
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    if (bintreeBtree == bintreep->mode || bintreeFrozen == bintreep->mode) {
+        return bintree_hasPathSum(bintreep, sum);
+    }
+    _par_split(&pc, _bintree_read_enter(bintreep), sum);
+    _pool_run(_par_task_hasPathSum, &pc, pc.nitems, nthreads);
+    _bintree_read_exit(bintreep);
+    free(pc.items);
+    return pc.found;
+out:
+    return 0;
+}
+
+/**
+ * Fold every key of a tree into one value on up to nthreads threads
+ *
+ * The result is combine() over map(key, ctx) for every key, with
+ * identity for an empty tree.  combine must be associative and
+ * commutative, and map must be safe to call from several threads at
+ * once: which thread maps which key, and the grouping of the combines,
+ * are unspecified.  map may itself call the *_parallel APIs; those
+ * nested calls run on the thread making them.
+ *
+ * @param bintreep (i) binary tree, any mode
+ * @param map      (i) per-key value
+ * @param combine  (i) merges two values
+ * @param identity (i) value that combine leaves unchanged
+ * @param ctx      (i) passed to map
+ * @param nthreads (i) threads to use, the caller included
+ * @return combined value
+ */
+long
+bintree_reduce_parallel(BintreePtr bintreep, long (*map)(int data, void *ctx),
+                        long (*combine)(long a, long b), long identity,
+                        void *ctx, int nthreads)
+{
+    par_ctx_t pc = {0};
+    long acc = identity;
+    int i = 0, data = 0;
+
+    assert(NULL != bintreep);
+    assert(NULL != map && NULL != combine);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    pc.map = map;
+    pc.combine = combine;
+    pc.identity = identity;
+    pc.ctx = ctx;
+
+    switch (bintreep->mode) {
+    case bintreeBtree: {
+        bintree_iter_t iter;
+        _bintree_iter_init(&iter, bintreep, INT_MIN);
+        while (_bintree_iter_next(&iter, &data)) {
+            acc = combine(acc, map(data, ctx));
+        }
+        _bintree_iter_release(&iter);
+        goto out;
+    }
+    case bintreeFrozen:
+        pc.eytz = bintreep->eytz;
+        pc.nkeys = bintreep->nkeys;
+        pc.nitems = (pc.nkeys + BINTREE_PAR_GRAIN - 1) / BINTREE_PAR_GRAIN;
+        pc.items = (par_item_t*)malloc((pc.nitems + 1) * sizeof(*pc.items));
+        assert(NULL != pc.items);
+        _pool_run(_par_task_reduce_frozen, &pc, pc.nitems, nthreads);
+        break;
+    default:
+        _par_split(&pc, _bintree_read_enter(bintreep), 0);
+        _pool_run(_par_task_reduce, &pc, pc.nitems, nthreads);
+        _bintree_read_exit(bintreep);
+        break;
+    }
+
+    for (i = 0; i < pc.nitems; i++) {
+        acc = combine(acc, pc.items[i].result);
+    }
+    free(pc.items);
+out:
+    return acc;
+}
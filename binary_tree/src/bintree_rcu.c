@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "bintree_avl_gen.h"
+#include "logger.h"
+
+/*
+ * Concurrent mode for bintree
+ *
+ * Readers never lock.  They pin the current version with epoch_enter(),
+ * load the root once and walk it as a plain tree, so every read API
+ * works unchanged.  A node is never modified once readers can reach it.
+ *
+ * Writers serialize on wlock and build the next version by copying each
+ * node they would change: the search path, the successor moved up by a
+ * remove, and the nodes a rotation moves.  The new root is published
+ * with one atomic store, and only then are the replaced nodes retired;
+ * epoch reclamation frees them after the last reader that could still
+ * see them has left.  Balancing is AVL, so a write copies O(log n) nodes.
+ *
+ * Rotations copy the child they lift even when this write already made
+ * it, which costs at most two spare nodes per rebalance but keeps the
+ * "copy before touching" rule local.
+ */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Remember a node the write in progress replaces
+ *
+ * @param bintreep (i/o) tree being written
+ * @param node     (i) replaced node
+ * @return void
+ */
+static void
+_rcu_stale(bintree_t *bintreep, bintreenode_t *node)
+{
+    if (bintreep->stale_len == bintreep->stale_cap) {
+        bintreep->stale_cap = bintreep->stale_cap ? 2 * bintreep->stale_cap : 64;
+        bintreep->stale = (bintreenode_t**)realloc(bintreep->stale,
+                bintreep->stale_cap * sizeof(*bintreep->stale));
+        assert(NULL != bintreep->stale);
+    }
+    bintreep->stale[bintreep->stale_len++] = node;
+}
+
+/**
+ * Make a private copy of a node and mark the original stale
+ *
+ * @param bintreep (i/o) tree being written
+ * @param node     (i) node to copy
+ * @return copy, free to modify
+ */
+static bintreenode_t*
+_rcu_copy(bintree_t *bintreep, bintreenode_t *node)
+{
+    bintreenode_t *copy = _bintree_node_alloc(bintreep, node->data);
+
+    *copy = *node;
+    _rcu_stale(bintreep, node);
+    return copy;
+}
+
+/**
+ * Size of a possibly-NULL subtree
+ *
+ * @param node (i) subtree root
+ * @return node count, 0 for NULL
+ */
+static inline int
+_rcu_size(bintreenode_t *node)
+{
+    return (NULL == node) ? 0 : node->size;
+}
+
+/**
+ * Recompute a private node's subtree size from its children, once its
+ * height is fixed
+ *
+ * @param node (i) node to update
+ * @return void
+ */
+static inline void
+_rcu_update(bintreenode_t *node)
+{
+    node->size = 1 + _rcu_size(node->left) + _rcu_size(node->right);
+}
+
+/* rotations only touch private nodes: copy each one they move */
+#define _RCU_OWN(_ctx_, _link_) (*(_link_) = _rcu_copy((bintree_t*)(_ctx_), *(_link_)))
+#define _RCU_ROTATED() BINTREE_COUNT(rotations)
+
+/* _rcu_height, _rcu_fix, _rcu_rotate_left/right, _rcu_rebalance_with */
+BINTREE_AVL_DEFINE(_rcu, bintreenode_t, _rcu_update, _RCU_OWN, _RCU_ROTATED)
+
+/**
+ * Copy-on-write AVL insert
+ *
+ * @param bintreep (i/o) tree being written
+ * @param node     (i) published subtree root
+ * @param data     (i) data to insert
+ * @return root of the new subtree version
+ */
+static bintreenode_t*
+_rcu_insert(bintree_t *bintreep, bintreenode_t *node, int data)
+{
+    if (NULL == node) {
+        return _bintree_node_alloc(bintreep, data);
+    }
+
+    node = _rcu_copy(bintreep, node);
+    if (data < node->data) {
+        node->left = _rcu_insert(bintreep, node->left, data);
+    } else {
+        node->right = _rcu_insert(bintreep, node->right, data);
+    }
+    return _rcu_rebalance_with(bintreep, node);
+}
+
+/**
+ * Copy-on-write unlink of a subtree's minimum node
+ *
+ * @param bintreep (i/o) tree being written
+ * @param node     (i) published subtree root
+ * @param min      (o) the (still published) minimum node
+ * @return root of the new subtree version
+ */
+static bintreenode_t*
+_rcu_unlink_min(bintree_t *bintreep, bintreenode_t *node, bintreenode_t **min)
+{
+    if (NULL == node->left) {
+        *min = node;
+        return node->right;
+    }
+    node = _rcu_copy(bintreep, node);
+    node->left = _rcu_unlink_min(bintreep, node->left, min);
+    return _rcu_rebalance_with(bintreep, node);
+}
+
+/**
+ * Copy-on-write AVL remove of a key known to be present
+ *
+ * @param bintreep (i/o) tree being written
+ * @param node     (i) published subtree root
+ * @param data     (i) data to remove
+ * @return root of the new subtree version
+ */
+static bintreenode_t*
+_rcu_remove(bintree_t *bintreep, bintreenode_t *node, int data)
+{
+    if (data != node->data) {
+        node = _rcu_copy(bintreep, node);
+        if (data < node->data) {
+            node->left = _rcu_remove(bintreep, node->left, data);
+        } else {
+            node->right = _rcu_remove(bintreep, node->right, data);
+        }
+    } else {
+        bintreenode_t *left = node->left;
+        bintreenode_t *right = node->right;
+        bintreenode_t *succ = NULL;
+
+        _rcu_stale(bintreep, node);
+        if (NULL == left) {
+            return right;
+        }
+        if (NULL == right) {
+            return left;
+        }
+        right = _rcu_unlink_min(bintreep, right, &succ);
+        node = _rcu_copy(bintreep, succ);
+        node->left = left;
+        node->right = right;
+    }
+    return _rcu_rebalance_with(bintreep, node);
+}
+
+/**
+ * Publish a new version and retire the nodes it replaced
+ *
+ * @param bintreep (i/o) tree being written
+ * @param root     (i) root of the new version
+ * @return void
+ */
+static void
+_rcu_publish(bintree_t *bintreep, bintreenode_t *root)
+{
+    int i = 0;
+
+    __atomic_store_n(&bintreep->root, root, __ATOMIC_RELEASE);
+    for (i = 0; i < bintreep->stale_len; i++) {
+        epoch_retire(bintreep->stale[i], free);
+    }
+    bintreep->stale_len = 0;
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Insert into a concurrent tree, safe against concurrent readers and
+ * other writers
+ *
+ * @param bintreep (i) tree to insert into
+ * @param data     (i) data to insert
+ * @return void
+ */
+void
+_bintree_rcu_insert(bintree_t *bintreep, int data)
+{
+    pthread_mutex_lock(&bintreep->wlock);
+    _rcu_publish(bintreep, _rcu_insert(bintreep, bintreep->root, data));
+    pthread_mutex_unlock(&bintreep->wlock);
+}
+
+/**
+ * Remove one occurrence of data from a concurrent tree, safe against
+ * concurrent readers and other writers
+ *
+ * @param bintreep (i) tree to remove from
+ * @param data     (i) data to remove
+ * @return void
+ */
+void
+_bintree_rcu_remove(bintree_t *bintreep, int data)
+{
+    bintreenode_t *node = NULL;
+
+    pthread_mutex_lock(&bintreep->wlock);
+    node = bintreep->root;
+    while (NULL != node && data != node->data) {
+        node = (data < node->data) ? node->left : node->right;
+    }
+    if (NULL == node) {
+        logger(dbgWarn, "Data %i not found in tree", data);
+    } else {
+        _rcu_publish(bintreep, _rcu_remove(bintreep, bintreep->root, data));
+    }
+    pthread_mutex_unlock(&bintreep->wlock);
+}
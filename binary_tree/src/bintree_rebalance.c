@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Rebalance on demand for bintree
+ *
+ * Day-Stout-Warren: rotate the whole tree into a right-leaning vine,
+ * then fold the vine back into a tree whose levels are all full but the
+ * last.  Both phases are runs of single rotations under a dummy root,
+ * O(n) time and no memory beyond a few pointers, and each rotation keeps
+ * the subtree sizes exact from the sizes it moves, so count, select and
+ * rank work straight after.  Keys and duplicates stay where in-order
+ * puts them, so every mode with the plain node layout can be rebuilt.
+ *
+ * Plain trees can also rebuild themselves, see bintree_set_auto_rebalance().
+ */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Size of a possibly-NULL subtree
+ *
+ * @param node (i) subtree root
+ * @return keys in the subtree, 0 for NULL
+ */
+static inline int
+_dsw_size(bintreenode_t *node)
+{
+    return (NULL == node) ? 0 : node->size;
+}
+
+/**
+ * Rotate a tree into a vine: every node's left link NULL
+ *
+ * Algorithm: walk down the right spine from the dummy root; while the
+ *            node there has a left child, rotate it right so the child
+ *            takes its place, else step past it.  Each rotation puts one
+ *            more node on the spine for good, so there are at most n.
+ *
+ * @param head (i/o) dummy root, the tree hangs off head->right
+ * @return nodes in the vine
+ */
+static int
+_dsw_tree_to_vine(bintreenode_t *head)
+{
+    bintreenode_t *tail = head, *rest = head->right, *l = NULL;
+    int n = 0;
+
+    while (NULL != rest) {
+        if (NULL == rest->left) {
+            tail = rest;
+            rest = rest->right;
+            n++;
+            continue;
+        }
+        BINTREE_COUNT(rotations);
+        l = rest->left;
+        rest->left = l->right;
+        l->right = rest;
+        l->size = rest->size;
+        rest->size = rest->count + _dsw_size(rest->left) + _dsw_size(rest->right);
+        rest = l;
+        tail->right = l;
+    }
+    return n;
+}
+
+/**
+ * Rotate left every other node of the vine, cnt times from the top
+ *
+ * Each of the first cnt odd-numbered spine nodes drops down as the left
+ * child of the node below it, halving that stretch of the spine.
+ *
+ * @param head (i/o) dummy root
+ * @param cnt  (i) rotations to make
+ * @return void
+ */
+static void
+_dsw_compress(bintreenode_t *head, int cnt)
+{
+    bintreenode_t *scan = head, *child = NULL;
+
+    while (cnt-- > 0) {
+        BINTREE_COUNT(rotations);
+        child = scan->right;
+        scan->right = child->right;
+        scan = scan->right;
+        child->right = scan->left;
+        scan->left = child;
+        scan->size = child->size;
+        child->size = child->count + _dsw_size(child->left) + _dsw_size(child->right);
+    }
+}
+
+/**
+ * Recompute the heights of a rebuilt tree for the modes that keep them
+ *
+ * Recursion is as deep as the tree, which DSW has just balanced.
+ *
+ * @param node (i/o) subtree root
+ * @return height, 0 for NULL
+ */
+static int
+_dsw_fix_heights(bintreenode_t *node)
+{
+    int hl = 0, hr = 0;
+
+    if (NULL == node) {
+        return 0;
+    }
+    hl = _dsw_fix_heights(node->left);
+    hr = _dsw_fix_heights(node->right);
+    node->height = 1 + (hl > hr ? hl : hr);
+    return node->height;
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Rebuild a pointer tree into minimum height
+ *
+ * Algorithm: vine the tree, then compress it: first as many rotations
+ *            as there are nodes beyond the largest full tree
+ *            2^k - 1 <= n, which leaves a vine of exactly 2^k - 1 nodes
+ *            over those leaves, then halve that vine until it is a
+ *            single root.
+ *
+ * @param bintreep (i/o) tree in a mode with the plain node layout, not
+ *                       bintreeConcurrent
+ * @return void
+ */
+void
+_bintree_dsw(bintree_t *bintreep)
+{
+    bintreenode_t head;
+    int n = 0, full = 1;
+
+    head.left = NULL;
+    head.right = bintreep->root;
+    n = _dsw_tree_to_vine(&head);
+
+    while (full <= (n + 1) / 2) {
+        full *= 2;
+    }
+    full--;
+    _dsw_compress(&head, n - full);
+    while (full > 1) {
+        full /= 2;
+        _dsw_compress(&head, full);
+    }
+    bintreep->root = head.right;
+
+    if (bintreeAvl == bintreep->mode || bintreeMultiset == bintreep->mode) {
+        _dsw_fix_heights(bintreep->root);
+    }
+}
+
+/**
+ * Check whether a plain tree's last insert went too deep
+ *
+ * @param bintreep (i) plain tree
+ * @param depth    (i) depth of the node just inserted, root is 1
+ * @return 1 if depth is over the tree's factor times log2(count), else 0
+ */
+int
+_bintree_rebalance_due(bintree_t *bintreep, int depth)
+{
+    if (bintreep->rebalance_factor <= 0.0 || depth <= 2) {
+        return 0;
+    }
+    return (depth > bintreep->rebalance_factor * log2(bintreep->root->size));
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Rebuild a binary tree into minimum height, in place
+ *
+ * Day-Stout-Warren in O(n) time and O(1) extra space.  The depth after
+ * is floor(log2(nodes)) + 1.  B-tree and frozen trees are always
+ * balanced and are left as they are.  Concurrent trees are refused:
+ * rotating in place would tear paths out from under their readers.
+ *
+ * @param bintreep (i/o) binary tree
+ * @return 1 on success, 0 else
+ */
+int
+bintree_rebalance(BintreePtr bintreep)
+{
+    int ok = 0;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+    case bintreeFrozen:
+        break;
+    case bintreeConcurrent:
+        logger(dbgErr, "Tree '%s' is concurrent, cannot rebalance in place",
+               bintreep->name);
+        goto out;
+    default:
+        _bintree_dsw(bintreep);
+        break;
+    }
+    ok = 1;
+out:
+    return ok;
+}
+
+/**
+ * Make a plain tree rebalance itself when it grows too deep
+ *
+ * Checked on every insert against the depth of the node just added,
+ * which is where bintree_maxdepth() grows: once that passes factor *
+ * log2(count) the whole tree is rebuilt with bintree_rebalance().  A
+ * factor of 2 keeps searches within about twice the ideal path.  Each
+ * rebuild is O(n), and sorted input brings the next one about
+ * (factor - 1) * log2(count) inserts later, so for bulk loads of sorted
+ * keys bintree_build_sorted() is still the better tool.
+ *
+ * @param bintreep (i/o) binary tree, bintreePlain mode
+ * @param factor   (i) allowed depth as a multiple of log2(count), must
+ *                     be above 1; 0 turns the check off (the default)
+ * @return 1 on success, 0 else
+ */
+int
+bintree_set_auto_rebalance(BintreePtr bintreep, double factor)
+{
+    int ok = 0;
+
+    assert(NULL != bintreep);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    if (bintreePlain != bintreep->mode) {
+        logger(dbgErr, "Tree '%s': auto rebalance is for plain trees only",
+               bintreep->name);
+        goto out;
+    }
+    if (0.0 != factor && factor <= 1.0) {
+        logger(dbgErr, "Tree '%s': rebalance factor %.2f must be above 1",
+               bintreep->name, factor);
+        goto out;
+    }
+    bintreep->rebalance_factor = factor;
+    ok = 1;
+out:
+    return ok;
+}
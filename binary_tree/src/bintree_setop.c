@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Set operations for AVL bintrees
+ *
+ * Union, intersection and difference are built on AVL split and join
+ * (see bintree_avl.c) in the divide-and-conquer form of Blelloch et al.,
+ * "Just Join for Parallel Ordered Sets": split the second tree around the
+ * root of the first, recurse on the two halves, join the results.  This
+ * takes O(m log(n/m + 1)) comparisons for trees of m <= n keys, so a
+ * small tree merges into a large one in little more than m searches, and
+ * two trees over disjoint key ranges merge in O(log n).  The two
+ * recursive calls never touch the same nodes, so they could run on
+ * separate threads.
+ *
+ * The operations consume src: its nodes are relinked into dst, never
+ * copied, and the ones that drop out are freed.  Trees are treated as
+ * sets, a key found in both appears once in a union; duplicates within
+ * one tree are kept.
+ */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Free every node of a subtree
+ *
+ * @param bintreep (i) owning tree
+ * @param node     (i) subtree root
+ * @return void
+ */
+static void
+_setop_free(bintree_t *bintreep, bintreenode_t *node)
+{
+    while (NULL != node) {
+        bintreenode_t *right = node->right;
+        _setop_free(bintreep, node->left);
+        _bintree_node_free(bintreep, node);
+        node = right;
+    }
+}
+
+/**
+ * Union of two subtrees
+ *
+ * @param bintreep (i) owning tree, for freeing duplicates
+ * @param a        (i) subtree, its nodes win ties
+ * @param b        (i) subtree
+ * @return root of the union
+ */
+static bintreenode_t*
+_setop_union(bintree_t *bintreep, bintreenode_t *a, bintreenode_t *b)
+{
+    bintreenode_t *bl = NULL, *br = NULL, *dup = NULL;
+    bintreenode_t *l = NULL, *r = NULL;
+
+    if (NULL == a) {
+        return b;
+    }
+    if (NULL == b) {
+        return a;
+    }
+    dup = _bintree_avl_split(b, a->data, &bl, &br);
+    if (NULL != dup) {
+        _bintree_node_free(bintreep, dup);
+    }
+    l = _setop_union(bintreep, a->left, bl);
+    r = _setop_union(bintreep, a->right, br);
+    return _bintree_avl_join(l, a, r);
+}
+
+/**
+ * Intersection of two subtrees
+ *
+ * @param bintreep (i) owning tree, for freeing what drops out
+ * @param a        (i) subtree, its nodes are the ones kept
+ * @param b        (i) subtree
+ * @return root of the intersection
+ */
+static bintreenode_t*
+_setop_intersection(bintree_t *bintreep, bintreenode_t *a, bintreenode_t *b)
+{
+    bintreenode_t *bl = NULL, *br = NULL, *dup = NULL;
+    bintreenode_t *al = NULL, *ar = NULL;
+    bintreenode_t *l = NULL, *r = NULL;
+
+    if (NULL == a || NULL == b) {
+        _setop_free(bintreep, a);
+        _setop_free(bintreep, b);
+        return NULL;
+    }
+    dup = _bintree_avl_split(b, a->data, &bl, &br);
+    al = a->left;
+    ar = a->right;
+    l = _setop_intersection(bintreep, al, bl);
+    r = _setop_intersection(bintreep, ar, br);
+    if (NULL != dup) {
+        _bintree_node_free(bintreep, dup);
+        return _bintree_avl_join(l, a, r);
+    }
+    _bintree_node_free(bintreep, a);
+    return _bintree_avl_join2(l, r);
+}
+
+/**
+ * Difference of two subtrees, the keys of a not in b
+ *
+ * @param bintreep (i) owning tree, for freeing what drops out
+ * @param a        (i) subtree
+ * @param b        (i) subtree of keys to take out
+ * @return root of the difference
+ */
+static bintreenode_t*
+_setop_difference(bintree_t *bintreep, bintreenode_t *a, bintreenode_t *b)
+{
+    bintreenode_t *al = NULL, *ar = NULL, *dup = NULL;
+    bintreenode_t *bl = NULL, *br = NULL;
+    bintreenode_t *l = NULL, *r = NULL;
+
+    if (NULL == a || NULL == b) {
+        _setop_free(bintreep, b);
+        return a;
+    }
+    dup = _bintree_avl_split(a, b->data, &al, &ar);
+    bl = b->left;
+    br = b->right;
+    _bintree_node_free(bintreep, b);
+    if (NULL != dup) {
+        _bintree_node_free(bintreep, dup);
+    }
+    l = _setop_difference(bintreep, al, bl);
+    r = _setop_difference(bintreep, ar, br);
+    return _bintree_avl_join2(l, r);
+}
+
+/**
+ * Check that two trees can take part in a set operation
+ *
+ * @param dst (i) destination tree
+ * @param src (i) source tree
+ * @param op  (i) operation name, for the log
+ * @return 1 if both are AVL trees, 0 else
+ */
+static int
+_setop_check(bintree_t *dst, bintree_t *src, const char *op)
+{
+    if (bintreeAvl != dst->mode || bintreeAvl != src->mode) {
+        logger(dbgErr, "%s of '%s' and '%s' needs two bintreeAvl trees", op,
+                dst->name, src->name);
+        return 0;
+    }
+    return 1;
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Add every key of src to dst
+ *
+ * O(m log(n/m + 1)) for trees of m <= n keys.  src is emptied, its nodes
+ * move into dst; src must still be destroyed.
+ *
+ * @param dst (i/o) AVL tree, becomes dst | src
+ * @param src (i/o) AVL tree, left empty
+ * @return keys in dst afterwards, -1 if either tree is not an AVL tree
+ */
+int
+bintree_union(BintreePtr dst, BintreePtr src)
+{
+    bintreenode_t *root = NULL;
+
+    assert(NULL != dst);
+    assert(NULL != src);
+    assert(dst != src);
+    MAGIC_IN_USE_CHECK(dst->magic);
+    MAGIC_IN_USE_CHECK(src->magic);
+
+    if (!_setop_check(dst, src, "Union")) {
+        goto out;
+    }
+    root = src->root;
+    _bintree_arena_merge(dst, src);
+    dst->root = _setop_union(dst, dst->root, root);
+    return bintree_count(dst);
+out:
+    return -1;
+}
+
+/**
+ * Keep only the keys of dst that are also in src
+ *
+ * Cost as bintree_union(), plus O(1) per node dropped.  src is emptied.
+ *
+ * @param dst (i/o) AVL tree, becomes dst & src
+ * @param src (i/o) AVL tree, left empty
+ * @return keys in dst afterwards, -1 if either tree is not an AVL tree
+ */
+int
+bintree_intersection(BintreePtr dst, BintreePtr src)
+{
+    bintreenode_t *root = NULL;
+
+    assert(NULL != dst);
+    assert(NULL != src);
+    assert(dst != src);
+    MAGIC_IN_USE_CHECK(dst->magic);
+    MAGIC_IN_USE_CHECK(src->magic);
+
+    if (!_setop_check(dst, src, "Intersection")) {
+        goto out;
+    }
+    root = src->root;
+    _bintree_arena_merge(dst, src);
+    dst->root = _setop_intersection(dst, dst->root, root);
+    return bintree_count(dst);
+out:
+    return -1;
+}
+
+/**
+ * Remove every key of src from dst
+ *
+ * Cost as bintree_union(), plus O(1) per node dropped.  src is emptied.
+ *
+ * @param dst (i/o) AVL tree, becomes dst - src
+ * @param src (i/o) AVL tree, left empty
+ * @return keys in dst afterwards, -1 if either tree is not an AVL tree
+ */
+int
+bintree_difference(BintreePtr dst, BintreePtr src)
+{
+    bintreenode_t *root = NULL;
+
+    assert(NULL != dst);
+    assert(NULL != src);
+    assert(dst != src);
+    MAGIC_IN_USE_CHECK(dst->magic);
+    MAGIC_IN_USE_CHECK(src->magic);
+
+    if (!_setop_check(dst, src, "Difference")) {
+        goto out;
+    }
+    root = src->root;
+    _bintree_arena_merge(dst, src);
+    dst->root = _setop_difference(dst, dst->root, root);
+    return bintree_count(dst);
+out:
+    return -1;
+}
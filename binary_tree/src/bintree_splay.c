@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Splay mode for bintree
+ *
+ * Plain node layout; search, insert and remove each splay the key they
+ * touch to the root, so a small set of hot keys stays within a few
+ * levels of it and any sequence of m operations costs O(m log n).
+ * Splaying is top-down (Sleator & Tarjan): one pass down the search
+ * path, no recursion and no parent pointers, and it keeps the subtree
+ * sizes that count, select and rank rely on.
+ *
+ * Every other read (min/max, traversals, iterators, batch search, ...)
+ * walks the tree as it is without reshaping it.  Because a search
+ * writes to the tree, splay trees must not be searched from two threads
+ * at once.
+ */
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Size of a possibly-NULL subtree
+ *
+ * @param node (i) subtree root
+ * @return node count, 0 for NULL
+ */
+static inline int
+_splay_size(bintreenode_t *node)
+{
+    return (NULL == node) ? 0 : node->size;
+}
+
+/**
+ * Compare a key with a node for splaying
+ *
+ * @param data  (i) key
+ * @param node  (i) node
+ * @param upper (i) non-zero to treat equal keys as greater
+ * @return <0 to go left, >0 to go right, 0 when found
+ */
+static inline int
+_splay_cmp(int data, const bintreenode_t *node, int upper)
+{
+    if (data < node->data) {
+        return -1;
+    }
+    return (data > node->data || upper) ? 1 : 0;
+}
+
+/**
+ * Splay a subtree around data
+ *
+ * Algorithm: top-down splay.  Walk down from the root, splitting off
+ *            the nodes passed into a left tree (keys below data) and a
+ *            right tree (keys above), rotating first at every zig-zig
+ *            step.  The node the walk stops at becomes the root with
+ *            the two trees as its children.  Sizes of the nodes on the
+ *            two trees' inner spines are fixed up in a second pass.
+ *
+ * @param node  (i) subtree root, may be NULL
+ * @param data  (i) key to splay for
+ * @param upper (i) non-zero to pass over keys equal to data, so the new
+ *                  root is the last node <= data (or the first > data)
+ * @return new subtree root: the node holding data if there is one, else
+ *         its in-order neighbour on the search path
+ */
+static bintreenode_t*
+_splay(bintreenode_t *node, int data, int upper)
+{
+    bintreenode_t head;
+    bintreenode_t *l = &head, *r = &head, *y = NULL;
+    int l_size = 0, r_size = 0, c = 0;
+
+    if (NULL == node) {
+        return NULL;
+    }
+    head.left = head.right = NULL;
+
+    for (;;) {
+        c = _splay_cmp(data, node, upper);
+        if (c < 0) {
+            if (NULL == node->left) {
+                break;
+            }
+            if (_splay_cmp(data, node->left, upper) < 0) {
+                /* zig-zig: rotate right */
+                BINTREE_COUNT(rotations);
+                y = node->left;
+                node->left = y->right;
+                y->right = node;
+                node->size = 1 + _splay_size(node->left) + _splay_size(node->right);
+                node = y;
+                if (NULL == node->left) {
+                    break;
+                }
+            }
+            /* link into the right tree */
+            r->left = node;
+            r = node;
+            node = node->left;
+            r_size += 1 + _splay_size(r->right);
+        } else if (c > 0) {
+            if (NULL == node->right) {
+                break;
+            }
+            if (_splay_cmp(data, node->right, upper) > 0) {
+                /* zag-zag: rotate left */
+                BINTREE_COUNT(rotations);
+                y = node->right;
+                node->right = y->left;
+                y->left = node;
+                node->size = 1 + _splay_size(node->left) + _splay_size(node->right);
+                node = y;
+                if (NULL == node->right) {
+                    break;
+                }
+            }
+            /* link into the left tree */
+            l->right = node;
+            l = node;
+            node = node->right;
+            l_size += 1 + _splay_size(l->left);
+        } else {
+            break;
+        }
+    }
+
+    /* sizes of the finished left and right trees */
+    l_size += _splay_size(node->left);
+    r_size += _splay_size(node->right);
+    node->size = l_size + r_size + 1;
+
+    /* fix the sizes down the inner spines, where the two trees were cut */
+    l->right = r->left = NULL;
+    for (y = head.right; NULL != y; y = y->right) {
+        y->size = l_size;
+        l_size -= 1 + _splay_size(y->left);
+    }
+    for (y = head.left; NULL != y; y = y->left) {
+        y->size = r_size;
+        r_size -= 1 + _splay_size(y->right);
+    }
+
+    /* assemble */
+    l->right = node->left;
+    r->left = node->right;
+    node->left = head.right;
+    node->right = head.left;
+    return node;
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Search a splay tree, moving the key (or its neighbour) to the root
+ *
+ * @param bintreep (i/o) splay tree
+ * @param data     (i) data to search for
+ * @return 1 if found, else 0
+ */
+int
+_bintree_splay_search(bintree_t *bintreep, int data)
+{
+    bintreep->root = _splay(bintreep->root, data, 0);
+    return (NULL != bintreep->root && data == bintreep->root->data);
+}
+
+/**
+ * Insert into a splay tree, the new node becomes the root
+ *
+ * Algorithm: splay for the last node <= data (or the first one
+ *            above it if there is none), then split the tree under the
+ *            new node: the old root goes to the side it belongs on and
+ *            its subtree on the other side moves across.  Equal keys go
+ *            right of existing ones, as with plain inserts.
+ *
+ * @param bintreep (i/o) splay tree
+ * @param data     (i) data to insert
+ * @return void
+ */
+void
+_bintree_splay_insert(bintree_t *bintreep, int data)
+{
+    bintreenode_t *root = _splay(bintreep->root, data, 1);
+    bintreenode_t *node = _bintree_node_alloc(bintreep, data);
+
+    if (NULL != root) {
+        if (data < root->data) {
+            node->right = root;
+            node->left = root->left;
+            root->left = NULL;
+            root->size = 1 + _splay_size(root->right);
+        } else {
+            node->left = root;
+            node->right = root->right;
+            root->right = NULL;
+            root->size = 1 + _splay_size(root->left);
+        }
+        node->size = 1 + _splay_size(node->left) + _splay_size(node->right);
+    }
+    bintreep->root = node;
+}
+
+/**
+ * Remove one occurrence of data from a splay tree
+ *
+ * Algorithm: splay data to the root and unlink it; splaying the left
+ *            subtree past data brings its maximum up with no right
+ *            child, and the right subtree hangs there
+ *
+ * @param bintreep (i/o) splay tree
+ * @param data     (i) data to remove
+ * @return void
+ */
+void
+_bintree_splay_remove(bintree_t *bintreep, int data)
+{
+    bintreenode_t *root = _splay(bintreep->root, data, 0);
+    bintreenode_t *left = NULL;
+
+    bintreep->root = root;
+    if (NULL == root || data != root->data) {
+        logger(dbgWarn, "Data %i not found in tree", data);
+        return;
+    }
+
+    if (NULL == root->left) {
+        bintreep->root = root->right;
+    } else {
+        left = _splay(root->left, data, 1);
+        left->right = root->right;
+        left->size += _splay_size(root->right);
+        bintreep->root = left;
+    }
+    _bintree_node_free(bintreep, root);
+}
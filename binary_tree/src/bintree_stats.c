@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Shape statistics for bintree
+ *
+ * One post-order pass over the tree measures every node's depth and the
+ * heights of both its subtrees, which give the depth histogram, average
+ * search path and balance factors; nothing stored in the nodes is
+ * trusted, so plain trees (no heights) get the same figures as AVL ones.
+ * The pass keeps its own stack of the current path, so degenerate trees
+ * are as safe to measure as balanced ones.
+ *
+ * The cost counters are separate: compiled in with
+ * -DBINTREE_STATS_COUNTERS and bumped on the search and rotation paths
+ * themselves, they cost nothing when left out.
+ */
+
+bintree_counters_t _bintree_counters;
+
+#define STATS_STACK_INLINE 64
+
+/* Frame of the post-order pass: state 0 = new, 1 = left done, 2 = both */
+typedef struct stats_frame_s {
+    bintreenode_t *node;
+    int depth;
+    int hl;
+    int state;
+} stats_frame_t;
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Add a pointer tree's shape to a stats record
+ *
+ * Algorithm: iterative post-order; each frame's subtree height is
+ *            handed to its parent through ret when the frame pops.
+ *            avg_path is left as the key-weighted sum of depths for the
+ *            caller to divide.
+ *
+ * @param root (i) root node
+ * @param out  (i/o) stats being gathered
+ * @return void
+ */
+static void
+_stats_walk(bintreenode_t *root, bintree_stats_t *out)
+{
+    stats_frame_t inline_st[STATS_STACK_INLINE];
+    stats_frame_t *st = inline_st;
+    stats_frame_t *f = NULL;
+    int top = 0, cap = STATS_STACK_INLINE, ret = 0, bf = 0;
+
+    if (NULL == root) {
+        return;
+    }
+    st[top++] = (stats_frame_t){root, 1, 0, 0};
+
+    while (top > 0) {
+        f = &st[top - 1];
+        if (0 == f->state) {
+            bintreenode_t *node = f->node;
+            int d = (f->depth < BINTREE_STATS_DEPTHS) ? f->depth : BINTREE_STATS_DEPTHS;
+
+            out->nodes++;
+            out->keys += node->count;
+            out->depth_hist[d - 1]++;
+            out->avg_path += (double)f->depth * node->count;
+            if (f->depth > out->height) {
+                out->height = f->depth;
+            }
+        }
+        if (f->state < 2) {
+            bintreenode_t *child = (0 == f->state) ? f->node->left : f->node->right;
+
+            if (1 == f->state) {
+                f->hl = ret;
+            }
+            f->state++;
+            if (NULL == child) {
+                ret = 0;
+                continue;
+            }
+            if (top == cap) {
+                cap *= 2;
+                if (st == inline_st) {
+                    st = (stats_frame_t*)malloc(cap * sizeof(*st));
+                    assert(NULL != st);
+                    memcpy(st, inline_st, sizeof(inline_st));
+                } else {
+                    st = (stats_frame_t*)realloc(st, cap * sizeof(*st));
+                    assert(NULL != st);
+                }
+                f = &st[top - 1];
+            }
+            st[top++] = (stats_frame_t){child, f->depth + 1, 0, 0};
+            continue;
+        }
+
+        /* both subtrees done, ret holds the right one's height */
+        bf = f->hl - ret;
+        bf = (bf < -2) ? -2 : (bf > 2) ? 2 : bf;
+        out->balance_hist[bf + 2]++;
+        ret = 1 + ((f->hl > ret) ? f->hl : ret);
+        top--;
+    }
+    if (st != inline_st) {
+        free(st);
+    }
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Gather a tree's shape, memory use and (optionally) cost counters
+ *
+ * One O(n) pass with O(height) extra memory; the tree is not modified,
+ * not even in bintreeSplay mode.  memory counts what the tree holds, so
+ * arena chunks count in full, used or not.
+ *
+ * @param bintreep (i) binary tree
+ * @param out      (o) statistics
+ * @return 1 on success, 0 else
+ */
+int
+bintree_stats(BintreePtr bintreep, bintree_stats_t *out)
+{
+    int ok = 0;
+
+    assert(NULL != bintreep);
+    assert(NULL != out);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    memset(out, 0, sizeof(*out));
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        _bintree_btree_stats(bintreep->broot, 1, out);
+        break;
+    case bintreeFrozen:
+        _bintree_frozen_stats(bintreep->nkeys, out);
+        if (NULL != bintreep->image) {
+            /* the keys live in the mapped file, not a heap array */
+            out->memory = bintreep->image_len;
+        }
+        break;
+    case bintreeConcurrent:
+        _stats_walk(_bintree_read_enter(bintreep), out);
+        _bintree_read_exit(bintreep);
+        out->memory = out->nodes * sizeof(bintreenode_t);
+        break;
+    default:
+        _stats_walk(bintreep->root, out);
+        out->memory = bintreep->arena_bytes;
+        break;
+    }
+    out->memory += sizeof(*bintreep);
+    out->avg_path = (out->keys > 0) ? out->avg_path / out->keys : 0.0;
+
+    out->searches = __atomic_load_n(&_bintree_counters.searches, __ATOMIC_RELAXED);
+    out->search_cmps = __atomic_load_n(&_bintree_counters.search_cmps, __ATOMIC_RELAXED);
+    out->rotations = __atomic_load_n(&_bintree_counters.rotations, __ATOMIC_RELAXED);
+    ok = 1;
+out:
+    return ok;
+}
+
+/**
+ * Zero the process-wide cost counters
+ *
+ * @return void
+ */
+void
+bintree_stats_reset_counters(void)
+{
+    __atomic_store_n(&_bintree_counters.searches, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_bintree_counters.search_cmps, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&_bintree_counters.rotations, 0, __ATOMIC_RELAXED);
+}
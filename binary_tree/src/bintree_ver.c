@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "bintree_ver_ext.h"
+#include "bintree_int.h"
+#include "bintree_avl_gen.h"
+#include "logger.h"
+
+/*
+ * Persistent (versioned) bintree
+ *
+ * Nodes are shared between versions and reference counted: every child
+ * pointer and every version's root holds one reference.  A write starts
+ * from a new reference to the old root and makes each node it is about
+ * to change its own first (_ver_own): a node only this write can reach,
+ * refcnt 1, is changed in place; any other is copied, the copy taking a
+ * reference on each child.  So the old version's nodes are never
+ * modified and a write copies the search path plus the nodes its
+ * rotations lift, O(log n).  Balancing is AVL, as in bintree_avl.c.
+ *
+ * Reference counts are atomic so versions can be released on any
+ * thread while other threads read or write from versions sharing the
+ * same nodes.
+ */
+
+#define VER_MAGIC_IN_USE_CHECK(_mag_) \
+    if (BINTREE_VER_MAGIC_IN_USE != _mag_) { \
+        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
+                BINTREE_VER_MAGIC_IN_USE, _mag_); \
+        goto out; \
+    } \
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Take a reference on a possibly-NULL node
+ *
+ * @param node (i) node
+ * @return node
+ */
+static inline bintree_vnode_t*
+_ver_ref(bintree_vnode_t *node)
+{
+    if (NULL != node) {
+        __atomic_add_fetch(&node->refcnt, 1, __ATOMIC_RELAXED);
+    }
+    return node;
+}
+
+/**
+ * Drop a reference on a possibly-NULL node, freeing it and dropping its
+ * references on its children when it was the last one
+ *
+ * @param node (i) node
+ * @return void
+ */
+static void
+_ver_unref(bintree_vnode_t *node)
+{
+    while (NULL != node &&
+           0 == __atomic_sub_fetch(&node->refcnt, 1, __ATOMIC_ACQ_REL)) {
+        bintree_vnode_t *right = node->right;
+        _ver_unref(node->left);
+        free(node);
+        node = right;
+    }
+}
+
+/**
+ * Alloc a leaf
+ *
+ * @param data (i) data to store
+ * @return node with one reference
+ */
+static bintree_vnode_t*
+_ver_node_alloc(int data)
+{
+    bintree_vnode_t *node = (bintree_vnode_t*)malloc(sizeof(*node));
+    assert(NULL != node);
+
+    node->data = data;
+    node->height = 1;
+    node->size = 1;
+    node->refcnt = 1;
+    node->left = NULL;
+    node->right = NULL;
+    return node;
+}
+
+/**
+ * Make a node safe to modify for the write holding a reference to it
+ *
+ * @param node (i) node, the caller's reference is consumed
+ * @return node itself if that reference was the only one, else a copy
+ *         with one reference
+ */
+static bintree_vnode_t*
+_ver_own(bintree_vnode_t *node)
+{
+    bintree_vnode_t *copy = NULL;
+
+    if (1 == __atomic_load_n(&node->refcnt, __ATOMIC_ACQUIRE)) {
+        return node;
+    }
+    copy = (bintree_vnode_t*)malloc(sizeof(*copy));
+    assert(NULL != copy);
+    copy->data = node->data;
+    copy->height = node->height;
+    copy->size = node->size;
+    copy->refcnt = 1;
+    copy->left = node->left;
+    copy->right = node->right;
+    _ver_ref(copy->left);
+    _ver_ref(copy->right);
+    _ver_unref(node);
+    return copy;
+}
+
+/**
+ * Size of a possibly-NULL subtree
+ *
+ * @param node (i) subtree root
+ * @return node count, 0 for NULL
+ */
+static inline int
+_ver_size(bintree_vnode_t *node)
+{
+    return (NULL == node) ? 0 : node->size;
+}
+
+/**
+ * Recompute an owned node's subtree size from its children, once its
+ * height is fixed
+ *
+ * @param node (i) owned node
+ * @return void
+ */
+static inline void
+_ver_update(bintree_vnode_t *node)
+{
+    node->size = 1 + _ver_size(node->left) + _ver_size(node->right);
+}
+
+/* rotations only touch owned nodes: own each one they move */
+#define _VER_OWN(_ctx_, _link_) (*(_link_) = _ver_own(*(_link_)))
+
+/* _ver_height, _ver_fix, _ver_rotate_left/right, _ver_rebalance */
+BINTREE_AVL_DEFINE(_ver, bintree_vnode_t, _ver_update, _VER_OWN, BINTREE_AVL_NOP)
+
+/**
+ * Insert into a subtree
+ *
+ * @param node (i) subtree root, the caller's reference is consumed
+ * @param data (i) data to insert, equal keys go right
+ * @return new subtree root, owned
+ */
+static bintree_vnode_t*
+_ver_insert(bintree_vnode_t *node, int data)
+{
+    if (NULL == node) {
+        return _ver_node_alloc(data);
+    }
+
+    node = _ver_own(node);
+    if (data < node->data) {
+        node->left = _ver_insert(node->left, data);
+    } else {
+        node->right = _ver_insert(node->right, data);
+    }
+    return _ver_rebalance(node);
+}
+
+/**
+ * Unlink the minimum node of a subtree
+ *
+ * @param node (i) subtree root, the caller's reference is consumed
+ * @param min  (o) the unlinked node, owned, children cleared
+ * @return new subtree root, owned
+ */
+static bintree_vnode_t*
+_ver_unlink_min(bintree_vnode_t *node, bintree_vnode_t **min)
+{
+    bintree_vnode_t *right = NULL;
+
+    node = _ver_own(node);
+    if (NULL == node->left) {
+        right = node->right;
+        node->right = NULL;
+        *min = node;
+        return right;
+    }
+    node->left = _ver_unlink_min(node->left, min);
+    return _ver_rebalance(node);
+}
+
+/**
+ * Remove one occurrence of data from a subtree known to hold it
+ *
+ * @param node (i) subtree root, the caller's reference is consumed
+ * @param data (i) data to remove
+ * @return new subtree root, owned
+ */
+static bintree_vnode_t*
+_ver_remove(bintree_vnode_t *node, int data)
+{
+    bintree_vnode_t *left = NULL;
+    bintree_vnode_t *right = NULL;
+    bintree_vnode_t *succ = NULL;
+
+    if (data != node->data) {
+        node = _ver_own(node);
+        if (data < node->data) {
+            node->left = _ver_remove(node->left, data);
+        } else {
+            node->right = _ver_remove(node->right, data);
+        }
+        return _ver_rebalance(node);
+    }
+
+    left = _ver_ref(node->left);
+    right = _ver_ref(node->right);
+    _ver_unref(node);
+    if (NULL == left) {
+        return right;
+    }
+    if (NULL == right) {
+        return left;
+    }
+    right = _ver_unlink_min(right, &succ);
+    succ->left = left;
+    succ->right = right;
+    return _ver_rebalance(succ);
+}
+
+/**
+ * Search a subtree
+ *
+ * @param node (i) subtree root
+ * @param data (i) data to find
+ * @return 1 if found, else 0
+ */
+static int
+_ver_search(const bintree_vnode_t *node, int data)
+{
+    while (NULL != node) {
+        if (data == node->data) {
+            return 1;
+        }
+        node = (data < node->data) ? node->left : node->right;
+    }
+    return 0;
+}
+
+/**
+ * In-order walk of a subtree
+ *
+ * @param node (i) subtree root
+ * @param fn   (i) callback, non-zero return stops the walk
+ * @param ctx  (i) passed to fn
+ * @param cnt  (i/o) keys passed to fn so far
+ * @return non-zero if fn stopped the walk
+ */
+static int
+_ver_foreach(const bintree_vnode_t *node, int (*fn)(int data, void *ctx),
+             void *ctx, int *cnt)
+{
+    if (NULL == node) {
+        return 0;
+    }
+    return _ver_foreach(node->left, fn, ctx, cnt) ||
+           ((*cnt)++, fn(node->data, ctx)) ||
+           _ver_foreach(node->right, fn, ctx, cnt);
+}
+
+/**
+ * Wrap a new root in a version handle
+ *
+ * @param parent (i) version it was derived from, NULL for a new tree
+ * @param name   (i) name for the version
+ * @param root   (i) root, the caller's reference moves to the handle
+ * @return BintreeVerPtr with one reference
+ */
+static BintreeVerPtr
+_ver_wrap(const bintree_ver_t *parent, const char *name, bintree_vnode_t *root)
+{
+    BintreeVerPtr verp = (bintree_ver_t*)malloc(sizeof(*verp));
+    assert(NULL != verp);
+
+    verp->magic = BINTREE_VER_MAGIC_IN_USE;
+    verp->refcnt = 1;
+    verp->number = (NULL == parent) ? 0 : parent->number + 1;
+    snprintf(verp->name, sizeof(verp->name), "%s", name);
+    verp->root = root;
+    return verp;
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Create an empty versioned tree, version 0
+ *
+ * Note - allocs mem, caller must call bintree_ver_release()
+ *
+ * @param name (i) name for the tree, kept by every derived version
+ * @return BintreeVerPtr
+ */
+BintreeVerPtr
+bintree_ver_create(const char *name)
+{
+    assert(NULL != name);
+
+    return _ver_wrap(NULL, name, NULL);
+}
+
+/**
+ * Take another reference to a version, e.g. to hand a snapshot to a
+ * reader.  O(1), nothing is copied.
+ *
+ * @param verp (i) version
+ * @return verp, to be released separately
+ */
+BintreeVerPtr
+bintree_ver_retain(BintreeVerPtr verp)
+{
+    assert(NULL != verp);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    __atomic_add_fetch(&verp->refcnt, 1, __ATOMIC_RELAXED);
+out:
+    return verp;
+}
+
+/**
+ * Drop a reference to a version; the last one frees it along with the
+ * nodes no other version shares
+ *
+ * @param verp (i) version
+ * @return void
+ */
+void
+bintree_ver_release(BintreeVerPtr verp)
+{
+    assert(NULL != verp);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    if (0 == __atomic_sub_fetch(&verp->refcnt, 1, __ATOMIC_ACQ_REL)) {
+        _ver_unref(verp->root);
+        verp->magic = BINTREE_VER_MAGIC_FREED;
+        free(verp);
+    }
+out:
+    return;
+}
+
+/**
+ * Derive a version with data added
+ *
+ * Note - allocs mem for the new version, caller must release it
+ *
+ * @param verp (i) version to start from, unchanged
+ * @param data (i) data to add, duplicates allowed
+ * @return new version
+ */
+BintreeVerPtr
+bintree_ver_insert(BintreeVerPtr verp, int data)
+{
+    assert(NULL != verp);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    return _ver_wrap(verp, verp->name, _ver_insert(_ver_ref(verp->root), data));
+out:
+    return NULL;
+}
+
+/**
+ * Derive a version with one occurrence of data removed
+ *
+ * If data is not there the new version shares the whole tree.
+ *
+ * Note - allocs mem for the new version, caller must release it
+ *
+ * @param verp (i) version to start from, unchanged
+ * @param data (i) data to remove
+ * @return new version
+ */
+BintreeVerPtr
+bintree_ver_remove(BintreeVerPtr verp, int data)
+{
+    bintree_vnode_t *root = NULL;
+
+    assert(NULL != verp);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    root = _ver_ref(verp->root);
+    if (_ver_search(root, data)) {
+        root = _ver_remove(root, data);
+    } else {
+        logger(dbgWarn, "Data %i not found in version %li", data, verp->number);
+    }
+    return _ver_wrap(verp, verp->name, root);
+out:
+    return NULL;
+}
+
+/**
+ * Search a version
+ *
+ * @param verp (i) version
+ * @param data (i) data to find
+ * @return 1 if found, else 0
+ */
+int
+bintree_ver_search(BintreeVerPtr verp, int data)
+{
+    assert(NULL != verp);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    return _ver_search(verp->root, data);
+out:
+    return 0;
+}
+
+/**
+ * Number of keys in a version, O(1)
+ *
+ * @param verp (i) version
+ * @return key count
+ */
+int
+bintree_ver_count(BintreeVerPtr verp)
+{
+    assert(NULL != verp);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    return _ver_size(verp->root);
+out:
+    return 0;
+}
+
+/**
+ * Version number: 0 for a new tree, one more than the version it was
+ * derived from for every insert or remove
+ *
+ * @param verp (i) version
+ * @return version number
+ */
+long
+bintree_ver_number(BintreeVerPtr verp)
+{
+    assert(NULL != verp);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    return verp->number;
+out:
+    return -1;
+}
+
+/**
+ * Call fn for every key of a version in ascending order
+ *
+ * @param verp (i) version
+ * @param fn   (i) callback, non-zero return stops the walk
+ * @param ctx  (i) passed to fn
+ * @return number of keys passed to fn
+ */
+int
+bintree_ver_foreach(BintreeVerPtr verp, int (*fn)(int data, void *ctx),
+                    void *ctx)
+{
+    int cnt = 0;
+
+    assert(NULL != verp);
+    assert(NULL != fn);
+    VER_MAGIC_IN_USE_CHECK(verp->magic);
+
+    _ver_foreach(verp->root, fn, ctx, &cnt);
+out:
+    return cnt;
+}
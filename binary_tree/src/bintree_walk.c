@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "bintree_ext.h"
+#include "bintree_int.h"
+#include "logger.h"
+
+/*
+ * Callback traversals for bintree
+ *
+ * Unlike bintree_preorder() and friends these hand each key to a
+ * callback instead of the logger, can be stopped early, and never
+ * recurse over pointer trees: a degenerate tree is as safe to walk as a
+ * balanced one.
+ *
+ * Pointer trees use an explicit stack, like the iterator, kept in a
+ * small inline array until a deep tree moves it to the heap.  Threading
+ * the tree Morris-style would save that memory but writes to nodes
+ * during a read, which concurrent-mode readers (and any two readers of
+ * one plain tree) cannot allow.  Stack use is bounded by the depth:
+ * in-order holds the pending left spine, pre-order only the pending
+ * right children, so a right-leaning chain walks in O(1) space either
+ * way; post-order holds the whole current path.
+ *
+ * B-tree and frozen trees are shallow and keep their recursive walks.
+ * A bintreeMultiset node is visited once per copy of its key.
+ */
+
+#define WALK_INLINE 64
+
+typedef struct walk_stack_s {
+    int top;
+    int cap;
+    bintreenode_t **slot;
+    bintreenode_t *inline_slot[WALK_INLINE];
+} walk_stack_t;
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Push a node, moving the stack to the heap once it outgrows the
+ * inline array
+ *
+ * @param st   (i/o) stack
+ * @param node (i) node to push
+ * @return void
+ */
+static inline void
+_walk_push(walk_stack_t *st, bintreenode_t *node)
+{
+    if (st->top == st->cap) {
+        bintreenode_t **grown = NULL;
+        st->cap *= 2;
+        if (st->slot == st->inline_slot) {
+            grown = (bintreenode_t**)malloc(st->cap * sizeof(*grown));
+            assert(NULL != grown);
+            memcpy(grown, st->inline_slot, sizeof(st->inline_slot));
+        } else {
+            grown = (bintreenode_t**)realloc(st->slot, st->cap * sizeof(*grown));
+            assert(NULL != grown);
+        }
+        st->slot = grown;
+    }
+    st->slot[st->top++] = node;
+}
+
+/**
+ * Pass a node's key to fn once per copy
+ *
+ * @param node    (i) node
+ * @param fn      (i) callback
+ * @param ctx     (i) passed to fn
+ * @param visited (i/o) keys passed to fn so far
+ * @return non-zero if fn asked to stop
+ */
+static inline int
+_walk_visit(bintreenode_t *node, int (*fn)(int data, void *ctx), void *ctx,
+            int *visited)
+{
+    int i = 0;
+
+    for (i = 0; i < node->count; i++) {
+        (*visited)++;
+        if (0 != fn(node->data, ctx)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Pre-order walk of a pointer tree
+ *
+ * @param st   (i/o) empty stack
+ * @param node (i) root node
+ * @param fn   (i) callback
+ * @param ctx  (i) passed to fn
+ * @return number of keys passed to fn
+ */
+static int
+_walk_preorder(walk_stack_t *st, bintreenode_t *node,
+               int (*fn)(int data, void *ctx), void *ctx)
+{
+    int visited = 0;
+
+    for (;;) {
+        while (NULL != node) {
+            if (_walk_visit(node, fn, ctx, &visited)) {
+                return visited;
+            }
+            if (NULL != node->right) {
+                _walk_push(st, node->right);
+            }
+            node = node->left;
+        }
+        if (0 == st->top) {
+            return visited;
+        }
+        node = st->slot[--st->top];
+    }
+}
+
+/**
+ * In-order walk of a pointer tree
+ *
+ * @param st   (i/o) empty stack
+ * @param node (i) root node
+ * @param fn   (i) callback
+ * @param ctx  (i) passed to fn
+ * @return number of keys passed to fn
+ */
+static int
+_walk_inorder(walk_stack_t *st, bintreenode_t *node,
+              int (*fn)(int data, void *ctx), void *ctx)
+{
+    int visited = 0;
+
+    for (;;) {
+        while (NULL != node) {
+            _walk_push(st, node);
+            node = node->left;
+        }
+        if (0 == st->top) {
+            return visited;
+        }
+        node = st->slot[--st->top];
+        if (_walk_visit(node, fn, ctx, &visited)) {
+            return visited;
+        }
+        node = node->right;
+    }
+}
+
+/**
+ * Post-order walk of a pointer tree
+ *
+ * Algorithm: the stack holds the path to the current node; a node is
+ *            visited when its right subtree is empty or was the last
+ *            thing visited
+ *
+ * @param st   (i/o) empty stack
+ * @param node (i) root node
+ * @param fn   (i) callback
+ * @param ctx  (i) passed to fn
+ * @return number of keys passed to fn
+ */
+static int
+_walk_postorder(walk_stack_t *st, bintreenode_t *node,
+                int (*fn)(int data, void *ctx), void *ctx)
+{
+    bintreenode_t *last = NULL;
+    int visited = 0;
+
+    for (;;) {
+        while (NULL != node) {
+            _walk_push(st, node);
+            node = node->left;
+        }
+        if (0 == st->top) {
+            return visited;
+        }
+        node = st->slot[st->top - 1];
+        if (NULL != node->right && last != node->right) {
+            node = node->right;
+            continue;
+        }
+        st->top--;
+        if (_walk_visit(node, fn, ctx, &visited)) {
+            return visited;
+        }
+        last = node;
+        node = NULL;
+    }
+}
+
+/**
+ * Walk a tree of any mode in the given order
+ *
+ * @param bintreep (i) binary tree
+ * @param order    (i) traversal order
+ * @param fn       (i) callback
+ * @param ctx      (i) passed to fn
+ * @return number of keys passed to fn
+ */
+static int
+_bintree_walk(bintree_t *bintreep, bintree_order_e order,
+              int (*fn)(int data, void *ctx), void *ctx)
+{
+    walk_stack_t st;
+    bintreenode_t *root = NULL;
+    int visited = 0;
+
+    switch (bintreep->mode) {
+    case bintreeBtree:
+        return _bintree_btree_walk(bintreep->broot, order, fn, ctx);
+    case bintreeFrozen:
+        return _bintree_frozen_walk(bintreep->eytz, bintreep->nkeys, order, fn, ctx);
+    default:
+        break;
+    }
+
+    st.top = 0;
+    st.cap = WALK_INLINE;
+    st.slot = st.inline_slot;
+    root = _bintree_read_enter(bintreep);
+    switch (order) {
+    case bintreePreorder:
+        visited = _walk_preorder(&st, root, fn, ctx);
+        break;
+    case bintreeInorder:
+        visited = _walk_inorder(&st, root, fn, ctx);
+        break;
+    default:
+        visited = _walk_postorder(&st, root, fn, ctx);
+        break;
+    }
+    _bintree_read_exit(bintreep);
+    if (st.slot != st.inline_slot) {
+        free(st.slot);
+    }
+    return visited;
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Call fn for every key in pre-order (parent, left, right)
+ *
+ * fn returns 0 to keep going, anything else to stop after the current
+ * key.  fn must not modify the tree.
+ *
+ * @param bintreep (i) binary tree
+ * @param fn       (i) callback, gets the key and ctx
+ * @param ctx      (i) opaque user context passed to fn
+ * @return number of keys passed to fn
+ */
+int
+bintree_preorder_foreach(BintreePtr bintreep, int (*fn)(int data, void *ctx),
+                         void *ctx)
+{
+    assert(NULL != bintreep);
+    assert(NULL != fn);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    return _bintree_walk(bintreep, bintreePreorder, fn, ctx);
+out:
+    return 0;
+}
+
+/**
+ * Call fn for every key in-order (ascending), see
+ * bintree_preorder_foreach()
+ *
+ * @param bintreep (i) binary tree
+ * @param fn       (i) callback, gets the key and ctx
+ * @param ctx      (i) opaque user context passed to fn
+ * @return number of keys passed to fn
+ */
+int
+bintree_inorder_foreach(BintreePtr bintreep, int (*fn)(int data, void *ctx),
+                        void *ctx)
+{
+    assert(NULL != bintreep);
+    assert(NULL != fn);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    return _bintree_walk(bintreep, bintreeInorder, fn, ctx);
+out:
+    return 0;
+}
+
+/**
+ * Call fn for every key in post-order (left, right, parent), see
+ * bintree_preorder_foreach()
+ *
+ * @param bintreep (i) binary tree
+ * @param fn       (i) callback, gets the key and ctx
+ * @param ctx      (i) opaque user context passed to fn
+ * @return number of keys passed to fn
+ */
+int
+bintree_postorder_foreach(BintreePtr bintreep, int (*fn)(int data, void *ctx),
+                          void *ctx)
+{
+    assert(NULL != bintreep);
+    assert(NULL != fn);
+    MAGIC_IN_USE_CHECK(bintreep->magic);
+
+    return _bintree_walk(bintreep, bintreePostorder, fn, ctx);
+out:
+    return 0;
+}
@@ -1,9 +1,21 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <glob.h>
 #include "test.h"
 #include "bintree_ext.h"
+#include "bintree_map_ext.h"
+#include "bintree_map_gen.h"
+#include "bintree_ver_ext.h"
+#include "bintree_compact_ext.h"
 #include "logger.h"
 
+BINTREE_MAP_DEFINE(t16map, int, long, BINTREE_MAP_CMP_NUM)
+
 /**
  * Convenience macro to save a couple lines of code
  */
@@ -290,6 +302,2622 @@ out:
     print_result(passed, test_name);
 }
 
+/** 
+ * Test7: AVL mode, sorted inserts stay balanced across inserts and removes
+ */
+void 
+test7(const char *test_name) {
+    int passed = 1;
+
+    int num_nodes = 1023;     /* perfect tree of depth 10 */
+    int i = 0;
+
+    BintreePtr b = bintree_create_mode(test_name, bintreeAvl);
+
+    /* sorted inserts would degrade a plain tree into a list */
+    for (i = 1; i <= num_nodes; i++) {
+        bintree_insert(b, i);
+    }
+
+    int got_depth = bintree_maxdepth(b);
+    if (10 != got_depth) {
+        logger(dbgErr, "Expected max depth 10, instead got: %i", got_depth);
+        FAIL_TEST;
+    }
+
+    /* remove every other key, including whatever sits at the root */
+    for (i = 1; i <= num_nodes; i += 2) {
+        bintree_remove(b, i);
+    }
+
+    int got_cnt = bintree_count(b);
+    if (num_nodes / 2 != got_cnt) {
+        logger(dbgErr, "Expected tree to have %i nodes, instead has %i",
+                num_nodes / 2, got_cnt);
+        FAIL_TEST;
+    }
+
+    /* 511 nodes, AVL bound 1.44*log2(n) keeps this at most 12 */
+    got_depth = bintree_maxdepth(b);
+    if (got_depth > 12) {
+        logger(dbgErr, "Expected max depth <= 12, instead got: %i", got_depth);
+        FAIL_TEST;
+    }
+
+    for (i = 1; i <= num_nodes; i++) {
+        if ((i % 2 == 0) != bintree_search(b, i)) {
+            logger(dbgErr, "Wrong search result for %i", i);
+            FAIL_TEST;
+        }
+    }
+
+    if (2 != bintree_minvalue(b) || 1022 != bintree_maxvalue(b)) {
+        logger(dbgErr, "Expected min 2, max 1022, got %i, %i",
+                bintree_minvalue(b), bintree_maxvalue(b));
+        FAIL_TEST;
+    }
+
+    /* cleanup */
+    bintree_destroy(b);
+    goto out;
+out:
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test8: plain tree removes at the root (two children, one child, leaf),
+ *        duplicates, and a long sorted chain
+ */
+void 
+test8(const char *test_name) {
+    int passed = 1;
+
+    int tree_nodes[] = {8, 5, 11, 3, 9, 13, 7, 8};
+    int num_nodes = sizeof(tree_nodes) / sizeof(tree_nodes[0]);
+    int chain_len = 5000;
+    int i = 0;
+
+    BintreePtr b = bintree_create(test_name);
+    
+    for (i = 0; i < num_nodes; i++) {
+        bintree_insert(b, tree_nodes[i]);
+    }
+
+    /* root 8 has two children, duplicate 8 stays behind */
+    bintree_remove(b, 8);
+    if (1 != bintree_search(b, 8) || (num_nodes - 1) != bintree_count(b)) {
+        logger(dbgErr, "Expected one copy of 8 and %i nodes", num_nodes - 1);
+        FAIL_TEST;
+    }
+    bintree_remove(b, 8);
+    if (0 != bintree_search(b, 8) || (num_nodes - 2) != bintree_count(b)) {
+        logger(dbgErr, "Expected no 8 and %i nodes", num_nodes - 2);
+        FAIL_TEST;
+    }
+
+    /* drain from the root down, whatever shape it has */
+    int drain[] = {9, 11, 13, 5, 3, 7};
+    for (i = 0; i < sizeof(drain) / sizeof(drain[0]); i++) {
+        bintree_remove(b, drain[i]);
+        if (0 != bintree_search(b, drain[i])) {
+            logger(dbgErr, "Removed %i but still found it", drain[i]);
+            FAIL_TEST;
+        }
+    }
+    if (0 != bintree_count(b)) {
+        logger(dbgErr, "Expected empty tree, has %i nodes", bintree_count(b));
+        FAIL_TEST;
+    }
+
+    /* degenerate chain, the iterative paths must not recurse */
+    for (i = 0; i < chain_len; i++) {
+        bintree_insert(b, i);
+    }
+    if (1 != bintree_search(b, chain_len - 1) || 0 != bintree_search(b, chain_len)) {
+        logger(dbgErr, "Search in sorted chain failed");
+        FAIL_TEST;
+    }
+    bintree_remove(b, chain_len - 1);
+    bintree_remove(b, 0);
+    if (1 != bintree_minvalue(b) || (chain_len - 2) != bintree_maxvalue(b)) {
+        logger(dbgErr, "Expected min 1, max %i", chain_len - 2);
+        FAIL_TEST;
+    }
+
+    /* cleanup */
+    bintree_destroy(b);
+    goto out;
+out:
+    print_result(passed, test_name);
+}
+
+/**
+ * Helper to check a tree against a reference multiplicity array
+ *
+ * @param b      (i) tree to check
+ * @param ref    (i) ref[k] = number of copies of key k expected
+ * @param range  (i) keys are 0..range-1
+ * @return 1 if tree matches, 0 else
+ */
+static int
+_bintree_verify_ref(BintreePtr b, const int *ref, int range)
+{
+    int k = 0, cnt = 0, min = -1, max = -1;
+
+    for (k = 0; k < range; k++) {
+        if ((ref[k] > 0) != bintree_search(b, k)) {
+            logger(dbgErr, "Key %i: expected %i copies, search says %i",
+                    k, ref[k], bintree_search(b, k));
+            return 0;
+        }
+        if (ref[k] > 0) {
+            cnt += ref[k];
+            if (min < 0) {
+                min = k;
+            }
+            max = k;
+        }
+    }
+    if (cnt != bintree_count(b)) {
+        logger(dbgErr, "Expected %i nodes, tree has %i", cnt, bintree_count(b));
+        return 0;
+    }
+    if (cnt > 0 && (min != bintree_minvalue(b) || max != bintree_maxvalue(b))) {
+        logger(dbgErr, "Expected min %i max %i, got %i %i", min, max,
+                bintree_minvalue(b), bintree_maxvalue(b));
+        return 0;
+    }
+    return 1;
+}
+
+/** 
+ * Test9: random insert/remove mix, with duplicates, in every mode,
+ *        checked against a reference count array
+ */
+void 
+test9(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int range = 600;
+    int ref[600];
+    int m = 0, i = 0;
+    unsigned int seed = 12345;
+
+    for (m = 0; m < num_modes; m++) {
+        BintreePtr b = bintree_create_mode(test_name, modes[m]);
+        memset(ref, 0, sizeof(ref));
+
+        for (i = 0; i < 20000; i++) {
+            int k = rand_r(&seed) % range;
+            /* bias towards inserts early, removes late */
+            if (rand_r(&seed) % 20000 > i) {
+                bintree_insert(b, k);
+                ref[k]++;
+            } else {
+                bintree_remove(b, k);
+                if (ref[k] > 0) {
+                    ref[k]--;
+                }
+            }
+            if (0 == i % 1000 && !_bintree_verify_ref(b, ref, range)) {
+                logger(dbgErr, "Mode %i diverged at op %i", modes[m], i);
+                bintree_destroy(b);
+                FAIL_TEST;
+            }
+        }
+
+        /* drain everything that is left */
+        for (i = 0; i < range; i++) {
+            while (ref[i] > 0) {
+                bintree_remove(b, i);
+                ref[i]--;
+            }
+        }
+        if (!_bintree_verify_ref(b, ref, range) || 0 != bintree_count(b)) {
+            logger(dbgErr, "Mode %i not empty after drain", modes[m]);
+            bintree_destroy(b);
+            FAIL_TEST;
+        }
+
+        /* cleanup */
+        bintree_destroy(b);
+    }
+    goto out;
+out:
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test10: freeze trees of every mode, verify lookups (single and batched),
+ *         count/min/max/depth, and that the frozen copy rejects updates
+ */
+void 
+test10(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int range = 1000;
+    int ref[1000];
+    int probe[1000];
+    uint8_t found[1000];
+    int m = 0, i = 0;
+    unsigned int seed = 777;
+
+    for (m = 0; m < num_modes; m++) {
+        BintreePtr b = bintree_create_mode(test_name, modes[m]);
+        memset(ref, 0, sizeof(ref));
+
+        /* 700 random keys with duplicates, odd count exercises a partial
+         * last level and a partial last batch */
+        for (i = 0; i < 700; i++) {
+            int k = rand_r(&seed) % range;
+            bintree_insert(b, k);
+            ref[k]++;
+        }
+        BintreePtr f = bintree_freeze(b);
+
+        if (!_bintree_verify_ref(f, ref, range)) {
+            logger(dbgErr, "Frozen copy of mode %i differs from source", modes[m]);
+            FAIL_TEST;
+        }
+        /* complete tree on 700 keys has 10 levels */
+        if (10 != bintree_maxdepth(f)) {
+            logger(dbgErr, "Expected frozen depth 10, got %i", bintree_maxdepth(f));
+            FAIL_TEST;
+        }
+
+        for (i = 0; i < range; i++) {
+            probe[i] = range - 1 - i;
+        }
+        bintree_search_many(f, probe, range, found);
+        for (i = 0; i < range; i++) {
+            if ((ref[probe[i]] > 0) != found[i]) {
+                logger(dbgErr, "search_many wrong for %i", probe[i]);
+                FAIL_TEST;
+            }
+        }
+
+        /* updates are rejected, source tree is untouched */
+        bintree_insert(f, range + 1);
+        bintree_remove(f, probe[0]);
+        if (700 != bintree_count(f) || 700 != bintree_count(b)) {
+            logger(dbgErr, "Expected 700 keys in both trees");
+            FAIL_TEST;
+        }
+
+        /* cleanup */
+        bintree_destroy(f);
+        bintree_destroy(b);
+    }
+
+    /* freezing an empty tree gives an empty frozen tree */
+    BintreePtr e = bintree_create(test_name);
+    BintreePtr fe = bintree_freeze(e);
+    if (0 != bintree_count(fe) || 0 != bintree_search(fe, 0)) {
+        logger(dbgErr, "Expected empty frozen tree");
+        FAIL_TEST;
+    }
+    bintree_destroy(fe);
+    bintree_destroy(e);
+    goto out;
+out:
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test11: bulk-load from a sorted array, round-trip back to an array,
+ *         then keep updating the bulk-loaded tree
+ */
+void 
+test11(const char *test_name) {
+    int passed = 1;
+
+    int range = 600;
+    int ref[600];
+    int keys[1000];
+    int out[1100];
+    int num_keys = sizeof(keys) / sizeof(keys[0]);
+    int i = 0;
+
+    memset(ref, 0, sizeof(ref));
+    for (i = 0; i < num_keys; i++) {
+        keys[i] = (i * 3) / 5;        /* ascending, with duplicates */
+        ref[keys[i]]++;
+    }
+
+    BintreePtr b = bintree_build_sorted(test_name, keys, num_keys);
+    if (!_bintree_verify_ref(b, ref, range)) {
+        FAIL_TEST;
+    }
+    /* perfectly balanced: ceil(log2(1000 + 1)) */
+    if (10 != bintree_maxdepth(b)) {
+        logger(dbgErr, "Expected depth 10, got %i", bintree_maxdepth(b));
+        FAIL_TEST;
+    }
+
+    int got_cnt = bintree_to_sorted_array(b, out);
+    if (num_keys != got_cnt || 0 != memcmp(keys, out, sizeof(keys))) {
+        logger(dbgErr, "Sorted array round trip mismatch");
+        FAIL_TEST;
+    }
+
+    /* remove block nodes, insert fresh ones, tree stays balanced */
+    for (i = 0; i < num_keys; i += 2) {
+        bintree_remove(b, keys[i]);
+        ref[keys[i]]--;
+    }
+    for (i = 0; i < 100; i++) {
+        bintree_insert(b, i);
+        ref[i]++;
+    }
+    if (!_bintree_verify_ref(b, ref, range)) {
+        FAIL_TEST;
+    }
+    if (bintree_maxdepth(b) > 12) {
+        logger(dbgErr, "Expected depth <= 12, got %i", bintree_maxdepth(b));
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+
+    /* unsorted input is rejected */
+    keys[10] = 9999;
+    if (NULL != bintree_build_sorted(test_name, keys, num_keys)) {
+        logger(dbgErr, "Expected unsorted input to be rejected");
+        FAIL_TEST;
+    }
+
+    /* empty input gives an empty tree */
+    b = bintree_build_sorted(test_name, keys, 0);
+    if (0 != bintree_count(b)) {
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+    goto out;
+out:
+    print_result(passed, test_name);
+}
+
+/**
+ * Range callback for test12: append key to a bounded array, stop when full
+ */
+typedef struct range_ctx_s {
+    int *out;
+    int cnt;
+    int max;
+} range_ctx_t;
+
+static int
+_range_collect(int data, void *ctx)
+{
+    range_ctx_t *rc = (range_ctx_t*)ctx;
+    rc->out[rc->cnt++] = data;
+    return (rc->cnt == rc->max);
+}
+
+/** 
+ * Test12: lower bound, range scans and iterators in every mode (and on a
+ *         degenerate plain tree deeper than the iterator's inline stack),
+ *         checked against a sorted reference
+ */
+void 
+test12(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree, bintreeFrozen};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int range = 600;
+    int sorted[2000];
+    int out[2000];
+    int n = 0, m = 0, i = 0, lo = 0, hi = 0, got = 0;
+    unsigned int seed = 777;
+    BintreePtr b = NULL;
+
+    for (m = 0; m < num_modes; m++) {
+        int ref[600];
+        memset(ref, 0, sizeof(ref));
+        b = bintree_create_mode(test_name, bintreeFrozen == modes[m] ?
+                                bintreeAvl : modes[m]);
+        for (i = 0; i < 1500; i++) {
+            int k = rand_r(&seed) % range;
+            bintree_insert(b, k);
+            ref[k]++;
+        }
+        if (bintreeFrozen == modes[m]) {
+            BintreePtr f = bintree_freeze(b);
+            bintree_destroy(b);
+            b = f;
+        }
+        for (n = 0, i = 0; i < range; i++) {
+            for (got = 0; got < ref[i]; got++) {
+                sorted[n++] = i;
+            }
+        }
+
+        /* lower bound for every probe, including past both ends */
+        for (lo = -2, i = 0; lo < range + 2; lo++) {
+            int want = 0, res = -1;
+            while (i < n && sorted[i] < lo) {
+                i++;
+            }
+            want = (i < n);
+            if (want != bintree_lower_bound(b, lo, &res) ||
+                (want && sorted[i] != res)) {
+                logger(dbgErr, "Mode %i lower_bound(%i) wrong", modes[m], lo);
+                FAIL_TEST;
+            }
+        }
+
+        /* range scans of assorted widths, including empty and inverted */
+        for (i = 0; i < 200; i++) {
+            range_ctx_t rc = {out, 0, n + 1};
+            int first = 0, last = 0;
+            lo = rand_r(&seed) % (range + 20) - 10;
+            hi = lo + rand_r(&seed) % (1 + (i % 4) * 100) - 5;
+            while (first < n && sorted[first] < lo) {
+                first++;
+            }
+            for (last = first; last < n && sorted[last] <= hi; last++);
+            got = bintree_range_foreach(b, lo, hi, _range_collect, &rc);
+            if (got != last - first || rc.cnt != got ||
+                0 != memcmp(out, sorted + first, got * sizeof(int))) {
+                logger(dbgErr, "Mode %i range [%i, %i] wrong", modes[m], lo, hi);
+                FAIL_TEST;
+            }
+        }
+
+        /* early stop after 7 keys */
+        range_ctx_t rc = {out, 0, 7};
+        if (7 != bintree_range_foreach(b, 0, range, _range_collect, &rc) ||
+            0 != memcmp(out, sorted, 7 * sizeof(int))) {
+            logger(dbgErr, "Mode %i early stop wrong", modes[m]);
+            FAIL_TEST;
+        }
+
+        /* full walk through the public iterator */
+        BintreeIterPtr it = bintree_iter_create(b, -1000);
+        for (got = 0; bintree_iter_next(it, &out[got]); got++);
+        bintree_iter_destroy(it);
+        if (got != n || 0 != memcmp(out, sorted, n * sizeof(int))) {
+            logger(dbgErr, "Mode %i iterator walk wrong", modes[m]);
+            FAIL_TEST;
+        }
+        bintree_destroy(b);
+        b = NULL;
+    }
+
+    /* degenerate chain, iterator stack has to leave its inline buffer */
+    b = bintree_create(test_name);
+    for (i = 0; i < 1000; i++) {
+        bintree_insert(b, 1000 - i);
+    }
+    BintreeIterPtr it = bintree_iter_create(b, 500);
+    for (got = 0; bintree_iter_next(it, &lo); got++) {
+        if (lo != 500 + got) {
+            break;
+        }
+    }
+    bintree_iter_destroy(it);
+    if (501 != got) {
+        logger(dbgErr, "Expected 501 keys from chain, got %i", got);
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    print_result(passed, test_name);
+}
+
+/**
+ * Helper to check count, rank and select of a tree against a reference
+ * count array
+ *
+ * @param b      (i) tree to check
+ * @param ref    (i) ref[k] = number of copies of key k expected
+ * @param range  (i) keys are 0..range-1
+ * @return 1 if tree matches, 0 else
+ */
+static int
+_bintree_verify_order(BintreePtr b, const int *ref, int range)
+{
+    int k = 0, c = 0, below = 0, got = -1;
+
+    for (k = 0; k <= range; k++) {
+        if (below != bintree_rank(b, k)) {
+            logger(dbgErr, "rank(%i): expected %i, got %i", k, below,
+                    bintree_rank(b, k));
+            return 0;
+        }
+        for (c = 0; k < range && c < ref[k]; c++) {
+            if (!bintree_select(b, below + c, &got) || k != got) {
+                logger(dbgErr, "select(%i): expected %i, got %i", below + c,
+                        k, got);
+                return 0;
+            }
+        }
+        below += (k < range) ? ref[k] : 0;
+    }
+    if (below != bintree_count(b) || bintree_select(b, below, &got) ||
+        bintree_select(b, -1, &got)) {
+        logger(dbgErr, "count %i or out-of-range select wrong", below);
+        return 0;
+    }
+    return 1;
+}
+
+/** 
+ * Test13: subtree sizes stay right through random inserts and removes
+ *         (plain, AVL, bulk-loaded and frozen trees), checked through
+ *         count, rank and select
+ */
+void 
+test13(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int range = 300;
+    int ref[300];
+    int keys[900];
+    int m = 0, i = 0;
+    unsigned int seed = 4242;
+    BintreePtr b = NULL, f = NULL;
+
+    for (m = 0; m <= num_modes; m++) {
+        memset(ref, 0, sizeof(ref));
+        if (m < num_modes) {
+            b = bintree_create_mode(test_name, modes[m]);
+        } else {
+            /* bulk-loaded: sizes come from the build, then from updates */
+            for (i = 0; i < 900; i++) {
+                keys[i] = i / 3;
+                ref[keys[i]]++;
+            }
+            b = bintree_build_sorted(test_name, keys, 900);
+        }
+        for (i = 0; i < 6000; i++) {
+            int k = rand_r(&seed) % range;
+            if (rand_r(&seed) % 6000 > i) {
+                bintree_insert(b, k);
+                ref[k]++;
+            } else {
+                bintree_remove(b, k);
+                if (ref[k] > 0) {
+                    ref[k]--;
+                }
+            }
+            if (0 == i % 500 && !_bintree_verify_order(b, ref, range)) {
+                logger(dbgErr, "Pass %i diverged at op %i", m, i);
+                FAIL_TEST;
+            }
+        }
+        f = bintree_freeze(b);
+        if (!_bintree_verify_order(f, ref, range)) {
+            logger(dbgErr, "Pass %i frozen copy wrong", m);
+            FAIL_TEST;
+        }
+        bintree_destroy(f);
+        bintree_destroy(b);
+        f = b = NULL;
+    }
+    goto out;
+out:
+    if (NULL != f) {
+        bintree_destroy(f);
+    }
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    print_result(passed, test_name);
+}
+
+/* Shared state for test14's reader and writer threads */
+#define T14_KEYS    2000
+#define T14_READERS 3
+
+typedef struct t14_ctx_s {
+    BintreePtr b;
+    int stop;
+    int errors;
+    unsigned int seed;
+} t14_ctx_t;
+
+/**
+ * Range callback for test14: keys must not descend, every even key must
+ * show up
+ */
+static int
+_t14_check(int data, void *ctx)
+{
+    int *expect = (int*)ctx;
+    int next_even = *expect + (*expect % 2);
+    /* odd keys may be inserted more than once */
+    if (data < *expect - 1 || data > next_even) {
+        *expect = -1;
+        return 1;
+    }
+    *expect = data + 1;
+    return 0;
+}
+
+/**
+ * Reader thread for test14: even keys are never removed, so they must
+ * always be found, whatever the writer is doing to the odd ones
+ */
+static void*
+_t14_reader(void *arg)
+{
+    t14_ctx_t *ctx = (t14_ctx_t*)arg;
+    unsigned int seed = ctx->seed;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_ACQUIRE)) {
+        int k = 2 * (rand_r(&seed) % T14_KEYS);
+        int lo = 2 * (rand_r(&seed) % (T14_KEYS - 50));
+        int expect = lo;
+        if (!bintree_search(ctx->b, k) || 0 != bintree_minvalue(ctx->b)) {
+            __atomic_add_fetch(&ctx->errors, 1, __ATOMIC_RELAXED);
+        }
+        bintree_range_foreach(ctx->b, lo, lo + 99, _t14_check, &expect);
+        if (expect < 0) {
+            __atomic_add_fetch(&ctx->errors, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/** 
+ * Test14: concurrent mode, first single-threaded against a reference,
+ *         then lock-free readers running while a writer churns odd keys
+ */
+void 
+test14(const char *test_name) {
+    int passed = 1;
+
+    int range = 600;
+    int ref[600];
+    int i = 0;
+    unsigned int seed = 1414;
+    BintreePtr b = bintree_create_mode(test_name, bintreeConcurrent);
+    pthread_t readers[T14_READERS];
+    t14_ctx_t ctx[T14_READERS];
+
+    memset(ref, 0, sizeof(ref));
+    for (i = 0; i < 20000; i++) {
+        int k = rand_r(&seed) % range;
+        if (rand_r(&seed) % 20000 > i) {
+            bintree_insert(b, k);
+            ref[k]++;
+        } else {
+            bintree_remove(b, k);
+            if (ref[k] > 0) {
+                ref[k]--;
+            }
+        }
+        if (0 == i % 1000 && (!_bintree_verify_ref(b, ref, range) ||
+                              !_bintree_verify_order(b, ref, range))) {
+            logger(dbgErr, "Concurrent mode diverged at op %i", i);
+            FAIL_TEST;
+        }
+    }
+    bintree_destroy(b);
+
+    b = bintree_create_mode(test_name, bintreeConcurrent);
+    for (i = 0; i < T14_KEYS; i++) {
+        bintree_insert(b, 2 * i);
+    }
+    for (i = 0; i < T14_READERS; i++) {
+        ctx[i].b = b;
+        ctx[i].stop = 0;
+        ctx[i].errors = 0;
+        ctx[i].seed = 100 + i;
+        pthread_create(&readers[i], NULL, _t14_reader, &ctx[i]);
+    }
+    for (i = 0; i < 100000; i++) {
+        int k = 2 * (rand_r(&seed) % T14_KEYS) + 1;
+        if (rand_r(&seed) % 2) {
+            bintree_insert(b, k);
+        } else if (bintree_search(b, k)) {
+            bintree_remove(b, k);
+        }
+    }
+    for (i = 0; i < T14_READERS; i++) {
+        __atomic_store_n(&ctx[i].stop, 1, __ATOMIC_RELEASE);
+        pthread_join(readers[i], NULL);
+        if (0 != ctx[i].errors) {
+            logger(dbgErr, "Reader %i saw %i inconsistencies", i, ctx[i].errors);
+            passed = 0;
+        }
+    }
+    for (i = 0; i < T14_KEYS && passed; i++) {
+        if (!bintree_search(b, 2 * i)) {
+            logger(dbgErr, "Key %i lost", 2 * i);
+            passed = 0;
+        }
+    }
+    goto out;
+out:
+    bintree_destroy(b);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test15: nodes from the arena survive chunk growth, removed nodes are
+ *         reused, and trees of every size (bulk-loaded and degenerate
+ *         ones too) are torn down without a walk
+ */
+void 
+test15(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int range = 5000;
+    int ref[5000];
+    int keys[1000];
+    int m = 0, i = 0, round = 0;
+    unsigned int seed = 1515;
+    BintreePtr b = NULL;
+
+    for (m = 0; m <= num_modes; m++) {
+        memset(ref, 0, sizeof(ref));
+        if (m < num_modes) {
+            b = bintree_create_mode(test_name, modes[m]);
+        } else {
+            /* bulk-loaded: one exact chunk, later inserts add more */
+            for (i = 0; i < 1000; i++) {
+                keys[i] = 5 * i;
+                ref[keys[i]]++;
+            }
+            b = bintree_build_sorted(test_name, keys, 1000);
+        }
+        /* fill, drain half, refill: the second fill runs off the freelist */
+        for (round = 0; round < 3; round++) {
+            for (i = 0; i < 4000; i++) {
+                int k = rand_r(&seed) % range;
+                if (1 == round) {
+                    bintree_remove(b, k);
+                    if (ref[k] > 0) {
+                        ref[k]--;
+                    }
+                } else {
+                    bintree_insert(b, k);
+                    ref[k]++;
+                }
+            }
+            if (!_bintree_verify_ref(b, ref, range) ||
+                !_bintree_verify_order(b, ref, range)) {
+                logger(dbgErr, "Pass %i diverged in round %i", m, round);
+                FAIL_TEST;
+            }
+        }
+        bintree_destroy(b);
+        b = NULL;
+    }
+
+    /* a 20000-deep chain */
+    b = bintree_create(test_name);
+    for (i = 0; i < 20000; i++) {
+        bintree_insert(b, i);
+    }
+    if (20000 != bintree_count(b) || 19999 != bintree_maxvalue(b)) {
+        logger(dbgErr, "Degenerate tree wrong");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    print_result(passed, test_name);
+}
+
+/**
+ * Key comparator for test16's callback map, keys point at ints
+ */
+static int
+_t16_cmp(const void *a, const void *b)
+{
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Ordered walk callbacks for test16: keys ascend, values match the key
+ */
+static int
+_t16_walk(const void *key, void *value, void *ctx)
+{
+    int *prev = (int*)ctx;
+    int k = *(const int*)key;
+    if (k <= *prev || *(long*)value % 1000 != k) {
+        *prev = 1 << 30;
+        return 1;
+    }
+    *prev = k;
+    return 0;
+}
+
+static int
+_t16_walk_gen(int key, long *value, void *ctx)
+{
+    int *prev = (int*)ctx;
+    if (key <= *prev || *value % 1000 != key) {
+        *prev = 1 << 30;
+        return 1;
+    }
+    *prev = key;
+    return 0;
+}
+
+/** 
+ * Test16: key/value maps, callback and macro-generated, against a
+ *         reference table through random put/update/find/erase
+ */
+void 
+test16(const char *test_name) {
+    int passed = 1;
+
+    int range = 1000;
+    int keys[1000];
+    long ref[1000];             /* 0 = absent */
+    long vals[1000];            /* callback map values point in here */
+    int live = 0, prev = 0;
+    int i = 0, op = 0;
+    unsigned int seed = 1616;
+    BintreeMapPtr m = bintree_map_create(test_name, _t16_cmp);
+    t16map_t *g = t16map_create();
+
+    for (i = 0; i < range; i++) {
+        keys[i] = i;
+        ref[i] = 0;
+    }
+    for (op = 1; op <= 20000; op++) {
+        int k = rand_r(&seed) % range;
+        long v = (long)op * 1000 + k;
+        if (rand_r(&seed) % 3) {
+            int fresh = (0 == ref[k]);
+            vals[k] = v;
+            if (fresh != bintree_map_put(m, &keys[k], &vals[k]) ||
+                fresh != t16map_put(g, k, v)) {
+                logger(dbgErr, "put %i disagrees on new vs update", k);
+                FAIL_TEST;
+            }
+            live += fresh;
+            ref[k] = v;
+        } else {
+            int had = (0 != ref[k]);
+            if (had != bintree_map_erase(m, &keys[k]) ||
+                had != t16map_erase(g, k)) {
+                logger(dbgErr, "erase %i disagrees", k);
+                FAIL_TEST;
+            }
+            live -= had;
+            ref[k] = 0;
+        }
+
+        k = rand_r(&seed) % range;
+        void **vp = bintree_map_find(m, &keys[k]);
+        long *gp = t16map_find(g, k);
+        if (0 == ref[k]) {
+            if (NULL != vp || NULL != gp) {
+                logger(dbgErr, "Found erased key %i", k);
+                FAIL_TEST;
+            }
+        } else if (NULL == vp || NULL == gp ||
+                   ref[k] != *(long*)*vp || ref[k] != *gp) {
+            logger(dbgErr, "Wrong value for key %i", k);
+            FAIL_TEST;
+        }
+        if (live != bintree_map_count(m) || live != t16map_count(g)) {
+            logger(dbgErr, "Count %i, maps say %i and %i", live,
+                    bintree_map_count(m), t16map_count(g));
+            FAIL_TEST;
+        }
+    }
+
+    /* in-order walks, and the found slot updates in place */
+    prev = -1;
+    if (0 != bintree_map_foreach(m, _t16_walk, &prev) || 1 << 30 == prev) {
+        logger(dbgErr, "Callback map walk out of order");
+        FAIL_TEST;
+    }
+    prev = -1;
+    if (0 != t16map_foreach(g, _t16_walk_gen, &prev) || 1 << 30 == prev) {
+        logger(dbgErr, "Generated map walk out of order");
+        FAIL_TEST;
+    }
+    t16map_put(g, 7, 1);
+    *t16map_find(g, 7) += 41;
+    if (42 != *t16map_find(g, 7)) {
+        logger(dbgErr, "Value slot not writable");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    bintree_map_destroy(m);
+    t16map_destroy(g);
+    print_result(passed, test_name);
+}
+
+typedef struct t17_saver_s {
+    BintreePtr tree;
+    const char *path;
+    int ok;
+} t17_saver_t;
+
+/**
+ * Helper for test17, saves one tree over a shared path again and again
+ */
+static void*
+_t17_saver(void *arg)
+{
+    t17_saver_t *s = (t17_saver_t*)arg;
+    int i = 0;
+
+    s->ok = 1;
+    for (i = 0; i < 40; i++) {
+        s->ok &= bintree_save(s->tree, s->path);
+    }
+    return NULL;
+}
+
+/**
+ * Helper for test17, whether a mapped tree holds exactly keys
+ * start, start + 2, ... of n
+ */
+static int
+_t17_holds(BintreePtr l, int start, int n, int *buf)
+{
+    int i = 0;
+
+    if (n != bintree_count(l) || n != bintree_to_sorted_array(l, buf)) {
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        if (start + 2 * i != buf[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Helper for test17, whether any file matches pattern
+ */
+static int
+_t17_any(const char *pattern)
+{
+    glob_t g;
+    int found = (0 == glob(pattern, 0, NULL, &g));
+
+    if (found) {
+        globfree(&g);
+    }
+    return found;
+}
+
+/** 
+ * Test17: trees of every mode saved and mapped back answer like the
+ *         original; saving over a mapped image leaves the mapping
+ *         readable; two threads saving to one path always leave a whole
+ *         image of one tree; bad images are refused; mapped trees are
+ *         read-only
+ */
+void 
+test17(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree,
+                              bintreeFrozen, bintreeConcurrent};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    char path[] = "/tmp/bintree_test17_XXXXXX";
+    char pattern[sizeof(path) + 2];
+    int want[500], got[500];
+    int *buf = NULL;
+    t17_saver_t savers[2];
+    pthread_t tid[2];
+    int m = 0, i = 0, v = 0, n = 0;
+    unsigned int seed = 1717;
+    BintreePtr b = NULL, f = NULL, l = NULL;
+    FILE *fp = NULL;
+    int fd = mkstemp(path);
+
+    if (fd < 0) {
+        logger(dbgErr, "Cannot create temp file");
+        FAIL_TEST;
+    }
+    close(fd);
+
+    for (m = 0; m < num_modes; m++) {
+        b = bintree_create_mode(test_name, bintreeAvl);
+        for (i = 0; i < 300 + m; i++) {
+            bintree_insert(b, rand_r(&seed) % 1000 - 500);
+        }
+        if (bintreeFrozen == modes[m]) {
+            f = bintree_freeze(b);
+        } else {
+            f = bintree_create_mode(test_name, modes[m]);
+            n = bintree_to_sorted_array(b, want);
+            for (i = 0; i < n; i++) {
+                bintree_insert(f, want[i]);
+            }
+        }
+        if (!bintree_save(f, path) || NULL == (l = bintree_load_mmap(path))) {
+            logger(dbgErr, "Mode %i did not save and load", modes[m]);
+            FAIL_TEST;
+        }
+        n = bintree_to_sorted_array(f, want);
+        if (n != bintree_count(l) || n != bintree_to_sorted_array(l, got) ||
+            0 != memcmp(want, got, n * sizeof(int)) ||
+            bintree_minvalue(f) != bintree_minvalue(l) ||
+            bintree_maxvalue(f) != bintree_maxvalue(l)) {
+            logger(dbgErr, "Mode %i loaded tree differs", modes[m]);
+            FAIL_TEST;
+        }
+        for (v = -510; v <= 510; v++) {
+            if (bintree_search(f, v) != bintree_search(l, v)) {
+                logger(dbgErr, "Mode %i search %i differs", modes[m], v);
+                FAIL_TEST;
+            }
+        }
+        bintree_insert(l, 12345);
+        if (bintree_search(l, 12345) || n != bintree_count(l)) {
+            logger(dbgErr, "Loaded tree accepted an insert");
+            FAIL_TEST;
+        }
+        bintree_destroy(l);
+        bintree_destroy(f);
+        bintree_destroy(b);
+        l = f = b = NULL;
+    }
+
+    /* empty tree round trip */
+    b = bintree_create(test_name);
+    if (!bintree_save(b, path) || NULL == (l = bintree_load_mmap(path)) ||
+        0 != bintree_count(l) || bintree_search(l, 0)) {
+        logger(dbgErr, "Empty tree round trip failed");
+        FAIL_TEST;
+    }
+    bintree_destroy(l);
+    l = NULL;
+
+    /* replacing the image under a live mapping */
+    for (i = 0; i < 1000; i++) {
+        bintree_insert(b, i);
+    }
+    bintree_save(b, path);
+    l = bintree_load_mmap(path);
+    bintree_destroy(b);
+    b = bintree_create(test_name);
+    bintree_insert(b, -1);
+    if (NULL == l || !bintree_save(b, path) || !bintree_search(l, 999) ||
+        1000 != bintree_count(l)) {
+        logger(dbgErr, "Mapped image broken by a save over it");
+        FAIL_TEST;
+    }
+    bintree_destroy(l);
+    snprintf(pattern, sizeof(pattern), "%s.*", path);
+    if (NULL == (l = bintree_load_mmap(path)) || 1 != bintree_count(l) ||
+        _t17_any(pattern)) {
+        logger(dbgErr, "Replaced image not loaded, or temp file left behind");
+        FAIL_TEST;
+    }
+    bintree_destroy(l);
+    bintree_destroy(b);
+    l = NULL;
+
+    /* two threads saving trees of the same size over one path */
+    for (m = 0; m < 2; m++) {
+        b = bintree_create_mode(test_name, bintreeBtree);
+        for (i = 0; i < 20000; i++) {
+            bintree_insert(b, 2 * i + m);
+        }
+        savers[m].tree = bintree_freeze(b);
+        savers[m].path = path;
+        bintree_destroy(b);
+    }
+    b = NULL;
+    buf = (int*)malloc(20000 * sizeof(int));
+    bintree_save(savers[0].tree, path);
+    for (m = 0; m < 2; m++) {
+        pthread_create(&tid[m], NULL, _t17_saver, &savers[m]);
+    }
+    for (i = 0; i < 100; i++) {
+        l = bintree_load_mmap(path);
+        if (NULL == l || !(_t17_holds(l, 0, 20000, buf) ||
+                           _t17_holds(l, 1, 20000, buf))) {
+            passed = 0;
+        }
+        if (NULL != l) {
+            bintree_destroy(l);
+        }
+    }
+    l = NULL;
+    for (m = 0; m < 2; m++) {
+        pthread_join(tid[m], NULL);
+        bintree_destroy(savers[m].tree);
+        passed &= savers[m].ok;
+    }
+    free(buf);
+    if (!passed || _t17_any(pattern)) {
+        logger(dbgErr, "Concurrent saves tore the image or left temp files");
+        FAIL_TEST;
+    }
+    b = bintree_create(test_name);
+
+    /* a truncated image and a file that is not an image */
+    bintree_insert(b, 1);
+    bintree_insert(b, 2);
+    bintree_save(b, path);
+    if (0 != truncate(path, 128 + 2 * sizeof(int)) ||
+        NULL != (l = bintree_load_mmap(path))) {
+        logger(dbgErr, "Truncated image accepted");
+        FAIL_TEST;
+    }
+    fp = fopen(path, "w");
+    for (i = 0; i < 64; i++) {
+        fputs("not a tree ", fp);
+    }
+    fclose(fp);
+    if (NULL != (l = bintree_load_mmap(path)) ||
+        NULL != (l = bintree_load_mmap("/nonexistent/bintree.img"))) {
+        logger(dbgErr, "Bad image accepted");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    if (NULL != l) {
+        bintree_destroy(l);
+    }
+    if (NULL != f) {
+        bintree_destroy(f);
+    }
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    unlink(path);
+    print_result(passed, test_name);
+}
+
+/**
+ * Reduce callbacks for test18: sum of keys, key count, max key
+ */
+static long
+_t18_key(int data, void *ctx)
+{
+    return data;
+}
+
+static long
+_t18_one(int data, void *ctx)
+{
+    return 1;
+}
+
+static long
+_t18_add(long a, long b)
+{
+    return a + b;
+}
+
+static long
+_t18_max(long a, long b)
+{
+    return a > b ? a : b;
+}
+
+/**
+ * Reduce callback for test18 that runs a parallel reduce of its own,
+ * over the tree in ctx, for every 1000th key
+ */
+static long
+_t18_nested(int data, void *ctx)
+{
+    if (0 != data % 1000) {
+        return 0;
+    }
+    return bintree_reduce_parallel((BintreePtr)ctx, _t18_one, _t18_add, 0, NULL, 4);
+}
+
+/** 
+ * Test18: parallel maxdepth, hasPathSum and reduce agree with the
+ *         serial answers for every mode and thread count, on trees big
+ *         enough to split into many tasks; a reduce whose callback
+ *         reduces in parallel again does not deadlock
+ */
+void 
+test18(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree,
+                              bintreeFrozen, bintreeConcurrent, bintreeSplay,
+                              bintreeMultiset};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int threads[] = {1, 2, 4};
+    int num_threads = sizeof(threads) / sizeof(threads[0]);
+    int n = 60000;
+    int *keys = (int*)malloc(n * sizeof(int));
+    int m = 0, i = 0, t = 0, sum = 0, hits = 0;
+    long key_sum = 0;
+    unsigned int seed = 1818;
+    BintreePtr b = NULL, src = NULL;
+
+    for (m = 0; m < num_modes; m++) {
+        /* wide keys for the reductions */
+        src = bintree_create_mode(test_name, bintreeFrozen == modes[m] ?
+                                             bintreeAvl : modes[m]);
+        key_sum = 0;
+        for (i = 0; i < n; i++) {
+            keys[i] = rand_r(&seed) % 100000 - 20000;
+            bintree_insert(src, keys[i]);
+            key_sum += keys[i];
+        }
+        b = (bintreeFrozen == modes[m]) ? bintree_freeze(src) : src;
+        for (t = 0; t < num_threads; t++) {
+            if (bintree_maxdepth(b) != bintree_maxdepth_parallel(b, threads[t]) ||
+                key_sum != bintree_reduce_parallel(b, _t18_key, _t18_add, 0,
+                                                   NULL, threads[t]) ||
+                n != bintree_reduce_parallel(b, _t18_one, _t18_add, 0,
+                                             NULL, threads[t]) ||
+                bintree_maxvalue(b) != bintree_reduce_parallel(b, _t18_key,
+                                            _t18_max, INT_MIN, NULL, threads[t])) {
+                logger(dbgErr, "Mode %i, %i threads: aggregate differs",
+                        modes[m], threads[t]);
+                FAIL_TEST;
+            }
+        }
+        if (b != src) {
+            bintree_destroy(b);
+        }
+        bintree_destroy(src);
+        b = src = NULL;
+        if (bintreeBtree == modes[m]) {
+            continue;
+        }
+
+        /* keys 0..3, so most small sums are a real path */
+        src = bintree_create_mode(test_name, bintreeFrozen == modes[m] ?
+                                             bintreeAvl : modes[m]);
+        for (i = 0; i < n / 2; i++) {
+            bintree_insert(src, rand_r(&seed) % 4);
+        }
+        b = (bintreeFrozen == modes[m]) ? bintree_freeze(src) : src;
+        for (t = 0; t < num_threads; t++) {
+            for (sum = -2; sum < 120; sum++) {
+                int has = bintree_hasPathSum(b, sum);
+                if (has != bintree_hasPathSum_parallel(b, sum, threads[t])) {
+                    logger(dbgErr, "Mode %i, %i threads: hasPathSum(%i) differs",
+                            modes[m], threads[t], sum);
+                    FAIL_TEST;
+                }
+                hits += has;
+            }
+        }
+        if (b != src) {
+            bintree_destroy(b);
+        }
+        bintree_destroy(src);
+        b = src = NULL;
+    }
+    if (0 == hits) {
+        logger(dbgErr, "No path sum was ever found");
+        FAIL_TEST;
+    }
+
+    /* nested parallel calls, both trees big enough for the pool */
+    src = bintree_create_mode(test_name, bintreeAvl);
+    b = bintree_create_mode(test_name, bintreeAvl);
+    for (i = 0; i < n / 2; i++) {
+        bintree_insert(src, i);
+        bintree_insert(b, i);
+    }
+    if (n / 2 / 1000 * bintree_count(b) !=
+        bintree_reduce_parallel(src, _t18_nested, _t18_add, 0, b, 4)) {
+        logger(dbgErr, "Nested parallel reduce gave the wrong answer");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    if (NULL != b && b != src) {
+        bintree_destroy(b);
+    }
+    if (NULL != src) {
+        bintree_destroy(src);
+    }
+    free(keys);
+    print_result(passed, test_name);
+}
+
+/* Recorder for test19's walks */
+typedef struct t19_rec_s {
+    int *out;
+    int len;
+    int stop_at;                /* stop after this many keys, 0 = never */
+} t19_rec_t;
+
+static int
+_t19_record(int data, void *ctx)
+{
+    t19_rec_t *rec = (t19_rec_t*)ctx;
+    rec->out[rec->len++] = data;
+    return (rec->len == rec->stop_at);
+}
+
+/**
+ * Helper for test19: run one walk and compare with the expected keys
+ */
+static int
+_t19_walk_is(BintreePtr b, int (*walk)(BintreePtr, int (*)(int, void*), void*),
+             const int *want, int n, int *buf)
+{
+    t19_rec_t rec = {buf, 0, 0};
+
+    if (n != walk(b, _t19_record, &rec) || n != rec.len) {
+        return 0;
+    }
+    return (0 == memcmp(buf, want, n * sizeof(int)));
+}
+
+/** 
+ * Test19: callback traversals visit the right keys in the right order
+ *         for every mode, stop when asked, and survive 20000-deep chains
+ */
+void 
+test19(const char *test_name) {
+    int passed = 1;
+
+    int ins[] = {50, 30, 70, 20, 40, 60, 80};
+    int pre[] = {50, 30, 20, 40, 70, 60, 80};
+    int in[] = {20, 30, 40, 50, 60, 70, 80};
+    int post[] = {20, 40, 30, 60, 80, 70, 50};
+    int bal_pre[] = {4, 2, 1, 3, 6, 5, 7};
+    int bal_post[] = {1, 3, 2, 5, 7, 6, 4};
+    int bal_in[] = {1, 2, 3, 4, 5, 6, 7};
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree,
+                              bintreeFrozen, bintreeConcurrent, bintreeSplay};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int deep = 20000;
+    int *buf = (int*)malloc(deep * sizeof(int));
+    int *want = (int*)malloc(deep * sizeof(int));
+    int m = 0, i = 0, d = 0;
+    t19_rec_t rec = {buf, 0, 0};
+    BintreePtr b = NULL, f = NULL;
+
+    /* known shapes */
+    b = bintree_create(test_name);
+    for (i = 0; i < 7; i++) {
+        bintree_insert(b, ins[i]);
+    }
+    if (!_t19_walk_is(b, bintree_preorder_foreach, pre, 7, buf) ||
+        !_t19_walk_is(b, bintree_inorder_foreach, in, 7, buf) ||
+        !_t19_walk_is(b, bintree_postorder_foreach, post, 7, buf)) {
+        logger(dbgErr, "Plain tree walked in the wrong order");
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+    b = bintree_build_sorted(test_name, bal_in, 7);
+    f = bintree_freeze(b);
+    if (!_t19_walk_is(b, bintree_preorder_foreach, bal_pre, 7, buf) ||
+        !_t19_walk_is(b, bintree_postorder_foreach, bal_post, 7, buf) ||
+        !_t19_walk_is(f, bintree_preorder_foreach, bal_pre, 7, buf) ||
+        !_t19_walk_is(f, bintree_inorder_foreach, bal_in, 7, buf) ||
+        !_t19_walk_is(f, bintree_postorder_foreach, bal_post, 7, buf)) {
+        logger(dbgErr, "Balanced/frozen tree walked in the wrong order");
+        FAIL_TEST;
+    }
+    bintree_destroy(f);
+    bintree_destroy(b);
+    f = b = NULL;
+
+    /* every mode: in-order is sorted, every order sees every key, stops */
+    for (m = 0; m < num_modes; m++) {
+        b = bintree_create_mode(test_name, bintreeFrozen == modes[m] ?
+                                           bintreeAvl : modes[m]);
+        for (i = 0; i < 1000; i++) {
+            bintree_insert(b, (i * 7919) % 1000);
+        }
+        if (bintreeFrozen == modes[m]) {
+            f = bintree_freeze(b);
+            bintree_destroy(b);
+            b = f;
+            f = NULL;
+        }
+        bintree_to_sorted_array(b, want);
+        if (!_t19_walk_is(b, bintree_inorder_foreach, want, 1000, buf)) {
+            logger(dbgErr, "Mode %i in-order walk not sorted", modes[m]);
+            FAIL_TEST;
+        }
+        rec.len = 0;
+        rec.stop_at = 0;
+        if (1000 != bintree_preorder_foreach(b, _t19_record, &rec) ||
+            1000 != bintree_postorder_foreach(b, _t19_record, &rec)) {
+            logger(dbgErr, "Mode %i walk missed keys", modes[m]);
+            FAIL_TEST;
+        }
+        rec.len = 0;
+        rec.stop_at = 17;
+        if (17 != bintree_preorder_foreach(b, _t19_record, &rec) ||
+            (rec.len = 0, 17 != bintree_inorder_foreach(b, _t19_record, &rec)) ||
+            (rec.len = 0, 17 != bintree_postorder_foreach(b, _t19_record, &rec))) {
+            logger(dbgErr, "Mode %i walk did not stop", modes[m]);
+            FAIL_TEST;
+        }
+        bintree_destroy(b);
+        b = NULL;
+    }
+
+    /* right- and left-leaning chains */
+    for (d = 0; d < 2; d++) {
+        b = bintree_create(test_name);
+        for (i = 0; i < deep; i++) {
+            bintree_insert(b, d ? deep - 1 - i : i);
+        }
+        for (i = 0; i < deep; i++) {
+            want[i] = i;
+        }
+        if (!_t19_walk_is(b, bintree_inorder_foreach, want, deep, buf)) {
+            logger(dbgErr, "Chain %i in-order wrong", d);
+            FAIL_TEST;
+        }
+        for (i = 0; i < deep; i++) {
+            want[i] = d ? deep - 1 - i : i;
+        }
+        if (!_t19_walk_is(b, bintree_preorder_foreach, want, deep, buf)) {
+            logger(dbgErr, "Chain %i pre-order wrong", d);
+            FAIL_TEST;
+        }
+        for (i = 0; i < deep; i++) {
+            want[i] = d ? i : deep - 1 - i;
+        }
+        if (!_t19_walk_is(b, bintree_postorder_foreach, want, deep, buf)) {
+            logger(dbgErr, "Chain %i post-order wrong", d);
+            FAIL_TEST;
+        }
+        bintree_destroy(b);
+        b = NULL;
+    }
+    goto out;
+out:
+    if (NULL != f) {
+        bintree_destroy(f);
+    }
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    free(buf);
+    free(want);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test20: bintree_search_batch() agrees with bintree_search() for every
+ *         mode, for batches smaller and larger than the lookup group,
+ *         and on a degenerate chain
+ */
+void 
+test20(const char *test_name) {
+    int passed = 1;
+
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree,
+                              bintreeFrozen, bintreeConcurrent, bintreeSplay,
+                              bintreeMultiset};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int sizes[] = {0, 1, 5, 17, 3000};
+    int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    int probe[6000];
+    uint8_t found[6001];
+    int m = 0, z = 0, i = 0, n = 0;
+    unsigned int seed = 2020;
+    BintreePtr b = NULL, f = NULL;
+
+    for (m = 0; m <= num_modes; m++) {
+        for (z = 0; z < num_sizes; z++) {
+            n = sizes[z];
+            if (m == num_modes) {
+                /* sorted inserts: a right-leaning chain */
+                b = bintree_create(test_name);
+                for (i = 0; i < n; i++) {
+                    bintree_insert(b, 2 * i);
+                }
+            } else {
+                b = bintree_create_mode(test_name, bintreeFrozen == modes[m] ?
+                                                   bintreeAvl : modes[m]);
+                for (i = 0; i < n; i++) {
+                    bintree_insert(b, 2 * (rand_r(&seed) % (2 * n)));
+                }
+            }
+            if (m < num_modes && bintreeFrozen == modes[m]) {
+                f = bintree_freeze(b);
+                bintree_destroy(b);
+                b = f;
+                f = NULL;
+            }
+            for (i = 0; i < 2 * n; i++) {
+                probe[i] = rand_r(&seed) % (4 * n + 2) - 1;
+            }
+            memset(found, 0xff, sizeof(found));
+            bintree_search_batch(b, probe, 2 * n, found);
+            for (i = 0; i < 2 * n; i++) {
+                if (found[i] != bintree_search(b, probe[i])) {
+                    logger(dbgErr, "Pass %i size %i: batch wrong for %i",
+                            m, n, probe[i]);
+                    FAIL_TEST;
+                }
+            }
+            if (0xff != found[2 * n]) {
+                logger(dbgErr, "Pass %i size %i: wrote past the batch", m, n);
+                FAIL_TEST;
+            }
+            bintree_destroy(b);
+            b = NULL;
+        }
+    }
+    goto out;
+out:
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    print_result(passed, test_name);
+}
+
+/**
+ * Helper to build an AVL tree from a membership table, half the time
+ * with bintree_build_sorted() and half with inserts in random order
+ */
+static BintreePtr
+_t21_build(const char *name, const char *in, int range, int sorted,
+           unsigned int *seed)
+{
+    BintreePtr b = NULL;
+    int *keys = (int*)malloc(range * sizeof(int));
+    int n = 0, i = 0;
+
+    for (i = 0; i < range; i++) {
+        if (in[i]) {
+            keys[n++] = i;
+        }
+    }
+    if (sorted) {
+        b = bintree_build_sorted(name, keys, n);
+    } else {
+        b = bintree_create_mode(name, bintreeAvl);
+        for (i = n - 1; i > 0; i--) {
+            int j = rand_r(seed) % (i + 1);
+            int tmp = keys[i];
+            keys[i] = keys[j];
+            keys[j] = tmp;
+        }
+        for (i = 0; i < n; i++) {
+            bintree_insert(b, keys[i]);
+        }
+    }
+    free(keys);
+    return b;
+}
+
+/**
+ * Helper to check a tree holds exactly the keys marked in want and is
+ * still AVL-shaped
+ */
+static int
+_t21_holds(BintreePtr b, const char *want, int range, int *buf)
+{
+    int n = 0, i = 0, h = 0, limit = 0;
+
+    for (i = 0; i < range; i++) {
+        n += want[i];
+    }
+    if (n != bintree_count(b) || n != bintree_to_sorted_array(b, buf)) {
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        if (buf[i] < 0 || buf[i] >= range || !want[buf[i]] ||
+            (i > 0 && buf[i] <= buf[i - 1])) {
+            return 0;
+        }
+    }
+    /* AVL height is below 1.45 * log2(n + 2) */
+    for (h = 1; (1 << h) < n + 2; h++);
+    limit = (145 * h) / 100 + 1;
+    return bintree_maxdepth(b) <= limit;
+}
+
+/**
+ * Test21: union, intersection and difference of AVL trees against a
+ *         membership table; src is left empty and both trees stay usable
+ */
+void 
+test21(const char *test_name) {
+    int passed = 1;
+
+    enum { RANGE = 4000 };
+    const char *ops[] = {"union", "intersection", "difference"};
+    int (*fns[])(BintreePtr, BintreePtr) = {bintree_union,
+                                            bintree_intersection,
+                                            bintree_difference};
+    int dens[][2] = {{40, 40}, {90, 3}, {3, 90}, {0, 50}, {50, 0}, {-1, -1}};
+    int num_dens = sizeof(dens) / sizeof(dens[0]);
+    char *in_a = (char*)calloc(RANGE, 1);
+    char *in_b = (char*)calloc(RANGE, 1);
+    char *want = (char*)calloc(RANGE, 1);
+    int *buf = (int*)malloc(RANGE * sizeof(int));
+    unsigned int seed = 2121;
+    int o = 0, d = 0, i = 0, cnt = 0;
+    BintreePtr a = NULL, b = NULL;
+
+    for (o = 0; o < 3; o++) {
+        for (d = 0; d < num_dens; d++) {
+            for (i = 0; i < RANGE; i++) {
+                if (dens[d][0] < 0) {
+                    /* disjoint key ranges, the O(log n) case */
+                    in_a[i] = (i < RANGE / 2) && (i % 3);
+                    in_b[i] = (i >= RANGE / 2) && (i % 5);
+                } else {
+                    in_a[i] = (rand_r(&seed) % 100) < dens[d][0];
+                    in_b[i] = (rand_r(&seed) % 100) < dens[d][1];
+                }
+                want[i] = (0 == o) ? (in_a[i] || in_b[i]) :
+                          (1 == o) ? (in_a[i] && in_b[i]) :
+                                     (in_a[i] && !in_b[i]);
+            }
+            a = _t21_build(test_name, in_a, RANGE, d & 1, &seed);
+            b = _t21_build(test_name, in_b, RANGE, !(d & 1), &seed);
+            cnt = fns[o](a, b);
+            if (cnt != bintree_count(a) || !_t21_holds(a, want, RANGE, buf)) {
+                logger(dbgErr, "%s %i: wrong result", ops[o], d);
+                FAIL_TEST;
+            }
+            if (0 != bintree_count(b)) {
+                logger(dbgErr, "%s %i: src not emptied", ops[o], d);
+                FAIL_TEST;
+            }
+            /* churn both trees through their merged/emptied arenas */
+            for (i = 0; i < RANGE; i += 7) {
+                if (want[i]) {
+                    bintree_remove(a, i);
+                } else {
+                    bintree_insert(a, i);
+                }
+                want[i] = !want[i];
+                bintree_insert(b, i);
+            }
+            if (!_t21_holds(a, want, RANGE, buf) ||
+                (RANGE + 6) / 7 != bintree_count(b)) {
+                logger(dbgErr, "%s %i: trees unusable afterwards", ops[o], d);
+                FAIL_TEST;
+            }
+            bintree_destroy(a);
+            bintree_destroy(b);
+            a = b = NULL;
+        }
+    }
+
+    /* only AVL trees */
+    a = bintree_create_mode(test_name, bintreeAvl);
+    b = bintree_create(test_name);
+    bintree_insert(a, 1);
+    bintree_insert(b, 2);
+    if (-1 != bintree_union(a, b) || 1 != bintree_count(a) ||
+        1 != bintree_count(b)) {
+        logger(dbgErr, "Union accepted a plain tree");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    if (NULL != a) {
+        bintree_destroy(a);
+    }
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    free(in_a);
+    free(in_b);
+    free(want);
+    free(buf);
+    print_result(passed, test_name);
+}
+
+/**
+ * Helper for test22, collects keys into an array
+ */
+static int
+_t22_collect(int data, void *ctx)
+{
+    int **pos = (int**)ctx;
+    *(*pos)++ = data;
+    return 0;
+}
+
+/**
+ * Helper for test22, checks a version against per-key counts
+ */
+static int
+_t22_holds(BintreeVerPtr v, const int *cnt, int range, int *buf)
+{
+    int *pos = buf;
+    int n = 0, i = 0, k = 0;
+
+    if (bintree_ver_foreach(v, _t22_collect, &pos) != bintree_ver_count(v)) {
+        return 0;
+    }
+    for (k = 0; k < range; k++) {
+        for (i = 0; i < cnt[k]; i++) {
+            if (n >= bintree_ver_count(v) || buf[n++] != k) {
+                return 0;
+            }
+        }
+        if ((cnt[k] > 0) != bintree_ver_search(v, k)) {
+            return 0;
+        }
+    }
+    return n == bintree_ver_count(v);
+}
+
+typedef struct t22_arg_s {
+    BintreeVerPtr base;
+    int seed;
+    int ok;
+} t22_arg_t;
+
+/**
+ * Helper for test22, derives and drops versions from a shared base
+ */
+static void*
+_t22_writer(void *arg)
+{
+    t22_arg_t *a = (t22_arg_t*)arg;
+    BintreeVerPtr v = bintree_ver_retain(a->base);
+    unsigned int seed = a->seed;
+    int base_cnt = bintree_ver_count(a->base);
+    int i = 0, added = 0;
+
+    for (i = 0; i < 2000; i++) {
+        BintreeVerPtr next = NULL;
+        int key = rand_r(&seed) % 500;
+        /* only remove keys that are there, the logger is not thread safe */
+        if (rand_r(&seed) % 3 && bintree_ver_search(v, key)) {
+            next = bintree_ver_remove(v, key);
+            added--;
+        } else {
+            next = bintree_ver_insert(v, key);
+            added++;
+        }
+        bintree_ver_release(v);
+        v = next;
+    }
+    a->ok = (base_cnt + added == bintree_ver_count(v));
+    bintree_ver_release(v);
+    return NULL;
+}
+
+/**
+ * Test22: persistent versions - every version keeps its own contents
+ *         while later ones are derived and earlier ones released, also
+ *         with writers on several threads sharing one base
+ */
+void 
+test22(const char *test_name) {
+    int passed = 1;
+
+    enum { RANGE = 100, NVER = 300, NTHREADS = 4 };
+    BintreeVerPtr v[NVER + 1];
+    int cnt[NVER + 1][RANGE];
+    int *buf = (int*)malloc((NVER + 1) * sizeof(int));
+    t22_arg_t args[NTHREADS];
+    pthread_t tid[NTHREADS];
+    unsigned int seed = 2222;
+    int i = 0, k = 0, released = 0;
+
+    memset(v, 0, sizeof(v));
+    memset(cnt, 0, sizeof(cnt));
+    v[0] = bintree_ver_create(test_name);
+    for (i = 0; i < NVER; i++) {
+        k = rand_r(&seed) % RANGE;
+        memcpy(cnt[i + 1], cnt[i], sizeof(cnt[i]));
+        if (rand_r(&seed) % 4) {
+            v[i + 1] = bintree_ver_insert(v[i], k);
+            cnt[i + 1][k]++;
+        } else {
+            v[i + 1] = bintree_ver_remove(v[i], k);
+            if (cnt[i + 1][k] > 0) {
+                cnt[i + 1][k]--;
+            }
+        }
+        if (i + 1 != bintree_ver_number(v[i + 1])) {
+            logger(dbgErr, "Version %i numbered %li", i + 1,
+                    bintree_ver_number(v[i + 1]));
+            FAIL_TEST;
+        }
+    }
+    /* drop every other remaining version, the rest must be unaffected */
+    for (released = 0; released < 3; released++) {
+        for (i = 0; i <= NVER; i++) {
+            if (NULL != v[i] && !_t22_holds(v[i], cnt[i], RANGE, buf)) {
+                logger(dbgErr, "Version %i changed (pass %i)", i, released);
+                FAIL_TEST;
+            }
+        }
+        for (i = (1 << released) - 1; i <= NVER && released < 2;
+             i += 2 << released) {
+            bintree_ver_release(v[i]);
+            v[i] = NULL;
+        }
+    }
+
+    /* snapshots: a retained handle is the same version */
+    if (bintree_ver_retain(v[NVER - 1]) != v[NVER - 1]) {
+        FAIL_TEST;
+    }
+    bintree_ver_release(v[NVER - 1]);
+    if (!_t22_holds(v[NVER - 1], cnt[NVER - 1], RANGE, buf)) {
+        logger(dbgErr, "Released snapshot took the version with it");
+        FAIL_TEST;
+    }
+
+    /* concurrent writers deriving from one base */
+    for (i = 0; i < NTHREADS; i++) {
+        args[i].base = v[NVER - 1];
+        args[i].seed = 100 + i;
+        args[i].ok = 0;
+        pthread_create(&tid[i], NULL, _t22_writer, &args[i]);
+    }
+    for (i = 0; i < NTHREADS; i++) {
+        pthread_join(tid[i], NULL);
+        if (!args[i].ok) {
+            logger(dbgErr, "Writer %i lost an update", i);
+            passed = 0;
+        }
+    }
+    if (!passed || !_t22_holds(v[NVER - 1], cnt[NVER - 1], RANGE, buf)) {
+        logger(dbgErr, "Concurrent writers changed their base");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    for (i = 0; i <= NVER; i++) {
+        if (NULL != v[i]) {
+            bintree_ver_release(v[i]);
+        }
+    }
+    free(buf);
+    print_result(passed, test_name);
+}
+
+/**
+ * Helper for test23, records the first key a walk visits
+ */
+static int
+_t23_first(int data, void *ctx)
+{
+    *(int*)ctx = data;
+    return 1;
+}
+
+/**
+ * Test23: splay mode - random inserts/removes/searches agree with a
+ *         count table, searched keys end up at the root, sizes stay
+ *         right for select/rank, sorted inserts do not recurse
+ */
+void 
+test23(const char *test_name) {
+    int passed = 1;
+
+    enum { RANGE = 500, OPS = 20000, CHAIN = 200000 };
+    int *cnt = (int*)calloc(RANGE, sizeof(int));
+    int *buf = (int*)malloc(CHAIN * sizeof(int));
+    unsigned int seed = 2323;
+    int i = 0, k = 0, n = 0, root = 0, sel = 0;
+    BintreePtr b = bintree_create_mode(test_name, bintreeSplay);
+
+    for (i = 0; i < OPS; i++) {
+        k = rand_r(&seed) % RANGE;
+        switch (rand_r(&seed) % 3) {
+        case 0:
+            bintree_insert(b, k);
+            cnt[k]++;
+            n++;
+            break;
+        case 1:
+            if (cnt[k] > 0) {
+                bintree_remove(b, k);
+                cnt[k]--;
+                n--;
+            }
+            break;
+        default:
+            if ((cnt[k] > 0) != bintree_search(b, k)) {
+                logger(dbgErr, "Search for %i wrong after %i ops", k, i);
+                FAIL_TEST;
+            }
+            if (cnt[k] > 0 &&
+                (bintree_preorder_foreach(b, _t23_first, &root), root != k)) {
+                logger(dbgErr, "Found %i but root is %i", k, root);
+                FAIL_TEST;
+            }
+            break;
+        }
+        if (n != bintree_count(b)) {
+            logger(dbgErr, "Count %i, expected %i after %i ops", bintree_count(b),
+                    n, i);
+            FAIL_TEST;
+        }
+    }
+    bintree_to_sorted_array(b, buf);
+    for (k = 0, i = 0; k < RANGE; k++) {
+        int c = 0;
+        for (c = 0; c < cnt[k]; c++, i++) {
+            if (buf[i] != k || !bintree_select(b, i, &sel) || sel != k) {
+                logger(dbgErr, "Key %i of %i wrong", i, n);
+                FAIL_TEST;
+            }
+        }
+        if (bintree_rank(b, k) != i - cnt[k]) {
+            logger(dbgErr, "Rank of %i is %i, expected %i", k,
+                    bintree_rank(b, k), i - cnt[k]);
+            FAIL_TEST;
+        }
+    }
+    bintree_destroy(b);
+
+    /* sorted inserts build a chain; splaying its far end must not recurse */
+    b = bintree_create_mode(test_name, bintreeSplay);
+    for (i = 0; i < CHAIN; i++) {
+        bintree_insert(b, i);
+    }
+    if (!bintree_search(b, 0) || !bintree_search(b, CHAIN / 2) ||
+        bintree_search(b, -1) || CHAIN != bintree_count(b)) {
+        logger(dbgErr, "Chain search failed");
+        FAIL_TEST;
+    }
+    for (i = 0; i < CHAIN; i += 2) {
+        bintree_remove(b, i);
+    }
+    if (CHAIN / 2 != bintree_to_sorted_array(b, buf) || 1 != buf[0] ||
+        CHAIN - 1 != buf[CHAIN / 2 - 1]) {
+        logger(dbgErr, "Chain removes failed");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    bintree_destroy(b);
+    free(cnt);
+    free(buf);
+    print_result(passed, test_name);
+}
+
+/**
+ * Helper for test24, appends each key to an array
+ */
+static int
+_t24_append(int data, void *ctx)
+{
+    int **pos = (int**)ctx;
+    *(*pos)++ = data;
+    return 0;
+}
+
+/* test24 walks its chain on a stack far too small to recurse down it */
+#define T24_STACK (64 * 1024)
+
+typedef struct t24_walk_s {
+    BintreeCompactPtr c;
+    int *buf;
+    int depth;
+    int walked;
+} t24_walk_t;
+
+/**
+ * Thread body for test24: depth and in-order walk of the whole tree
+ */
+static void*
+_t24_walk(void *arg)
+{
+    t24_walk_t *w = (t24_walk_t*)arg;
+    int *pos = w->buf;
+
+    w->depth = bintree_compact_maxdepth(w->c);
+    w->walked = bintree_compact_inorder_foreach(w->c, _t24_append, &pos);
+    return NULL;
+}
+
+/**
+ * Helper for test24, runs _t24_walk() on a thread with a T24_STACK stack
+ */
+static void
+_t24_walk_small_stack(t24_walk_t *w)
+{
+    pthread_attr_t attr;
+    pthread_t tid;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, T24_STACK);
+    pthread_create(&tid, &attr, _t24_walk, w);
+    pthread_join(tid, NULL);
+    pthread_attr_destroy(&attr);
+}
+
+/**
+ * Test24: compact trees - random inserts/removes with duplicates give
+ *         the same keys and the same shape as a plain tree fed the same
+ *         operations; a sorted-insert chain walks on a small stack, so
+ *         without recursion, and freed slots are reused
+ */
+void 
+test24(const char *test_name) {
+    int passed = 1;
+
+    enum { RANGE = 2000, OPS = 30000, CHAIN = 20000 };
+    int *cnt = (int*)calloc(RANGE, sizeof(int));
+    int *buf = (int*)malloc(CHAIN * sizeof(int));
+    int *ref = (int*)malloc(CHAIN * sizeof(int));
+    int *pos = buf;
+    unsigned int seed = 2424;
+    int i = 0, k = 0, n = 0;
+    size_t mem = 0;
+    t24_walk_t w;
+    BintreeCompactPtr c = bintree_compact_create(test_name);
+    BintreePtr b = bintree_create(test_name);
+
+    if (0 != bintree_compact_count(c) || bintree_compact_search(c, 0) ||
+        0 != bintree_compact_maxdepth(c) || 0 != bintree_compact_minvalue(c)) {
+        logger(dbgErr, "Empty compact tree misbehaves");
+        FAIL_TEST;
+    }
+    for (i = 0; i < OPS; i++) {
+        k = rand_r(&seed) % RANGE;
+        if (rand_r(&seed) % 3) {
+            bintree_compact_insert(c, k);
+            bintree_insert(b, k);
+            cnt[k]++;
+            n++;
+        } else if (cnt[k] > 0) {
+            bintree_compact_remove(c, k);
+            bintree_remove(b, k);
+            cnt[k]--;
+            n--;
+        }
+        if ((cnt[k] > 0) != bintree_compact_search(c, k) ||
+            n != bintree_compact_count(c)) {
+            logger(dbgErr, "Key %i or count %i wrong after %i ops", k,
+                    bintree_compact_count(c), i);
+            FAIL_TEST;
+        }
+    }
+    if (n != bintree_compact_inorder_foreach(c, _t24_append, &pos) ||
+        n != bintree_to_sorted_array(b, ref) ||
+        0 != memcmp(buf, ref, n * sizeof(int)) ||
+        bintree_maxdepth(b) != bintree_compact_maxdepth(c) ||
+        bintree_minvalue(b) != bintree_compact_minvalue(c) ||
+        bintree_maxvalue(b) != bintree_compact_maxvalue(c)) {
+        logger(dbgErr, "Compact tree differs from plain tree");
+        FAIL_TEST;
+    }
+    bintree_compact_destroy(c);
+
+    /* sorted inserts build a chain as deep as it is long */
+    c = bintree_compact_create(test_name);
+    bintree_compact_reserve(c, CHAIN);
+    for (i = 0; i < CHAIN; i++) {
+        bintree_compact_insert(c, i);
+    }
+    mem = bintree_compact_memory(c);
+    w = (t24_walk_t){c, buf, 0, 0};
+    _t24_walk_small_stack(&w);
+    if (CHAIN != w.depth || !bintree_compact_search(c, CHAIN - 1) ||
+        mem > 12 * (size_t)CHAIN + 4096) {
+        logger(dbgErr, "Chain depth %i, memory %zu", w.depth, mem);
+        FAIL_TEST;
+    }
+    for (i = 0; i < CHAIN; i += 2) {
+        bintree_compact_remove(c, i);
+    }
+    for (i = 0; i < CHAIN; i += 2) {
+        bintree_compact_insert(c, -i);
+    }
+    _t24_walk_small_stack(&w);
+    if (CHAIN != w.walked || -(CHAIN - 2) != buf[0] || CHAIN - 1 != buf[CHAIN - 1] ||
+        mem != bintree_compact_memory(c)) {
+        logger(dbgErr, "Freed slots not reused or walk wrong");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    bintree_compact_destroy(c);
+    bintree_destroy(b);
+    free(cnt);
+    free(buf);
+    free(ref);
+    print_result(passed, test_name);
+}
+
+/**
+ * Helper for test25, appends each key to an array
+ */
+static int
+_t25_append(int data, void *ctx)
+{
+    int **pos = (int**)ctx;
+    *(*pos)++ = data;
+    return 0;
+}
+
+/**
+ * Test25: multiset mode - heavy duplication agrees with a count table
+ *         for count, count_key, select, rank and every enumeration,
+ *         depth stays that of an AVL tree over the distinct keys, and
+ *         count_key gives the same answers in every other mode
+ */
+void 
+test25(const char *test_name) {
+    int passed = 1;
+
+    enum { RANGE = 50, OPS = 40000, MAX = OPS };
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree,
+                              bintreeFrozen, bintreeConcurrent, bintreeSplay};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int *cnt = (int*)calloc(RANGE, sizeof(int));
+    int *buf = (int*)malloc(MAX * sizeof(int));
+    int *walk = (int*)malloc(MAX * sizeof(int));
+    int *pos = NULL;
+    unsigned int seed = 2525;
+    int i = 0, k = 0, n = 0, m = 0, sel = 0, data = 0;
+    BintreePtr b = bintree_create_mode(test_name, bintreeMultiset);
+    BintreePtr o = NULL, f = NULL;
+    BintreeIterPtr it = NULL;
+
+    for (i = 0; i < OPS; i++) {
+        k = rand_r(&seed) % RANGE;
+        if (rand_r(&seed) % 4) {
+            bintree_insert(b, k);
+            cnt[k]++;
+            n++;
+        } else if (cnt[k] > 0) {
+            bintree_remove(b, k);
+            cnt[k]--;
+            n--;
+        }
+        if (cnt[k] != bintree_count_key(b, k) || n != bintree_count(b) ||
+            (cnt[k] > 0) != bintree_search(b, k)) {
+            logger(dbgErr, "Key %i count %i, expected %i after %i ops", k,
+                    bintree_count_key(b, k), cnt[k], i);
+            FAIL_TEST;
+        }
+    }
+    /* at most RANGE nodes, however many copies */
+    if (bintree_maxdepth(b) > 8) {
+        logger(dbgErr, "Depth %i for %i distinct keys", bintree_maxdepth(b), RANGE);
+        FAIL_TEST;
+    }
+    if (n != bintree_to_sorted_array(b, buf)) {
+        FAIL_TEST;
+    }
+    for (k = 0, i = 0; k < RANGE; k++) {
+        int c = 0;
+        for (c = 0; c < cnt[k]; c++, i++) {
+            if (buf[i] != k || !bintree_select(b, i, &sel) || sel != k) {
+                logger(dbgErr, "Key %i of %i wrong", i, n);
+                FAIL_TEST;
+            }
+        }
+        if (bintree_rank(b, k) != i - cnt[k]) {
+            logger(dbgErr, "Rank of %i is %i, expected %i", k,
+                    bintree_rank(b, k), i - cnt[k]);
+            FAIL_TEST;
+        }
+    }
+    pos = walk;
+    if (n != bintree_inorder_foreach(b, _t25_append, &pos) ||
+        0 != memcmp(buf, walk, n * sizeof(int))) {
+        logger(dbgErr, "In-order walk misses copies");
+        FAIL_TEST;
+    }
+    it = bintree_iter_create(b, INT_MIN);
+    for (i = 0; bintree_iter_next(it, &data); i++) {
+        if (i >= n || data != buf[i]) {
+            FAIL_TEST;
+        }
+    }
+    if (i != n) {
+        logger(dbgErr, "Iterator gave %i keys, expected %i", i, n);
+        FAIL_TEST;
+    }
+    f = bintree_freeze(b);
+    if (n != bintree_count(f) || cnt[7] != bintree_count_key(f, 7)) {
+        FAIL_TEST;
+    }
+    bintree_destroy(f);
+    f = NULL;
+
+    /* same duplicates, one node each, in every other mode */
+    memcpy(walk, buf, n * sizeof(int));
+    for (i = n - 1; i > 0; i--) {
+        k = rand_r(&seed) % (i + 1);
+        data = walk[i];
+        walk[i] = walk[k];
+        walk[k] = data;
+    }
+    for (m = 0; m < num_modes; m++) {
+        o = bintree_create_mode(test_name, bintreeFrozen == modes[m] ?
+                                bintreeAvl : modes[m]);
+        for (i = 0; i < n; i++) {
+            bintree_insert(o, walk[i]);
+        }
+        if (bintreeFrozen == modes[m]) {
+            f = bintree_freeze(o);
+            bintree_destroy(o);
+            o = f;
+            f = NULL;
+        }
+        for (k = -1; k <= RANGE; k++) {
+            if ((k >= 0 && k < RANGE ? cnt[k] : 0) != bintree_count_key(o, k)) {
+                logger(dbgErr, "Mode %i: key %i count %i", modes[m], k,
+                        bintree_count_key(o, k));
+                FAIL_TEST;
+            }
+        }
+        bintree_destroy(o);
+        o = NULL;
+    }
+    goto out;
+out:
+    if (NULL != it) {
+        bintree_iter_destroy(it);
+    }
+    if (NULL != o) {
+        bintree_destroy(o);
+    }
+    if (NULL != f) {
+        bintree_destroy(f);
+    }
+    bintree_destroy(b);
+    free(cnt);
+    free(buf);
+    free(walk);
+    print_result(passed, test_name);
+}
+
+/**
+ * Test26: stats - exact figures for a chain, a perfect tree, a frozen
+ *         and a multiset tree, consistency with count/maxdepth in every
+ *         mode, a deep chain measured without recursion
+ */
+void 
+test26(const char *test_name) {
+    int passed = 1;
+
+    enum { CHAIN = 20000 };
+    bintree_mode_e modes[] = {bintreePlain, bintreeAvl, bintreeBtree,
+                              bintreeFrozen, bintreeConcurrent, bintreeSplay,
+                              bintreeMultiset};
+    int num_modes = sizeof(modes) / sizeof(modes[0]);
+    int keys[7] = {1, 2, 3, 4, 5, 6, 7};
+    bintree_stats_t st;
+    unsigned int seed = 2626;
+    long sum = 0;
+    int i = 0, m = 0;
+    BintreePtr b = bintree_create(test_name);
+    BintreePtr f = NULL;
+
+    /* chain of 100: every node a depth of its own, all right-leaning */
+    for (i = 0; i < 100; i++) {
+        bintree_insert(b, i);
+    }
+    if (!bintree_stats(b, &st) || 100 != st.keys || 100 != st.nodes ||
+        100 != st.height || 1 != st.depth_hist[0] || 1 != st.depth_hist[62] ||
+        37 != st.depth_hist[BINTREE_STATS_DEPTHS - 1] ||
+        98 != st.balance_hist[0] || 1 != st.balance_hist[1] ||
+        1 != st.balance_hist[2] || 50.5 != st.avg_path ||
+        st.memory < 100 * 32) {
+        logger(dbgErr, "Chain stats wrong: height %i avg %f", st.height, st.avg_path);
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+
+    /* perfect tree of 7, frozen or not */
+    b = bintree_build_sorted(test_name, keys, 7);
+    f = bintree_freeze(b);
+    for (m = 0; m < 2; m++) {
+        if (!bintree_stats(m ? f : b, &st) || 7 != st.keys || 3 != st.height ||
+            1 != st.depth_hist[0] || 2 != st.depth_hist[1] ||
+            4 != st.depth_hist[2] || 7 != st.balance_hist[2] ||
+            17.0 / 7 != st.avg_path) {
+            logger(dbgErr, "Perfect tree stats wrong, frozen %i", m);
+            FAIL_TEST;
+        }
+    }
+    bintree_destroy(b);
+    bintree_destroy(f);
+    f = NULL;
+
+    /* duplicates are keys, not nodes */
+    b = bintree_create_mode(test_name, bintreeMultiset);
+    for (i = 0; i < 1000; i++) {
+        bintree_insert(b, i % 10);
+    }
+    if (!bintree_stats(b, &st) || 1000 != st.keys || 10 != st.nodes ||
+        bintree_maxdepth(b) != st.height) {
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+
+    for (m = 0; m < num_modes; m++) {
+        b = bintree_create_mode(test_name, bintreeFrozen == modes[m] ?
+                                bintreeAvl : modes[m]);
+        for (i = 0; i < 5000; i++) {
+            bintree_insert(b, rand_r(&seed) % 100000);
+        }
+        if (bintreeFrozen == modes[m]) {
+            f = bintree_freeze(b);
+            bintree_destroy(b);
+            b = f;
+            f = NULL;
+        }
+        sum = 0;
+        if (!bintree_stats(b, &st) || bintree_count(b) != st.keys ||
+            bintree_maxdepth(b) != st.height || st.avg_path < 1 ||
+            st.avg_path > st.height || st.memory < st.nodes * sizeof(int)) {
+            logger(dbgErr, "Mode %i: keys %li height %i", modes[m], st.keys,
+                    st.height);
+            FAIL_TEST;
+        }
+        for (i = 0; i < BINTREE_STATS_DEPTHS; i++) {
+            sum += st.depth_hist[i];
+        }
+        if (sum != st.nodes ||
+            (bintreeAvl == modes[m] && st.balance_hist[2] + st.balance_hist[1] +
+             st.balance_hist[3] != st.nodes)) {
+            logger(dbgErr, "Mode %i: histograms do not add up", modes[m]);
+            FAIL_TEST;
+        }
+        bintree_destroy(b);
+    }
+
+    /* counters only move when compiled in */
+    b = bintree_create_mode(test_name, bintreeAvl);
+    bintree_stats_reset_counters();
+    for (i = 0; i < 1000; i++) {
+        bintree_insert(b, i);
+    }
+    bintree_search(b, 500);
+    bintree_stats(b, &st);
+#ifdef BINTREE_STATS_COUNTERS
+    if (1 != st.searches || st.search_cmps < 1 || st.search_cmps > st.height ||
+        st.rotations < 900) {
+        logger(dbgErr, "Counters: %li searches, %li cmps, %li rotations",
+                st.searches, st.search_cmps, st.rotations);
+        FAIL_TEST;
+    }
+#else
+    if (0 != st.searches || 0 != st.search_cmps || 0 != st.rotations) {
+        FAIL_TEST;
+    }
+#endif
+    bintree_destroy(b);
+
+    /* a chain too deep to recurse over */
+    b = bintree_create(test_name);
+    for (i = 0; i < CHAIN; i++) {
+        bintree_insert(b, i);
+    }
+    if (!bintree_stats(b, &st) || CHAIN != st.height ||
+        CHAIN - BINTREE_STATS_DEPTHS + 1 != st.depth_hist[BINTREE_STATS_DEPTHS - 1]) {
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    if (NULL != f) {
+        bintree_destroy(f);
+    }
+    bintree_destroy(b);
+    print_result(passed, test_name);
+}
+
+/**
+ * Test27: rebalance - minimum height and intact keys and sizes after
+ *         DSW on chains of every awkward length, AVL and multiset trees
+ *         still valid to update afterwards, unsupported modes, auto
+ *         rebalance on sorted inserts
+ */
+void 
+test27(const char *test_name) {
+    int passed = 1;
+
+    enum { CHAIN = 20000 };
+    int lens[] = {0, 1, 2, 3, 4, 7, 8, 100, 1000, 1023, 1024};
+    int num_lens = sizeof(lens) / sizeof(lens[0]);
+    int *buf = (int*)malloc(CHAIN * sizeof(int));
+    bintree_stats_t st;
+    unsigned int seed = 2727;
+    int l = 0, i = 0, n = 0, v = 0, want = 0;
+    BintreePtr b = NULL;
+
+    for (l = 0; l < num_lens; l++) {
+        n = lens[l];
+        b = bintree_create(test_name);
+        for (i = 0; i < n; i++) {
+            bintree_insert(b, i);
+        }
+        for (want = 0, i = n; i > 0; i /= 2) {
+            want++;
+        }
+        if (!bintree_rebalance(b) || want != bintree_maxdepth(b) ||
+            n != bintree_count(b) || n != bintree_to_sorted_array(b, buf)) {
+            logger(dbgErr, "Chain of %i: depth %i, want %i", n,
+                    bintree_maxdepth(b), want);
+            FAIL_TEST;
+        }
+        for (i = 0; i < n; i++) {
+            if (i != buf[i] || !bintree_select(b, i, &v) || i != v ||
+                i != bintree_rank(b, i)) {
+                logger(dbgErr, "Chain of %i: key %i lost or misplaced", n, i);
+                FAIL_TEST;
+            }
+        }
+        bintree_destroy(b);
+        b = NULL;
+    }
+
+    /* rebuilt AVL and multiset trees carry correct heights on */
+    for (l = 0; l < 2; l++) {
+        b = bintree_create_mode(test_name, l ? bintreeMultiset : bintreeAvl);
+        for (i = 0; i < 3000; i++) {
+            bintree_insert(b, rand_r(&seed) % 1000);
+        }
+        if (!bintree_rebalance(b) || 3000 != bintree_count(b)) {
+            FAIL_TEST;
+        }
+        for (i = 0; i < 3000; i++) {
+            if (i % 3) {
+                bintree_insert(b, rand_r(&seed) % 2000);
+            } else {
+                bintree_remove(b, rand_r(&seed) % 2000);
+            }
+        }
+        bintree_stats(b, &st);
+        if (0 != st.balance_hist[0] || 0 != st.balance_hist[4] ||
+            bintree_count(b) != st.keys) {
+            logger(dbgErr, "Mode %i out of balance after rebalance", l);
+            FAIL_TEST;
+        }
+        bintree_destroy(b);
+        b = NULL;
+    }
+
+    /* splay trees keep splaying, the rest refuse or need nothing */
+    b = bintree_create_mode(test_name, bintreeSplay);
+    for (i = 0; i < 1000; i++) {
+        bintree_insert(b, i);
+    }
+    if (!bintree_rebalance(b) || 10 != bintree_maxdepth(b) ||
+        !bintree_search(b, 999) || bintree_search(b, 1000)) {
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+    b = bintree_create_mode(test_name, bintreeBtree);
+    bintree_insert(b, 1);
+    if (!bintree_rebalance(b) || 1 != bintree_count(b) ||
+        bintree_set_auto_rebalance(b, 2.0)) {
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+    b = bintree_create_mode(test_name, bintreeConcurrent);
+    bintree_insert(b, 1);
+    if (bintree_rebalance(b) || !bintree_search(b, 1)) {
+        FAIL_TEST;
+    }
+    bintree_destroy(b);
+
+    /* sorted inserts into a self-rebalancing plain tree */
+    b = bintree_create(test_name);
+    if (bintree_set_auto_rebalance(b, 1.0) || !bintree_set_auto_rebalance(b, 2.0)) {
+        FAIL_TEST;
+    }
+    for (i = 0; i < CHAIN; i++) {
+        bintree_insert(b, i);
+    }
+    bintree_stats(b, &st);
+    if (CHAIN != st.keys || st.height > 2 * log2(CHAIN) ||
+        CHAIN != bintree_to_sorted_array(b, buf) || 0 != buf[0] ||
+        CHAIN - 1 != buf[CHAIN - 1]) {
+        logger(dbgErr, "Auto rebalance: height %i for %i keys", st.height, CHAIN);
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    if (NULL != b) {
+        bintree_destroy(b);
+    }
+    free(buf);
+    print_result(passed, test_name);
+}
+
+/* Shared state for test28's writer thread */
+#define T28_KEYS  2000
+#define T28_BATCH 200
+
+typedef struct t28_ctx_s {
+    BintreePtr b;
+    int stop;
+} t28_ctx_t;
+
+/**
+ * Writer thread for test28: inserts a batch of odd keys, then removes
+ * exactly those, so removes never miss (the logger is not thread safe)
+ */
+static void*
+_t28_writer(void *arg)
+{
+    t28_ctx_t *ctx = (t28_ctx_t*)arg;
+    int batch[T28_BATCH];
+    unsigned int seed = 2828;
+    int i = 0;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_ACQUIRE)) {
+        for (i = 0; i < T28_BATCH; i++) {
+            batch[i] = 2 * (rand_r(&seed) % T28_KEYS) + 1;
+            bintree_insert(ctx->b, batch[i]);
+        }
+        for (i = 0; i < T28_BATCH; i++) {
+            bintree_remove(ctx->b, batch[i]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Test28: freezing a concurrent tree while a writer inserts and removes
+ *         gives a consistent snapshot: every even key, sorted, no more
+ *         than one batch of odd keys, and a count matching its contents
+ */
+void 
+test28(const char *test_name) {
+    int passed = 1;
+
+    int *buf = (int*)malloc((T28_KEYS + T28_BATCH) * sizeof(int));
+    int i = 0, round = 0, n = 0, evens = 0;
+    BintreePtr b = bintree_create_mode(test_name, bintreeConcurrent);
+    BintreePtr f = NULL;
+    pthread_t writer;
+    t28_ctx_t ctx = {b, 0};
+
+    for (i = 0; i < T28_KEYS; i++) {
+        bintree_insert(b, 2 * i);
+    }
+    pthread_create(&writer, NULL, _t28_writer, &ctx);
+    for (round = 0; round < 300 && passed; round++) {
+        f = bintree_freeze(b);
+        n = bintree_count(f);
+        if (n < T28_KEYS || n > T28_KEYS + T28_BATCH ||
+            n != bintree_to_sorted_array(f, buf)) {
+            logger(dbgErr, "Round %i: frozen copy has %i keys", round, n);
+            passed = 0;
+        }
+        for (i = 0, evens = 0; i < n && passed; i++) {
+            evens += (0 == buf[i] % 2);
+            if (i > 0 && buf[i - 1] > buf[i]) {
+                logger(dbgErr, "Round %i: frozen copy out of order", round);
+                passed = 0;
+            }
+        }
+        if (passed && T28_KEYS != evens) {
+            logger(dbgErr, "Round %i: %i of %i even keys", round, evens, T28_KEYS);
+            passed = 0;
+        }
+        bintree_destroy(f);
+    }
+    __atomic_store_n(&ctx.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(writer, NULL);
+    goto out;
+out:
+    bintree_destroy(b);
+    free(buf);
+    print_result(passed, test_name);
+}
+
 test_arr_t Tests[] = 
 {
     {"test1", test1},
@@ -298,6 +2926,28 @@ test_arr_t Tests[] =
     {"test4", test4},
     {"test5", test5},
     {"test6", test6},
+    {"test7", test7},
+    {"test8", test8},
+    {"test9", test9},
+    {"test10", test10},
+    {"test11", test11},
+    {"test12", test12},
+    {"test13", test13},
+    {"test14", test14},
+    {"test15", test15},
+    {"test16", test16},
+    {"test17", test17},
+    {"test18", test18},
+    {"test19", test19},
+    {"test20", test20},
+    {"test21", test21},
+    {"test22", test22},
+    {"test23", test23},
+    {"test24", test24},
+    {"test25", test25},
+    {"test26", test26},
+    {"test27", test27},
+    {"test28", test28},
 };
 
 int
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "dlist_ext.h"
+#include "logger.h"
+
+/*
+ * dlist churn benchmark
+ *
+ * N threads each own a list and repeatedly add a burst of nodes at the
+ * head/tail, then delete the same number from the head/tail.  Burst sizes
+ * vary so thread caches spill to and refill from the depot.
+ *
+ * Usage: dlist_bench [max_threads] [ops_per_thread]
+ * Compare dlist_bench (node cache) against dlist_bench_malloc.
+ */
+
+#define BENCH_MAX_BURST 256
+
+typedef struct bench_arg_s {
+    int id;
+    long ops;
+} bench_arg_t;
+
+/**
+ * Helper to get a monotonic timestamp in seconds
+ *
+ * @return seconds
+ */
+static double
+_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Worker thread: add/del churn against a private list
+ *
+ * @param arg (i) bench_arg_t*
+ * @return NULL
+ */
+static void*
+_churn(void *arg)
+{
+    bench_arg_t *ba = (bench_arg_t*)arg;
+    unsigned int seed = ba->id + 1;
+    int data[BENCH_MAX_BURST];
+    long done = 0;
+    int i = 0;
+    char name[32];
+
+    snprintf(name, sizeof(name), "churn%i", ba->id);
+    DListPtr p = dlist_new(name);
+
+    for (i = 0; i < BENCH_MAX_BURST; i++) {
+        data[i] = i;
+    }
+
+    while (done < ba->ops) {
+        int burst = 1 + rand_r(&seed) % BENCH_MAX_BURST;
+        for (i = 0; i < burst; i++) {
+            dlist_add_head(p, &data[i]);
+        }
+        for (i = 0; i < burst; i++) {
+            dlist_del_head(p);
+        }
+        /* one tail op per burst, tail ops walk the whole list */
+        dlist_add_tail(p, &data[0]);
+        dlist_del_tail(p);
+        done += 2 * burst + 2;
+    }
+
+    dlist_destroy(p);
+    return NULL;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int max_threads = (argc > 1) ? atoi(argv[1]) : 8;
+    long ops = (argc > 2) ? atol(argv[2]) : 4000000;
+    pthread_t tids[max_threads];
+    bench_arg_t args[max_threads];
+    int nthreads = 0;
+    int i = 0;
+
+    /* silence per-op tracing */
+    logger_set_level(dbgErr);
+
+#ifdef DLIST_NO_NODE_CACHE
+    printf("dlist churn, malloc/free nodes\n");
+#else
+    printf("dlist churn, per-thread node cache\n");
+#endif
+    printf("%8s %14s %12s\n", "threads", "total ops", "Mops/s");
+
+    for (nthreads = 1; nthreads <= max_threads; nthreads *= 2) {
+        double start = _now();
+        for (i = 0; i < nthreads; i++) {
+            args[i].id = i;
+            args[i].ops = ops;
+            pthread_create(&tids[i], NULL, _churn, &args[i]);
+        }
+        for (i = 0; i < nthreads; i++) {
+            pthread_join(tids[i], NULL);
+        }
+        double secs = _now() - start;
+        printf("%8i %14li %12.2f\n", nthreads, ops * nthreads,
+                (ops * nthreads) / secs / 1e6);
+    }
+
+    dlist_cache_reclaim();
+    return 0;
+}
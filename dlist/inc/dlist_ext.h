@@ -14,6 +14,7 @@ void dlist_reverse(DListPtr listp);
 void dlist_apply_fn(DListPtr listp, void (*apply_fn)(void *));
 void* dlist_get_pos(DListPtr listp, int pos);
 int dlist_count(DListPtr listp);
+void dlist_cache_reclaim(void);
 
 #endif /* __DLIST_EXT_H__ */
 
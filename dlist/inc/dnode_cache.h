@@ -0,0 +1,21 @@
+
+#ifndef __DNODE_CACHE_H__
+#define __DNODE_CACHE_H__
+
+#include "dlist_int.h"
+
+/* Nodes moved between a thread cache and the global depot in one go */
+#define DNODE_CACHE_BATCH      64
+
+/* Thread cache spills a batch to the depot once it holds this many */
+#define DNODE_CACHE_MAX        (2 * DNODE_CACHE_BATCH)
+
+/* Depot frees batches back to malloc beyond this many */
+#define DNODE_DEPOT_MAX_BATCHES 256
+
+/* Internal node-recycling APIs used by dlist */
+dnode_t* _dnode_cache_get(void);
+void _dnode_cache_put(dnode_t *node);
+int _dnode_cache_depot_count(void);
+
+#endif /* __DNODE_CACHE_H__ */
@@ -4,6 +4,7 @@
 #include <assert.h>
 #include "dlist_ext.h"
 #include "dlist_int.h"
+#include "dnode_cache.h"
 #include "logger.h"
 
 /************************************
@@ -12,7 +13,8 @@
 /**
  * Internal API to alloc and init a node
  *
- * Note this alloc's memory, need to call _dlist_node_free to free
+ * Note this alloc's memory, need to call _dlist_node_free to free.
+ * Nodes come from the per-thread node cache, see dnode_cache.c
  * 
  * @param data (i) void pointer to data to store
  * @return node_t*
@@ -20,7 +22,7 @@
 static dnode_t*
 _dlist_node_alloc(void *data)
 {
-    dnode_t *node = (dnode_t*)malloc(sizeof(dnode_t));
+    dnode_t *node = _dnode_cache_get();
     assert(NULL != node);
 
     node->data = data;
@@ -40,7 +42,7 @@ _dlist_node_free(dnode_t *node)
 {
     assert(NULL != node);
     logger(dbgInfo, "Freeing %i", *(int*)node->data);
-    free(node);
+    _dnode_cache_put(node);
 }
 
 /************************************
@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include "dlist_ext.h"
+#include "dlist_int.h"
+#include "dnode_cache.h"
+#include "logger.h"
+
+/*
+ * Node recycling for dlist
+ *
+ * Each thread keeps a private freelist of dnode_t's chained through
+ * ->next, so alloc/free in steady state never takes a lock.  When a
+ * thread frees more than it allocates, full batches of nodes spill to a
+ * mutex-protected global depot, where threads that run dry pick them up.
+ * Inside a depot batch nodes are chained through ->next, and batches are
+ * chained to each other through the ->prev of their first node.  An
+ * exiting thread hands all of its cache to the depot, the remainder as
+ * one short batch.
+ *
+ * Build with -DDLIST_NO_NODE_CACHE to go straight to malloc/free.
+ */
+
+#ifndef DLIST_NO_NODE_CACHE
+
+/* Per-thread freelist */
+typedef struct dnode_tcache_s {
+    dnode_t *head;
+    int count;
+    int registered;
+} dnode_tcache_t;
+
+static __thread dnode_tcache_t tcache;
+
+/* Global depot of full batches */
+static pthread_mutex_t depot_lock = PTHREAD_MUTEX_INITIALIZER;
+static dnode_t *depot_head = NULL;
+static int depot_batches = 0;
+
+/* Used to flush a thread's cache when it exits */
+static pthread_key_t tcache_key;
+static pthread_once_t tcache_once = PTHREAD_ONCE_INIT;
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Internal API to free a chain of nodes linked through ->next
+ *
+ * @param node (i) first node of chain
+ * @return void
+ */
+static void
+_dnode_chain_free(dnode_t *node)
+{
+    dnode_t *next = NULL;
+
+    while (NULL != node) {
+        next = node->next;
+        free(node);
+        node = next;
+    }
+}
+
+/**
+ * Internal API to hand one batch from the head of the thread cache
+ * to the depot
+ *
+ * Algorithm: walk cnt nodes, cut the chain there, and push the cut-off
+ *            piece onto the depot.  If the depot is already full, give
+ *            the batch back to malloc instead
+ *
+ * @param tc  (i) thread cache to spill from
+ * @param cnt (i) nodes in the batch, DNODE_CACHE_BATCH but for the
+ *                last one of an exiting thread
+ * @return void
+ */
+static void
+_dnode_cache_spill(dnode_tcache_t *tc, int cnt)
+{
+    dnode_t *batch = tc->head;
+    dnode_t *last = batch;
+    int i = 0;
+
+    assert(cnt > 0 && tc->count >= cnt);
+
+    for (i = 1; i < cnt; i++) {
+        last = last->next;
+    }
+    tc->head = last->next;
+    tc->count -= cnt;
+    last->next = NULL;
+
+    pthread_mutex_lock(&depot_lock);
+    if (depot_batches < DNODE_DEPOT_MAX_BATCHES) {
+        batch->prev = depot_head;
+        depot_head = batch;
+        depot_batches++;
+        batch = NULL;
+    }
+    pthread_mutex_unlock(&depot_lock);
+
+    /* depot full, release outside the lock */
+    _dnode_chain_free(batch);
+}
+
+/**
+ * Thread-exit destructor: return the whole cache to the depot, the
+ * remainder past the full batches as a short one
+ *
+ * @param arg (i) exiting thread's cache
+ * @return void
+ */
+static void
+_dnode_cache_thread_exit(void *arg)
+{
+    dnode_tcache_t *tc = (dnode_tcache_t*)arg;
+
+    while (tc->count >= DNODE_CACHE_BATCH) {
+        _dnode_cache_spill(tc, DNODE_CACHE_BATCH);
+    }
+    if (tc->count > 0) {
+        _dnode_cache_spill(tc, tc->count);
+    }
+}
+
+/**
+ * One-time creation of the thread-exit key
+ *
+ * @return void
+ */
+static void
+_dnode_cache_key_init(void)
+{
+    pthread_key_create(&tcache_key, _dnode_cache_thread_exit);
+}
+
+/**
+ * Arrange for a thread's cache to be flushed when the thread exits
+ *
+ * Needed before the cache first holds nodes, whichever way they come:
+ * freed by the thread, or pulled from the depot by a thread that only
+ * allocates.
+ *
+ * @param tc (i) this thread's cache
+ * @return void
+ */
+static void
+_dnode_cache_register(dnode_tcache_t *tc)
+{
+    if (!tc->registered) {
+        pthread_once(&tcache_once, _dnode_cache_key_init);
+        pthread_setspecific(tcache_key, tc);
+        tc->registered = 1;
+    }
+}
+
+/**
+ * Internal API to refill an empty thread cache from the depot
+ *
+ * @param tc (i) thread cache to refill
+ * @return void
+ */
+static void
+_dnode_cache_refill(dnode_tcache_t *tc)
+{
+    dnode_t *batch = NULL;
+    dnode_t *node = NULL;
+
+    pthread_mutex_lock(&depot_lock);
+    if (NULL != depot_head) {
+        batch = depot_head;
+        depot_head = batch->prev;
+        depot_batches--;
+    }
+    pthread_mutex_unlock(&depot_lock);
+
+    if (NULL != batch) {
+        _dnode_cache_register(tc);
+        batch->prev = NULL;
+        tc->head = batch;
+        /* short batches come from exited threads */
+        for (node = batch; NULL != node; node = node->next) {
+            tc->count++;
+        }
+    }
+}
+
+/************************************
+ *    Internal APIs
+ ************************************/
+/**
+ * Get a node, from this thread's cache if possible
+ *
+ * Note - contents of the returned node are undefined
+ *
+ * @return dnode_t*
+ */
+dnode_t*
+_dnode_cache_get(void)
+{
+    dnode_tcache_t *tc = &tcache;
+    dnode_t *node = NULL;
+
+    if (NULL == tc->head) {
+        _dnode_cache_refill(tc);
+    }
+    if (NULL == tc->head) {
+        /* cache and depot both empty */
+        return (dnode_t*)malloc(sizeof(dnode_t));
+    }
+
+    node = tc->head;
+    tc->head = node->next;
+    tc->count--;
+    return node;
+}
+
+/**
+ * Return a node to this thread's cache
+ *
+ * @param node (i) node to recycle
+ * @return void
+ */
+void
+_dnode_cache_put(dnode_t *node)
+{
+    dnode_tcache_t *tc = &tcache;
+
+    assert(NULL != node);
+
+    _dnode_cache_register(tc);
+    node->next = tc->head;
+    tc->head = node;
+    tc->count++;
+
+    if (tc->count >= DNODE_CACHE_MAX) {
+        _dnode_cache_spill(tc, DNODE_CACHE_BATCH);
+    }
+}
+
+/**
+ * Number of batches waiting in the depot, for tests
+ *
+ * @return batch count
+ */
+int
+_dnode_cache_depot_count(void)
+{
+    int n = 0;
+
+    pthread_mutex_lock(&depot_lock);
+    n = depot_batches;
+    pthread_mutex_unlock(&depot_lock);
+    return n;
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Release cached dlist nodes back to malloc
+ *
+ * Frees the calling thread's cache and everything in the global depot.
+ * Other threads' private caches are left alone.
+ *
+ * @return void
+ */
+void
+dlist_cache_reclaim(void)
+{
+    dnode_tcache_t *tc = &tcache;
+    dnode_t *batch = NULL;
+    dnode_t *next = NULL;
+
+    _dnode_chain_free(tc->head);
+    tc->head = NULL;
+    tc->count = 0;
+
+    pthread_mutex_lock(&depot_lock);
+    batch = depot_head;
+    depot_head = NULL;
+    depot_batches = 0;
+    pthread_mutex_unlock(&depot_lock);
+
+    while (NULL != batch) {
+        next = batch->prev;
+        _dnode_chain_free(batch);
+        batch = next;
+    }
+}
+
+#else /* DLIST_NO_NODE_CACHE */
+
+dnode_t*
+_dnode_cache_get(void)
+{
+    return (dnode_t*)malloc(sizeof(dnode_t));
+}
+
+void
+_dnode_cache_put(dnode_t *node)
+{
+    assert(NULL != node);
+    free(node);
+}
+
+int
+_dnode_cache_depot_count(void)
+{
+    return 0;
+}
+
+void
+dlist_cache_reclaim(void)
+{
+    return;
+}
+
+#endif /* DLIST_NO_NODE_CACHE */
@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "test.h"
 #include "dlist_ext.h"
+#include "dnode_cache.h"
 #include "logger.h"
 
 /**
@@ -359,6 +361,112 @@ out:
     print_result(passed, test_name);
 }
 
+/** 
+ * Test9: churn enough nodes to cycle through the node cache and depot,
+ *        verify recycled nodes come back clean
+ */
+void 
+test9(const char *test_name) {
+    int passed = 1;
+    int arr[500];
+    int i = 0, round = 0;
+    int num_nodes = sizeof(arr)/sizeof(arr[0]);
+
+    DListPtr p = dlist_new(test_name);
+
+    for (i = 0; i < num_nodes; i++) {
+	arr[i] = i;
+    }
+
+    for (round = 0; round < 3; round++) {
+	/* head add all nodes, more than the per-thread cache holds */
+	for (i = 0; i < num_nodes; i++) {
+	    dlist_add_head(p, &arr[i]);
+	}
+	if (1 != _dlist_verify(p, num_nodes, arr[num_nodes-1], 0)) {
+	    FAIL_TEST;
+	}
+	if (1 != _dlist_verify(p, num_nodes, arr[0], num_nodes-1)) {
+	    FAIL_TEST;
+	}
+	/* delete them all, sending nodes back to the cache */
+	for (i = 0; i < num_nodes; i++) {
+	    dlist_del_tail(p);
+	}
+	if (1 != _dlist_verify(p, 0, 0, 0)) {
+	    FAIL_TEST;
+	}
+    }
+
+    /* recycled node must not carry stale links */
+    dlist_add_tail(p, &arr[7]);
+    dlist_add_tail(p, &arr[8]);
+    if (1 != _dlist_verify(p, 2, arr[8], 1)) {
+	FAIL_TEST;
+    }
+    if (NULL != dlist_get_pos(p, 2)) {
+	FAIL_TEST;
+    }
+
+    /* cleanup */
+    dlist_destroy(p);
+    dlist_cache_reclaim();
+out:
+    print_result(passed, test_name);
+}
+
+/**
+ * Producer thread for test10: only allocates nodes, never frees one
+ */
+static void*
+_t10_producer(void *arg)
+{
+    static int data[10];
+    int i = 0;
+
+    for (i = 0; i < 10; i++) {
+        dlist_add_tail((DListPtr)arg, &data[i]);
+    }
+    return NULL;
+}
+
+/** 
+ * Test10: a thread that only allocates pulls a batch from the depot;
+ *         what it has not used goes back to the depot when it exits
+ */
+void 
+test10(const char *test_name) {
+    int passed = 1;
+    int arr[300];
+    int i = 0, before = 0;
+    pthread_t producer;
+
+    DListPtr p = dlist_new(test_name);
+
+    /* fill the depot: more frees than this thread's cache holds */
+    dlist_cache_reclaim();
+    for (i = 0; i < 300; i++) {
+        dlist_add_head(p, &arr[i]);
+    }
+    for (i = 0; i < 300; i++) {
+        dlist_del_head(p);
+    }
+    before = _dnode_cache_depot_count();
+
+    pthread_create(&producer, NULL, _t10_producer, p);
+    pthread_join(producer, NULL);
+    if (10 != dlist_count(p) || before != _dnode_cache_depot_count()) {
+        logger(dbgErr, "Depot had %i batches, %i after the producer exited",
+                before, _dnode_cache_depot_count());
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    dlist_destroy(p);
+    dlist_cache_reclaim();
+    print_result(passed, test_name);
+}
+
 test_arr_t Tests[] = 
 {
     {"test1", test1},
@@ -368,7 +476,9 @@ test_arr_t Tests[] =
     {"test5", test5},
     {"test6", test6},
     {"test7", test7},
-    {"test8", test8}
+    {"test8", test8},
+    {"test9", test9},
+    {"test10", test10}
 };
 
 int
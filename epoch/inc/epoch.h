@@ -0,0 +1,21 @@
+#ifndef __EPOCH_H__
+#define __EPOCH_H__
+
+/*
+ * Epoch-based memory reclamation for lock-free readers
+ *
+ * Readers bracket every access to shared nodes with epoch_enter() and
+ * epoch_exit().  Writers unlink a node, publish the change, then hand the
+ * node to epoch_retire(); it is freed only once every reader that might
+ * still hold it has left its critical section.
+ *
+ * Critical sections nest and are per thread.  Never call epoch_barrier()
+ * from inside one.
+ */
+
+void epoch_enter(void);
+void epoch_exit(void);
+void epoch_retire(void *ptr, void (*free_fn)(void *ptr));
+void epoch_barrier(void);
+
+#endif /* __EPOCH_H__ */
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sched.h>
+#include <pthread.h>
+#include "epoch.h"
+
+/*
+ * Epoch-based reclamation
+ *
+ * A global epoch counter only moves from e to e+1 once every thread
+ * inside a critical section has announced e.  A node retired while the
+ * counter read e was already unlinked, so any reader that can still see
+ * it announced e or earlier; by the time the counter reaches e+2 all of
+ * those readers are gone and the node can be freed.
+ *
+ * Each thread owns a record on a global, append-only list holding its
+ * announced epoch and three limbo bags, one per epoch modulo 3.  Retiring
+ * into a bag last used three or more epochs ago empties it first.  Every
+ * EPOCH_ADVANCE_EVERY retires the thread tries to move the epoch along.
+ * When a thread exits, its unfreed bags move to a shared orphan bag and
+ * its record is left for the next new thread to adopt.
+ */
+
+#define EPOCH_BAGS          3
+#define EPOCH_ADVANCE_EVERY 64
+#define EPOCH_BAG_MIN       64
+
+typedef struct epoch_item_s {
+    void *ptr;
+    void (*free_fn)(void *ptr);
+} epoch_item_t;
+
+typedef struct epoch_bag_s {
+    unsigned long epoch;        /* newest epoch anything in here was retired in */
+    int len;
+    int cap;
+    epoch_item_t *items;
+} epoch_bag_t;
+
+typedef struct epoch_rec_s {
+    unsigned long state;        /* (epoch << 1) | 1 inside a section, else 0 */
+    int in_use;                 /* owned by a live thread */
+    int nest;
+    int retires;
+    epoch_bag_t bag[EPOCH_BAGS];
+    struct epoch_rec_s *next;
+} epoch_rec_t;
+
+static unsigned long global_epoch = EPOCH_BAGS;
+static epoch_rec_t *rec_head = NULL;
+static __thread epoch_rec_t *self = NULL;
+
+static pthread_mutex_t orphan_lock = PTHREAD_MUTEX_INITIALIZER;
+static epoch_bag_t orphans;
+
+/* Used to hand a thread's bags over when it exits */
+static pthread_key_t rec_key;
+static pthread_once_t rec_once = PTHREAD_ONCE_INIT;
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Internal API to free everything in a bag
+ *
+ * @param bag (i/o) bag to empty
+ * @return void
+ */
+static void
+_epoch_bag_free(epoch_bag_t *bag)
+{
+    int i = 0;
+
+    for (i = 0; i < bag->len; i++) {
+        bag->items[i].free_fn(bag->items[i].ptr);
+    }
+    bag->len = 0;
+}
+
+/**
+ * Internal API to append an item to a bag, growing it as needed
+ *
+ * @param bag     (i/o) bag
+ * @param ptr     (i) pointer to free later
+ * @param free_fn (i) function to free it with
+ * @return void
+ */
+static void
+_epoch_bag_push(epoch_bag_t *bag, void *ptr, void (*free_fn)(void *ptr))
+{
+    if (bag->len == bag->cap) {
+        bag->cap = bag->cap ? 2 * bag->cap : EPOCH_BAG_MIN;
+        bag->items = (epoch_item_t*)realloc(bag->items,
+                                            bag->cap * sizeof(*bag->items));
+        assert(NULL != bag->items);
+    }
+    bag->items[bag->len].ptr = ptr;
+    bag->items[bag->len].free_fn = free_fn;
+    bag->len++;
+}
+
+/**
+ * Thread-exit destructor, moves leftover bags to the orphan bag and
+ * releases the record for adoption
+ *
+ * @param arg (i) the exiting thread's record
+ * @return void
+ */
+static void
+_epoch_rec_release(void *arg)
+{
+    epoch_rec_t *rec = (epoch_rec_t*)arg;
+    int b = 0, i = 0;
+
+    pthread_mutex_lock(&orphan_lock);
+    for (b = 0; b < EPOCH_BAGS; b++) {
+        epoch_bag_t *bag = &rec->bag[b];
+        for (i = 0; i < bag->len; i++) {
+            _epoch_bag_push(&orphans, bag->items[i].ptr, bag->items[i].free_fn);
+        }
+        if (bag->len > 0 && bag->epoch > orphans.epoch) {
+            orphans.epoch = bag->epoch;
+        }
+        free(bag->items);
+        bag->items = NULL;
+        bag->len = bag->cap = 0;
+    }
+    pthread_mutex_unlock(&orphan_lock);
+
+    rec->nest = 0;
+    __atomic_store_n(&rec->state, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&rec->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * One-time setup of the thread-exit key
+ *
+ * @return void
+ */
+static void
+_epoch_key_init(void)
+{
+    int rc = pthread_key_create(&rec_key, _epoch_rec_release);
+    assert(0 == rc);
+}
+
+/**
+ * Internal API to get the calling thread's record, adopting a released
+ * one or registering a new one on first use
+ *
+ * @return this thread's record
+ */
+static epoch_rec_t*
+_epoch_self(void)
+{
+    epoch_rec_t *rec = NULL;
+
+    if (NULL != self) {
+        return self;
+    }
+    pthread_once(&rec_once, _epoch_key_init);
+
+    for (rec = __atomic_load_n(&rec_head, __ATOMIC_ACQUIRE); NULL != rec;
+         rec = rec->next) {
+        int free_rec = 0;
+        if (__atomic_compare_exchange_n(&rec->in_use, &free_rec, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (NULL == rec) {
+        rec = (epoch_rec_t*)calloc(1, sizeof(*rec));
+        assert(NULL != rec);
+        rec->in_use = 1;
+        rec->next = __atomic_load_n(&rec_head, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&rec_head, &rec->next, rec, 0,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+    pthread_setspecific(rec_key, rec);
+    self = rec;
+    return rec;
+}
+
+/**
+ * Internal API to move the global epoch on if every thread inside a
+ * critical section has caught up with it
+ *
+ * @return global epoch after the attempt
+ */
+static unsigned long
+_epoch_try_advance(void)
+{
+    unsigned long e = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    epoch_rec_t *rec = NULL;
+
+    for (rec = __atomic_load_n(&rec_head, __ATOMIC_ACQUIRE); NULL != rec;
+         rec = rec->next) {
+        unsigned long state = __atomic_load_n(&rec->state, __ATOMIC_SEQ_CST);
+        if ((state & 1) && (state >> 1) != e) {
+            return e;
+        }
+    }
+    __atomic_compare_exchange_n(&global_epoch, &e, e + 1, 0,
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Internal API to free every bag that is two epochs old at epoch e
+ *
+ * @param rec (i/o) this thread's record
+ * @param e   (i) current global epoch
+ * @return void
+ */
+static void
+_epoch_reclaim(epoch_rec_t *rec, unsigned long e)
+{
+    int b = 0;
+
+    for (b = 0; b < EPOCH_BAGS; b++) {
+        if (rec->bag[b].len > 0 && rec->bag[b].epoch + 2 <= e) {
+            _epoch_bag_free(&rec->bag[b]);
+        }
+    }
+    if (0 == pthread_mutex_trylock(&orphan_lock)) {
+        if (orphans.len > 0 && orphans.epoch + 2 <= e) {
+            _epoch_bag_free(&orphans);
+        }
+        pthread_mutex_unlock(&orphan_lock);
+    }
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Enter a read-side critical section
+ *
+ * Nodes reachable from a shared structure stay valid until the matching
+ * epoch_exit().  Sections nest.
+ *
+ * @return void
+ */
+void
+epoch_enter(void)
+{
+    epoch_rec_t *rec = _epoch_self();
+
+    if (0 == rec->nest++) {
+        unsigned long e = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&rec->state, (e << 1) | 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * Leave a read-side critical section
+ *
+ * @return void
+ */
+void
+epoch_exit(void)
+{
+    epoch_rec_t *rec = self;
+
+    assert(NULL != rec && rec->nest > 0);
+    if (0 == --rec->nest) {
+        __atomic_store_n(&rec->state, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Free ptr with free_fn once no reader can still hold it
+ *
+ * Call only after ptr has been unlinked and the unlink published.  May
+ * be called from inside a critical section.
+ *
+ * @param ptr     (i) pointer to free
+ * @param free_fn (i) function to free it with, e.g. free
+ * @return void
+ */
+void
+epoch_retire(void *ptr, void (*free_fn)(void *ptr))
+{
+    epoch_rec_t *rec = _epoch_self();
+    unsigned long e = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+    epoch_bag_t *bag = &rec->bag[e % EPOCH_BAGS];
+
+    if (bag->epoch != e) {
+        /* last used at e - 3 or earlier, long safe */
+        _epoch_bag_free(bag);
+        bag->epoch = e;
+    }
+    _epoch_bag_push(bag, ptr, free_fn);
+
+    if (0 == ++rec->retires % EPOCH_ADVANCE_EVERY) {
+        _epoch_reclaim(rec, _epoch_try_advance());
+    }
+}
+
+/**
+ * Wait for every critical section in progress to end, then free all
+ * that this thread (and any exited thread) has retired so far
+ *
+ * Used before teardown and at quiet points; must not be called from
+ * inside a critical section.
+ *
+ * @return void
+ */
+void
+epoch_barrier(void)
+{
+    epoch_rec_t *rec = _epoch_self();
+    unsigned long target = 0;
+    int b = 0;
+
+    assert(0 == rec->nest);
+    target = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST) + 2;
+    while (_epoch_try_advance() < target) {
+        sched_yield();
+    }
+    for (b = 0; b < EPOCH_BAGS; b++) {
+        _epoch_bag_free(&rec->bag[b]);
+    }
+    pthread_mutex_lock(&orphan_lock);
+    if (orphans.epoch + 2 <= __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST)) {
+        _epoch_bag_free(&orphans);
+    }
+    pthread_mutex_unlock(&orphan_lock);
+}
@@ -14,4 +14,7 @@ typedef enum logger_ {
 void
 logger(logger_e lvl, const char *fmt, ...);
 
+void
+logger_set_level(logger_e lvl);
+
 #endif /* __LOGGER_H__ */
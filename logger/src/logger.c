@@ -45,6 +45,11 @@ const char *log_str[] =
     "CRIT",
 };
 
+/**
+ * Minimum level that gets printed, anything below is dropped
+ */
+static logger_e log_level = dbgInfo;
+
 /**
  * Helper to get a log_str corresponding to a given log_lvl
  *
@@ -78,6 +83,11 @@ void
 logger(logger_e lvl, const char *fmt, ...)
 {
     va_list arglist;
+
+    /* drop anything below the configured level before formatting */
+    if (lvl < log_level) {
+        return;
+    }
     
     /* dump the timestamp */
     print_time_str();
@@ -94,3 +104,21 @@ logger(logger_e lvl, const char *fmt, ...)
     printf("\n");
 }
 
+
+/**
+ * Set the minimum level printed by logger()
+ *
+ * Messages below this level return before the timestamp is formatted,
+ * so benchmarks can silence dbgInfo tracing without rebuilding
+ *
+ * @param lvl (i) minimum log level to print
+ * @return void
+ */
+void
+logger_set_level(logger_e lvl)
+{
+    if (lvl > dbgMax) {
+        lvl = dbgMax;
+    }
+    log_level = lvl;
+}
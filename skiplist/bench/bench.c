@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "skiplist_ext.h"
+#include "bintree_ext.h"
+#include "logger.h"
+
+/*
+ * skiplist benchmark
+ *
+ * Usage: skiplist_bench [n]
+ *
+ * Mixed workloads (90/10, 50/50 and 0/100 search/update) on n keys drawn
+ * from [0, 2n), from 1 to 8 threads: the lock-free skip list against an
+ * AVL bintree behind one mutex.
+ */
+
+#define BENCH_OPS_PER_THREAD 300000
+#define BENCH_MAX_THREADS    8
+
+typedef struct bench_thr_s {
+    SkiplistPtr s;
+    BintreePtr b;
+    long range;
+    int update_pct;
+    unsigned int seed;
+    long hits;
+} bench_thr_t;
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double
+bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void*
+_bench_worker(void *arg)
+{
+    bench_thr_t *t = (bench_thr_t*)arg;
+    unsigned int seed = t->seed;
+    int i = 0;
+
+    for (i = 0; i < BENCH_OPS_PER_THREAD; i++) {
+        int k = (int)(((long)rand_r(&seed) << 15 ^ rand_r(&seed)) % t->range);
+        int op = rand_r(&seed) % 100;
+
+        if (NULL != t->s) {
+            if (op >= t->update_pct) {
+                t->hits += skiplist_search(t->s, k);
+            } else if (op & 1) {
+                t->hits += skiplist_insert(t->s, k);
+            } else {
+                t->hits += skiplist_remove(t->s, k);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&bench_mutex);
+        if (op >= t->update_pct) {
+            t->hits += bintree_search(t->b, k);
+        } else if (op & 1) {
+            /* same set semantics as the skip list */
+            if (!bintree_search(t->b, k)) {
+                bintree_insert(t->b, k);
+                t->hits++;
+            }
+        } else if (bintree_search(t->b, k)) {
+            bintree_remove(t->b, k);
+            t->hits++;
+        }
+        pthread_mutex_unlock(&bench_mutex);
+    }
+    return NULL;
+}
+
+static void
+_bench_run(const char *label, int use_skiplist, int update_pct, long n)
+{
+    pthread_t tids[BENCH_MAX_THREADS];
+    bench_thr_t thr[BENCH_MAX_THREADS];
+    int nthreads = 0, j = 0;
+    long i = 0;
+
+    for (nthreads = 1; nthreads <= BENCH_MAX_THREADS; nthreads *= 2) {
+        SkiplistPtr s = use_skiplist ? skiplist_create(label) : NULL;
+        BintreePtr b = use_skiplist ? NULL : bintree_create_mode(label, bintreeAvl);
+        unsigned int seed = 1;
+        long hits = 0;
+
+        for (i = 0; i < n; i++) {
+            int k = (int)(((long)rand_r(&seed) << 15 ^ rand_r(&seed)) % (2 * n));
+            if (use_skiplist) {
+                skiplist_insert(s, k);
+            } else if (!bintree_search(b, k)) {
+                bintree_insert(b, k);
+            }
+        }
+
+        double t0 = bench_now();
+        for (j = 0; j < nthreads; j++) {
+            thr[j].s = s;
+            thr[j].b = b;
+            thr[j].range = 2 * n;
+            thr[j].update_pct = update_pct;
+            thr[j].seed = 31 + j;
+            thr[j].hits = 0;
+            pthread_create(&tids[j], NULL, _bench_worker, &thr[j]);
+        }
+        for (j = 0; j < nthreads; j++) {
+            pthread_join(tids[j], NULL);
+            hits += thr[j].hits;
+        }
+        double t1 = bench_now();
+
+        printf("%-14s %3i%% upd  threads %i  %7.2f Mops/s  (hits %li)\n", label,
+               update_pct, nthreads,
+               (double)nthreads * BENCH_OPS_PER_THREAD / (t1 - t0) / 1e6, hits);
+        if (use_skiplist) {
+            skiplist_destroy(s);
+        } else {
+            bintree_destroy(b);
+        }
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    long n = (argc > 1) ? atol(argv[1]) : 1000000;
+    int mixes[] = {10, 50, 100};
+    int m = 0;
+
+    /* per-node tracing would dominate every measurement */
+    logger_set_level(dbgErr);
+
+    for (m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+        printf("=== n=%li, %i%% updates\n", n, mixes[m]);
+        _bench_run("skiplist", 1, mixes[m], n);
+        _bench_run("avl + mutex", 0, mixes[m], n);
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef __SKIPLIST_EXT_H__
+#define __SKIPLIST_EXT_H__
+
+typedef struct skiplist_s* SkiplistPtr;
+
+/*
+ * Lock-free ordered set of ints.  Every API except create/destroy may be
+ * called from any number of threads at once.
+ */
+
+/* Public APIs */
+SkiplistPtr skiplist_create(const char *name);
+void skiplist_destroy(SkiplistPtr listp);
+
+int  skiplist_insert(SkiplistPtr listp, int data);
+int  skiplist_remove(SkiplistPtr listp, int data);
+int  skiplist_search(SkiplistPtr listp, int data);
+int  skiplist_count(SkiplistPtr listp);
+int  skiplist_minvalue(SkiplistPtr listp);
+int  skiplist_maxvalue(SkiplistPtr listp);
+int  skiplist_range_foreach(SkiplistPtr listp, int lo, int hi,
+                            int (*fn)(int data, void *ctx), void *ctx);
+
+#endif /* __SKIPLIST_EXT_H__ */
@@ -0,0 +1,36 @@
+#ifndef __SKIPLIST_INT_H__
+#define __SKIPLIST_INT_H__
+
+#include <stdint.h>
+#include "skiplist_ext.h"
+
+#define SKIPLIST_MAGIC_IN_USE 0x1240
+#define SKIPLIST_MAGIC_FREED  0x1241
+
+#define SKIPLIST_MAX_NAME_LEN 80
+#define SKIPLIST_MAX_LEVEL    24       /* p = 1/2, plenty for 2^24+ keys */
+
+/*
+ * Internal node.  The low bit of next[i] marks the node as deleted at
+ * level i; a marked link is never changed again.
+ */
+typedef struct sknode_s {
+    int data;
+    int height;                 /* levels this node is linked into */
+    int refs;                   /* inserter and remover still busy with it */
+    struct sknode_s *next[];
+} sknode_t;
+
+#define SK_MARKED(_p_)  ((uintptr_t)(_p_) & 1)
+#define SK_MARK(_p_)    ((sknode_t*)((uintptr_t)(_p_) | 1))
+#define SK_UNMARK(_p_)  ((sknode_t*)((uintptr_t)(_p_) & ~(uintptr_t)1))
+
+/* Public list */
+typedef struct skiplist_s {
+    int magic;
+    char name[SKIPLIST_MAX_NAME_LEN];
+    int count;
+    sknode_t *head;             /* sentinel, SKIPLIST_MAX_LEVEL levels */
+} skiplist_t;
+
+#endif /* __SKIPLIST_INT_H__ */
@@ -0,0 +1,578 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include "skiplist_ext.h"
+#include "skiplist_int.h"
+#include "epoch.h"
+#include "logger.h"
+
+/*
+ * Lock-free skip list (Herlihy/Shavit, after Fraser)
+ *
+ * A node is removed by first marking its links top-down, then level 0;
+ * whoever marks level 0 owns the removal.  Marked nodes are snipped out
+ * by any thread that walks past them.  Readers never write.
+ *
+ * Memory safety: every operation runs inside an epoch section, and a node
+ * is retired only once it is unreachable.  Both the inserter (still
+ * linking upper levels) and the remover may be the last to touch a node's
+ * links, so each holds a reference; whichever drops the last one has
+ * already made sure the node is unlinked at every level, and retires it.
+ *
+ * Operations on different keys are linearizable.  min/max and range scans
+ * are exact when the list is quiet and see a consistent mix of old and
+ * new keys otherwise.
+ */
+
+#define MAGIC_IN_USE_CHECK(_mag_) \
+    if (SKIPLIST_MAGIC_IN_USE != _mag_) { \
+        logger(dbgCrit, "Magic corrupted, expected %x, received %x", \
+                SKIPLIST_MAGIC_IN_USE, _mag_); \
+        goto out; \
+    } \
+
+static __thread unsigned int sk_seed = 0;
+
+/************************************
+ *    Static Helpers
+ ************************************/
+/**
+ * Atomic load of a (possibly marked) link
+ *
+ * @param node (i) node
+ * @param lvl  (i) level
+ * @return link value
+ */
+static inline sknode_t*
+_sk_next(sknode_t *node, int lvl)
+{
+    return __atomic_load_n(&node->next[lvl], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Compare-and-swap a link
+ *
+ * @param slot   (i/o) link to update
+ * @param expect (i) value it must still hold
+ * @param val    (i) new value
+ * @return 1 if swapped, 0 else
+ */
+static inline int
+_sk_cas(sknode_t **slot, sknode_t *expect, sknode_t *val)
+{
+    return __atomic_compare_exchange_n(slot, &expect, val, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Pick a node height, 1 + number of coin flips that came up heads
+ *
+ * @return height in 1..SKIPLIST_MAX_LEVEL
+ */
+static int
+_sk_random_height(void)
+{
+    unsigned int x = sk_seed;
+    int height = 0;
+
+    if (0 == x) {
+        x = (unsigned int)(uintptr_t)&sk_seed | 1;
+    }
+    /* xorshift32 */
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sk_seed = x;
+
+    height = 1 + __builtin_ctz(~x);
+    return (height > SKIPLIST_MAX_LEVEL) ? SKIPLIST_MAX_LEVEL : height;
+}
+
+/**
+ * Internal API to alloc and init a node
+ *
+ * @param data   (i) key
+ * @param height (i) number of levels
+ * @return sknode_t*
+ */
+static sknode_t*
+_sk_node_alloc(int data, int height)
+{
+    sknode_t *node = (sknode_t*)malloc(sizeof(*node) + height * sizeof(node->next[0]));
+    assert(NULL != node);
+
+    node->data = data;
+    node->height = height;
+    node->refs = 2;
+    memset(node->next, 0, height * sizeof(node->next[0]));
+    return node;
+}
+
+/**
+ * Drop one of a node's two references, retiring it on the last one
+ *
+ * @param node (i) node
+ * @return void
+ */
+static void
+_sk_release(sknode_t *node)
+{
+    if (0 == __atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL)) {
+        epoch_retire(node, free);
+    }
+}
+
+/**
+ * Find, at every level, the last node with key < data and the node
+ * after it, snipping out marked nodes on the way
+ *
+ * @param listp (i) list
+ * @param data  (i) key
+ * @param preds (o) per-level predecessor
+ * @param succs (o) per-level successor (first key >= data), may be NULL
+ * @return 1 if succs[0] holds data, 0 else
+ */
+static int
+_sk_find(skiplist_t *listp, int data, sknode_t **preds, sknode_t **succs)
+{
+    sknode_t *pred = NULL, *curr = NULL, *succ = NULL;
+    int lvl = 0;
+
+retry:
+    pred = listp->head;
+    for (lvl = SKIPLIST_MAX_LEVEL - 1; lvl >= 0; lvl--) {
+        curr = SK_UNMARK(_sk_next(pred, lvl));
+        while (NULL != curr) {
+            succ = _sk_next(curr, lvl);
+            if (SK_MARKED(succ)) {
+                if (!_sk_cas(&pred->next[lvl], curr, SK_UNMARK(succ))) {
+                    goto retry;
+                }
+                curr = SK_UNMARK(succ);
+                continue;
+            }
+            if (curr->data >= data) {
+                break;
+            }
+            pred = curr;
+            curr = SK_UNMARK(succ);
+        }
+        preds[lvl] = pred;
+        succs[lvl] = curr;
+    }
+    return (NULL != curr && curr->data == data);
+}
+
+/**
+ * Read-only descent to the first unmarked node with key >= data
+ *
+ * @param listp (i) list
+ * @param data  (i) key
+ * @return node, or NULL if every key is smaller
+ */
+static sknode_t*
+_sk_lower(skiplist_t *listp, int data)
+{
+    sknode_t *pred = listp->head, *curr = NULL, *succ = NULL;
+    int lvl = 0;
+
+    for (lvl = SKIPLIST_MAX_LEVEL - 1; lvl >= 0; lvl--) {
+        curr = SK_UNMARK(_sk_next(pred, lvl));
+        while (NULL != curr) {
+            succ = _sk_next(curr, lvl);
+            if (SK_MARKED(succ)) {
+                curr = SK_UNMARK(succ);
+                continue;
+            }
+            if (curr->data >= data) {
+                break;
+            }
+            pred = curr;
+            curr = SK_UNMARK(succ);
+        }
+    }
+    return curr;
+}
+
+/**
+ * Make sure a node marked at every level is linked at none
+ *
+ * Algorithm: _sk_find() snips the node wherever it directly follows the
+ *            level's predecessor.  Elsewhere it can only sit behind other
+ *            nodes with the same key, so walk those, snipping as we go.
+ *
+ * @param listp (i) list
+ * @param node  (i) node to unlink
+ * @return void
+ */
+static void
+_sk_unlink(skiplist_t *listp, sknode_t *node)
+{
+    sknode_t *preds[SKIPLIST_MAX_LEVEL];
+    sknode_t *succs[SKIPLIST_MAX_LEVEL];
+    int lvl = 0;
+
+again:
+    _sk_find(listp, node->data, preds, succs);
+    for (lvl = node->height - 1; lvl >= 0; lvl--) {
+        sknode_t *pred = preds[lvl];
+        sknode_t *curr = succs[lvl];
+        while (NULL != curr && curr != node && curr->data == node->data) {
+            sknode_t *succ = _sk_next(curr, lvl);
+            if (SK_MARKED(succ)) {
+                if (!_sk_cas(&pred->next[lvl], curr, SK_UNMARK(succ))) {
+                    goto again;
+                }
+                curr = SK_UNMARK(succ);
+                continue;
+            }
+            pred = curr;
+            curr = SK_UNMARK(succ);
+        }
+        if (curr == node &&
+            !_sk_cas(&pred->next[lvl], node, SK_UNMARK(_sk_next(node, lvl)))) {
+            goto again;
+        }
+    }
+}
+
+/**
+ * Link a new node into its upper levels, giving up once it is removed
+ *
+ * Algorithm: before each attempt point the node's own link at the
+ *            current successor (a CAS, so a remover's mark wins), then
+ *            CAS the predecessor over to it; on failure search again
+ *
+ * @param listp (i) list
+ * @param node  (i) node already linked at level 0
+ * @param preds (i/o) predecessors from the insert's search
+ * @param succs (i/o) successors from the insert's search
+ * @return void
+ */
+static void
+_sk_link_upper(skiplist_t *listp, sknode_t *node, sknode_t **preds,
+               sknode_t **succs)
+{
+    int lvl = 0;
+
+    for (lvl = 1; lvl < node->height; lvl++) {
+        while (1) {
+            sknode_t *old = _sk_next(node, lvl);
+            if (SK_MARKED(old) ||
+                (old != succs[lvl] && !_sk_cas(&node->next[lvl], old, succs[lvl]))) {
+                goto done;
+            }
+            if (_sk_cas(&preds[lvl]->next[lvl], succs[lvl], node)) {
+                break;
+            }
+            if (!_sk_find(listp, node->data, preds, succs) || succs[0] != node) {
+                goto done;
+            }
+        }
+    }
+done:
+    if (SK_MARKED(_sk_next(node, 0))) {
+        /* removed while we were linking, we may have relinked it */
+        _sk_unlink(listp, node);
+    }
+    _sk_release(node);
+}
+
+/************************************
+ *    Public APIs
+ ************************************/
+/**
+ * Create a new skip list
+ *
+ * Note - allocs mem for a new list, caller must call skiplist_destroy()
+ *
+ * @param name (i) name for skip list
+ * @return SkiplistPtr
+ */
+SkiplistPtr
+skiplist_create(const char *name)
+{
+    assert(NULL != name);
+
+    SkiplistPtr listp = (skiplist_t*)malloc(sizeof(*listp));
+    assert(NULL != listp);
+
+    listp->magic = SKIPLIST_MAGIC_IN_USE;
+    strncpy(listp->name, name, SKIPLIST_MAX_NAME_LEN - 1);
+    listp->name[SKIPLIST_MAX_NAME_LEN - 1] = '\0';
+    listp->count = 0;
+    listp->head = _sk_node_alloc(INT_MIN, SKIPLIST_MAX_LEVEL);
+    return listp;
+}
+
+/**
+ * Destroy a skip list
+ *
+ * No other thread may be using the list
+ *
+ * @param listp (i) ptr to skip list to destroy
+ * @return void
+ */
+void
+skiplist_destroy(SkiplistPtr listp)
+{
+    sknode_t *node = NULL, *next = NULL;
+
+    assert(NULL != listp);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    for (node = listp->head; NULL != node; node = next) {
+        next = SK_UNMARK(node->next[0]);
+        free(node);
+    }
+    /* flush nodes this thread retired */
+    epoch_barrier();
+
+    listp->magic = SKIPLIST_MAGIC_FREED;
+    free(listp);
+out:
+    return;
+}
+
+/**
+ * Insert a key
+ *
+ * @param listp (i) skip list
+ * @param data  (i) key to insert
+ * @return 1 if inserted, 0 if already present
+ */
+int
+skiplist_insert(SkiplistPtr listp, int data)
+{
+    sknode_t *preds[SKIPLIST_MAX_LEVEL];
+    sknode_t *succs[SKIPLIST_MAX_LEVEL];
+    sknode_t *node = NULL;
+    int inserted = 0;
+    int lvl = 0;
+
+    assert(NULL != listp);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    epoch_enter();
+    while (!_sk_find(listp, data, preds, succs)) {
+        if (NULL == node) {
+            node = _sk_node_alloc(data, _sk_random_height());
+        }
+        for (lvl = 0; lvl < node->height; lvl++) {
+            node->next[lvl] = succs[lvl];
+        }
+        if (_sk_cas(&preds[0]->next[0], succs[0], node)) {
+            inserted = 1;
+            break;
+        }
+    }
+    if (inserted) {
+        __atomic_add_fetch(&listp->count, 1, __ATOMIC_RELAXED);
+        _sk_link_upper(listp, node, preds, succs);
+    } else {
+        /* never published */
+        free(node);
+    }
+    epoch_exit();
+out:
+    return inserted;
+}
+
+/**
+ * Remove a key
+ *
+ * @param listp (i) skip list
+ * @param data  (i) key to remove
+ * @return 1 if removed, 0 if not present
+ */
+int
+skiplist_remove(SkiplistPtr listp, int data)
+{
+    sknode_t *preds[SKIPLIST_MAX_LEVEL];
+    sknode_t *succs[SKIPLIST_MAX_LEVEL];
+    sknode_t *node = NULL, *succ = NULL;
+    int removed = 0;
+    int lvl = 0;
+
+    assert(NULL != listp);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    epoch_enter();
+    if (!_sk_find(listp, data, preds, succs)) {
+        goto exit;
+    }
+    node = succs[0];
+    for (lvl = node->height - 1; lvl >= 1; lvl--) {
+        succ = _sk_next(node, lvl);
+        while (!SK_MARKED(succ) && !_sk_cas(&node->next[lvl], succ, SK_MARK(succ))) {
+            succ = _sk_next(node, lvl);
+        }
+    }
+    succ = _sk_next(node, 0);
+    while (!SK_MARKED(succ)) {
+        if (_sk_cas(&node->next[0], succ, SK_MARK(succ))) {
+            removed = 1;
+            break;
+        }
+        succ = _sk_next(node, 0);
+    }
+    if (removed) {
+        __atomic_sub_fetch(&listp->count, 1, __ATOMIC_RELAXED);
+        _sk_unlink(listp, node);
+        _sk_release(node);
+    }
+exit:
+    epoch_exit();
+out:
+    return removed;
+}
+
+/**
+ * Search for a key
+ *
+ * @param listp (i) skip list
+ * @param data  (i) key to search for
+ * @return 1 if found, 0 if not found
+ */
+int
+skiplist_search(SkiplistPtr listp, int data)
+{
+    sknode_t *node = NULL;
+    int found = 0;
+
+    assert(NULL != listp);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    epoch_enter();
+    node = _sk_lower(listp, data);
+    found = (NULL != node && node->data == data);
+    epoch_exit();
+out:
+    return found;
+}
+
+/**
+ * Return how many keys are in the skip list, in O(1)
+ *
+ * @param listp (i) skip list
+ * @return count of keys
+ */
+int
+skiplist_count(SkiplistPtr listp)
+{
+    int cnt = 0;
+
+    assert(NULL != listp);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    cnt = __atomic_load_n(&listp->count, __ATOMIC_RELAXED);
+out:
+    return cnt;
+}
+
+/**
+ * Find the smallest key
+ *
+ * @param listp (i) skip list
+ * @return minimum value, 0 if empty
+ */
+int
+skiplist_minvalue(SkiplistPtr listp)
+{
+    sknode_t *node = NULL;
+    int min = 0;
+
+    assert(NULL != listp);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    epoch_enter();
+    node = _sk_lower(listp, INT_MIN);
+    if (NULL != node) {
+        min = node->data;
+    }
+    epoch_exit();
+out:
+    return min;
+}
+
+/**
+ * Find the largest key
+ *
+ * Algorithm: run along each level to its end, stepping down from the
+ *            last node not deleted at that level
+ *
+ * @param listp (i) skip list
+ * @return maximum value, 0 if empty
+ */
+int
+skiplist_maxvalue(SkiplistPtr listp)
+{
+    sknode_t *pred = NULL, *curr = NULL, *succ = NULL;
+    int max = 0;
+    int lvl = 0;
+
+    assert(NULL != listp);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    epoch_enter();
+    pred = listp->head;
+    for (lvl = SKIPLIST_MAX_LEVEL - 1; lvl >= 0; lvl--) {
+        for (curr = SK_UNMARK(_sk_next(pred, lvl)); NULL != curr;
+             curr = SK_UNMARK(succ)) {
+            succ = _sk_next(curr, lvl);
+            if (!SK_MARKED(succ)) {
+                pred = curr;
+            }
+        }
+    }
+    if (pred != listp->head) {
+        max = pred->data;
+    }
+    epoch_exit();
+out:
+    return max;
+}
+
+/**
+ * Call fn for every key in [lo, hi], in ascending order
+ *
+ * fn returns 0 to keep going, anything else to stop after the current
+ * key.  fn runs inside the list's read section and must not call
+ * epoch_barrier().
+ *
+ * @param listp (i) skip list
+ * @param lo    (i) smallest key to visit
+ * @param hi    (i) largest key to visit
+ * @param fn    (i) callback, gets the key and ctx
+ * @param ctx   (i) opaque user context passed to fn
+ * @return number of keys passed to fn
+ */
+int
+skiplist_range_foreach(SkiplistPtr listp, int lo, int hi,
+                       int (*fn)(int data, void *ctx), void *ctx)
+{
+    sknode_t *node = NULL, *succ = NULL;
+    int visited = 0;
+
+    assert(NULL != listp);
+    assert(NULL != fn);
+    MAGIC_IN_USE_CHECK(listp->magic);
+
+    epoch_enter();
+    for (node = _sk_lower(listp, lo); NULL != node && node->data <= hi;
+         node = SK_UNMARK(succ)) {
+        succ = _sk_next(node, 0);
+        if (SK_MARKED(succ)) {
+            continue;
+        }
+        visited++;
+        if (0 != fn(node->data, ctx)) {
+            break;
+        }
+    }
+    epoch_exit();
+out:
+    return visited;
+}
@@ -0,0 +1,360 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "test.h"
+#include "skiplist_ext.h"
+#include "logger.h"
+
+/**
+ * Convenience macro to save a couple lines of code
+ */
+#define FAIL_TEST do { \
+        passed = 0; \
+        goto out; \
+    } while(0)
+
+/**
+ * Helper to print timestamped PASS or FAIL message
+ *
+ * @param result (i) result, 1 if passed, 0 if failed
+ * @param test_name (i) test name to log
+ * @return void
+ */
+static inline void 
+print_result(int result, const char* test_name) {
+    if (result) {
+        logger(dbgInfo, "*** TestID: %s PASSED", test_name);
+    } else {
+        logger(dbgInfo, "*** TestID: %s FAILED", test_name);
+    }
+}
+
+/**
+ * Range callback: append key to a bounded array, stop when full
+ */
+typedef struct range_ctx_s {
+    int *out;
+    int cnt;
+    int max;
+} range_ctx_t;
+
+static int
+_range_collect(int data, void *ctx)
+{
+    range_ctx_t *rc = (range_ctx_t*)ctx;
+    rc->out[rc->cnt++] = data;
+    return (rc->cnt == rc->max);
+}
+
+/**
+ * Helper to check a list against a reference membership array
+ *
+ * @param s      (i) list to check
+ * @param ref    (i) ref[k] = 1 if key k expected
+ * @param range  (i) keys are 0..range-1
+ * @return 1 if list matches, 0 else
+ */
+static int
+_skiplist_verify_ref(SkiplistPtr s, const char *ref, int range)
+{
+    int out[1000];
+    int k = 0, cnt = 0, min = -1, max = -1;
+    range_ctx_t rc = {out, 0, 1000};
+
+    for (k = 0; k < range; k++) {
+        if (ref[k] != skiplist_search(s, k)) {
+            logger(dbgErr, "Key %i: expected %i, search says %i", k, ref[k],
+                    skiplist_search(s, k));
+            return 0;
+        }
+        if (ref[k]) {
+            if (min < 0) {
+                min = k;
+            }
+            max = k;
+            out[cnt++] = k;
+        }
+    }
+    if (cnt != skiplist_count(s)) {
+        logger(dbgErr, "Expected %i keys, list has %i", cnt, skiplist_count(s));
+        return 0;
+    }
+    if (cnt > 0 && (min != skiplist_minvalue(s) || max != skiplist_maxvalue(s))) {
+        logger(dbgErr, "Expected min %i max %i, got %i %i", min, max,
+                skiplist_minvalue(s), skiplist_maxvalue(s));
+        return 0;
+    }
+    /* a full scan must give back exactly the keys, in order */
+    int expect[1000];
+    memcpy(expect, out, cnt * sizeof(int));
+    if (cnt != skiplist_range_foreach(s, INT_MIN, INT_MAX, _range_collect, &rc) ||
+        0 != memcmp(out, expect, cnt * sizeof(int))) {
+        logger(dbgErr, "Full range scan mismatch");
+        return 0;
+    }
+    return 1;
+}
+
+/** 
+ * Test1: empty list, verify count is 0 and lookups miss
+ */
+void 
+test1(const char *test_name) {
+    int passed = 1;
+
+    SkiplistPtr s = skiplist_create(test_name);
+
+    if (0 != skiplist_count(s) || skiplist_search(s, 0) ||
+        skiplist_remove(s, 0) || 0 != skiplist_minvalue(s) ||
+        0 != skiplist_maxvalue(s)) {
+        logger(dbgErr, "Empty list misbehaves");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    skiplist_destroy(s);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test2: insert a handful of keys including the int extremes, verify
+ *        set semantics, count, min and max
+ */
+void 
+test2(const char *test_name) {
+    int passed = 1;
+
+    int keys[] = {8, 3, 10, -1, 6, 14, INT_MAX, INT_MIN, 4, 7, 13};
+    int num_keys = sizeof(keys) / sizeof(keys[0]);
+    int i = 0;
+
+    SkiplistPtr s = skiplist_create(test_name);
+    for (i = 0; i < num_keys; i++) {
+        if (!skiplist_insert(s, keys[i])) {
+            FAIL_TEST;
+        }
+    }
+    /* second insert of a key is refused */
+    if (skiplist_insert(s, 6) || num_keys != skiplist_count(s)) {
+        logger(dbgErr, "Duplicate accepted or count %i wrong", skiplist_count(s));
+        FAIL_TEST;
+    }
+    for (i = 0; i < num_keys; i++) {
+        if (!skiplist_search(s, keys[i])) {
+            logger(dbgErr, "Key %i missing", keys[i]);
+            FAIL_TEST;
+        }
+    }
+    if (INT_MIN != skiplist_minvalue(s) || INT_MAX != skiplist_maxvalue(s) ||
+        skiplist_search(s, 5)) {
+        FAIL_TEST;
+    }
+    if (!skiplist_remove(s, INT_MIN) || !skiplist_remove(s, INT_MAX) ||
+        skiplist_remove(s, INT_MAX) || -1 != skiplist_minvalue(s) ||
+        14 != skiplist_maxvalue(s) || num_keys - 2 != skiplist_count(s)) {
+        logger(dbgErr, "Remove of extremes wrong");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    skiplist_destroy(s);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test3: random insert/remove mix checked against a reference array
+ */
+void 
+test3(const char *test_name) {
+    int passed = 1;
+
+    int range = 600;
+    char ref[600];
+    int i = 0;
+    unsigned int seed = 333;
+
+    SkiplistPtr s = skiplist_create(test_name);
+    memset(ref, 0, sizeof(ref));
+    for (i = 0; i < 30000; i++) {
+        int k = rand_r(&seed) % range;
+        if (rand_r(&seed) % 30000 > i) {
+            if (skiplist_insert(s, k) == ref[k]) {
+                logger(dbgErr, "Insert %i returned wrong status", k);
+                FAIL_TEST;
+            }
+            ref[k] = 1;
+        } else {
+            if (skiplist_remove(s, k) != ref[k]) {
+                logger(dbgErr, "Remove %i returned wrong status", k);
+                FAIL_TEST;
+            }
+            ref[k] = 0;
+        }
+        if (0 == i % 1000 && !_skiplist_verify_ref(s, ref, range)) {
+            logger(dbgErr, "Diverged at op %i", i);
+            FAIL_TEST;
+        }
+    }
+    goto out;
+out:
+    skiplist_destroy(s);
+    print_result(passed, test_name);
+}
+
+/** 
+ * Test4: range scans, including empty, inverted and early-stopped ones
+ */
+void 
+test4(const char *test_name) {
+    int passed = 1;
+
+    int out[100];
+    int i = 0;
+    range_ctx_t rc = {out, 0, 100};
+
+    SkiplistPtr s = skiplist_create(test_name);
+    for (i = 0; i < 100; i++) {
+        skiplist_insert(s, 3 * i);
+    }
+    /* [10, 40] holds 12, 15, ..., 39 */
+    if (10 != skiplist_range_foreach(s, 10, 40, _range_collect, &rc) ||
+        12 != out[0] || 39 != out[9]) {
+        FAIL_TEST;
+    }
+    rc.cnt = 0;
+    if (0 != skiplist_range_foreach(s, 40, 10, _range_collect, &rc) ||
+        0 != skiplist_range_foreach(s, 301, 400, _range_collect, &rc) ||
+        1 != skiplist_range_foreach(s, 297, 297, _range_collect, &rc)) {
+        FAIL_TEST;
+    }
+    rc.cnt = 0;
+    rc.max = 5;
+    if (5 != skiplist_range_foreach(s, 0, 1000, _range_collect, &rc) ||
+        12 != out[4]) {
+        logger(dbgErr, "Early stop wrong");
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    skiplist_destroy(s);
+    print_result(passed, test_name);
+}
+
+/* Shared state for test5's threads */
+#define T5_THREADS 4
+#define T5_RANGE   256
+
+typedef struct t5_ctx_s {
+    SkiplistPtr s;
+    int id;
+    int net;                    /* shared inserts minus shared removes */
+    int errors;                 /* wrong insert/remove status on own keys */
+    char own[T5_RANGE];         /* keys id, id + T5_THREADS, ... */
+} t5_ctx_t;
+
+/**
+ * Worker for test5: churn a private stripe of keys, tracking what should
+ * be left, while also churning keys shared with every other thread
+ */
+static void*
+_t5_worker(void *arg)
+{
+    t5_ctx_t *ctx = (t5_ctx_t*)arg;
+    unsigned int seed = 500 + ctx->id;
+    int i = 0;
+
+    for (i = 0; i < 100000; i++) {
+        int k = rand_r(&seed) % T5_RANGE;
+        int shared = -1 - k;
+        int key = k * T5_THREADS + ctx->id;
+
+        if (rand_r(&seed) % 2) {
+            if (skiplist_insert(ctx->s, key) == ctx->own[k]) {
+                ctx->errors++;
+            }
+            ctx->own[k] = 1;
+            ctx->net += skiplist_insert(ctx->s, shared);
+        } else {
+            if (skiplist_remove(ctx->s, key) != ctx->own[k]) {
+                ctx->errors++;
+            }
+            ctx->own[k] = 0;
+            ctx->net -= skiplist_remove(ctx->s, shared);
+        }
+    }
+    return NULL;
+}
+
+/** 
+ * Test5: threads hammer private and shared keys at once; private keys
+ *        must end exactly as each thread left them, shared inserts and
+ *        removes must balance out against the final count
+ */
+void 
+test5(const char *test_name) {
+    int passed = 1;
+
+    pthread_t tids[T5_THREADS];
+    t5_ctx_t *ctx = (t5_ctx_t*)calloc(T5_THREADS, sizeof(*ctx));
+    int t = 0, k = 0, shared_net = 0, shared_left = 0, own_left = 0;
+
+    SkiplistPtr s = skiplist_create(test_name);
+    for (t = 0; t < T5_THREADS; t++) {
+        ctx[t].s = s;
+        ctx[t].id = t;
+        pthread_create(&tids[t], NULL, _t5_worker, &ctx[t]);
+    }
+    for (t = 0; t < T5_THREADS; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    for (t = 0; t < T5_THREADS; t++) {
+        if (0 != ctx[t].errors) {
+            logger(dbgErr, "Thread %i saw a wrong insert/remove status", t);
+            FAIL_TEST;
+        }
+        shared_net += ctx[t].net;
+        for (k = 0; k < T5_RANGE; k++) {
+            if (ctx[t].own[k] != skiplist_search(s, k * T5_THREADS + t)) {
+                logger(dbgErr, "Thread %i key %i wrong", t, k * T5_THREADS + t);
+                FAIL_TEST;
+            }
+            own_left += ctx[t].own[k];
+        }
+    }
+    for (k = 0; k < T5_RANGE; k++) {
+        shared_left += skiplist_search(s, -1 - k);
+    }
+    if (shared_net != shared_left || own_left + shared_left != skiplist_count(s)) {
+        logger(dbgErr, "Shared net %i, left %i, count %i", shared_net,
+                shared_left, skiplist_count(s));
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    skiplist_destroy(s);
+    free(ctx);
+    print_result(passed, test_name);
+}
+
+test_arr_t Tests[] = 
+{
+    {"test1", test1},
+    {"test2", test2},
+    {"test3", test3},
+    {"test4", test4},
+    {"test5", test5},
+};
+
+int
+main(int argc, char *argv[])
+{
+    int i = 0;
+    for (i = 0; i < sizeof(Tests) / sizeof(Tests[0]); i++) {
+	logger(dbgInfo, "Running %s...", Tests[i].test_name);
+	Tests[i].test_fn(Tests[i].test_name);
+    }
+    return 0;
+}
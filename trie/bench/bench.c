@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "trie_ext.h"
+#include "logger.h"
+
+/*
+ * trie benchmark
+ *
+ * Usage: trie_bench [n] [wordfile]
+ *
+ * Loads n words (default 500000) into a trie with tracing off and
+ * reports insert, hit search and miss search throughput.  Words come
+ * from wordfile, one per line (lines that are not all a-z are skipped),
+ * or are generated: 3 to 12 letters drawn with English letter
+ * frequencies, so prefixes are shared about as much as in a real
+ * dictionary.  Hits are searched in shuffled order; misses are the
+ * words with their last letter changed.
+ *
+ * For comparison, the first BENCH_TRACED words are then loaded into a
+ * second trie with the stock trie_trace_print() hook, the per-letter
+ * output the trie used to produce unconditionally, with stdout sent to
+ * /dev/null so only the formatting and write cost is measured.
+ */
+
+#define BENCH_DEFAULT_N  500000
+#define BENCH_WORD_MAX   64
+#define BENCH_TRACED     50000
+
+/* letter weights, per mille, English text */
+static const int letter_freq[26] = {
+    82, 15, 28, 43, 127, 22, 20, 61, 70, 2, 8, 40, 24,
+    67, 75, 19, 1, 60, 63, 91, 28, 10, 24, 2, 20, 1
+};
+
+static double
+bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char
+bench_letter(unsigned int *seed)
+{
+    int r = rand_r(seed) % 1000;
+    int i = 0;
+
+    for (i = 0; i < 25 && r >= letter_freq[i]; i++) {
+        r -= letter_freq[i];
+    }
+    return 'a' + i;
+}
+
+/* n generated words, NUL-separated in one block, pointers in *words */
+static char*
+bench_words_gen(long n, char ***words)
+{
+    char *block = (char*)malloc(n * 13);
+    char *p = block;
+    unsigned int seed = 50;
+    long i = 0;
+    int len = 0, j = 0;
+
+    *words = (char**)malloc(n * sizeof(char*));
+    for (i = 0; i < n; i++) {
+        len = 3 + rand_r(&seed) % 10;
+        (*words)[i] = p;
+        for (j = 0; j < len; j++) {
+            *p++ = bench_letter(&seed);
+        }
+        *p++ = '\0';
+    }
+    return block;
+}
+
+/* up to n a-z words from path, as bench_words_gen(); count in *got */
+static char*
+bench_words_load(const char *path, long n, char ***words, long *got)
+{
+    FILE *fp = fopen(path, "r");
+    char line[BENCH_WORD_MAX + 2];
+    char *block = NULL, *p = NULL;
+    long i = 0;
+    size_t len = 0;
+
+    *got = 0;
+    if (NULL == fp) {
+        logger(dbgErr, "Cannot open '%s'", path);
+        return NULL;
+    }
+    block = p = (char*)malloc(n * (BENCH_WORD_MAX + 1));
+    *words = (char**)malloc(n * sizeof(char*));
+    while (i < n && NULL != fgets(line, sizeof(line), fp)) {
+        len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (0 == len || len != strspn(line, "abcdefghijklmnopqrstuvwxyz")) {
+            continue;
+        }
+        memcpy(p, line, len + 1);
+        (*words)[i++] = p;
+        p += len + 1;
+    }
+    fclose(fp);
+    *got = i;
+    return block;
+}
+
+static void
+bench_shuffle(char **words, long n, unsigned int seed)
+{
+    long i = 0;
+
+    for (i = n - 1; i > 0; i--) {
+        long j = ((long)rand_r(&seed) << 15 ^ rand_r(&seed)) % (i + 1);
+        char *tmp = words[i];
+        words[i] = words[j];
+        words[j] = tmp;
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    long n = (argc > 1) ? atol(argv[1]) : BENCH_DEFAULT_N;
+    long i = 0, hits = 0, misses = 0, chars = 0, traced = 0;
+    char **words = NULL, **probe = NULL, **miss = NULL;
+    char *block = NULL, *mblock = NULL;
+    double t0 = 0, t_ins = 0, t_hit = 0, t_miss = 0, t_traced = 0;
+    int out_fd = -1, null_fd = -1;
+    size_t len = 0;
+    TriePtr t = NULL;
+
+    if (argc > 2) {
+        block = bench_words_load(argv[2], n, &words, &n);
+    } else {
+        block = bench_words_gen(n, &words);
+    }
+    if (NULL == block || 0 == n) {
+        return 1;
+    }
+
+    probe = (char**)malloc(n * sizeof(char*));
+    miss = (char**)malloc(n * sizeof(char*));
+    mblock = (char*)malloc(n * (BENCH_WORD_MAX + 1));
+    for (i = 0; i < n; i++) {
+        len = strlen(words[i]);
+        chars += len;
+        probe[i] = words[i];
+        miss[i] = mblock + i * (BENCH_WORD_MAX + 1);
+        memcpy(miss[i], words[i], len + 1);
+        miss[i][len - 1] = ('z' == miss[i][len - 1]) ? 'q' : 'z';
+    }
+    bench_shuffle(probe, n, 7);
+
+    t = trie_create("bench");
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        trie_insert(t, words[i]);
+    }
+    t_ins = bench_now() - t0;
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        hits += trie_search(t, probe[i]);
+    }
+    t_hit = bench_now() - t0;
+    t0 = bench_now();
+    for (i = 0; i < n; i++) {
+        misses += !trie_search(t, miss[i]);
+    }
+    t_miss = bench_now() - t0;
+    trie_destroy(t);
+
+    /* the old always-on tracing, output discarded */
+    traced = (n < BENCH_TRACED) ? n : BENCH_TRACED;
+    t = trie_create("traced");
+    trie_set_trace(t, trie_trace_print, NULL);
+    fflush(stdout);
+    out_fd = dup(STDOUT_FILENO);
+    null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    t0 = bench_now();
+    for (i = 0; i < traced; i++) {
+        trie_insert(t, words[i]);
+    }
+    fflush(stdout);
+    t_traced = bench_now() - t0;
+    dup2(out_fd, STDOUT_FILENO);
+    close(null_fd);
+    close(out_fd);
+    trie_destroy(t);
+
+    printf("%li words, %.1f letters avg (%s)\n", n, (double)chars / n,
+           (argc > 2) ? argv[2] : "generated");
+    printf("insert          %8.1f ns/word  %6.2f Mwords/s\n",
+           t_ins / n * 1e9, n / t_ins / 1e6);
+    printf("search hit      %8.1f ns/word  %6.2f Mwords/s  (%li found)\n",
+           t_hit / n * 1e9, n / t_hit / 1e6, hits);
+    printf("search miss     %8.1f ns/word  %6.2f Mwords/s  (%li missed)\n",
+           t_miss / n * 1e9, n / t_miss / 1e6, misses);
+    printf("insert traced   %8.1f ns/word  %6.2f Mwords/s  (first %li, "
+           "stdout to /dev/null)\n", t_traced / traced * 1e9,
+           traced / t_traced / 1e6, traced);
+
+    free(words);
+    free(probe);
+    free(miss);
+    free(block);
+    free(mblock);
+    return 0;
+}
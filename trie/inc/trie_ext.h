@@ -3,6 +3,23 @@
 
 typedef struct trie_s* TriePtr;
 
+/*
+ * Tracing: what trie_insert() and trie_search() report to a trie's trace
+ * hook, if it has one.  pos indexes the word's letter the event is
+ * about, -1 for events about the whole word.
+ */
+typedef enum trie_trace_ {
+    trieTraceAdd,       /* insert starting */
+    trieTraceNewNode,   /* no child for word[pos], node added */
+    trieTraceAdvance,   /* child for word[pos] found */
+    trieTraceAdded,     /* insert done */
+    trieTraceSearch,    /* search starting */
+    trieTraceMatch,     /* search matched word[pos] */
+    trieTraceMax
+} trie_trace_e;
+
+typedef void (*trie_trace_fn)(trie_trace_e ev, const char *word, int pos, void *ctx);
+
 /* Public APIs */
 TriePtr trie_create(const char *name);
 void trie_destroy(TriePtr trieptr);
@@ -10,6 +27,9 @@ void trie_destroy(TriePtr trieptr);
 void trie_insert(TriePtr trieptr, char *data);
 int  trie_search(TriePtr trieptr, char *data);
 
+void trie_set_trace(TriePtr trieptr, trie_trace_fn fn, void *ctx);
+void trie_trace_print(trie_trace_e ev, const char *word, int pos, void *ctx);
+
 // int trie_count(TriePtr trieptr);
 
 #endif /* __TRIE_EXT_H__ */
@@ -22,6 +22,8 @@ typedef struct trie_s {
     int magic;
     char name[TRIE_MAX_NAME_LEN];
     trienode_t *root;
+    trie_trace_fn trace;        /* NULL unless trie_set_trace() */
+    void *trace_ctx;
 } trie_t;
 
 #endif /* __TRIE_INT_H__ */
@@ -13,6 +13,13 @@
         goto out; \
     } \
 
+/* Report an event to the trie's trace hook; one test when there is none */
+#define TRIE_TRACE(_t_, _ev_, _word_, _pos_) do { \
+        if (NULL != (_t_)->trace) { \
+            (_t_)->trace(_ev_, _word_, _pos_, (_t_)->trace_ctx); \
+        } \
+    } while (0)
+
 int letter_to_idx(char c) {
     return c - 'a';
 }
@@ -104,6 +111,8 @@ trie_create(const char *name)
     tptr->magic = TRIE_MAGIC_IN_USE;
     strcpy(tptr->name, name);
     tptr->root = _trie_node_alloc();
+    tptr->trace = NULL;
+    tptr->trace_ctx = NULL;
 
     return tptr;
 }
@@ -136,6 +145,8 @@ out:
  *            advance to child node
  *            once done with all letters, mark the final node as a leaf and bump the matches
  *
+ * Silent unless the trie has a trace hook, see trie_set_trace()
+ *
  * @param tptr (i) trie to add to
  * @param data (i) word to add
  */
@@ -146,22 +157,21 @@ trie_insert(TriePtr tptr, char *data)
     assert(NULL != data);
     MAGIC_IN_USE_CHECK(tptr->magic);
 
-    logger(dbgInfo, "Adding word: '%s'", data);
     int i = 0, idx = 0;
-    int length = strlen(data);
     trienode_t *cur = tptr->root;
 
-    for (i = 0; i < length; i++) {
+    TRIE_TRACE(tptr, trieTraceAdd, data, -1);
+    for (i = 0; '\0' != data[i]; i++) {
         idx = letter_to_idx(data[i]);
         if (NULL == cur->children[idx]) {
-            printf("No child for '%c', adding new node\n", data[i]);
+            TRIE_TRACE(tptr, trieTraceNewNode, data, i);
             cur->children[idx] = _trie_node_alloc();
         } else { 
-            printf("Child letter '%c' found, advancing to it\n", idx_to_letter(idx));
+            TRIE_TRACE(tptr, trieTraceAdvance, data, i);
         }
         cur = cur->children[idx];
     }
-    printf("finished adding '%s'\n", data);
+    TRIE_TRACE(tptr, trieTraceAdded, data, -1);
 
     /* at end of word - need to set leaf to true and bump matches */
     cur->is_leaf = TRUE;
@@ -180,6 +190,8 @@ out:
  *             if !NULL -> walk down to this child and repeat
  *             once we've hit all the letters, simply check to see if cur node is a leaf
  *
+ * Silent unless the trie has a trace hook, see trie_set_trace()
+ *
  * @param tptr (i) trie to search
  * @param data (i) word to search for 
  * @return void
@@ -192,19 +204,77 @@ trie_search(TriePtr tptr, char *data)
     assert(NULL != tptr);
     MAGIC_IN_USE_CHECK(tptr->magic);
 
-    logger(dbgInfo, "Searching for word: '%s'", data);
-
-    int length = strlen(data);
+    TRIE_TRACE(tptr, trieTraceSearch, data, -1);
     cur = tptr->root;
 
-    for (i = 0; i < length; i++) {
+    for (i = 0; '\0' != data[i]; i++) {
         idx = letter_to_idx(data[i]);
         if (NULL == cur->children[idx]) {
             return 0;  /* found a letter not present in trie, return 0 immediately */
         }
         cur = cur->children[idx];
-        printf("Matched on '%c'\n", data[i]);
+        TRIE_TRACE(tptr, trieTraceMatch, data, i);
     }
 out:
     return (NULL != cur && cur->is_leaf);
 }
+
+/**
+ * Set or clear a trie's trace hook
+ *
+ * Tracing is off by default, so inserts and searches cost no I/O; a
+ * hook gets every trie_trace_e event of every later insert and search.
+ *
+ * @param tptr (i/o) trie
+ * @param fn   (i) hook, NULL to turn tracing off
+ * @param ctx  (i) passed through to fn
+ * @return void
+ */
+void
+trie_set_trace(TriePtr tptr, trie_trace_fn fn, void *ctx)
+{
+    assert(NULL != tptr);
+    MAGIC_IN_USE_CHECK(tptr->magic);
+
+    tptr->trace = fn;
+    tptr->trace_ctx = ctx;
+out:
+    return;
+}
+
+/**
+ * Stock trace hook: logs each word and prints each letter step to stdout
+ *
+ * @param ev   (i) event
+ * @param word (i) word being inserted or searched for
+ * @param pos  (i) letter index, -1 for whole-word events
+ * @param ctx  (i) unused
+ * @return void
+ */
+void
+trie_trace_print(trie_trace_e ev, const char *word, int pos, void *ctx)
+{
+    switch (ev) {
+    case trieTraceAdd:
+        logger(dbgInfo, "Adding word: '%s'", word);
+        break;
+    case trieTraceNewNode:
+        printf("No child for '%c', adding new node\n", word[pos]);
+        break;
+    case trieTraceAdvance:
+        printf("Child letter '%c' found, advancing to it\n", word[pos]);
+        break;
+    case trieTraceAdded:
+        printf("finished adding '%s'\n", word);
+        break;
+    case trieTraceSearch:
+        logger(dbgInfo, "Searching for word: '%s'", word);
+        break;
+    case trieTraceMatch:
+        printf("Matched on '%c'\n", word[pos]);
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
@@ -87,10 +87,65 @@ out:
     print_result(passed, test_name);
 }
 
+/**
+ * Trace hook for test2: counts events by type
+ */
+static void
+_t2_count(trie_trace_e ev, const char *word, int pos, void *ctx)
+{
+    ((int*)ctx)[ev]++;
+}
+
+/** 
+ * Test2: tracing is off until a hook is set, the hook sees every letter
+ *        step, and clearing it turns tracing off again
+ */
+void 
+test2(const char *test_name) {
+    int passed = 1;
+    int cnt[trieTraceMax] = {0};
+    int i = 0;
+
+    TriePtr t = trie_create(test_name);
+
+    trie_insert(t, "ben");
+    trie_set_trace(t, _t2_count, cnt);
+    trie_insert(t, "benny");        /* 3 letters shared, 2 new */
+    trie_search(t, "benny");
+    trie_search(t, "bex");          /* misses at the third letter */
+    if (1 != cnt[trieTraceAdd] || 2 != cnt[trieTraceNewNode] ||
+        3 != cnt[trieTraceAdvance] || 1 != cnt[trieTraceAdded] ||
+        2 != cnt[trieTraceSearch] || 7 != cnt[trieTraceMatch]) {
+        logger(dbgErr, "Unexpected trace event counts");
+        FAIL_TEST;
+    }
+
+    trie_set_trace(t, NULL, NULL);
+    trie_insert(t, "tom");
+    if (!trie_search(t, "tom") || 1 != cnt[trieTraceAdd]) {
+        logger(dbgErr, "Trace hook still called after clearing it");
+        FAIL_TEST;
+    }
+
+    /* the stock hook keeps the old verbose output available */
+    trie_set_trace(t, trie_trace_print, NULL);
+    for (i = 0; i < sizeArr; i++) {
+        trie_insert(t, testArr[i]);
+    }
+    if (!trie_search(t, "afar")) {
+        FAIL_TEST;
+    }
+    goto out;
+out:
+    trie_destroy(t);
+    print_result(passed, test_name);
+}
+
 
 test_arr_t Tests[] = 
 {
     {"test1", test1},
+    {"test2", test2},
 };
 
 int